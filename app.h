@@ -41,6 +41,7 @@
 
 #include "cpu_core_map.h"
 #include "thread.h"
+#include "ccmp_defns.h"
 
 #ifndef APP_MAX_LINKS
 #define APP_MAX_LINKS                        16
@@ -87,7 +88,7 @@
 #endif
 
 #ifndef APP_MAX_THREADS
-#define APP_MAX_THREADS                      4
+#define APP_MAX_THREADS                      64
 #endif
 
 enum cdev_type {
@@ -223,6 +224,7 @@ struct app_link_params {
     uint32_t depth;    /* Valid only when IP is valid */
     struct ether_addr mac_addr; /* Read from HW / write from config file */
     uint32_t vlan_id;
+    uint64_t rss_hf;   /* RSS hash fields, only used when rss_qs is set */
     struct rte_eth_conf conf;
 };
 
@@ -246,6 +248,15 @@ struct app_pktq_hwq_out_params {
     struct rte_eth_txconf conf;
 };
 
+struct app_pktq_swq_params {
+    char *name;
+    uint32_t parsed;
+    uint32_t size;
+    uint32_t burst_read;
+    uint32_t burst_write;
+    uint32_t cpu_socket_id;
+};
+
 struct app_stat_params {
     uint64_t timer_period;
     uint32_t parsed;
@@ -262,11 +273,18 @@ struct app_pktq_tm_params {
     uint32_t burst_write;
 };
 
+/* no crypto device id set, as valid ids are < RTE_CRYPTO_MAX_DEVS */
+#define APP_CRYPTO_DEV_NONE                  0xFF
+
 struct app_crypto_params {
     enum cdev_type type;
     char cdev_type_string[32];
     uint64_t cryptodev_mask;
     uint16_t n_qp;
+    int async;
+    uint8_t spillover_dev;
+    uint32_t max_sessions;
+    enum ccmp_engine engine;
 };
 
 struct app_addr_params {
@@ -283,10 +301,28 @@ struct app_addr_params {
     char ap_config_file[100];
 };
 
+/*
+ * store capacities, the entries are allocated at startup on the socket
+ * of the packet processing threads (unless socket_id is set)
+ */
+#define APP_STORE_SOCKET_ANY                 0xFFFFFFFF
+
+struct app_store_params {
+    uint32_t vaps_max;
+    uint32_t stas_max;
+    uint32_t socket_id;
+    uint32_t ptk_rx_overlap_ms; /* old PTK kept for RX after a TX switch */
+    uint32_t sta_idle_timeout_s; /* idle stations deleted after, 0: never */
+};
+
 struct app_misc_params {
     uint32_t uplink_pmd_us;
     uint32_t uplink_tls_us;
+    uint32_t tls_tx_drain_us;
     char preloaded_key_store[100];
+    char store_snapshot[100];
+    uint32_t store_snapshot_interval_s;
+    uint64_t store_snapshot_pn_margin;
     char certs_dir[100];
     char certs_password[100];
     uint32_t max_vap_frag_sz;
@@ -319,12 +355,14 @@ struct app_params {
     struct app_link_params         link_params[APP_MAX_LINKS];
     struct app_pktq_hwq_in_params  hwq_in_params[APP_MAX_HWQ_IN];
     struct app_pktq_hwq_out_params hwq_out_params[APP_MAX_HWQ_OUT];
+    struct app_pktq_swq_params     swq_params[APP_MAX_PKTQ_SWQ];
     struct app_thread_params       thread_params[APP_MAX_THREADS];
     struct app_pktq_tm_params      tm_params;
     struct app_stat_params         stat_params;
     struct app_addr_params         addr_params;
     struct app_misc_params         misc_params;
     struct app_crypto_params       crypto_params;
+    struct app_store_params        store_params;
     uint32_t n_mempools;
     uint32_t n_links;
     uint32_t n_pktq_hwq_in;
@@ -338,6 +376,7 @@ struct app_params {
     struct cpu_core_map *core_map;
     uint64_t core_mask[APP_CORE_MASK_SIZE];
     struct rte_mempool *mempool[APP_MAX_MEMPOOLS];
+    struct rte_ring *swq[APP_MAX_PKTQ_SWQ];
     struct app_link_data link_data[APP_MAX_LINKS];
     struct thread_type thread_type[APP_MAX_THREAD_TYPES];
     int eal_argc;
@@ -513,6 +552,106 @@ app_txq_get_writers(struct app_params *app, struct app_pktq_hwq_out_params *txq)
     return n_writers;
 }
 
+static inline uint32_t
+app_swq_get_readers(struct app_params *app, struct app_pktq_swq_params *swq)
+{
+    uint32_t pos = swq - app->swq_params;
+    uint32_t n_threads = RTE_MIN(app->n_threads, RTE_DIM(app->thread_params));
+    uint32_t n_readers = 0, i;
+
+    for (i = 0; i < n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+        uint32_t n_pktq_in = RTE_MIN(p->n_pktq_in, RTE_DIM(p->pktq_in));
+        uint32_t j;
+
+        for (j = 0; j < n_pktq_in; j++) {
+            struct app_pktq_in_params *pktq = &p->pktq_in[j];
+
+            if ((pktq->type == APP_PKTQ_IN_SWQ) && (pktq->id == pos))
+                n_readers++;
+        }
+    }
+
+    return n_readers;
+}
+
+static inline uint32_t
+app_swq_get_writers(struct app_params *app, struct app_pktq_swq_params *swq)
+{
+    uint32_t pos = swq - app->swq_params;
+    uint32_t n_threads = RTE_MIN(app->n_threads, RTE_DIM(app->thread_params));
+    uint32_t n_writers = 0, i;
+
+    for (i = 0; i < n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+        uint32_t n_pktq_out = RTE_MIN(p->n_pktq_out, RTE_DIM(p->pktq_out));
+        uint32_t j;
+
+        for (j = 0; j < n_pktq_out; j++) {
+            struct app_pktq_out_params *pktq = &p->pktq_out[j];
+
+            if ((pktq->type == APP_PKTQ_OUT_SWQ) && (pktq->id == pos))
+                n_writers++;
+        }
+    }
+
+    return n_writers;
+}
+
+/*
+ * get the thread writing to a SWQ
+ * - returns NULL if the SWQ has no writer
+ */
+static inline struct app_thread_params *
+app_swq_get_writer(struct app_params *app, struct app_pktq_swq_params *swq)
+{
+    uint32_t pos = swq - app->swq_params;
+    uint32_t n_threads = RTE_MIN(app->n_threads, RTE_DIM(app->thread_params));
+    uint32_t i;
+
+    for (i = 0; i < n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+        uint32_t n_pktq_out = RTE_MIN(p->n_pktq_out, RTE_DIM(p->pktq_out));
+        uint32_t j;
+
+        for (j = 0; j < n_pktq_out; j++) {
+            struct app_pktq_out_params *pktq = &p->pktq_out[j];
+
+            if ((pktq->type == APP_PKTQ_OUT_SWQ) && (pktq->id == pos))
+                return p;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * get the thread reading from a SWQ
+ * - returns NULL if the SWQ has no reader
+ */
+static inline struct app_thread_params *
+app_swq_get_reader(struct app_params *app, struct app_pktq_swq_params *swq)
+{
+    uint32_t pos = swq - app->swq_params;
+    uint32_t n_threads = RTE_MIN(app->n_threads, RTE_DIM(app->thread_params));
+    uint32_t i;
+
+    for (i = 0; i < n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+        uint32_t n_pktq_in = RTE_MIN(p->n_pktq_in, RTE_DIM(p->pktq_in));
+        uint32_t j;
+
+        for (j = 0; j < n_pktq_in; j++) {
+            struct app_pktq_in_params *pktq = &p->pktq_in[j];
+
+            if ((pktq->type == APP_PKTQ_IN_SWQ) && (pktq->id == pos))
+                return p;
+        }
+    }
+
+    return NULL;
+}
+
 static inline uint32_t
 app_core_is_enabled(struct app_params *app, uint32_t lcore_id)
 {
@@ -38,6 +38,7 @@
 #include <rte_malloc.h>
 #include <rte_ether.h>
 #include <rte_cryptodev.h>
+#include <rte_prefetch.h>
 
 #include "app.h"
 #include "r-wpa_global_vars.h"
@@ -49,6 +50,8 @@
 #include "crypto.h"
 #include "ccmp_sa.h"
 #include "ccmp.h"
+#include "sess_cache.h"
+#include "ccmp_inline.h"
 
 /*
  * AAD Frame Control Mask
@@ -79,12 +82,21 @@
  */
 #define AAD_QC_MASK          0x000F
 
+/* engine encrypting and decrypting the bursts */
+static enum ccmp_engine ccmp_engine = CCMP_ENGINE_CRYPTODEV;
+
 static inline enum rwpa_status
 op_setup(struct rte_mbuf      *mbuf,
          struct rwpa_meta     *meta,
          enum ccmp_op          op,
          struct rte_crypto_op *cop);
 
+static inline void
+op_session_put(struct rte_crypto_op *cop);
+
+static inline void
+op_prefetch(struct rte_crypto_op *cop);
+
 static inline void
 counter_val_to_pn(counter_val_t  ctr_val,
                   uint8_t       *pn,
@@ -190,6 +202,27 @@ ccmp_nonce_generate(struct ieee80211_hdr *wifi_hdr,
     return RWPA_STS_OK;
 }
 
+enum rwpa_status
+gcmp_nonce_generate(struct ieee80211_hdr *wifi_hdr,
+                    counter_val_t         ctr_val,
+                    uint8_t              *nonce)
+{
+    /* check parameters */
+    if (unlikely(wifi_hdr == NULL ||
+                 nonce == NULL))
+        return RWPA_STS_ERR;
+
+    struct gcmp_nonce *nonce_p = (struct gcmp_nonce *)nonce;
+
+    /* Address 2, copy directly from 802.11 header */
+    ether_addr_copy(&(wifi_hdr->addr2), &(nonce_p->addr2));
+
+    /* PN */
+    counter_val_to_pn(ctr_val, nonce_p->pn, TRUE);
+
+    return RWPA_STS_OK;
+}
+
 enum rwpa_status
 ccmp_hdr_generate(counter_val_t  pn,
                   enum key_id    key_id,
@@ -216,13 +249,28 @@ ccmp_hdr_generate(counter_val_t  pn,
     return RWPA_STS_OK;
 }
 
+void
+ccmp_engine_set(enum ccmp_engine engine)
+{
+    ccmp_engine = engine;
+}
+
+int
+ccmp_gcmp_supported(void)
+{
+    if (ccmp_engine == CCMP_ENGINE_INLINE)
+        return ccmp_inline_gcmp_supported();
+
+    return crypto_gcm_supported();
+}
+
 uint16_t
-ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
-                   uint16_t          pkts_in_sz,
-                   struct rwpa_meta *meta[],
-                   enum ccmp_op      op,
-                   uint16_t          qp,
-                   uint8_t           success[])
+ccmp_burst_enqueue(struct rte_mbuf    *pkts_in[],
+                   uint16_t            pkts_in_sz,
+                   struct rwpa_meta   *meta[],
+                   enum ccmp_op        op,
+                   struct crypto_chan *chan,
+                   uint8_t             success[])
 {
     enum rwpa_status crypto_sts;
     struct rte_crypto_op *ops[MAX_PKT_BURST];
@@ -241,6 +289,10 @@ ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
 
     RWPA_CHECK_ARRAY_OFFSET(pkts_in_sz, MAX_PKT_BURST);
 
+    if (ccmp_engine == CCMP_ENGINE_INLINE)
+        return ccmp_inline_burst_enqueue(pkts_in, pkts_in_sz,
+                                         meta, op, success);
+
     /* allocate the crypto ops */
     crypto_sts = crypto_ops_alloc(pkts_in_sz, ops);
     if (unlikely(crypto_sts == RWPA_STS_ERR)) {
@@ -248,9 +300,19 @@ ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
         return 0;
     } 
 
-    /* setup the crypto ops */
+    /*
+     * setup the crypto ops
+     * - the op setup writes the op and the nonce and AAD after it, which
+     *   are prefetched PREFETCH_OFFSET ops ahead
+     */
+    for (i = 0; i < PREFETCH_OFFSET && i < pkts_in_sz; i++)
+        op_prefetch(ops[i]);
+
     nb_ops = 0;
     for (i = 0; i < pkts_in_sz; i++) {
+        if (i + PREFETCH_OFFSET < pkts_in_sz)
+            op_prefetch(ops[i + PREFETCH_OFFSET]);
+
         if (likely(op_setup(pkts_in[i], meta[i], op, ops[nb_ops]) == RWPA_STS_OK)) {
             success[i] = TRUE;
             ops_success[nb_ops++] = i;
@@ -260,7 +322,7 @@ ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
 
     /* enqueue the burst of crypto operations */
     if (likely(nb_ops > 0))
-        nb_enq = nb_enq_ret = crypto_burst_enqueue(ops, nb_ops, qp);
+        nb_enq = nb_enq_ret = crypto_burst_enqueue(ops, nb_ops, chan);
     else
         nb_enq = nb_enq_ret = 0;
 
@@ -268,6 +330,7 @@ ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
     if (unlikely(nb_enq < nb_ops)) {
         do {
             success[ops_success[nb_enq]] = FALSE;
+            op_session_put(ops[nb_enq]);
             rte_crypto_op_free(ops[nb_enq]);
         } while (++nb_enq < nb_ops);
     }
@@ -283,11 +346,12 @@ ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
 }
 
 uint16_t
-ccmp_burst_dequeue(struct rte_mbuf *pkts_out[],
-                   uint16_t         pkts_out_sz,
-                   uint16_t         qp,
-                   uint16_t        *nb_success,
-                   uint8_t          success[])
+ccmp_burst_dequeue(struct rte_mbuf    *pkts_out[],
+                   struct rwpa_meta    meta_out[],
+                   uint16_t            pkts_out_sz,
+                   struct crypto_chan *chan,
+                   uint16_t           *nb_success,
+                   uint8_t             success[])
 {
     struct rte_crypto_op *ops[MAX_PKT_BURST];
     uint16_t nb_deq, i;
@@ -303,9 +367,13 @@ ccmp_burst_dequeue(struct rte_mbuf *pkts_out[],
         return 0;
     }
 
+    if (ccmp_engine == CCMP_ENGINE_INLINE)
+        return ccmp_inline_burst_dequeue(pkts_out, meta_out, pkts_out_sz,
+                                         nb_success, success);
+
     /* dequeue the burst of crypto operations */
     if (likely(pkts_out_sz > 0))
-        nb_deq = *nb_success = crypto_burst_dequeue(ops, pkts_out_sz, qp);
+        nb_deq = *nb_success = crypto_burst_dequeue(ops, pkts_out_sz, chan);
     else
         nb_deq = *nb_success = 0;
 
@@ -316,6 +384,13 @@ ccmp_burst_dequeue(struct rte_mbuf *pkts_out[],
          */
         pkts_out[i] = ops[i]->sym->m_src;
 
+        /* return the meta info saved when the op was setup */
+        if (meta_out != NULL)
+            rte_memcpy(&meta_out[i],
+                       rte_crypto_op_ctod_offset(ops[i], struct rwpa_meta *,
+                                                 META_OFFSET),
+                       sizeof(struct rwpa_meta));
+
         if (likely(ops[i]->status == RTE_CRYPTO_OP_STATUS_SUCCESS))
             success[i] = TRUE;
         else {
@@ -323,6 +398,7 @@ ccmp_burst_dequeue(struct rte_mbuf *pkts_out[],
             (*nb_success)--;
         }
 
+        op_session_put(ops[i]);
         rte_crypto_op_free(ops[i]);
     }
 
@@ -387,15 +463,14 @@ ccmp_encap(struct rte_mbuf *mbuf,
                                 meta->wifi_hdr_sz);
     /* fill ccmp_hdr */
     if (unlikely(ccmp_hdr_generate(
-                     meta->counter, 0, ccmp_hdr) != RWPA_STS_OK)) {
+                     meta->counter, meta->key_id, ccmp_hdr) != RWPA_STS_OK)) {
         return RWPA_STS_ERR;
     } else {
         /*
          * append space to the end of the packet mbuf for
-         * CCMP MIC
-         * - MIC is half the length of the key
+         * CCMP/GCMP MIC
          */
-        if (unlikely(rte_pktmbuf_append(mbuf, (meta->sa->tk_len >> 1)) == NULL))
+        if (unlikely(rte_pktmbuf_append(mbuf, meta->sa->mic_len) == NULL))
             return RWPA_STS_ERR;
     }
 
@@ -440,7 +515,7 @@ ccmp_decap(struct rte_mbuf  *mbuf,
 
     if (unlikely((wifi_hdr_u8 = (uint8_t *)rte_pktmbuf_adj(
                                             mbuf, sizeof(struct ccmp_hdr))) == NULL ||
-                 rte_pktmbuf_trim(mbuf, (meta->sa->tk_len >> 1)) == -1))
+                 rte_pktmbuf_trim(mbuf, meta->sa->mic_len) == -1))
         return RWPA_STS_ERR;
 
     rte_memcpy(wifi_hdr_u8, wifi_hdr_u8_tmp, wifi_hdr_sz);
@@ -484,6 +559,13 @@ pn_to_counter_val(const uint8_t *pn)
     return ret;
 }
 
+static inline void
+op_prefetch(struct rte_crypto_op *cop)
+{
+    rte_prefetch0(cop);
+    rte_prefetch0(rte_crypto_op_ctod_offset(cop, uint8_t *, AAD_OFFSET));
+}
+
 static inline enum rwpa_status
 op_setup(struct rte_mbuf      *mbuf,
          struct rwpa_meta     *meta,
@@ -491,6 +573,8 @@ op_setup(struct rte_mbuf      *mbuf,
          struct rte_crypto_op *cop)
 {
     struct ieee80211_hdr *wifi_hdr;
+    struct sess_cache_entry *sess;
+    struct rwpa_meta *meta_op;
     uint8_t aad_len = 0;
     uint32_t data_offset;
     uint32_t data_length;
@@ -506,11 +590,12 @@ op_setup(struct rte_mbuf      *mbuf,
         return RWPA_STS_ERR;
 
     /*
-     * digest length is half the key length
+     * digest length is set by the SA's cipher
      * - CCMP-128 has 16 byte key and 8 byte MIC
      * - CCMP-256 has 32 byte key and 16 byte MIC
+     * - GCMP-128 and GCMP-256 have 16 byte MIC
      */
-    digest_length = meta->sa->tk_len >> 1;
+    digest_length = meta->sa->mic_len;
 
     /*
      * fill in the crypto op data
@@ -537,29 +622,42 @@ op_setup(struct rte_mbuf      *mbuf,
     cop->sym->aead.digest.phys_addr =
         rte_pktmbuf_mtophys_offset(mbuf, (data_offset + data_length));
 
-    /*
-     * Nonce (IV) is appended at the end of the crypto
-     * operation
-     * - 1 byte left too for cryptodev to write to, hence
-     *   the '+1' below
-     */
-    uint8_t *nonce = rte_crypto_op_ctod_offset(
-                         cop, uint8_t *, IV_OFFSET);
-    ccmp_nonce_generate(wifi_hdr, meta, meta->counter, nonce+1);
-
-    /* AAD is appended after the nonce */
+    /* AAD is appended after the nonce, and is the same for GCMP */
     uint8_t *aad = rte_crypto_op_ctod_offset(
                        cop, uint8_t *, AAD_OFFSET);
     ccmp_aad_generate(wifi_hdr, meta, aad, &aad_len);
 
-    /*
-     * the AAD is written 18 bytes after the actual aad
-     * pointer, which for us is the same as the pointer
-     * to the nonce
-     */
-    cop->sym->aead.aad.data = nonce;
-    cop->sym->aead.aad.phys_addr =
-        rte_crypto_op_ctophys_offset(cop, IV_OFFSET);
+    uint8_t *nonce = rte_crypto_op_ctod_offset(
+                         cop, uint8_t *, IV_OFFSET);
+
+    if (meta->sa->cipher == CCMP_CIPHER_GCMP) {
+        /*
+         * GCMP nonce (IV) is appended at the end of the crypto
+         * operation, and the AAD pointer is the AAD itself
+         */
+        gcmp_nonce_generate(wifi_hdr, meta->counter, nonce);
+
+        cop->sym->aead.aad.data = aad;
+        cop->sym->aead.aad.phys_addr =
+            rte_crypto_op_ctophys_offset(cop, AAD_OFFSET);
+    } else {
+        /*
+         * CCMP nonce (IV) is appended at the end of the crypto
+         * operation
+         * - 1 byte left too for cryptodev to write to, hence
+         *   the '+1' below
+         */
+        ccmp_nonce_generate(wifi_hdr, meta, meta->counter, nonce+1);
+
+        /*
+         * the AAD is written 18 bytes after the actual aad
+         * pointer, which for us is the same as the pointer
+         * to the nonce
+         */
+        cop->sym->aead.aad.data = nonce;
+        cop->sym->aead.aad.phys_addr =
+            rte_crypto_op_ctophys_offset(cop, IV_OFFSET);
+    }
 
     /* setup the source mbuf */
     cop->sym->m_src = mbuf;
@@ -567,16 +665,34 @@ op_setup(struct rte_mbuf      *mbuf,
     /*
      * select the correct crypto session from the SA
      * and attach to the operation
+     * - the session cache holds a reference to it until the
+     *   op is dequeued (or fails to be enqueued)
      */
-    struct rte_cryptodev_sym_session *session =
-                                ccmp_sa_session_select(meta->sa,
-                                                       op,
-                                                       aad_len);
+    sess = ccmp_sa_session_select(meta->sa, op, aad_len);
 
-    if (likely(session != NULL))
-        rte_crypto_op_attach_sym_session(cop, session);
+    if (likely(sess != NULL))
+        rte_crypto_op_attach_sym_session(cop, sess->session);
     else
         return RWPA_STS_ERR;
 
+    /*
+     * save the meta info after the AAD
+     * - it is returned with the packet when the op is dequeued, so
+     *   the op can complete after the packet's burst has been
+     *   processed
+     */
+    meta_op = rte_crypto_op_ctod_offset(cop, struct rwpa_meta *, META_OFFSET);
+    rte_memcpy(meta_op, meta, sizeof(struct rwpa_meta));
+    meta_op->sess = sess;
+
     return RWPA_STS_OK;
 }
+
+static inline void
+op_session_put(struct rte_crypto_op *cop)
+{
+    struct rwpa_meta *meta_op =
+        rte_crypto_op_ctod_offset(cop, struct rwpa_meta *, META_OFFSET);
+
+    sess_cache_put(meta_op->sess);
+}
@@ -36,8 +36,17 @@
 #ifndef __INCLUDE_CCMP_H__
 #define __INCLUDE_CCMP_H__
 
+/*
+ * max number of crypto ops a thread keeps in flight on its
+ * crypto qp when running in async mode
+ */
+#define CCMP_MAX_INFLIGHT_OPS   (4 * MAX_PKT_BURST)
+
+struct crypto_chan;
+
 /*
  * CCMP Header
+ * - the GCMP header has the same layout
  */
 struct ccmp_hdr {
     uint8_t         pn0;
@@ -95,6 +104,15 @@ struct ccmp_nonce {
     uint8_t           pn[CCMP_PN_LEN];
 } __attribute__((__packed__));
 
+/*
+ * GCMP Nonce
+ * - as the CCMP nonce, without the flags
+ */
+struct gcmp_nonce {
+    struct ether_addr addr2;
+    uint8_t           pn[CCMP_PN_LEN];
+} __attribute__((__packed__));
+
 enum rwpa_status
 ccmp_aad_generate(struct ieee80211_hdr *wifi_hdr,
                   struct rwpa_meta     *meta,
@@ -107,25 +125,45 @@ ccmp_nonce_generate(struct ieee80211_hdr *wifi_hdr,
                     counter_val_t         ctr_val,
                     uint8_t              *nonce);
 
+enum rwpa_status
+gcmp_nonce_generate(struct ieee80211_hdr *wifi_hdr,
+                    counter_val_t         ctr_val,
+                    uint8_t              *nonce);
+
 enum rwpa_status
 ccmp_hdr_generate(counter_val_t  ctr_val,
                   enum key_id    key_id,
                   uint8_t       *ccmp_hdr);
 
+/*
+ * Select the engine used by ccmp_burst_enqueue/dequeue
+ * - must be called before the pipelines start
+ */
+void
+ccmp_engine_set(enum ccmp_engine engine);
+
+/*
+ * Can the selected engine do GCMP
+ * - with cryptodevs, only if all the devices in use support AES-GCM
+ */
+int
+ccmp_gcmp_supported(void);
+
 uint16_t
-ccmp_burst_enqueue(struct rte_mbuf  *pkts_in[],
-                   uint16_t          pkts_in_sz,
-                   struct rwpa_meta *meta[],
-                   enum ccmp_op      op,
-                   uint16_t          qp,
-                   uint8_t           success[]);
+ccmp_burst_enqueue(struct rte_mbuf    *pkts_in[],
+                   uint16_t            pkts_in_sz,
+                   struct rwpa_meta   *meta[],
+                   enum ccmp_op        op,
+                   struct crypto_chan *chan,
+                   uint8_t             success[]);
 
 uint16_t
-ccmp_burst_dequeue(struct rte_mbuf *pkts_out[],
-                   uint16_t         pkts_out_sz,
-                   uint16_t         qp,
-                   uint16_t        *nb_deq_success,
-                   uint8_t          success[]);
+ccmp_burst_dequeue(struct rte_mbuf    *pkts_out[],
+                   struct rwpa_meta    meta_out[],
+                   uint16_t            pkts_out_sz,
+                   struct crypto_chan *chan,
+                   uint16_t           *nb_deq_success,
+                   uint8_t             success[]);
 
 enum rwpa_status
 ccmp_replay_detect(struct ccmp_hdr *hdr,
@@ -53,6 +53,22 @@
 #define CCMP_128_MIC_LEN (8)
 #define CCMP_256_MIC_LEN (16)
 
+/* GCMP Nonce length, and MIC length (GCMP-128 and GCMP-256) */
+#define GCMP_NONCE_LEN   (12)
+#define GCMP_MIC_LEN     (16)
+
+/*
+ * Cipher suites
+ * - GCMP uses the same header, PN and AAD as CCMP, so both are
+ *   handled by the CCMP module, with the nonce, MIC length and
+ *   AEAD algorithm chosen by the SA's cipher
+ */
+enum ccmp_cipher {
+    CCMP_CIPHER_CCMP = 0,
+    CCMP_CIPHER_GCMP,
+    CCMP_CIPHER_MAX,
+};
+
 /*
  * Operations
  * - Encrypt or Decrypt
@@ -63,4 +79,13 @@ enum ccmp_op {
     CCMP_OP_MAX,
 };
 
+/*
+ * Engines
+ * - cryptodev PMDs, or inline AES-NI on the calling lcore
+ */
+enum ccmp_engine {
+    CCMP_ENGINE_CRYPTODEV = 0,
+    CCMP_ENGINE_INLINE,
+};
+
 #endif // __INCLUDE_CCMP_DEFNS_H__
@@ -0,0 +1,810 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_branch_prediction.h>
+#include <rte_common.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_ether.h>
+
+#ifdef RTE_MACHINE_CPUFLAG_AES
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+/* GCMP needs carry-less multiply for GHASH, as well as AES-NI */
+#if defined(RTE_MACHINE_CPUFLAG_AES) && defined(RTE_MACHINE_CPUFLAG_PCLMULQDQ)
+#define INLINE_GCM
+#include <tmmintrin.h>
+#endif
+
+#include "app.h"
+#include "r-wpa_global_vars.h"
+#include "key.h"
+#include "counter.h"
+#include "seq_num.h"
+#include "meta.h"
+#include "ieee80211.h"
+#include "ccmp_sa.h"
+#include "ccmp.h"
+#include "ccmp_inline.h"
+
+#define AES_BLOCK_LEN            16
+
+/* CCM length field size (L), as the nonce is 13 bytes */
+#define CCM_L                    2
+
+/* blocks hashed and encrypted together by GCM */
+#define GCM_BLOCKS               CCMP_INLINE_GHASH_POWERS
+
+/*
+ * completions are queued per lcore, and the pipelines keep at most
+ * CCMP_MAX_INFLIGHT_OPS in flight plus a burst being enqueued
+ */
+#define INLINE_DONE_Q_SZ         (2 * CCMP_MAX_INFLIGHT_OPS)
+#define INLINE_DONE_Q_MASK       (INLINE_DONE_Q_SZ - 1)
+
+struct inline_done {
+    struct rte_mbuf *m;
+    struct rwpa_meta meta;
+    uint8_t success;
+};
+
+struct inline_done_q {
+    uint32_t head;
+    uint32_t tail;
+    struct inline_done done[INLINE_DONE_Q_SZ];
+} __rte_cache_aligned;
+
+static struct inline_done_q *done_q[RTE_MAX_LCORE];
+
+#ifdef RTE_MACHINE_CPUFLAG_AES
+
+static enum rwpa_status
+pkt_process(struct rte_mbuf  *m,
+            struct rwpa_meta *meta,
+            enum ccmp_op      op);
+
+#endif
+
+int
+ccmp_inline_supported(void)
+{
+#ifdef RTE_MACHINE_CPUFLAG_AES
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+int
+ccmp_inline_gcmp_supported(void)
+{
+#ifdef INLINE_GCM
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+void
+ccmp_inline_lcore_init(void)
+{
+    unsigned lcore_id = rte_lcore_id();
+
+    if (done_q[lcore_id] != NULL)
+        return;
+
+    done_q[lcore_id] = rte_zmalloc_socket("ccmp_inline_done_q",
+                                          sizeof(struct inline_done_q),
+                                          RTE_CACHE_LINE_SIZE,
+                                          rte_socket_id());
+
+    if (done_q[lcore_id] == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Error creating inline crypto queue on lcore %u, exiting\n",
+                 lcore_id);
+}
+
+void
+ccmp_inline_destroy(void)
+{
+    unsigned i;
+
+    for (i = 0; i < RTE_MAX_LCORE; i++) {
+        rte_free(done_q[i]);
+        done_q[i] = NULL;
+    }
+}
+
+uint16_t
+ccmp_inline_burst_enqueue(struct rte_mbuf  *pkts_in[],
+                          uint16_t          pkts_in_sz,
+                          struct rwpa_meta *meta[],
+                          enum ccmp_op      op,
+                          uint8_t           success[])
+{
+    struct inline_done_q *q = done_q[rte_lcore_id()];
+    struct inline_done *d;
+    uint16_t i, nb_enq = 0;
+
+    for (i = 0; i < pkts_in_sz; i++) {
+        /* no room left to queue the result */
+        if (unlikely(q->tail - q->head == INLINE_DONE_Q_SZ)) {
+            memset(&success[i], FALSE, pkts_in_sz - i);
+            break;
+        }
+
+        if (unlikely(pkts_in[i] == NULL ||
+                     meta[i] == NULL ||
+                     meta[i]->sa == NULL ||
+                     meta[i]->sa->tk_len == 0)) {
+            success[i] = FALSE;
+            continue;
+        }
+
+        d = &q->done[q->tail++ & INLINE_DONE_Q_MASK];
+        d->m = pkts_in[i];
+        rte_memcpy(&d->meta, meta[i], sizeof(struct rwpa_meta));
+
+#ifdef RTE_MACHINE_CPUFLAG_AES
+        d->success = (pkt_process(pkts_in[i], meta[i], op) == RWPA_STS_OK);
+#else
+        RTE_SET_USED(op);
+        d->success = FALSE;
+#endif
+
+        success[i] = TRUE;
+        nb_enq++;
+    }
+
+    return nb_enq;
+}
+
+uint16_t
+ccmp_inline_burst_dequeue(struct rte_mbuf  *pkts_out[],
+                          struct rwpa_meta *meta_out,
+                          uint16_t          pkts_out_sz,
+                          uint16_t         *nb_success,
+                          uint8_t           success[])
+{
+    struct inline_done_q *q = done_q[rte_lcore_id()];
+    struct inline_done *d;
+    uint16_t nb_deq = 0;
+
+    *nb_success = 0;
+
+    while (nb_deq < pkts_out_sz && q->head != q->tail) {
+        d = &q->done[q->head++ & INLINE_DONE_Q_MASK];
+
+        pkts_out[nb_deq] = d->m;
+        if (meta_out != NULL)
+            rte_memcpy(&meta_out[nb_deq], &d->meta, sizeof(struct rwpa_meta));
+
+        success[nb_deq] = d->success;
+        if (likely(d->success))
+            (*nb_success)++;
+
+        nb_deq++;
+    }
+
+    return nb_deq;
+}
+
+#ifdef RTE_MACHINE_CPUFLAG_AES
+
+/*
+ * AES key expansion, as in the Intel AES-NI white paper
+ */
+static inline __m128i
+aes128_key_assist(__m128i t1, __m128i t2)
+{
+    __m128i t3;
+
+    t2 = _mm_shuffle_epi32(t2, 0xff);
+    t3 = _mm_slli_si128(t1, 0x4);
+    t1 = _mm_xor_si128(t1, t3);
+    t3 = _mm_slli_si128(t3, 0x4);
+    t1 = _mm_xor_si128(t1, t3);
+    t3 = _mm_slli_si128(t3, 0x4);
+    t1 = _mm_xor_si128(t1, t3);
+
+    return _mm_xor_si128(t1, t2);
+}
+
+static inline __m128i
+aes256_key_assist_odd(__m128i t1, __m128i t3)
+{
+    __m128i t2, t4;
+
+    t4 = _mm_aeskeygenassist_si128(t1, 0x0);
+    t2 = _mm_shuffle_epi32(t4, 0xaa);
+    t4 = _mm_slli_si128(t3, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+
+    return _mm_xor_si128(t3, t2);
+}
+
+#define AES128_KEY_EXP(rk, i, rcon)                                            \
+    (rk)[i] = aes128_key_assist((rk)[(i) - 1],                                 \
+                  _mm_aeskeygenassist_si128((rk)[(i) - 1], rcon))
+
+#define AES256_KEY_EXP(rk, i, rcon)                                            \
+do {                                                                           \
+    (rk)[i] = aes128_key_assist((rk)[(i) - 2],                                 \
+                  _mm_aeskeygenassist_si128((rk)[(i) - 1], rcon));             \
+    if ((i) + 1 <= 14)                                                         \
+        (rk)[(i) + 1] = aes256_key_assist_odd((rk)[i], (rk)[(i) - 1]);         \
+} while (0)
+
+#ifdef INLINE_GCM
+static void
+ghash_key_init(struct ccmp_inline_key *key);
+#endif
+
+enum rwpa_status
+ccmp_inline_key_expand(const uint8_t          *tk,
+                       uint8_t                 tk_len,
+                       enum ccmp_cipher        cipher,
+                       struct ccmp_inline_key *key)
+{
+    __m128i *rk;
+
+    if (unlikely(tk == NULL || key == NULL))
+        return RWPA_STS_ERR;
+
+    rk = (__m128i *)key->rk;
+
+    if (tk_len == CCMP_128_KEY_LEN) {
+        rk[0] = _mm_loadu_si128((const __m128i *)tk);
+        AES128_KEY_EXP(rk, 1, 0x01);
+        AES128_KEY_EXP(rk, 2, 0x02);
+        AES128_KEY_EXP(rk, 3, 0x04);
+        AES128_KEY_EXP(rk, 4, 0x08);
+        AES128_KEY_EXP(rk, 5, 0x10);
+        AES128_KEY_EXP(rk, 6, 0x20);
+        AES128_KEY_EXP(rk, 7, 0x40);
+        AES128_KEY_EXP(rk, 8, 0x80);
+        AES128_KEY_EXP(rk, 9, 0x1b);
+        AES128_KEY_EXP(rk, 10, 0x36);
+        key->rounds = 10;
+    } else if (tk_len == CCMP_256_KEY_LEN) {
+        rk[0] = _mm_loadu_si128((const __m128i *)tk);
+        rk[1] = _mm_loadu_si128((const __m128i *)(tk + AES_BLOCK_LEN));
+        AES256_KEY_EXP(rk, 2, 0x01);
+        AES256_KEY_EXP(rk, 4, 0x02);
+        AES256_KEY_EXP(rk, 6, 0x04);
+        AES256_KEY_EXP(rk, 8, 0x08);
+        AES256_KEY_EXP(rk, 10, 0x10);
+        AES256_KEY_EXP(rk, 12, 0x20);
+        AES256_KEY_EXP(rk, 14, 0x40);
+        key->rounds = 14;
+    } else
+        return RWPA_STS_ERR;
+
+    if (cipher == CCMP_CIPHER_GCMP) {
+#ifdef INLINE_GCM
+        ghash_key_init(key);
+#else
+        return RWPA_STS_ERR;
+#endif
+    }
+
+    return RWPA_STS_OK;
+}
+
+static inline __m128i
+aes_enc(const __m128i *rk, uint8_t rounds, __m128i b)
+{
+    uint8_t r;
+
+    b = _mm_xor_si128(b, rk[0]);
+    for (r = 1; r < rounds; r++)
+        b = _mm_aesenc_si128(b, rk[r]);
+
+    return _mm_aesenclast_si128(b, rk[rounds]);
+}
+
+/*
+ * encrypt 2 independent blocks, interleaving the rounds so that the
+ * latency of one hides the other's
+ * - used to stitch the CBC-MAC of one block with the CTR keystream
+ *   of another
+ */
+static inline void
+aes_enc2(const __m128i *rk, uint8_t rounds, __m128i *a, __m128i *b)
+{
+    __m128i x = _mm_xor_si128(*a, rk[0]);
+    __m128i y = _mm_xor_si128(*b, rk[0]);
+    uint8_t r;
+
+    for (r = 1; r < rounds; r++) {
+        x = _mm_aesenc_si128(x, rk[r]);
+        y = _mm_aesenc_si128(y, rk[r]);
+    }
+
+    *a = _mm_aesenclast_si128(x, rk[rounds]);
+    *b = _mm_aesenclast_si128(y, rk[rounds]);
+}
+
+#ifdef INLINE_GCM
+/*
+ * encrypt GCM_BLOCKS independent blocks, interleaving the rounds
+ * - used for the GCM counter blocks
+ */
+static inline void
+aes_enc4(const __m128i *rk, uint8_t rounds, __m128i b[GCM_BLOCKS])
+{
+    __m128i x0 = _mm_xor_si128(b[0], rk[0]);
+    __m128i x1 = _mm_xor_si128(b[1], rk[0]);
+    __m128i x2 = _mm_xor_si128(b[2], rk[0]);
+    __m128i x3 = _mm_xor_si128(b[3], rk[0]);
+    uint8_t r;
+
+    for (r = 1; r < rounds; r++) {
+        x0 = _mm_aesenc_si128(x0, rk[r]);
+        x1 = _mm_aesenc_si128(x1, rk[r]);
+        x2 = _mm_aesenc_si128(x2, rk[r]);
+        x3 = _mm_aesenc_si128(x3, rk[r]);
+    }
+
+    b[0] = _mm_aesenclast_si128(x0, rk[rounds]);
+    b[1] = _mm_aesenclast_si128(x1, rk[rounds]);
+    b[2] = _mm_aesenclast_si128(x2, rk[rounds]);
+    b[3] = _mm_aesenclast_si128(x3, rk[rounds]);
+}
+#endif
+
+static inline __m128i
+block_load(const uint8_t *p, uint32_t len)
+{
+    uint8_t buf[AES_BLOCK_LEN];
+
+    if (likely(len == AES_BLOCK_LEN))
+        return _mm_loadu_si128((const __m128i *)p);
+
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, p, len);
+
+    return _mm_loadu_si128((const __m128i *)buf);
+}
+
+static inline void
+block_store(uint8_t *p, __m128i b, uint32_t len)
+{
+    uint8_t buf[AES_BLOCK_LEN];
+
+    if (likely(len == AES_BLOCK_LEN)) {
+        _mm_storeu_si128((__m128i *)p, b);
+        return;
+    }
+
+    _mm_storeu_si128((__m128i *)buf, b);
+    memcpy(p, buf, len);
+}
+
+/*
+ * CTR block A_i: flags (L - 1), nonce and the 2 byte counter
+ * - the counter is big endian, in the last 16 bit lane of A0
+ */
+static inline __m128i
+ctr_block(__m128i a0, uint16_t i)
+{
+    return _mm_insert_epi16(a0, (uint16_t)((i << 8) | (i >> 8)), 7);
+}
+
+/*
+ * CCM (RFC 3610) with a 13 byte nonce and 2 byte length field
+ * - the payload is encrypted/decrypted in place, and the MIC is
+ *   written (encrypt) or checked (decrypt) at mic
+ */
+static enum rwpa_status
+ccm_process(const struct ccmp_inline_key *key,
+            const uint8_t                *nonce,
+            const uint8_t                *aad,
+            uint8_t                       aad_len,
+            uint8_t                      *data,
+            uint32_t                      data_len,
+            uint8_t                      *mic,
+            uint8_t                       mic_len,
+            enum ccmp_op                  op)
+{
+    const __m128i *rk = (const __m128i *)key->rk;
+    uint8_t b0[AES_BLOCK_LEN], a0[AES_BLOCK_LEN];
+    uint8_t aad_blks[2 * AES_BLOCK_LEN];
+    uint8_t tag[AES_BLOCK_LEN];
+    __m128i x, s, a, k, p, p_prev = _mm_setzero_si128();
+    uint32_t off, len, aad_blks_len;
+    uint16_t i;
+    uint8_t diff = 0;
+
+    /* B0: flags (Adata, M' and L'), nonce and payload length */
+    b0[0] = 0x40 | (((mic_len - 2) / 2) << 3) | (CCM_L - 1);
+    memcpy(&b0[1], nonce, CCMP_NONCE_LEN);
+    b0[AES_BLOCK_LEN - 2] = (uint8_t)(data_len >> 8);
+    b0[AES_BLOCK_LEN - 1] = (uint8_t)data_len;
+
+    /* A0, whose keystream encrypts the MIC */
+    a0[0] = CCM_L - 1;
+    memcpy(&a0[1], nonce, CCMP_NONCE_LEN);
+    a0[AES_BLOCK_LEN - 2] = 0;
+    a0[AES_BLOCK_LEN - 1] = 0;
+
+    x = _mm_loadu_si128((const __m128i *)b0);
+    a = _mm_loadu_si128((const __m128i *)a0);
+    s = a;
+    aes_enc2(rk, key->rounds, &x, &s);
+
+    /* AAD, prefixed by its length and padded (at most 2 blocks) */
+    memset(aad_blks, 0, sizeof(aad_blks));
+    aad_blks[0] = 0;
+    aad_blks[1] = aad_len;
+    memcpy(&aad_blks[2], aad, aad_len);
+    aad_blks_len = RTE_ALIGN_CEIL(aad_len + 2, AES_BLOCK_LEN);
+
+    for (off = 0; off < aad_blks_len; off += AES_BLOCK_LEN)
+        x = aes_enc(rk, key->rounds,
+                    _mm_xor_si128(x, _mm_loadu_si128(
+                                         (const __m128i *)&aad_blks[off])));
+
+    /*
+     * payload, running the CBC-MAC and the CTR keystream together
+     * - encrypting, the MAC of block i is stitched with the keystream
+     *   of block i
+     * - decrypting, the plaintext is needed for the MAC, so the MAC of
+     *   block i - 1 is stitched with the keystream of block i
+     */
+    for (off = 0, i = 1; off < data_len; off += AES_BLOCK_LEN, i++) {
+        len = RTE_MIN(data_len - off, (uint32_t)AES_BLOCK_LEN);
+        k = ctr_block(a, i);
+
+        if (op == CCMP_OP_ENCRYPT) {
+            p = block_load(&data[off], len);
+            x = _mm_xor_si128(x, p);
+            aes_enc2(rk, key->rounds, &x, &k);
+            block_store(&data[off], _mm_xor_si128(p, k), len);
+        } else {
+            if (off > 0) {
+                x = _mm_xor_si128(x, p_prev);
+                aes_enc2(rk, key->rounds, &x, &k);
+            } else
+                k = aes_enc(rk, key->rounds, k);
+
+            p = _mm_xor_si128(block_load(&data[off], len), k);
+            block_store(&data[off], p, len);
+
+            /* the MAC is over the zero padded plaintext */
+            p_prev = block_load(&data[off], len);
+        }
+    }
+
+    if (op == CCMP_OP_DECRYPT && data_len > 0)
+        x = aes_enc(rk, key->rounds, _mm_xor_si128(x, p_prev));
+
+    _mm_storeu_si128((__m128i *)tag, _mm_xor_si128(x, s));
+
+    if (op == CCMP_OP_ENCRYPT) {
+        memcpy(mic, tag, mic_len);
+        return RWPA_STS_OK;
+    }
+
+    for (i = 0; i < mic_len; i++)
+        diff |= tag[i] ^ mic[i];
+
+    return diff == 0 ? RWPA_STS_OK : RWPA_STS_ERR;
+}
+
+#ifdef INLINE_GCM
+
+/*
+ * GHASH, as in the Intel carry-less multiplication white paper
+ * - field elements are kept byte reflected, so the blocks are byte
+ *   swapped on the way in and the hash on the way out
+ * - the multiplication is split from the reduction, so the products
+ *   of GCM_BLOCKS blocks by the powers of H are reduced once
+ */
+static inline __m128i
+bswap_128(__m128i b)
+{
+    return _mm_shuffle_epi8(b, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                            8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+static inline void
+gf_mul_wide(__m128i a, __m128i b, __m128i *lo, __m128i *hi)
+{
+    __m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i t1 = _mm_clmulepi64_si128(a, b, 0x10);
+    __m128i t2 = _mm_clmulepi64_si128(a, b, 0x01);
+    __m128i t3 = _mm_clmulepi64_si128(a, b, 0x11);
+
+    t1 = _mm_xor_si128(t1, t2);
+    *lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+    *hi = _mm_xor_si128(t3, _mm_srli_si128(t1, 8));
+}
+
+static inline __m128i
+gf_reduce(__m128i lo, __m128i hi)
+{
+    __m128i t1, t2, t3;
+
+    /* shift the 256 bit product left by 1, for the bit reflection */
+    t1 = _mm_srli_epi32(lo, 31);
+    t2 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t3 = _mm_srli_si128(t1, 12);
+    t2 = _mm_slli_si128(t2, 4);
+    t1 = _mm_slli_si128(t1, 4);
+    lo = _mm_or_si128(lo, t1);
+    hi = _mm_or_si128(hi, t2);
+    hi = _mm_or_si128(hi, t3);
+
+    /* reduce modulo x^128 + x^7 + x^2 + x + 1 */
+    t1 = _mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30));
+    t1 = _mm_xor_si128(t1, _mm_slli_epi32(lo, 25));
+    t2 = _mm_srli_si128(t1, 4);
+    lo = _mm_xor_si128(lo, _mm_slli_si128(t1, 12));
+
+    t3 = _mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2));
+    t3 = _mm_xor_si128(t3, _mm_srli_epi32(lo, 7));
+    t3 = _mm_xor_si128(t3, t2);
+    lo = _mm_xor_si128(lo, t3);
+
+    return _mm_xor_si128(hi, lo);
+}
+
+static inline __m128i
+gf_mul(__m128i a, __m128i b)
+{
+    __m128i lo, hi;
+
+    gf_mul_wide(a, b, &lo, &hi);
+
+    return gf_reduce(lo, hi);
+}
+
+/* H = E(K, 0), and its powers up to H^GCM_BLOCKS */
+static void
+ghash_key_init(struct ccmp_inline_key *key)
+{
+    __m128i *h = (__m128i *)key->h;
+    unsigned i;
+
+    h[0] = bswap_128(aes_enc((const __m128i *)key->rk, key->rounds,
+                             _mm_setzero_si128()));
+
+    for (i = 1; i < CCMP_INLINE_GHASH_POWERS; i++)
+        h[i] = gf_mul(h[i - 1], h[0]);
+}
+
+/* hash 1 block, b being byte swapped already */
+static inline __m128i
+ghash_1(const __m128i *h, __m128i x, __m128i b)
+{
+    return gf_mul(_mm_xor_si128(x, b), h[0]);
+}
+
+/* hash GCM_BLOCKS blocks, as they come in the packet */
+static inline __m128i
+ghash_4(const __m128i *h, __m128i x, const __m128i b[GCM_BLOCKS])
+{
+    __m128i lo, hi, l, m;
+
+    gf_mul_wide(_mm_xor_si128(x, bswap_128(b[0])), h[3], &lo, &hi);
+    gf_mul_wide(bswap_128(b[1]), h[2], &l, &m);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, m);
+    gf_mul_wide(bswap_128(b[2]), h[1], &l, &m);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, m);
+    gf_mul_wide(bswap_128(b[3]), h[0], &l, &m);
+    lo = _mm_xor_si128(lo, l);
+    hi = _mm_xor_si128(hi, m);
+
+    return gf_reduce(lo, hi);
+}
+
+/*
+ * GCM (NIST SP 800-38D) with a 12 byte nonce and 16 byte tag
+ * - the payload is encrypted/decrypted in place, and the MIC is
+ *   written (encrypt) or checked (decrypt) at mic
+ * - GCM_BLOCKS counter blocks are encrypted together, and the
+ *   ciphertext hashed with a single reduction
+ */
+static enum rwpa_status
+gcm_process(const struct ccmp_inline_key *key,
+            const uint8_t                *nonce,
+            const uint8_t                *aad,
+            uint8_t                       aad_len,
+            uint8_t                      *data,
+            uint32_t                      data_len,
+            uint8_t                      *mic,
+            enum ccmp_op                  op)
+{
+    const __m128i *rk = (const __m128i *)key->rk;
+    const __m128i *h = (const __m128i *)key->h;
+    uint8_t j0_b[AES_BLOCK_LEN], tag[AES_BLOCK_LEN];
+    __m128i j0, s, x = _mm_setzero_si128();
+    __m128i k[GCM_BLOCKS], c[GCM_BLOCKS];
+    uint32_t off, len;
+    uint16_t i, n;
+    uint8_t diff = 0;
+
+    /* J0: nonce and a 32 bit counter of 1 */
+    memcpy(j0_b, nonce, GCMP_NONCE_LEN);
+    j0_b[12] = 0;
+    j0_b[13] = 0;
+    j0_b[14] = 0;
+    j0_b[15] = 1;
+    j0 = _mm_loadu_si128((const __m128i *)j0_b);
+
+    /* keystream for the tag */
+    s = aes_enc(rk, key->rounds, j0);
+
+    /* AAD, zero padded (at most 2 blocks) */
+    for (off = 0; off < aad_len; off += AES_BLOCK_LEN) {
+        len = RTE_MIN((uint32_t)aad_len - off, (uint32_t)AES_BLOCK_LEN);
+        x = ghash_1(h, x, bswap_128(block_load(&aad[off], len)));
+    }
+
+    /*
+     * payload, GCM_BLOCKS at a time
+     * - the counter of payload block i is i + 2, and payloads are
+     *   short enough for it to fit the low 16 bits
+     */
+    for (off = 0, i = 2; off + GCM_BLOCKS * AES_BLOCK_LEN <= data_len;
+         off += GCM_BLOCKS * AES_BLOCK_LEN, i += GCM_BLOCKS) {
+        for (n = 0; n < GCM_BLOCKS; n++) {
+            k[n] = ctr_block(j0, i + n);
+            c[n] = _mm_loadu_si128((const __m128i *)
+                                       &data[off + n * AES_BLOCK_LEN]);
+        }
+
+        aes_enc4(rk, key->rounds, k);
+
+        for (n = 0; n < GCM_BLOCKS; n++) {
+            k[n] = _mm_xor_si128(c[n], k[n]);
+            _mm_storeu_si128((__m128i *)&data[off + n * AES_BLOCK_LEN], k[n]);
+        }
+
+        /* the hash is over the ciphertext */
+        x = ghash_4(h, x, op == CCMP_OP_ENCRYPT ? k : c);
+    }
+
+    for (; off < data_len; off += AES_BLOCK_LEN, i++) {
+        len = RTE_MIN(data_len - off, (uint32_t)AES_BLOCK_LEN);
+        k[0] = aes_enc(rk, key->rounds, ctr_block(j0, i));
+
+        if (op == CCMP_OP_DECRYPT)
+            x = ghash_1(h, x, bswap_128(block_load(&data[off], len)));
+
+        block_store(&data[off],
+                    _mm_xor_si128(block_load(&data[off], len), k[0]), len);
+
+        if (op == CCMP_OP_ENCRYPT)
+            x = ghash_1(h, x, bswap_128(block_load(&data[off], len)));
+    }
+
+    /* lengths of the AAD and ciphertext, in bits */
+    x = ghash_1(h, x, _mm_set_epi64x((uint64_t)aad_len * 8,
+                                     (uint64_t)data_len * 8));
+
+    _mm_storeu_si128((__m128i *)tag, _mm_xor_si128(bswap_128(x), s));
+
+    if (op == CCMP_OP_ENCRYPT) {
+        memcpy(mic, tag, GCMP_MIC_LEN);
+        return RWPA_STS_OK;
+    }
+
+    for (i = 0; i < GCMP_MIC_LEN; i++)
+        diff |= tag[i] ^ mic[i];
+
+    return diff == 0 ? RWPA_STS_OK : RWPA_STS_ERR;
+}
+
+#endif // INLINE_GCM
+
+/*
+ * process a packet laid out as for a cryptodev op (see op_setup() in
+ * ccmp.c): wifi header, CCMP header, data and space for the MIC
+ */
+static enum rwpa_status
+pkt_process(struct rte_mbuf  *m,
+            struct rwpa_meta *meta,
+            enum ccmp_op      op)
+{
+    struct ieee80211_hdr *wifi_hdr;
+    uint8_t nonce[CCMP_NONCE_LEN];
+    uint8_t aad[CCMP_AAD_MAX_LEN + 2];
+    uint8_t aad_len = 0;
+    uint8_t *data, *mic;
+    uint32_t data_offset, data_len, mic_len;
+
+    wifi_hdr = rte_pktmbuf_mtod(m, struct ieee80211_hdr *);
+    mic_len = meta->sa->mic_len;
+    data_offset = meta->wifi_hdr_sz + sizeof(struct ccmp_hdr);
+
+    if (unlikely(m->data_len < data_offset + mic_len))
+        return RWPA_STS_ERR;
+
+    ccmp_aad_generate(wifi_hdr, meta, aad, &aad_len);
+
+    if (unlikely(aad_len > CCMP_AAD_MAX_LEN))
+        return RWPA_STS_ERR;
+
+    data = rte_pktmbuf_mtod_offset(m, uint8_t *, data_offset);
+    data_len = m->data_len - data_offset - mic_len;
+    mic = rte_pktmbuf_mtod_offset(m, uint8_t *, m->data_len - mic_len);
+
+    if (meta->sa->cipher == CCMP_CIPHER_GCMP) {
+#ifdef INLINE_GCM
+        gcmp_nonce_generate(wifi_hdr, meta->counter, nonce);
+
+        return gcm_process(&meta->sa->cold->inline_key, nonce, aad, aad_len,
+                           data, data_len, mic, op);
+#else
+        return RWPA_STS_ERR;
+#endif
+    }
+
+    ccmp_nonce_generate(wifi_hdr, meta, meta->counter, nonce);
+
+    return ccm_process(&meta->sa->cold->inline_key, nonce, aad, aad_len,
+                       data, data_len, mic, (uint8_t)mic_len, op);
+}
+
+#else
+
+enum rwpa_status
+ccmp_inline_key_expand(__attribute__((unused)) const uint8_t          *tk,
+                       __attribute__((unused)) uint8_t                 tk_len,
+                       __attribute__((unused)) enum ccmp_cipher        cipher,
+                       __attribute__((unused)) struct ccmp_inline_key *key)
+{
+    return RWPA_STS_ERR;
+}
+
+#endif // RTE_MACHINE_CPUFLAG_AES
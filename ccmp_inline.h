@@ -0,0 +1,112 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#ifndef __INCLUDE_CCMP_INLINE_H__
+#define __INCLUDE_CCMP_INLINE_H__
+
+#include <rte_common.h>
+
+#include "ccmp_defns.h"
+
+/* AES-256 has 14 rounds, AES-128 has 10 */
+#define CCMP_INLINE_ROUNDS_MAX   14
+
+/* GHASH key powers precomputed for GCMP, to hash 4 blocks at a time */
+#define CCMP_INLINE_GHASH_POWERS 4
+
+/*
+ * AES key schedule, expanded once when the key is set so that each
+ * packet only has to run the rounds
+ * - for GCMP, also the GHASH key H and its powers, byte reflected
+ */
+struct ccmp_inline_key {
+    uint8_t rk[CCMP_INLINE_ROUNDS_MAX + 1][16] __rte_aligned(16);
+    uint8_t h[CCMP_INLINE_GHASH_POWERS][16] __rte_aligned(16);
+    uint8_t rounds;
+};
+
+struct rte_mbuf;
+struct rwpa_meta;
+
+/*
+ * Is the inline engine available
+ * - it needs AES-NI, so the application must be built for a CPU
+ *   with AES-NI (RTE_MACHINE_CPUFLAG_AES)
+ * - GCMP also needs PCLMULQDQ (RTE_MACHINE_CPUFLAG_PCLMULQDQ), see
+ *   ccmp_inline_gcmp_supported()
+ */
+int
+ccmp_inline_supported(void);
+
+/* Can the inline engine do GCMP */
+int
+ccmp_inline_gcmp_supported(void);
+
+enum rwpa_status
+ccmp_inline_key_expand(const uint8_t          *tk,
+                       uint8_t                 tk_len,
+                       enum ccmp_cipher        cipher,
+                       struct ccmp_inline_key *key);
+
+/*
+ * Create the completion queue for the calling lcore
+ * - must be called by each thread which uses the inline engine
+ */
+void
+ccmp_inline_lcore_init(void);
+
+void
+ccmp_inline_destroy(void);
+
+/*
+ * Encrypt/decrypt a burst in place, on the calling lcore
+ * - the results are queued, to be returned in order by
+ *   ccmp_inline_burst_dequeue() like ops from a cryptodev
+ */
+uint16_t
+ccmp_inline_burst_enqueue(struct rte_mbuf  *pkts_in[],
+                          uint16_t          pkts_in_sz,
+                          struct rwpa_meta *meta[],
+                          enum ccmp_op      op,
+                          uint8_t           success[]);
+
+uint16_t
+ccmp_inline_burst_dequeue(struct rte_mbuf  *pkts_out[],
+                          struct rwpa_meta *meta_out,
+                          uint16_t          pkts_out_sz,
+                          uint16_t         *nb_success,
+                          uint8_t           success[]);
+
+#endif // __INCLUDE_CCMP_INLINE_H__
@@ -33,6 +33,7 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#include <rte_atomic.h>
 #include <rte_branch_prediction.h>
 #include <rte_common.h>
 #include <rte_cryptodev.h>
@@ -42,6 +43,7 @@
 #include "key.h"
 #include "ccmp_sa.h"
 #include "crypto.h"
+#include "sess_cache.h"
 
 /*
  * AAD Lengths
@@ -59,7 +61,7 @@
 
 static enum rwpa_status
 xform_init(enum ccmp_op                 op,
-           uint8_t                     *tk,
+           struct ccmp_sa              *sa,
            uint8_t                      tk_len,
            uint8_t                      aad_len,
            struct rte_crypto_sym_xform *xform);
@@ -69,9 +71,10 @@ session_select(enum ccmp_op op,
                uint8_t      aad_len);
 
 enum rwpa_status
-ccmp_sa_init(const uint8_t  *tk,
-             const uint8_t   tk_len,
-             struct ccmp_sa *sa)
+ccmp_sa_init(const uint8_t    *tk,
+             const uint8_t     tk_len,
+             enum ccmp_cipher  cipher,
+             struct ccmp_sa   *sa)
 {
     enum ccmp_op ops[OPS_NUM_MAX] = {
                             CCMP_OP_ENCRYPT,
@@ -86,31 +89,62 @@ ccmp_sa_init(const uint8_t  *tk,
 
     /* check parameters */
     if (unlikely(tk == NULL ||
-                 sa == NULL))
+                 sa == NULL ||
+                 sa->cold == NULL ||
+                 cipher >= CCMP_CIPHER_MAX))
         return RWPA_STS_ERR;
 
-    /* check the key length is valid */
+    /*
+     * check the key length is valid
+     * - 16 bytes for CCMP-128/GCMP-128, 32 for CCMP-256/GCMP-256
+     */
     if (unlikely(!(tk_len == CCMP_128_KEY_LEN ||
                    tk_len == CCMP_256_KEY_LEN))) {
         RTE_LOG(DEBUG, RWPA_CCMP,
-                "Invalid key length %d for CCMP\n",
-                tk_len);
+                "Invalid key length %d for %s\n",
+                tk_len, cipher == CCMP_CIPHER_GCMP ? "GCMP" : "CCMP");
         return RWPA_STS_ERR;
     }
 
-    /* store the key */
-    rte_memcpy(sa->tk, tk, tk_len);
-    sa->tk_len = tk_len;
-
-    /* setup each of the crypto xforms and sessions */
+    /*
+     * store the key
+     * - tk_len is set last, as the data path reads the SA without
+     *   locking it and treats tk_len == 0 as no key
+     */
+    rte_memcpy(sa->cold->tk, tk, tk_len);
+
+    /*
+     * MIC length
+     * - CCMP MIC is half the key length
+     * - GCMP MIC is always 16 bytes
+     */
+    sa->cipher = (uint8_t)cipher;
+    sa->mic_len = (cipher == CCMP_CIPHER_GCMP ?
+                       GCMP_MIC_LEN : tk_len >> 1);
+
+    /* expand the key for the inline engine, if it is supported */
+    if (ccmp_inline_supported())
+        ccmp_inline_key_expand(sa->cold->tk, tk_len, cipher,
+                               &(sa->cold->inline_key));
+
+    /*
+     * setup each of the crypto xforms
+     * - the sessions are only created when first used, as a station
+     *   typically uses 1 or 2 of the AAD lengths in each direction,
+     *   and may be evicted and recreated by the session cache
+     */
     for (i = 0; i < OPS_NUM_MAX; i++) {
         for (j = 0; j < AAD_LENGTHS_NUM_MAX; j++) {
             sess_type = session_select(ops[i], aad_lens[j]);
-            xform_init(ops[i], sa->tk, sa->tk_len, aad_lens[j], &(sa->xform[sess_type]));
-            sa->session[sess_type] = crypto_session_alloc(&(sa->xform[sess_type]), ops[i]);
+            xform_init(ops[i], sa, tk_len, aad_lens[j],
+                       &(sa->cold->xform[sess_type]));
         }
     }
 
+    /* publish the key */
+    rte_smp_wmb();
+    sa->tk_len = tk_len;
+
     return RWPA_STS_OK;
 }
 
@@ -125,55 +159,65 @@ ccmp_sa_reset(struct ccmp_sa *sa)
 
     /* free each of the crypto sessions */
     for (i = 0; i < CCMP_SESSION_TYPE_MAX; i++) {
-        crypto_session_free(sa->session[i]);
+        sess_cache_release(&(sa->sess[i]));
     }
 
-    memset(sa, 0, sizeof(struct ccmp_sa));
+    /* clear the key, but keep the SA bound to its cold part */
+    if (sa->cold != NULL)
+        memset(sa->cold, 0, sizeof(struct ccmp_sa_cold));
+    sa->tk_len = 0;
+    sa->cipher = 0;
+    sa->mic_len = 0;
 }
 
-struct rte_cryptodev_sym_session *
+struct sess_cache_entry *
 ccmp_sa_session_select(struct ccmp_sa *sa,
                        enum ccmp_op    op,
                        uint8_t         aad_len)
 {
-    struct rte_cryptodev_sym_session *session;
     enum ccmp_sa_session_type type;
 
-    if (unlikely(sa == NULL))
+    /* check parameters, and that a key has been set */
+    if (unlikely(sa == NULL || sa->tk_len == 0))
         return NULL;
 
     type  = session_select(op, aad_len);
 
-    if (likely(type != CCMP_SESSION_TYPE_MAX))
-        session = sa->session[type];
-    else
-        session = NULL;
+    if (unlikely(type == CCMP_SESSION_TYPE_MAX))
+        return NULL;
 
-    return session;
+    return sess_cache_get(&(sa->sess[type]), &(sa->cold->xform[type]));
 }
 
 static enum rwpa_status
 xform_init(enum ccmp_op                 op,
-           uint8_t                     *tk,
+           struct ccmp_sa              *sa,
            uint8_t                      tk_len,
            uint8_t                      aad_len,
            struct rte_crypto_sym_xform *xform)
 {
     /* check parameters */
-    if (unlikely(tk == NULL ||
+    if (unlikely(sa == NULL ||
                  xform == NULL))
         return RWPA_STS_ERR;
 
     xform->aead.op = (op == CCMP_OP_ENCRYPT ?
                            RTE_CRYPTO_AEAD_OP_ENCRYPT :
                            RTE_CRYPTO_AEAD_OP_DECRYPT);
-    xform->aead.algo = RTE_CRYPTO_AEAD_AES_CCM;
-    xform->aead.digest_length = tk_len >> 1;
+    xform->aead.digest_length = sa->mic_len;
     xform->aead.aad_length = aad_len;
     xform->aead.key.length = tk_len;
-    xform->aead.key.data = tk;
+    xform->aead.key.data = sa->cold->tk;
     xform->aead.iv.offset = IV_OFFSET;
-    xform->aead.iv.length = CCMP_NONCE_LEN;
+
+    if (sa->cipher == CCMP_CIPHER_GCMP) {
+        xform->aead.algo = RTE_CRYPTO_AEAD_AES_GCM;
+        xform->aead.iv.length = GCMP_NONCE_LEN;
+    } else {
+        xform->aead.algo = RTE_CRYPTO_AEAD_AES_CCM;
+        xform->aead.iv.length = CCMP_NONCE_LEN;
+    }
+
     xform->type = RTE_CRYPTO_SYM_XFORM_AEAD;
     xform->next = NULL;
 
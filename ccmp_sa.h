@@ -39,6 +39,9 @@
 #include <rte_cryptodev.h>
 
 #include "ccmp_defns.h"
+#include "ccmp_inline.h"
+
+struct sess_cache_entry;
 
 /*
  * Session Types
@@ -60,30 +63,74 @@ enum ccmp_sa_session_type {
     CCMP_SESSION_TYPE_MAX,
 };
 
-#define CCMP_MAX_SESSIONS (NUM_STA_MAX * CCMP_SESSION_TYPE_MAX) +   \
-                          (NUM_VAP_MAX * CCMP_SESSION_TYPE_MAX * 2)
+/*
+ * sessions are created on first use, so each SA is expected to use
+ * a few of its CCMP_SESSION_TYPE_MAX sessions (e.g. 1 or 2 AAD lengths
+ * in each direction)
+ * - this is the default session budget, see [CRYPTO] max_sessions
+ */
+#ifndef CCMP_SA_SESSIONS_NUM_AVG
+#define CCMP_SA_SESSIONS_NUM_AVG 4
+#endif
+
+#define CCMP_MAX_SESSIONS(nb_vaps, nb_stas)                                    \
+    (((nb_stas) * CCMP_SA_SESSIONS_NUM_AVG) +                                  \
+     ((nb_vaps) * CCMP_SA_SESSIONS_NUM_AVG * 2))
 
 /*
- * CCMP SA
+ * CCMP SA, cold part
+ * - the key and the xforms the sessions are created from, only read
+ *   when the key is set and when a session is (re)created
+ * - the exception is the key schedule, which the inline engine reads
+ *   on each packet
  */
-struct ccmp_sa {
+struct ccmp_sa_cold {
     uint8_t tk[KEY_LEN_MAX];
-    uint8_t tk_len;
 
     struct rte_crypto_sym_xform xform[CCMP_SESSION_TYPE_MAX];
 
-    struct rte_cryptodev_sym_session *session[CCMP_SESSION_TYPE_MAX];
+    /* key schedule for the inline engine */
+    struct ccmp_inline_key inline_key;
+} __rte_cache_aligned;
+
+/*
+ * CCMP SA, hot part
+ * - what the data path reads on each packet, kept small so that it
+ *   shares its owner's cache lines
+ */
+struct ccmp_sa {
+    uint8_t tk_len;
+
+    /* CCMP or GCMP, and the MIC length which follows from it */
+    uint8_t cipher;
+    uint8_t mic_len;
+
+    struct ccmp_sa_cold *cold;
+
+    /* bound by the session cache, and NULL until used or once evicted */
+    struct sess_cache_entry *sess[CCMP_SESSION_TYPE_MAX];
 };
 
+/*
+ * bind the SA to its cold part, which must be done once before its
+ * key is first set
+ */
+static inline void
+ccmp_sa_bind(struct ccmp_sa *sa, struct ccmp_sa_cold *cold)
+{
+    sa->cold = cold;
+}
+
 enum rwpa_status
-ccmp_sa_init(const uint8_t  *tk,
-             const uint8_t   tk_len,
-             struct ccmp_sa *sa);
+ccmp_sa_init(const uint8_t    *tk,
+             const uint8_t     tk_len,
+             enum ccmp_cipher  cipher,
+             struct ccmp_sa   *sa);
 
 void
 ccmp_sa_reset(struct ccmp_sa *sa);
 
-struct rte_cryptodev_sym_session *
+struct sess_cache_entry *
 ccmp_sa_session_select(struct ccmp_sa *sa,
                        enum ccmp_op    op,
                        uint8_t         aad_len);
@@ -40,8 +40,10 @@
 #include <rte_cfgfile.h>
 #include <rte_string_fns.h>
 
+#include "r-wpa_global_vars.h"
 #include "app.h"
 #include "parser.h"
+#include "ccmp_inline.h"
 
 /**
  * Default config values
@@ -74,6 +76,7 @@ static const struct app_link_params link_params_default = {
     .ip = 0,
     .depth = 0,
     .mac_addr = { .addr_bytes={0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    .rss_hf = ETH_RSS_IP,
 
     .conf = {
         .link_speeds = 0,
@@ -146,11 +149,20 @@ static const struct app_pktq_hwq_out_params default_hwq_out_params = {
     }
 };
 
+static const struct app_pktq_swq_params default_swq_params = {
+    .parsed = 0,
+    .size = 1024,
+    .burst_read = 32,
+    .burst_write = 32,
+    .cpu_socket_id = 0,
+};
+
 struct app_thread_params default_thread_params = {
     .parsed = 0,
     .socket_id = 0,
     .core_id = 0,
     .hyper_th_id = 0,
+    .crypto_dev = APP_CRYPTO_DEV_NONE,
     .crypto_qp = 0,
     .n_args = 0,
 };
@@ -168,6 +180,10 @@ struct app_crypto_params default_crypto_params = {
     .cdev_type_string = "SW",
     .cryptodev_mask = 1,
     .n_qp = 2,
+    .async = 0,
+    .spillover_dev = APP_CRYPTO_DEV_NONE,
+    .max_sessions = 0,
+    .engine = CCMP_ENGINE_CRYPTODEV,
 };
 
 struct app_addr_params default_addr_params = {
@@ -184,10 +200,22 @@ struct app_addr_params default_addr_params = {
     .ap_config_file = "/tmp/ap.conf",
 };
 
+struct app_store_params default_store_params = {
+    .vaps_max = NUM_VAP_MAX,
+    .stas_max = NUM_STA_MAX,
+    .socket_id = APP_STORE_SOCKET_ANY,
+    .ptk_rx_overlap_ms = 1000,
+    .sta_idle_timeout_s = 0,
+};
+
 struct app_misc_params default_misc_params = {
     .uplink_pmd_us = 199,
     .uplink_tls_us = 1,
+    .tls_tx_drain_us = 50,
     .preloaded_key_store = "../config/stations.txt",
+    .store_snapshot = "",
+    .store_snapshot_interval_s = 0,
+    .store_snapshot_pn_margin = 0x1000000,
     .certs_dir = "../certs/",
     .certs_password = "MadCowBetaRelease",
     .max_vap_frag_sz = 1432,
@@ -775,6 +803,29 @@ parse_link_rss_qs(struct app_link_params *p, char *value)
     return 0;
 }
 
+/*
+ * RSS hash fields
+ * - ip:  outer IP addresses only, all the traffic of an AP tunnel is
+ *        received on the same RXQ
+ * - udp: outer IP addresses and UDP ports, for APs which encode a per
+ *        station value into the tunnel UDP source port
+ */
+static int
+parse_link_rss_hash(struct app_link_params *p, const char *value)
+{
+    if (strcmp(value, "ip") == 0) {
+        p->rss_hf = ETH_RSS_IP;
+        return 0;
+    }
+
+    if (strcmp(value, "udp") == 0) {
+        p->rss_hf = ETH_RSS_IP | ETH_RSS_UDP;
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
 static void
 parse_link(struct app_params *app, const char *section_name, struct rte_cfgfile *cfg)
 {
@@ -822,6 +873,13 @@ parse_link(struct app_params *app, const char *section_name, struct rte_cfgfile
             continue;
         }
 
+        if (strcmp(ent->name, "rss_hash") == 0) {
+            int status = parse_link_rss_hash(param, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
         /* unrecognized */
         PARSE_ERROR_INVALID(0, section_name, ent->name);
     }
@@ -948,6 +1006,64 @@ parse_txq(struct app_params *app, const char *section_name, struct rte_cfgfile *
     free(entries);
 }
 
+static void
+parse_swq(struct app_params *app, const char *section_name, struct rte_cfgfile *cfg)
+{
+    struct app_pktq_swq_params *param;
+    struct rte_cfgfile_entry *entries;
+    int n_entries, i;
+    ssize_t param_idx;
+
+    n_entries = rte_cfgfile_section_num_entries(cfg, section_name);
+    PARSE_ERROR_SECTION_NO_ENTRIES((n_entries > 0), section_name);
+
+    entries = malloc(n_entries * sizeof(struct rte_cfgfile_entry));
+    PARSE_ERROR_MALLOC(entries != NULL);
+
+    rte_cfgfile_section_entries(cfg, section_name, entries, n_entries);
+
+    param_idx = APP_PARAM_ADD(app->swq_params, section_name);
+    param = &app->swq_params[param_idx];
+    PARSE_CHECK_DUPLICATE_SECTION(param);
+
+    for (i = 0; i < n_entries; i++) {
+        struct rte_cfgfile_entry *ent = &entries[i];
+
+        if (strcmp(ent->name, "size") == 0) {
+            int status = parser_read_uint32(&param->size, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "burst_read") == 0) {
+            int status = parser_read_uint32(&param->burst_read, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "burst_write") == 0) {
+            int status = parser_read_uint32(&param->burst_write, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "cpu") == 0) {
+            int status = parser_read_uint32(&param->cpu_socket_id, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        /* unrecognized */
+        PARSE_ERROR_INVALID(0, section_name, ent->name);
+    }
+
+    free(entries);
+}
+
 static void
 parse_stat(struct app_params *app, const char *section_name, struct rte_cfgfile *cfg)
 {
@@ -1030,6 +1146,10 @@ parse_pipeline_pktq_in(struct app_params *app, struct app_thread_params *p, char
             id = APP_PARAM_ADD(app->hwq_in_params, name);
             APP_PARAM_ADD_LINK_FOR_RXQ(app, name);
         }
+        else if (validate_name(name, "SWQ", 1) == 0) {
+            type = APP_PKTQ_IN_SWQ;
+            id = APP_PARAM_ADD(app->swq_params, name);
+        }
         else
             PARSE_ERROR_INVALID_ELEMENT(0, p->name, "pktq_in", name);
 
@@ -1063,6 +1183,9 @@ parse_pipeline_pktq_out(struct app_params *app,
             type = APP_PKTQ_OUT_HWQ;
             id = APP_PARAM_ADD(app->hwq_out_params, name);
             APP_PARAM_ADD_LINK_FOR_TXQ(app, name);
+        } else if (validate_name(name, "SWQ", 1) == 0) {
+            type = APP_PKTQ_OUT_SWQ;
+            id = APP_PARAM_ADD(app->swq_params, name);
         } else {
             PARSE_ERROR_INVALID_ELEMENT(0, p->name, "pktq_out", name);
         }
@@ -1122,6 +1245,13 @@ parse_thread(struct app_params *app, const char *section_name, struct rte_cfgfil
             continue;
         }
 
+        if (strcmp(ent->name, "crypto_dev") == 0) {
+            int status = parser_read_uint8(&param->crypto_dev, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
         if (strcmp(ent->name, "crypto_qp") == 0) {
             int status = parser_read_uint16(&param->crypto_qp, ent->value);
 
@@ -1279,6 +1409,13 @@ parse_miscellaneous(struct app_params *app,
             continue;
         }
 
+        if (strcmp(ent->name, "tls_tx_drain_us") == 0) {
+            int status = parser_read_uint32(&param->tls_tx_drain_us, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
         if (strcmp(ent->name, "preload_key_store") == 0) {
             int status = parse_string(ent->value, param->preloaded_key_store);
 
@@ -1286,6 +1423,29 @@ parse_miscellaneous(struct app_params *app,
             continue;
         }
 
+        if (strcmp(ent->name, "store_snapshot") == 0) {
+            int status = parse_string(ent->value, param->store_snapshot);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "store_snapshot_interval_s") == 0) {
+            int status = parser_read_uint32(&param->store_snapshot_interval_s,
+                                            ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "store_snapshot_pn_margin") == 0) {
+            int status = parser_read_uint64(&param->store_snapshot_pn_margin,
+                                            ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
         if (strcmp(ent->name, "tls_certs_dir") == 0) {
             int status = parse_string(ent->value, param->certs_dir);
 
@@ -1375,6 +1535,103 @@ parse_crypto_params(struct app_params *app,
             continue;
         }
 
+        if (strcmp(ent->name, "async") == 0) {
+            int val = parser_read_arg_bool(ent->value);
+
+            PARSE_ERROR((val >= 0), section_name, ent->name);
+            param->async = val;
+            continue;
+        }
+
+        if (strcmp(ent->name, "spillover_dev") == 0) {
+            int status = parser_read_uint8(&param->spillover_dev, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "max_sessions") == 0) {
+            int status = parser_read_uint32(&param->max_sessions, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "engine") == 0) {
+            if (strcmp(ent->value, "cryptodev") == 0)
+                param->engine = CCMP_ENGINE_CRYPTODEV;
+            else if (strcmp(ent->value, "inline") == 0)
+                param->engine = CCMP_ENGINE_INLINE;
+            else
+                PARSE_ERROR(0, section_name, ent->name);
+
+            continue;
+        }
+
+        /* unrecognized */
+        PARSE_ERROR_INVALID(0, section_name, ent->name);
+    }
+
+    free(entries);
+}
+
+static void
+parse_store(struct app_params *app,
+    const char *section_name,
+    struct rte_cfgfile *cfg)
+{
+    struct app_store_params *param = &app->store_params;
+    struct rte_cfgfile_entry *entries;
+    int n_entries, i;
+
+    n_entries = rte_cfgfile_section_num_entries(cfg, section_name);
+    PARSE_ERROR_SECTION_NO_ENTRIES((n_entries > 0), section_name);
+
+    entries = malloc(n_entries * sizeof(struct rte_cfgfile_entry));
+    PARSE_ERROR_MALLOC(entries != NULL);
+
+    rte_cfgfile_section_entries(cfg, section_name, entries, n_entries);
+
+    for (i = 0; i < n_entries; i++) {
+        struct rte_cfgfile_entry *ent = &entries[i];
+
+        if (strcmp(ent->name, "vaps_max") == 0) {
+            int status = parser_read_uint32(&param->vaps_max, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "stas_max") == 0) {
+            int status = parser_read_uint32(&param->stas_max, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "socket_id") == 0) {
+            int status = parser_read_uint32(&param->socket_id, ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "ptk_rx_overlap_ms") == 0) {
+            int status = parser_read_uint32(&param->ptk_rx_overlap_ms,
+                                            ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
+        if (strcmp(ent->name, "sta_idle_timeout_s") == 0) {
+            int status = parser_read_uint32(&param->sta_idle_timeout_s,
+                                            ent->value);
+
+            PARSE_ERROR((status == 0), section_name, ent->name);
+            continue;
+        }
+
         /* unrecognized */
         PARSE_ERROR_INVALID(0, section_name, ent->name);
     }
@@ -1389,10 +1646,12 @@ static const struct config_section cfg_file_scheme[] = {
     {"LINK", 1, parse_link},
     {"RXQ", 2, parse_rxq},
     {"TXQ", 2, parse_txq},
+    {"SWQ", 1, parse_swq},
     {"STAT", 0, parse_stat},
     {"ADDRESSES", 0, parse_addresses},
     {"CRYPTO", 0, parse_crypto_params},
     {"MISCELLANEOUS", 0, parse_miscellaneous},
+    {"STORE", 0, parse_store},
 };
 
 static void
@@ -1498,6 +1757,7 @@ app_config_parse(struct app_params *app, const char *file_name)
     APP_PARAM_COUNT(app->link_params, app->n_links);
     APP_PARAM_COUNT(app->hwq_in_params, app->n_pktq_hwq_in);
     APP_PARAM_COUNT(app->hwq_out_params, app->n_pktq_hwq_out);
+    APP_PARAM_COUNT(app->swq_params, app->n_pktq_swq);
     APP_PARAM_COUNT(app->thread_params, app->n_threads);
 
     return 0;
@@ -1523,6 +1783,9 @@ app_config_init(struct app_params *app)
     for (i = 0; i < RTE_DIM(app->hwq_out_params); i++)
         memcpy(&app->hwq_out_params[i], &default_hwq_out_params, sizeof(default_hwq_out_params));
 
+    for (i = 0; i < RTE_DIM(app->swq_params); i++)
+        memcpy(&app->swq_params[i], &default_swq_params, sizeof(default_swq_params));
+
     for (i = 0; i < RTE_DIM(app->thread_params); i++)
         memcpy(&app->thread_params[i], &default_thread_params, sizeof(default_thread_params));
 
@@ -1530,6 +1793,7 @@ app_config_init(struct app_params *app)
     memcpy(&app->crypto_params, &default_crypto_params, sizeof(default_crypto_params));
     memcpy(&app->addr_params, &default_addr_params, sizeof(default_addr_params));
     memcpy(&app->misc_params, &default_misc_params, sizeof(default_misc_params));
+    memcpy(&app->store_params, &default_store_params, sizeof(default_store_params));
 
     return 0;
 }
@@ -1755,6 +2019,53 @@ check_txqs(struct app_params *app)
     }
 }
 
+static void
+check_swqs(struct app_params *app)
+{
+    uint32_t i;
+
+    for (i = 0; i < app->n_pktq_swq; i++) {
+        struct app_pktq_swq_params *p = &app->swq_params[i];
+        uint32_t n_readers = app_swq_get_readers(app, p);
+        uint32_t n_writers = app_swq_get_writers(app, p);
+
+        APP_CHECK((p->size > 0), "%s size is 0\n", p->name);
+
+        APP_CHECK((rte_is_power_of_2(p->size)), "%s size is not a power of 2\n", p->name);
+
+        APP_CHECK((p->burst_read > 0), "%s read burst size is 0\n", p->name);
+
+        APP_CHECK((p->burst_read <= p->size), "%s read burst size is bigger than its size\n", p->name);
+
+        APP_CHECK((p->burst_write > 0), "%s write burst size is 0\n", p->name);
+
+        APP_CHECK((p->burst_write <= p->size), "%s write burst size is bigger than its size\n", p->name);
+
+        /* SWQs are created single producer and single consumer */
+        APP_CHECK((n_readers != 0), "%s has no reader\n", p->name);
+
+        APP_CHECK((n_readers == 1), "%s has more than one reader\n", p->name);
+
+        APP_CHECK((n_writers != 0), "%s has no writer\n", p->name);
+
+        APP_CHECK((n_writers == 1), "%s has more than one writer\n", p->name);
+    }
+}
+
+static void
+check_store(struct app_params *app)
+{
+    struct app_store_params *p = &app->store_params;
+
+    APP_CHECK((p->vaps_max > 0), "Store vaps_max is 0\n");
+
+    APP_CHECK((p->stas_max > 0), "Store stas_max is 0\n");
+
+    APP_CHECK((p->socket_id == APP_STORE_SOCKET_ANY ||
+               p->socket_id < RTE_MAX_NUMA_NODES),
+               "Store socket_id %u is invalid\n", p->socket_id);
+}
+
 static void
 check_crypto(struct app_params *app)
 {
@@ -1763,22 +2074,199 @@ check_crypto(struct app_params *app)
     APP_CHECK((p->cryptodev_mask > 0), "No devices specified in crypto mask\n");
 
     APP_CHECK((p->n_qp > 0), "Crypto n_qp is 0\n");
+
+    APP_CHECK((p->engine != CCMP_ENGINE_INLINE || ccmp_inline_supported()),
+               "Crypto engine inline needs AES-NI, which this build "
+               "does not use\n");
+
+    /*
+     * the spillover device is only used when a thread's qp is full,
+     * so it cannot be the main device of any thread
+     */
+    if (p->spillover_dev != APP_CRYPTO_DEV_NONE) {
+        APP_CHECK((p->spillover_dev < RTE_CRYPTO_MAX_DEVS),
+                   "Crypto spillover_dev %u is invalid\n", p->spillover_dev);
+
+        APP_CHECK((p->cryptodev_mask & ~(1ULL << p->spillover_dev)),
+                   "No devices specified in crypto mask other than "
+                   "spillover_dev %u\n", p->spillover_dev);
+    }
+}
+
+/*
+ * does the thread process packets, and so use its crypto qp
+ * - dispatch threads read RXQs but only pass the packets on
+ */
+static inline int
+thread_uses_crypto_qp(struct app_thread_params *tp)
+{
+    return (tp->n_pktq_in > 0 &&
+            strcmp(tp->type, "DISPATCH_THREAD") != 0);
 }
 
 static void
 check_threads(struct app_params *app)
 {
-    uint32_t i;
+    uint32_t i, n_control = 0;
 
     struct app_crypto_params *cp = &app->crypto_params;
 
     for (i = 0; i < app->n_threads; i++) {
         struct app_thread_params *tp = &app->thread_params[i];
+        uint32_t j;
 
         APP_CHECK((tp->crypto_qp < cp->n_qp),
                    "%s crypto qp is %d but only %d qp(s) configured\n",
                    tp->name, tp->crypto_qp, cp->n_qp);
+
+        if (tp->crypto_dev != APP_CRYPTO_DEV_NONE) {
+            APP_CHECK((tp->crypto_dev < RTE_CRYPTO_MAX_DEVS &&
+                       (cp->cryptodev_mask & (1ULL << tp->crypto_dev))),
+                       "%s crypto dev %u is not in the crypto mask\n",
+                       tp->name, tp->crypto_dev);
+
+            APP_CHECK((tp->crypto_dev != cp->spillover_dev),
+                       "%s crypto dev %u is the spillover_dev\n",
+                       tp->name, tp->crypto_dev);
+        }
+
+        /*
+         * dispatch threads read RXQs and spread the packets across
+         * the SWQs of the worker threads
+         * - the workers of a dispatch thread are either all uplink or
+         *   all downlink threads, as this decides the steering key
+         */
+        /*
+         * the control thread owns the TLS connection to the controller
+         * and only exchanges packets with the uplink threads over rings
+         */
+        if (strcmp(tp->type, "CONTROL_THREAD") == 0) {
+            APP_CHECK((tp->n_pktq_in == 0 && tp->n_pktq_out == 0),
+                       "%s (%s) must not have any pktq_in or pktq_out\n",
+                       tp->name, tp->type);
+
+            n_control++;
+            continue;
+        }
+
+        if (strcmp(tp->type, "DISPATCH_THREAD") == 0) {
+            struct app_thread_params *tp_worker0 = NULL;
+
+            for (j = 0; j < tp->n_pktq_in; j++)
+                APP_CHECK((tp->pktq_in[j].type == APP_PKTQ_IN_HWQ),
+                           "%s pktq_in must be RXQs\n", tp->name);
+
+            for (j = 0; j < tp->n_pktq_out; j++) {
+                struct app_thread_params *tp_worker;
+
+                APP_CHECK((tp->pktq_out[j].type == APP_PKTQ_OUT_SWQ),
+                           "%s pktq_out must be SWQs\n", tp->name);
+
+                tp_worker = app_swq_get_reader(app,
+                                &app->swq_params[tp->pktq_out[j].id]);
+
+                APP_CHECK((tp_worker != NULL &&
+                           (strcmp(tp_worker->type, "UPLINK_THREAD") == 0 ||
+                            strcmp(tp_worker->type, "DOWNLINK_THREAD") == 0)),
+                           "%s pktq_out SWQs must be read by uplink or "
+                           "downlink threads\n", tp->name);
+
+                if (tp_worker0 == NULL)
+                    tp_worker0 = tp_worker;
+
+                APP_CHECK((strcmp(tp_worker->type, tp_worker0->type) == 0),
+                           "%s mixes %s and %s workers\n",
+                           tp->name, tp_worker0->type, tp_worker->type);
+            }
+            continue;
+        }
+
+        /*
+         * crypto qps are not thread safe, so each packet processing
+         * thread (i.e. any thread reading a RXQ or SWQ) needs its own one
+         */
+        if (!thread_uses_crypto_qp(tp))
+            continue;
+
+        /*
+         * uplink and downlink threads may be instantiated many times but
+         * each instance reads exactly one RXQ (or SWQ fed by a dispatch
+         * thread) and writes one TXQ on each of the AP and WAG links
+         */
+        if ((strcmp(tp->type, "UPLINK_THREAD") == 0) ||
+            (strcmp(tp->type, "DOWNLINK_THREAD") == 0)) {
+            struct app_link_params *link_out0, *link_out1;
+
+            APP_CHECK((tp->n_pktq_in == 1),
+                       "%s (%s) must have exactly 1 pktq_in\n",
+                       tp->name, tp->type);
+
+            APP_CHECK((tp->n_pktq_out == 2),
+                       "%s (%s) must have exactly 2 pktq_out\n",
+                       tp->name, tp->type);
+
+            APP_CHECK((tp->pktq_out[0].type == APP_PKTQ_OUT_HWQ &&
+                       tp->pktq_out[1].type == APP_PKTQ_OUT_HWQ),
+                       "%s pktq_out must be TXQs\n", tp->name);
+
+            link_out0 = app_get_link_for_txq(app,
+                            &app->hwq_out_params[tp->pktq_out[0].id]);
+            link_out1 = app_get_link_for_txq(app,
+                            &app->hwq_out_params[tp->pktq_out[1].id]);
+
+            APP_CHECK((link_out0 != link_out1),
+                       "%s pktq_out TXQs must be on different links\n",
+                       tp->name);
+
+            if (tp->pktq_in[0].type == APP_PKTQ_IN_SWQ) {
+                struct app_thread_params *tp_writer =
+                    app_swq_get_writer(app, &app->swq_params[tp->pktq_in[0].id]);
+
+                APP_CHECK((tp_writer != NULL &&
+                           strcmp(tp_writer->type, "DISPATCH_THREAD") == 0),
+                           "%s pktq_in SWQ must be written by a dispatch thread\n",
+                           tp->name);
+            }
+        }
+
+        /*
+         * threads on different crypto devices may use the same qp number,
+         * unless their ops spill over to the same qp on the spillover
+         * device
+         * - a thread not setting crypto_dev uses the first suitable device,
+         *   which is not known until the devices are probed
+         */
+        for (j = 0; j < i; j++) {
+            struct app_thread_params *tp_prev = &app->thread_params[j];
+
+            if (!thread_uses_crypto_qp(tp_prev))
+                continue;
+
+            if (cp->spillover_dev == APP_CRYPTO_DEV_NONE &&
+                tp->crypto_dev != APP_CRYPTO_DEV_NONE &&
+                tp_prev->crypto_dev != APP_CRYPTO_DEV_NONE &&
+                tp->crypto_dev != tp_prev->crypto_dev)
+                continue;
+
+            APP_CHECK((tp->crypto_qp != tp_prev->crypto_qp),
+                       "%s and %s are both using crypto qp %d\n",
+                       tp_prev->name, tp->name, tp->crypto_qp);
+        }
     }
+
+#ifndef RWPA_UL_NO_TLS_POLLING
+    APP_CHECK((n_control == 1),
+               "Exactly one CONTROL_THREAD must be configured\n");
+#else
+    /*
+     * the uplink threads do not poll the rings from the control thread
+     * in this build, so the EAPOLs from the controller would fill them
+     * and be dropped
+     */
+    APP_CHECK((n_control == 0),
+               "No CONTROL_THREAD may be configured with "
+               "RWPA_UL_NO_TLS_POLLING\n");
+#endif
 }
 
 int
@@ -1788,7 +2276,9 @@ app_config_check(struct app_params *app)
     check_links(app);
     check_rxqs(app);
     check_txqs(app);
+    check_swqs(app);
     check_crypto(app);
+    check_store(app);
     check_threads(app);
     return 0;
 }
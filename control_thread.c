@@ -0,0 +1,503 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_branch_prediction.h>
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_log.h>
+#include <rte_ring.h>
+#include <rte_ether.h>
+#include <rte_mbuf.h>
+#include <rte_prefetch.h>
+#include <rte_cycles.h>
+
+#ifdef RTE_MACHINE_CPUFLAG_SSE4_2
+#include <rte_hash_crc.h>
+#define DEFAULT_HASH_FUNC rte_hash_crc
+#else
+#include <rte_jhash.h>
+#define DEFAULT_HASH_FUNC rte_jhash
+#endif
+
+#include "app.h"
+#include "parser.h"
+#include "thread.h"
+#include "ring.h"
+#include "r-wpa_global_vars.h"
+#include "counter.h"
+#include "seq_num.h"
+#include "meta.h"
+#include "ieee80211.h"
+#include "wpapt_cdi.h"
+#include "wpapt_cdi_helper.h"
+#include "tls_msg_handler.h"
+#include "tls_socket.h"
+#include "store.h"
+#ifdef RWPA_STATS_CAPTURE
+#include "statistics_capture.h"
+#endif
+#include "control_thread.h"
+
+/*
+ * Control thread
+ * - owns the TLS connection to the controller and runs the WPAPT
+ *   message handlers, so that key installs and station/vAP updates
+ *   are not processed on the uplink lcores
+ * - EAPOLs from the controller are passed to an uplink worker, picked
+ *   by hashing the station MAC, over a ring per worker
+ * - EAPOLs from the APs are passed back by the uplink workers over a
+ *   single shared ring and written to the TLS socket
+ */
+
+#define CTRL_TP_TLS_MEMPOOL_ID  "tls_mempool_id"
+
+#define CTRL_RING_TO_WORKER     "CTRL_TO_%s"
+#define CTRL_RING_FROM_WORKERS  "CTRL_FROM_WORKERS"
+
+#define CTRL_MAX_WORKERS        APP_MAX_THREADS
+
+#define CTRL_HASH_INIT_VAL      0
+
+/*
+ * Control thread context
+ */
+struct control_ctx {
+    struct app_thread_params *tp;
+    struct rte_mempool *mempool;
+    struct tls_socket tls;
+    struct rte_ring *from_workers;
+    unsigned nb_workers;
+    struct rte_ring *workers[CTRL_MAX_WORKERS];
+    struct pkt_buffer worker_bufs[CTRL_MAX_WORKERS];
+    uint64_t nb_ring_full_drops;
+    uint64_t ring_full_log_tsc;
+} __rte_cache_aligned;
+
+#if !defined RWPA_STATS_CAPTURE_CONTROL_OFF && defined RWPA_STATS_CAPTURE
+
+#define CTRL_DROP_STAT_INC(stat, amt)                                          \
+     stats_capture_control_drops_inc(stat, (uint64_t)amt);
+
+#else
+
+#define CTRL_DROP_STAT_INC(stat, amt)
+
+#endif
+
+#define CTRL_LOG_AND_DROP(p_mbuf, level, logtype, err_msg, stat)               \
+({                                                                             \
+     CTRL_DROP_STAT_INC(stat, 1);                                              \
+     RWPA_LOG(level, logtype, err_msg);                                        \
+     DROP(p_mbuf);                                                             \
+})
+
+extern volatile int force_quit;
+
+struct rte_ring *
+control_ring_to_worker_get(const char *worker_name, int socket_id)
+{
+    char name[RTE_RING_NAMESIZE];
+
+    snprintf(name, sizeof(name), CTRL_RING_TO_WORKER, worker_name);
+
+    return create_ring(name, CONTROL_RING_SZ, socket_id,
+                       RING_F_SP_ENQ | RING_F_SC_DEQ);
+}
+
+struct rte_ring *
+control_ring_from_workers_get(int socket_id)
+{
+    return create_ring(CTRL_RING_FROM_WORKERS, CONTROL_RING_SZ, socket_id,
+                       RING_F_SC_DEQ);
+}
+
+static void *
+thread_control_init(struct app_thread_params *p, void *arg)
+{
+    unsigned lcore_id, socket_id, i;
+    struct control_ctx *ctx;
+    struct app_params *app = (struct app_params *)arg;
+    uint32_t tls_mempool_id;
+    int tls_mempool_id_rd_sts = -1;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    if (p->n_ports_in != 0 || p->n_ports_out != 0)
+        rte_exit(EXIT_FAILURE,
+                 "%s: no ports may be assigned to control\n", p->name);
+
+    for (i = 0; i < p->n_args; i++) {
+        if (strcmp(p->args_name[i], CTRL_TP_TLS_MEMPOOL_ID) == 0) {
+            tls_mempool_id_rd_sts = parser_read_uint32(&tls_mempool_id,
+                                                       p->args_value[i]);
+            if (tls_mempool_id_rd_sts != 0 ||
+                tls_mempool_id >= app->n_mempools)
+                rte_exit(EXIT_FAILURE,
+                         "Invalid %s thread param for %s\n",
+                         CTRL_TP_TLS_MEMPOOL_ID, p->name);
+        }
+    }
+
+    if (tls_mempool_id_rd_sts != 0)
+        rte_exit(EXIT_FAILURE,
+                 "%s: %s thread param not set\n",
+                 p->name, CTRL_TP_TLS_MEMPOOL_ID);
+
+    ctx = rte_zmalloc_socket(p->name, sizeof(struct control_ctx),
+                             RTE_CACHE_LINE_SIZE, socket_id);
+    if (ctx == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Could not allocate context for %s\n", p->name);
+
+    ctx->tp = p;
+    ctx->mempool = app->mempool[tls_mempool_id];
+
+    /* get the rings to and from the uplink workers */
+    ctx->from_workers = control_ring_from_workers_get(socket_id);
+    if (ctx->from_workers == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "%s: could not create ring %s\n",
+                 p->name, CTRL_RING_FROM_WORKERS);
+
+    for (i = 0; i < app->n_threads; i++) {
+        struct app_thread_params *tp_worker = &app->thread_params[i];
+
+        if (strcmp(tp_worker->type, "UPLINK_THREAD") != 0)
+            continue;
+
+        if (ctx->nb_workers == CTRL_MAX_WORKERS)
+            rte_exit(EXIT_FAILURE,
+                     "%s: more than %d uplink threads\n",
+                     p->name, CTRL_MAX_WORKERS);
+
+        ctx->workers[ctx->nb_workers] =
+            control_ring_to_worker_get(tp_worker->name, socket_id);
+        if (ctx->workers[ctx->nb_workers] == NULL)
+            rte_exit(EXIT_FAILURE,
+                     "%s: could not create ring to %s\n",
+                     p->name, tp_worker->name);
+        ctx->nb_workers++;
+    }
+
+    if (ctx->nb_workers == 0)
+        rte_exit(EXIT_FAILURE,
+                 "%s: no uplink threads to pass EAPOLs to\n", p->name);
+
+    /* initialise tls socket */
+    tls_socket_init(&ctx->tls, tls_handlers, app->mempool[tls_mempool_id],
+                    app->addr_params.vnfc_tls_ss_ip,
+                    app->addr_params.vnfc_tls_ss_port,
+                    &app->misc_params);
+
+    RTE_LOG(INFO, RWPA_CTRL,
+            "%s (%s): Initializing on lcore %u (socket %u), "
+            "%u uplink worker(s)\n",
+            p->name, p->type, lcore_id, socket_id, ctx->nb_workers);
+
+    return ctx;
+}
+
+/*
+ * get the uplink worker for an EAPOL from the controller
+ * - hashes the station MAC of the 802.11 header
+ */
+static inline unsigned
+eapol_worker_get(struct control_ctx *ctx, struct rte_mbuf *m)
+{
+    struct ieee80211_hdr *hdr;
+    struct ether_addr *sta_addr = NULL, *bssid = NULL;
+
+    if (unlikely(rte_pktmbuf_data_len(m) < sizeof(struct ieee80211_hdr)))
+        return 0;
+
+    hdr = rte_pktmbuf_mtod(m, struct ieee80211_hdr *);
+    ieee80211_addrs_get(hdr, &sta_addr, &bssid);
+
+    return DEFAULT_HASH_FUNC(sta_addr, ETHER_ADDR_LEN,
+                             CTRL_HASH_INIT_VAL) % ctx->nb_workers;
+}
+
+/*
+ * pass the buffered EAPOLs to the uplink workers
+ * - EAPOLs which do not fit in a worker's ring are dropped
+ * - the drops are logged at most once a second, with their number
+ *   since the last log
+ */
+static void
+eapols_to_workers_flush(struct control_ctx *ctx)
+{
+    unsigned i, nb_enq;
+    uint64_t cur_tsc;
+    struct pkt_buffer *buf;
+
+    for (i = 0; i < ctx->nb_workers; i++) {
+        buf = &ctx->worker_bufs[i];
+        if (buf->len == 0)
+            continue;
+
+        nb_enq = rte_ring_sp_enqueue_burst(ctx->workers[i],
+                                           (void **)buf->buffer,
+                                           buf->len, NULL);
+        if (unlikely(nb_enq < buf->len)) {
+            CTRL_DROP_STAT_INC(STATS_CTRL_DROPS_TYPE_RING_FULL,
+                               buf->len - nb_enq);
+            ctx->nb_ring_full_drops += buf->len - nb_enq;
+            for (; nb_enq < buf->len; nb_enq++)
+                DROP(buf->buffer[nb_enq]);
+
+            cur_tsc = rte_rdtsc();
+            if (cur_tsc - ctx->ring_full_log_tsc > rte_get_tsc_hz()) {
+                RTE_LOG(ERR, RWPA_CTRL,
+                        "Uplink worker ring full, dropped %"PRIu64
+                        " EAPOL(s)\n", ctx->nb_ring_full_drops);
+                ctx->nb_ring_full_drops = 0;
+                ctx->ring_full_log_tsc = cur_tsc;
+            }
+        }
+
+        buf->len = 0;
+    }
+}
+
+/*
+ * read a burst of WPAPT messages from the controller and handle them
+ */
+static void
+tls_dequeue(struct control_ctx *ctx)
+{
+    unsigned i, j;
+    struct rte_mbuf *m;
+    struct pkt_buffer pkts_in __rte_cache_aligned;
+    struct pkt_buffer *buf;
+    struct tls_socket *tls = &ctx->tls;
+
+    pkts_in.len = poll_sock(tls, pkts_in.buffer, MAX_PKT_BURST);
+    if (pkts_in.len == 0)
+        return;
+
+    for (i = 0; i < pkts_in.len; i++) {
+        RWPA_CHECK_ARRAY_OFFSET(i, MAX_PKT_BURST - 1);
+
+        m = pkts_in.buffer[i];
+        rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+
+        struct wpapt_cdi_msg_header *data = rte_pktmbuf_mtod(m, struct wpapt_cdi_msg_header *);
+        uint16_t type = data->message_id;
+
+        for (j = 0; tls->ctx[j].type != EOL; j++) {
+            if (tls->ctx[j].cmd == type) {
+                if (wpapt_cdi_hdr_decap(m) == RWPA_STS_OK) {
+                    int action = tls->ctx[j].handler(m);
+                    switch (action) {
+                        case TLS_HANDLER_ACTION_PROCESS:
+                            buf = &ctx->worker_bufs[eapol_worker_get(ctx, m)];
+                            buf->buffer[buf->len++] = m;
+                            break;
+                        case TLS_HANDLER_ACTION_TLS_TX:
+                            if (tls_socket_write(tls, m) < 0)
+                                CTRL_LOG_AND_DROP(m, ERR, RWPA_CTRL,
+                                                  "TLS TX queue full, dropping\n",
+                                                  STATS_CTRL_DROPS_TYPE_TLS_TX_FULL);
+                            break;
+                        case TLS_HANDLER_ACTION_ERROR:
+                            CTRL_LOG_AND_DROP(m, ERR, RWPA_CTRL,
+                                              "Error handling WPAPT message, dropping\n",
+                                              STATS_CTRL_DROPS_TYPE_MSG_HANDLING_ERROR);
+                            break;
+                        case TLS_HANDLER_ACTION_NONE:
+                        default:
+                            rte_pktmbuf_free(m);
+                            break;
+                    }
+                } else {
+                    CTRL_LOG_AND_DROP(m, ERR, RWPA_CTRL,
+                                      "Error removing WPAPT header, dropping\n",
+                                      STATS_CTRL_DROPS_TYPE_PACKET_DECAP_ERROR);
+                }
+                break;
+            }
+        }
+
+        if (tls->ctx[j].type == EOL) {
+#ifdef RWPA_EXTRA_DEBUG
+            RTE_LOG(ERR, RWPA_CTRL,
+                    "Unknown WPAPT message type [%d] received, dropping\n",
+                    type);
+#endif
+            CTRL_DROP_STAT_INC(STATS_CTRL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE, 1);
+            DROP(m);
+        }
+    }
+
+    eapols_to_workers_flush(ctx);
+}
+
+/*
+ * queue the EAPOLs from the uplink workers on the TLS socket
+ * - they already have their WPAPT encapsulation
+ * - nothing is dequeued while the TLS transmit buffer is full, so the
+ *   ring fills up and the uplink workers drop instead
+ */
+static void
+workers_dequeue(struct control_ctx *ctx)
+{
+    unsigned i;
+    struct pkt_buffer pkts_in __rte_cache_aligned;
+
+    if (unlikely(!tls_socket_tx_has_room(&ctx->tls)))
+        return;
+
+    pkts_in.len = rte_ring_sc_dequeue_burst(ctx->from_workers,
+                                            (void **)pkts_in.buffer,
+                                            MAX_PKT_BURST, NULL);
+
+    for (i = 0; i < pkts_in.len; i++)
+        if (unlikely(tls_socket_write(&ctx->tls, pkts_in.buffer[i]) < 0))
+            CTRL_LOG_AND_DROP(pkts_in.buffer[i], ERR, RWPA_CTRL,
+                              "TLS TX queue full, dropping\n",
+                              STATS_CTRL_DROPS_TYPE_TLS_TX_FULL);
+}
+
+/*
+ * report a station deleted for being idle to the controller, with a
+ * STA_REMOVE message, see store_sta_age()
+ */
+static void
+sta_idle_report(const struct ether_addr *sta_addr,
+                const struct ether_addr *vap_addr,
+                void *arg)
+{
+    struct control_ctx *ctx = (struct control_ctx *)arg;
+    struct wpapt_cdi_msg_sta_remove *sta_remove;
+    struct rte_mbuf *m;
+
+    m = rte_pktmbuf_alloc(ctx->mempool);
+    if (unlikely(m == NULL)) {
+        RTE_LOG(ERR, RWPA_CTRL,
+                "Could not allocate idle station report, dropping\n");
+        return;
+    }
+
+    sta_remove = (struct wpapt_cdi_msg_sta_remove *)
+        rte_pktmbuf_append(m, sizeof(struct wpapt_cdi_msg_sta_remove));
+    if (unlikely(sta_remove == NULL ||
+                 wpapt_cdi_hdr_encap(m, WPAPT_CDI_MSG_STA_REMOVE,
+                                     sizeof(struct wpapt_cdi_msg_sta_remove))
+                 != RWPA_STS_OK)) {
+        CTRL_LOG_AND_DROP(m, ERR, RWPA_CTRL,
+                          "Error adding WPAPT header, dropping\n",
+                          STATS_CTRL_DROPS_TYPE_PACKET_ENCAP_ERROR);
+        return;
+    }
+
+    memcpy(sta_remove->bssid, vap_addr->addr_bytes, WPAPT_ETH_ALEN);
+    memcpy(sta_remove->sta_addr, sta_addr->addr_bytes, WPAPT_ETH_ALEN);
+    sta_remove->reason = WPAPT_CDI_STA_REMOVE_REASON_IDLE;
+
+    if (unlikely(tls_socket_write(&ctx->tls, m) < 0))
+        CTRL_LOG_AND_DROP(m, ERR, RWPA_CTRL,
+                          "TLS TX queue full, dropping\n",
+                          STATS_CTRL_DROPS_TYPE_TLS_TX_FULL);
+}
+
+static void
+control_main_loop(struct control_ctx *ctx)
+{
+    uint64_t cur_tsc;
+
+    while (!force_quit) {
+        tls_dequeue(ctx);
+        workers_dequeue(ctx);
+
+        cur_tsc = rte_rdtsc();
+        store_sta_age(cur_tsc, sta_idle_report, ctx);
+        tls_socket_drain(&ctx->tls, cur_tsc);
+    }
+}
+
+static int
+thread_control_run(void *arg)
+{
+    struct control_ctx *ctx = (struct control_ctx *)arg;
+    unsigned lcore_id, socket_id;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    RTE_LOG(INFO, RWPA_CTRL,
+            "%s (%s): Entering main loop on lcore %u (socket %u)\n",
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
+
+    control_main_loop(ctx);
+
+    return 0;
+}
+
+static int
+thread_control_free(void *arg)
+{
+    struct control_ctx *ctx = (struct control_ctx *)arg;
+    unsigned lcore_id, socket_id;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    RTE_LOG(INFO, RWPA_CTRL,
+            "%s (%s): Freeing on lcore %u (socket %u)\n",
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
+
+    tls_socket_flush(&ctx->tls);
+    tls_socket_free();
+
+    rte_free(ctx);
+
+    return 0;
+}
+
+static struct thread_ops_s thread_control_ops = {
+    .f_init = thread_control_init,
+    .f_free = thread_control_free,
+    .f_run  = thread_control_run,
+};
+
+struct thread_type thread_control = {
+    .name = "CONTROL_THREAD",
+    .thread_ops = &thread_control_ops,
+};
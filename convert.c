@@ -172,10 +172,9 @@ ether_to_ieee80211_convert(struct rte_mbuf  *mbuf,
 
         /*
          * append space to the end of the packet mbuf for
-         * CCMP MIC
-         * - MIC is half the length of the key
+         * CCMP/GCMP MIC
          */
-        if (unlikely(rte_pktmbuf_append(mbuf, (meta->sa->tk_len >> 1)) == NULL))
+        if (unlikely(rte_pktmbuf_append(mbuf, meta->sa->mic_len) == NULL))
             return RWPA_STS_ERR;
 
         /* get pointers to the station and bssid MAC addresses*/
@@ -238,11 +237,10 @@ ieee80211_to_ether_convert(struct rte_mbuf  *mbuf,
     if (meta->wep) {
         /*
          * remove space from the end of the packet mbuf where
-         * the CCMP MIC is
-         * - MIC is half the length of the key
+         * the CCMP/GCMP MIC is
          */
         if (unlikely(meta->sa == NULL || 
-                     rte_pktmbuf_trim(mbuf, (meta->sa->tk_len >> 1)) == -1))
+                     rte_pktmbuf_trim(mbuf, meta->sa->mic_len) == -1))
             return RWPA_STS_ERR;
     }
 
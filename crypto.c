@@ -48,21 +48,63 @@
 
 #include "app.h"
 #include "r-wpa_global_vars.h"
+#include "counter.h"
+#include "seq_num.h"
+#include "meta.h"
 #include "crypto.h"
 
+/*
+ * the packet's meta info is saved after the nonce and AAD, so that
+ * the packet can be processed further when its op is dequeued
+ */
 #define CRYPTO_OP_PRIV_DATA_SIZE (sizeof(struct rte_crypto_sym_xform) + \
                                   MAX_IV_LENGTH + \
-                                  MAX_AAD_LENGTH)
+                                  MAX_AAD_LENGTH + \
+                                  sizeof(struct rwpa_meta))
                                    
 static struct rte_mempool *crypto_op_pool;
 static struct rte_mempool *session_pool;
 
-static uint8_t cdev_id = 0;
-static uint8_t driver_id = 0xFF;
+/*
+ * crypto devices in use
+ * - the devices enabled by the mask that support AES-CCM and are of the
+ *   preferred type, followed by the spillover device (if configured)
+ * - threads are assigned a qp on one of the first n_main_devs devices
+ */
+struct crypto_dev {
+    uint8_t cdev_id;
+    uint8_t driver_id;
+};
+
+static struct crypto_dev crypto_devs[RTE_CRYPTO_MAX_DEVS];
+static uint8_t n_crypto_devs = 0;
+static uint8_t n_main_devs = 0;
+static uint8_t spill_cdev_id = APP_CRYPTO_DEV_NONE;
+static uint16_t n_qp = 0;
+static uint32_t n_max_sessions = 0;
+static int gcm_supported = TRUE;
 
 static int
 cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions);
 
+static int
+cryptodev_setup(uint8_t cdev_id, uint16_t nb_qp);
+
+static int
+cryptodev_aead_check(struct rte_cryptodev_info    *dev_info,
+                     enum rte_crypto_aead_algorithm algo);
+
+static void
+cryptodev_gcm_check(uint8_t cdev_id, struct rte_cryptodev_info *dev_info);
+
+static int
+cryptodev_driver_first(unsigned idx);
+
+static uint32_t
+cryptodev_max_sessions_check(uint32_t max_sessions,
+                             uint8_t cdev_id,
+                             struct rte_cryptodev_info *dev_info);
+
 static int
 cryptodev_mask_check(struct app_crypto_params *params, uint8_t cdev_id);
 
@@ -73,8 +115,6 @@ device_type_check(struct app_crypto_params *params,
 void
 crypto_init(struct app_crypto_params *params, uint32_t max_sessions)
 {
-    int ret_val;
-
     /* create crypto operations pool */
     crypto_op_pool = rte_crypto_op_pool_create("crypto_op_pool",
                                                RTE_CRYPTO_OP_TYPE_SYMMETRIC,
@@ -86,41 +126,64 @@ crypto_init(struct app_crypto_params *params, uint32_t max_sessions)
     if (crypto_op_pool == NULL)
         rte_exit(EXIT_FAILURE, "Cannot create crypto op pool\n");
 
-    /* init crypto device */
-    if ((ret_val = cryptodev_init(params, max_sessions)) < 0)
+    /* init crypto devices */
+    if (cryptodev_init(params, max_sessions) < 0)
         rte_exit(EXIT_FAILURE, "Failed to initialize crypto devices\n");
-    else
-        cdev_id = (uint8_t)ret_val;
 }
 
 void
 crypto_destroy(void)
 {
-    rte_cryptodev_stop(cdev_id);
+    unsigned i;
+
+    for (i = 0; i < n_crypto_devs; i++)
+        rte_cryptodev_stop(crypto_devs[i].cdev_id);
 }
 
 struct rte_cryptodev_sym_session *
-crypto_session_alloc(struct rte_crypto_sym_xform *xform, uint16_t qp)
+crypto_session_alloc(struct rte_crypto_sym_xform *xform)
 {
     struct rte_cryptodev_sym_session *session;
+    unsigned i;
+    uint16_t qp;
 
     session = rte_cryptodev_sym_session_create(session_pool);
     if (unlikely(session == NULL)) {
         RTE_LOG(CRIT, RWPA_CRYPTO,
                 "Failed to create crypto session\n");
-    } else if (unlikely(rte_cryptodev_sym_session_init(
-                            cdev_id, session, xform, session_pool) < 0)) {
-        RTE_LOG(CRIT, RWPA_CRYPTO,
-                "Failed to init crypto session\n");
-        rte_cryptodev_sym_session_free(session);
-        session = NULL;
-    } else if (unlikely(rte_cryptodev_queue_pair_attach_sym_session(
-                            cdev_id, qp, session) < 0)) {
-        RTE_LOG(CRIT, RWPA_CRYPTO,
-                "Session cannot be attached to qp %u\n",
-                qp);
-        rte_cryptodev_sym_session_free(session);
-        session = NULL;
+        return NULL;
+    }
+
+    /*
+     * the session may be used on any qp of any of the devices, as
+     * ops are spilled over from a thread's main device
+     * - the session holds private data for each driver, so it only
+     *   needs to be initialised once per driver
+     */
+    for (i = 0; i < n_crypto_devs; i++) {
+        uint8_t cdev_id = crypto_devs[i].cdev_id;
+
+        if (cryptodev_driver_first(i) &&
+            unlikely(rte_cryptodev_sym_session_init(
+                         cdev_id, session, xform, session_pool) < 0)) {
+            RTE_LOG(CRIT, RWPA_CRYPTO,
+                    "Failed to init crypto session on cryptodev %u\n",
+                    cdev_id);
+            crypto_session_free(session);
+            return NULL;
+        }
+
+        for (qp = 0; qp < n_qp; qp++) {
+            if (unlikely(rte_cryptodev_queue_pair_attach_sym_session(
+                             cdev_id, qp, session) < 0)) {
+                RTE_LOG(CRIT, RWPA_CRYPTO,
+                        "Session cannot be attached to qp %u "
+                        "on cryptodev %u\n",
+                        qp, cdev_id);
+                crypto_session_free(session);
+                return NULL;
+            }
+        }
     }
 
     return session;
@@ -129,8 +192,13 @@ crypto_session_alloc(struct rte_crypto_sym_xform *xform, uint16_t qp)
 void
 crypto_session_free(struct rte_cryptodev_sym_session *sess)
 {
+    unsigned i;
+
     if (sess != NULL) {
-        rte_cryptodev_sym_session_clear(cdev_id, sess);
+        for (i = 0; i < n_crypto_devs; i++)
+            if (cryptodev_driver_first(i))
+                rte_cryptodev_sym_session_clear(crypto_devs[i].cdev_id,
+                                                sess);
         rte_cryptodev_sym_session_free(sess);
     }
 }
@@ -165,10 +233,43 @@ crypto_ops_alloc(uint32_t num_ops_alloc, struct rte_crypto_op **ops)
     return RWPA_STS_OK;
 }
 
+enum rwpa_status
+crypto_chan_init(struct crypto_chan *chan, uint8_t cdev_id, uint16_t qp)
+{
+    unsigned i;
+
+    if (unlikely(chan == NULL || qp >= n_qp))
+        return RWPA_STS_ERR;
+
+    /* the first device is used if none is given */
+    if (cdev_id == APP_CRYPTO_DEV_NONE)
+        cdev_id = crypto_devs[0].cdev_id;
+
+    for (i = 0; i < n_main_devs; i++)
+        if (crypto_devs[i].cdev_id == cdev_id)
+            break;
+
+    if (i == n_main_devs) {
+        RTE_LOG(CRIT, RWPA_CRYPTO,
+                "Cryptodev %u is not enabled or not suitable\n",
+                cdev_id);
+        return RWPA_STS_ERR;
+    }
+
+    memset(chan, 0, sizeof(*chan));
+    chan->cdev_id = cdev_id;
+    chan->qp = qp;
+    chan->spill_cdev_id = spill_cdev_id;
+    chan->has_spill = (spill_cdev_id != APP_CRYPTO_DEV_NONE);
+
+    return RWPA_STS_OK;
+}
+
 uint16_t
-crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp)
+crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan)
 {
-    uint16_t nb_enq;
+    uint16_t nb_enq, nb_spill = 0;
 
     if (unlikely(!nb_ops))
         return 0;
@@ -177,21 +278,42 @@ crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp)
      * the rte_cryptodev_enqueue_burst() function returns the number
      * of operations enqueued for processing. A return value equal
      * to nb_ops means that all the packets have been enqueued
+     * - while ops are in flight on the spillover device, the main
+     *   device is skipped, so that these ops do not overtake them
      */
-    nb_enq = rte_cryptodev_enqueue_burst(cdev_id, qp, ops, nb_ops);
+    if (likely(chan->nb_spilled == 0)) {
+        nb_enq = rte_cryptodev_enqueue_burst(chan->cdev_id, chan->qp,
+                                             ops, nb_ops);
+        chan->nb_main += nb_enq;
+    } else
+        nb_enq = 0;
+
+    /*
+     * the main device's qp is full, or being drained, so spill the
+     * remaining ops over to the same qp on the spillover device
+     */
+    if (unlikely(nb_enq < nb_ops) && chan->has_spill) {
+        nb_spill = rte_cryptodev_enqueue_burst(chan->spill_cdev_id,
+                                               chan->qp,
+                                               &ops[nb_enq],
+                                               nb_ops - nb_enq);
+        chan->nb_spilled += nb_spill;
+    }
 
     RTE_LOG(DEBUG, RWPA_CRYPTO,
-            "Enqueued %d crypto operations from %d requested "
-            "to cryptodev %u queue %u,\n",
-            nb_enq, nb_ops, cdev_id, qp);
+            "Enqueued %d (+%d spilled to cryptodev %u) crypto operations "
+            "from %d requested to cryptodev %u queue %u,\n",
+            nb_enq, nb_spill, chan->spill_cdev_id,
+            nb_ops, chan->cdev_id, chan->qp);
 
-    return nb_enq;
+    return nb_enq + nb_spill;
 }
 
 uint16_t
-crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp)
+crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan)
 {
-    uint16_t nb_deq;
+    uint16_t nb_deq, nb_spill = 0;
 
     if (unlikely(!nb_ops))
         return 0;
@@ -199,32 +321,72 @@ crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp)
     /*
      * dequeue from crypto device
      * - the max number of dequeued packets is nb_ops
+     * - the main device is dequeued from first, and the spillover
+     *   device only once the main device's ops, which were all
+     *   enqueued before the spilled ones, have completed
      */
-    nb_deq = rte_cryptodev_dequeue_burst(cdev_id, qp, ops, nb_ops);
+    if (likely(chan->nb_main > 0)) {
+        nb_deq = rte_cryptodev_dequeue_burst(chan->cdev_id, chan->qp,
+                                             ops, nb_ops);
+        chan->nb_main -= nb_deq;
+    } else
+        nb_deq = 0;
+
+    if (unlikely(chan->nb_spilled > 0) && chan->nb_main == 0 &&
+        nb_deq < nb_ops) {
+        nb_spill = rte_cryptodev_dequeue_burst(chan->spill_cdev_id,
+                                               chan->qp,
+                                               &ops[nb_deq],
+                                               nb_ops - nb_deq);
+        chan->nb_spilled -= nb_spill;
+    }
 
     RTE_LOG(DEBUG, RWPA_CRYPTO,
-            "Dequeued %d crypto operations from %d requested "
-            "from cryptodev %u queue %u\n",
-            nb_deq, nb_ops, cdev_id, qp);
+            "Dequeued %d (+%d spilled from cryptodev %u) crypto operations "
+            "from %d requested from cryptodev %u queue %u\n",
+            nb_deq, nb_spill, chan->spill_cdev_id,
+            nb_ops, chan->cdev_id, chan->qp);
 
-    return nb_deq;
+    return nb_deq + nb_spill;
 }
 
 uint8_t
 crypto_driver_id_get(void)
 {
-    return driver_id;
+    return n_crypto_devs ? crypto_devs[0].driver_id : 0xFF;
+}
+
+uint32_t
+crypto_max_sessions_get(void)
+{
+    return n_max_sessions;
+}
+
+int
+crypto_gcm_supported(void)
+{
+    return gcm_supported;
+}
+
+uint8_t
+crypto_dev_count(void)
+{
+    return n_crypto_devs;
+}
+
+uint8_t
+crypto_dev_id_get(uint8_t idx)
+{
+    if (idx >= n_crypto_devs)
+        return APP_CRYPTO_DEV_NONE;
+
+    return crypto_devs[idx].cdev_id;
 }
 
 static int
 cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
 {
-    const struct rte_cryptodev_capabilities *cap;
-    struct rte_cryptodev_config dev_conf;
-    struct rte_cryptodev_qp_conf qp_conf;
-    uint32_t i, cdev_id, cdev_count, sess_sz;
-    uint16_t qp;
-    int ret_val;
+    uint32_t i, cdev_id, cdev_count, sess_sz = 0, n_drivers = 0;
 
     cdev_count = rte_cryptodev_count();
     if (cdev_count == 0) {
@@ -232,31 +394,25 @@ cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
         return -1;
     }
 
+    n_qp = params->n_qp;
+
     for (cdev_id = 0; cdev_id < cdev_count; cdev_id++) {
         struct rte_cryptodev_info dev_info;
 
         if (cryptodev_mask_check(params, (uint8_t)cdev_id))
             continue;
 
+        if (cdev_id == params->spillover_dev)
+            continue;
+
         rte_cryptodev_info_get(cdev_id, &dev_info);
 
         /*
          * check if device supports AES-CCM algo and is of
          * the preferred type
          */
-        i = 0;
-        cap = &dev_info.capabilities[i];
-        while (cap->op != RTE_CRYPTO_OP_TYPE_UNDEFINED) {
-            if (cap->sym.xform_type == RTE_CRYPTO_SYM_XFORM_AEAD) {
-                if (cap->sym.aead.algo == RTE_CRYPTO_AEAD_AES_CCM) {
-                    if (device_type_check(params, &dev_info) == 0)
-                        break;
-                }
-            }
-            cap = &dev_info.capabilities[++i];
-        }
-
-        if (cap->op == RTE_CRYPTO_OP_TYPE_UNDEFINED) {
+        if (cryptodev_aead_check(&dev_info, RTE_CRYPTO_AEAD_AES_CCM) < 0 ||
+            device_type_check(params, &dev_info) < 0) {
             RTE_LOG(ERR, RWPA_CRYPTO,
                     "Algorithm %s not supported by cryptodev %u "
                     "or device not of preferred type (%s)\n",
@@ -265,12 +421,17 @@ cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
                     params->cdev_type_string);
         } else {
             /* suitable cryptodev has been found */
-            driver_id = dev_info.driver_id;
-            break;
+            cryptodev_gcm_check((uint8_t)cdev_id, &dev_info);
+            max_sessions = cryptodev_max_sessions_check(max_sessions,
+                                                        (uint8_t)cdev_id,
+                                                        &dev_info);
+            crypto_devs[n_crypto_devs].cdev_id = (uint8_t)cdev_id;
+            crypto_devs[n_crypto_devs].driver_id = dev_info.driver_id;
+            n_crypto_devs++;
         }
     }
-    
-    if (cdev_id == cdev_count) {
+
+    if (n_crypto_devs == 0) {
         RTE_LOG(CRIT, RWPA_CRYPTO,
                 "No suitable %s cryptodev found to support %s algorithm\n",
                 params->cdev_type_string,
@@ -278,14 +439,62 @@ cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
         return -1;
     }
 
-    sess_sz = rte_cryptodev_get_private_session_size(cdev_id);
+    n_main_devs = n_crypto_devs;
+
+    /*
+     * the spillover device only has to support AES-CCM, it is
+     * typically a SW PMD backing up a HW device
+     */
+    if (params->spillover_dev != APP_CRYPTO_DEV_NONE) {
+        struct rte_cryptodev_info dev_info;
+
+        if (params->spillover_dev >= cdev_count) {
+            RTE_LOG(CRIT, RWPA_CRYPTO,
+                    "Spillover cryptodev %u not available\n",
+                    params->spillover_dev);
+            return -1;
+        }
+
+        rte_cryptodev_info_get(params->spillover_dev, &dev_info);
+
+        if (cryptodev_aead_check(&dev_info, RTE_CRYPTO_AEAD_AES_CCM) < 0) {
+            RTE_LOG(CRIT, RWPA_CRYPTO,
+                    "Algorithm %s not supported by spillover cryptodev %u\n",
+                    rte_crypto_aead_algorithm_strings[RTE_CRYPTO_AEAD_AES_CCM],
+                    params->spillover_dev);
+            return -1;
+        }
+
+        cryptodev_gcm_check(params->spillover_dev, &dev_info);
+        max_sessions = cryptodev_max_sessions_check(max_sessions,
+                                                    params->spillover_dev,
+                                                    &dev_info);
+        spill_cdev_id = params->spillover_dev;
+        crypto_devs[n_crypto_devs].cdev_id = spill_cdev_id;
+        crypto_devs[n_crypto_devs].driver_id = dev_info.driver_id;
+        n_crypto_devs++;
+    }
+
+    n_max_sessions = max_sessions;
+
+    /*
+     * the session pool elements must fit the private data of
+     * any of the devices
+     */
+    for (i = 0; i < n_crypto_devs; i++) {
+        sess_sz = RTE_MAX(sess_sz,
+                          rte_cryptodev_get_private_session_size(
+                              crypto_devs[i].cdev_id));
+        if (cryptodev_driver_first(i))
+            n_drivers++;
+    }
 
     /*
      * Create enough objects for session headers and
-     * device private data
+     * device private data of each driver
      */
     session_pool = rte_mempool_create("session_pool",
-                                      max_sessions * 2,
+                                      max_sessions * (1 + n_drivers),
                                       sess_sz,
                                       POOL_CACHE_SIZE,
                                       0, NULL, NULL, NULL,
@@ -299,8 +508,33 @@ cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
         return -1;
     }
 
+    for (i = 0; i < n_crypto_devs; i++) {
+        if (cryptodev_setup(crypto_devs[i].cdev_id, params->n_qp) < 0)
+            return -1;
+
+        RTE_LOG(INFO, RWPA_CRYPTO,
+                "Using cryptodev %u (%s)%s with %u qp(s)\n",
+                crypto_devs[i].cdev_id,
+                rte_cryptodev_driver_name_get(crypto_devs[i].driver_id),
+                crypto_devs[i].cdev_id == spill_cdev_id ?
+                    " for spillover" : "",
+                params->n_qp);
+    }
+
+    return 0;
+}
+
+/* configure the device's qps and start it */
+static int
+cryptodev_setup(uint8_t cdev_id, uint16_t nb_qp)
+{
+    struct rte_cryptodev_config dev_conf;
+    struct rte_cryptodev_qp_conf qp_conf;
+    uint16_t qp;
+    int ret_val;
+
     dev_conf.socket_id = rte_cryptodev_socket_id(cdev_id);
-    dev_conf.nb_queue_pairs = params->n_qp;
+    dev_conf.nb_queue_pairs = nb_qp;
 
     ret_val = rte_cryptodev_configure(cdev_id, &dev_conf);
     if (ret_val < 0) {
@@ -335,7 +569,81 @@ cryptodev_init(struct app_crypto_params *params, uint32_t max_sessions)
         return -1;
     }
 
-    return cdev_id;
+    return 0;
+}
+
+/* check if the device supports an AEAD algo */
+static int
+cryptodev_aead_check(struct rte_cryptodev_info    *dev_info,
+                     enum rte_crypto_aead_algorithm algo)
+{
+    const struct rte_cryptodev_capabilities *cap;
+    uint32_t i = 0;
+
+    cap = &dev_info->capabilities[i];
+    while (cap->op != RTE_CRYPTO_OP_TYPE_UNDEFINED) {
+        if (cap->sym.xform_type == RTE_CRYPTO_SYM_XFORM_AEAD &&
+            cap->sym.aead.algo == algo)
+            return 0;
+        cap = &dev_info->capabilities[++i];
+    }
+
+    return -1;
+}
+
+/*
+ * warn if the device does not support AES-GCM
+ * - only stations with a GCMP key need it, so the device is still used,
+ *   but GCMP keys are refused, as a station may be served by any of
+ *   the devices in use
+ */
+static void
+cryptodev_gcm_check(uint8_t cdev_id, struct rte_cryptodev_info *dev_info)
+{
+    if (cryptodev_aead_check(dev_info, RTE_CRYPTO_AEAD_AES_GCM) < 0) {
+        RTE_LOG(WARNING, RWPA_CRYPTO,
+                "Algorithm %s not supported by cryptodev %u, "
+                "GCMP keys are refused\n",
+                rte_crypto_aead_algorithm_strings[RTE_CRYPTO_AEAD_AES_GCM],
+                cdev_id);
+        gcm_supported = FALSE;
+    }
+}
+
+/* check if the device is the first in use with its driver */
+static int
+cryptodev_driver_first(unsigned idx)
+{
+    unsigned i;
+
+    for (i = 0; i < idx; i++)
+        if (crypto_devs[i].driver_id == crypto_devs[idx].driver_id)
+            return 0;
+
+    return 1;
+}
+
+/*
+ * limit the number of sessions to what a HW device supports
+ * - SW devices keep their session data in the session pool, so are
+ *   only limited by its size
+ */
+static uint32_t
+cryptodev_max_sessions_check(uint32_t max_sessions,
+                             uint8_t cdev_id,
+                             struct rte_cryptodev_info *dev_info)
+{
+    if ((dev_info->feature_flags & RTE_CRYPTODEV_FF_HW_ACCELERATED) &&
+        dev_info->sym.max_nb_sessions > 0 &&
+        dev_info->sym.max_nb_sessions < max_sessions) {
+        RTE_LOG(INFO, RWPA_CRYPTO,
+                "Cryptodev %u supports %u sessions, limiting "
+                "sessions from %u\n",
+                cdev_id, dev_info->sym.max_nb_sessions, max_sessions);
+        return dev_info->sym.max_nb_sessions;
+    }
+
+    return max_sessions;
 }
 
 /* check if the device is enabled by cryptodev_mask */
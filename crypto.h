@@ -47,6 +47,28 @@
 #define IV_OFFSET        (sizeof(struct rte_crypto_op) + \
                           sizeof(struct rte_crypto_sym_op))
 #define AAD_OFFSET       (IV_OFFSET + MAX_IV_LENGTH)
+#define META_OFFSET      (AAD_OFFSET + MAX_AAD_LENGTH)
+
+/*
+ * a thread's channel to the crypto devices
+ * - ops are enqueued to the thread's qp on its main device, and any
+ *   that do not fit are enqueued to the same qp on the spillover
+ *   device, if one is configured
+ * - the ops complete in the order they were enqueued (the downlink
+ *   PNs are assigned before the enqueue), so once ops have spilled,
+ *   the following ones go to the spillover device too until it has
+ *   drained, and it is only dequeued from once the main device has
+ *   no ops left in flight
+ * - nb_main and nb_spilled count the ops in flight on each device
+ */
+struct crypto_chan {
+    uint8_t cdev_id;
+    uint8_t spill_cdev_id;
+    uint8_t has_spill;
+    uint16_t qp;
+    uint32_t nb_main;
+    uint32_t nb_spilled;
+};
 
 void
 crypto_init(struct app_crypto_params *options, uint32_t max_sessions);
@@ -55,7 +77,7 @@ void
 crypto_destroy(void);
 
 struct rte_cryptodev_sym_session *
-crypto_session_alloc(struct rte_crypto_sym_xform *xform, uint16_t qp);
+crypto_session_alloc(struct rte_crypto_sym_xform *xform);
 
 void
 crypto_session_free(struct rte_cryptodev_sym_session *sess);
@@ -63,13 +85,31 @@ crypto_session_free(struct rte_cryptodev_sym_session *sess);
 enum rwpa_status
 crypto_ops_alloc(uint32_t num_ops_alloc, struct rte_crypto_op **ops);
 
+enum rwpa_status
+crypto_chan_init(struct crypto_chan *chan, uint8_t cdev_id, uint16_t qp);
+
 uint16_t
-crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp);
+crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan);
 
 uint16_t
-crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops, uint16_t qp);
+crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan);
 
 uint8_t
 crypto_driver_id_get(void);
 
+uint32_t
+crypto_max_sessions_get(void);
+
+/* Do all the crypto devices in use support AES-GCM */
+int
+crypto_gcm_supported(void);
+
+uint8_t
+crypto_dev_count(void);
+
+uint8_t
+crypto_dev_id_get(uint8_t idx);
+
 #endif // __INCLUDE_CRYPTO_H__
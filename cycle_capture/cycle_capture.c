@@ -33,8 +33,17 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
 #include <rte_common.h>
 #include <rte_memory.h>
+#include <rte_log.h>
 
 #include "r-wpa_global_vars.h"
 #include "cycle_capture.h"
@@ -96,6 +105,108 @@ static const uint32_t cycle_capture_function_num =
                                 sizeof(function_names)/sizeof(function_names[0]);
 static struct cycle_stats *cycle_stats_arr;
 
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+/*
+ * cache miss counter of the calling thread
+ * - opened on the thread's first capture, as a counter counts for the
+ *   thread which opens it
+ * - read from user space with rdpmc, so that it is cheap enough to be
+ *   read around a single function
+ * - not retried if it cannot be opened (e.g. perf_event_paranoid is
+ *   too restrictive), in which case no misses are counted
+ */
+static __thread struct perf_event_mmap_page *pmc_page = NULL;
+static __thread uint8_t pmc_failed = FALSE;
+
+static void
+pmc_open(void)
+{
+    struct perf_event_attr attr;
+    void *page;
+    int fd;
+
+    pmc_failed = TRUE;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+        RTE_LOG(WARNING, RWPA_STATS,
+                "Cache miss counter not available, not counting misses\n");
+        return;
+    }
+
+    page = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ,
+                MAP_SHARED, fd, 0);
+    close(fd);
+    if (page == MAP_FAILED)
+        return;
+
+    if (!((struct perf_event_mmap_page *)page)->cap_user_rdpmc) {
+        RTE_LOG(WARNING, RWPA_STATS,
+                "Cache miss counter cannot be read from user space, "
+                "not counting misses\n");
+        munmap(page, (size_t)sysconf(_SC_PAGESIZE));
+        return;
+    }
+
+    pmc_page = page;
+    pmc_failed = FALSE;
+}
+
+static inline uint64_t
+pmc_rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+
+    asm volatile("rdpmc" : "=a" (lo), "=d" (hi) : "c" (counter));
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t
+pmc_read(void)
+{
+    struct perf_event_mmap_page *pc;
+    uint32_t seq, idx;
+    uint64_t count;
+    int64_t pmc;
+
+    if (unlikely(pmc_page == NULL)) {
+        if (pmc_failed)
+            return 0;
+        pmc_open();
+        if (pmc_page == NULL)
+            return 0;
+    }
+
+    /* see the perf_event_mmap_page description in linux/perf_event.h */
+    pc = pmc_page;
+    do {
+        seq = pc->lock;
+        rte_compiler_barrier();
+        idx = pc->index;
+        count = (uint64_t)pc->offset;
+        if (idx != 0) {
+            pmc = (int64_t)pmc_rdpmc(idx - 1);
+            pmc <<= 64 - pc->pmc_width;
+            pmc >>= 64 - pc->pmc_width;
+            count += (uint64_t)pmc;
+        }
+        rte_compiler_barrier();
+    } while (pc->lock != seq);
+
+    return count;
+}
+#else
+#define pmc_read() (0)
+#endif
+
 void
 cycle_capture_init(void)
 {
@@ -117,6 +228,8 @@ cycle_capture_init(void)
         cycle_stats_arr[i].last_call_cycles = 0;
         cycle_stats_arr[i].total_cycles = 0;
         cycle_stats_arr[i].reset = FALSE;
+        cycle_stats_arr[i].start_misses = 0;
+        cycle_stats_arr[i].total_misses = 0;
     }
 }
 
@@ -136,10 +249,12 @@ cycle_capture_start(enum e_capture_funcs func)
         stats->start_cycles = 0;
         stats->last_call_cycles = 0;
         stats->total_cycles = 0;
+        stats->total_misses = 0;
         stats->reset = FALSE;
     }
 
     stats->last_call_cycles = 0;
+    stats->start_misses = pmc_read();
     cycle_capture_raw_start(&(stats->start_cycles));
 }
 
@@ -154,6 +269,7 @@ cycle_capture_stop(enum e_capture_funcs func)
         return;
 
     cycle_capture_raw_stop(&stop_cycles);
+    stats->total_misses += pmc_read() - stats->start_misses;
     stats->last_call_cycles += stop_cycles - stats->start_cycles;
     stats->total_cycles += stats->last_call_cycles;
     stats->call_count++;
@@ -213,6 +329,7 @@ cycle_capture_copy_last(enum e_capture_funcs to_func,
         to_stats->start_cycles = 0;
         to_stats->last_call_cycles = 0;
         to_stats->total_cycles = 0;
+        to_stats->total_misses = 0;
         to_stats->reset = FALSE;
     }
 
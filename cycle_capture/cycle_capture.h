@@ -151,6 +151,13 @@ struct cycle_stats {
     uint64_t last_call_cycles;
     uint64_t total_cycles;
     uint8_t  reset;
+
+    /*
+     * cache misses between start and stop, only counted when built
+     * with RWPA_CYCLE_CAPTURE_PMC
+     */
+    uint64_t start_misses;
+    uint64_t total_misses;
 };
 
 void
@@ -0,0 +1,378 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+ 
+#include <string.h>
+
+#include <rte_branch_prediction.h>
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_log.h>
+#include <rte_ring.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_udp.h>
+#include <rte_gre.h>
+
+#ifdef RTE_MACHINE_CPUFLAG_SSE4_2
+#include <rte_hash_crc.h>
+#define DEFAULT_HASH_FUNC rte_hash_crc
+#else
+#include <rte_jhash.h>
+#define DEFAULT_HASH_FUNC rte_jhash
+#endif
+
+#include "app.h"
+#include "thread.h"
+#include "r-wpa_global_vars.h"
+#include "counter.h"
+#include "seq_num.h"
+#include "meta.h"
+#include "gre.h"
+#include "dispatch_thread.h"
+
+/*
+ * Dispatch thread
+ * - reads one or more RXQs and spreads the packets across the SWQs
+ *   of a set of uplink or downlink worker threads (one SWQ per worker)
+ * - every packet of a station is sent to the same worker, so the
+ *   station's replay check, vAP fragment reassembly and encrypt
+ *   packet number are only touched by that worker
+ *   - uplink: the worker is picked by hashing the inner source
+ *     (station) MAC of the AP tunnel
+ *   - downlink: the worker is picked by hashing the inner destination
+ *     (station) MAC of the WAG GRE tunnel, or the destination MAC of
+ *     the packet itself in no_wag mode
+ *   - packets which are not tunnel packets (ARP, ICMP etc.) are all
+ *     sent to the first worker
+ */
+
+#define DISPATCH_MAX_SRC_PORTS  APP_MAX_THREAD_PKTQ_IN
+#define DISPATCH_MAX_WORKERS    APP_MAX_THREAD_PKTQ_OUT
+
+#define DISPATCH_HASH_INIT_VAL  0
+
+enum dispatch_key {
+    DISPATCH_KEY_UL_STA_MAC,
+    DISPATCH_KEY_DL_STA_MAC,
+};
+
+/*
+ * Dispatch thread context
+ */
+struct dispatch_ctx {
+    struct app_thread_params *tp;
+    enum dispatch_key key;
+    int no_wag;
+    unsigned nb_src_ports;
+    struct src_port_params src_ports[DISPATCH_MAX_SRC_PORTS];
+    unsigned nb_workers;
+    struct rte_ring *workers[DISPATCH_MAX_WORKERS];
+    struct pkt_buffer worker_bufs[DISPATCH_MAX_WORKERS];
+    uint64_t nb_dispatched[DISPATCH_MAX_WORKERS];
+    uint64_t nb_dropped[DISPATCH_MAX_WORKERS];
+} __rte_cache_aligned;
+
+extern volatile int force_quit;
+
+static void *
+thread_dispatch_init(struct app_thread_params *p, void *arg)
+{
+    unsigned lcore_id, socket_id, i;
+    struct dispatch_ctx *ctx;
+    struct app_thread_params *tp_worker;
+    struct app_params *app = (struct app_params *)arg;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    /* check number of ports */
+    if (p->n_ports_in == 0 || p->n_ports_in > DISPATCH_MAX_SRC_PORTS)
+        rte_exit(EXIT_FAILURE,
+                 "%s: between 1 and %d src ports must be assigned to dispatch\n",
+                 p->name, DISPATCH_MAX_SRC_PORTS);
+
+    if (p->n_ports_out == 0 || p->n_ports_out > DISPATCH_MAX_WORKERS)
+        rte_exit(EXIT_FAILURE,
+                 "%s: between 1 and %d dst SWQs must be assigned to dispatch\n",
+                 p->name, DISPATCH_MAX_WORKERS);
+
+    ctx = rte_zmalloc_socket(p->name, sizeof(struct dispatch_ctx),
+                             RTE_CACHE_LINE_SIZE, socket_id);
+    if (ctx == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Could not allocate context for %s\n", p->name);
+
+    ctx->tp = p;
+
+    /* get src port info */
+    ctx->nb_src_ports = p->n_ports_in;
+    for (i = 0; i < ctx->nb_src_ports; i++) {
+        ctx->src_ports[i].port_id =
+            thread_port_in_get_id(&p->port_in[i]);
+        ctx->src_ports[i].queue_id =
+            thread_port_in_get_queue_id(&p->port_in[i]);
+    }
+
+    /* get worker SWQs */
+    ctx->nb_workers = p->n_ports_out;
+    for (i = 0; i < ctx->nb_workers; i++) {
+        ctx->workers[i] = thread_port_out_get_ring(&p->port_out[i]);
+        if (ctx->workers[i] == NULL)
+            rte_exit(EXIT_FAILURE,
+                     "%s: dst port %u is not a SWQ\n", p->name, i);
+    }
+
+    /*
+     * the steering key depends on the workers' direction, which
+     * has been checked to be the same for all workers
+     */
+    tp_worker = app_swq_get_reader(app,
+                    &app->swq_params[p->pktq_out[0].id]);
+    if (tp_worker != NULL &&
+        strcmp(tp_worker->type, "DOWNLINK_THREAD") == 0)
+        ctx->key = DISPATCH_KEY_DL_STA_MAC;
+    else
+        ctx->key = DISPATCH_KEY_UL_STA_MAC;
+    ctx->no_wag = app->misc_params.no_wag;
+
+    RTE_LOG(INFO, RWPA_DISPATCH,
+            "%s (%s): Initializing on lcore %u (socket %u), "
+            "%u src port(s), %u %s worker(s)\n",
+            p->name, p->type, lcore_id, socket_id,
+            ctx->nb_src_ports, ctx->nb_workers,
+            ctx->key == DISPATCH_KEY_DL_STA_MAC ? "downlink" : "uplink");
+
+    return ctx;
+}
+
+/*
+ * get the worker for an AP tunnel packet
+ * - hashes the source MAC of the inner Ethernet header, i.e. the
+ *   station's MAC, which is in the first (or only) vAP fragment and
+ *   every subsequent one
+ */
+static inline unsigned
+ap_tunnel_worker_get(struct dispatch_ctx *ctx, struct rte_mbuf *m)
+{
+    struct ether_hdr *eth_hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
+    struct ipv4_hdr *ip_hdr = (struct ipv4_hdr *)&eth_hdr[1];
+    struct ether_hdr *inner_eth_hdr;
+    uint16_t offset = sizeof(struct ether_hdr) + sizeof(struct ipv4_hdr);
+
+    if (unlikely(eth_hdr->ether_type != rte_cpu_to_be_16(ETHER_TYPE_IPv4)))
+        return 0;
+
+#ifndef RWPA_AP_TUNNELLING_GRE
+    if (unlikely(ip_hdr->next_proto_id != IPPROTO_UDP))
+        return 0;
+
+    offset += sizeof(struct udp_hdr);
+#else
+    struct gre_hdr *gre_hdr = (struct gre_hdr *)&ip_hdr[1];
+
+    if (unlikely(ip_hdr->next_proto_id != IPPROTO_GRE))
+        return 0;
+
+    offset += sizeof(struct gre_hdr);
+    if (gre_hdr->c) offset += GRE_CKSUM_SZ;
+    if (gre_hdr->k) offset += GRE_KEY_SZ;
+    if (gre_hdr->s) offset += GRE_SEQ_SZ;
+#endif
+
+    if (unlikely(rte_pktmbuf_data_len(m) < offset + sizeof(struct ether_hdr)))
+        return 0;
+
+    inner_eth_hdr = rte_pktmbuf_mtod_offset(m, struct ether_hdr *, offset);
+
+    return DEFAULT_HASH_FUNC(&(inner_eth_hdr->s_addr), ETHER_ADDR_LEN,
+                             DISPATCH_HASH_INIT_VAL) % ctx->nb_workers;
+}
+
+/*
+ * get the worker for a downlink packet
+ * - hashes the destination MAC of the inner Ethernet header of the
+ *   WAG GRE tunnel, i.e. the station's MAC
+ * - in no_wag mode the packets are not tunnelled, so the destination
+ *   MAC of the packet itself is used
+ */
+static inline unsigned
+wag_tunnel_worker_get(struct dispatch_ctx *ctx, struct rte_mbuf *m)
+{
+    struct ether_hdr *eth_hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
+    struct ipv4_hdr *ip_hdr = (struct ipv4_hdr *)&eth_hdr[1];
+    struct gre_hdr *gre_hdr = (struct gre_hdr *)&ip_hdr[1];
+    struct ether_hdr *inner_eth_hdr;
+    uint16_t offset = sizeof(struct ether_hdr) + sizeof(struct ipv4_hdr) +
+                      sizeof(struct gre_hdr);
+
+    if (ctx->no_wag)
+        return DEFAULT_HASH_FUNC(&(eth_hdr->d_addr), ETHER_ADDR_LEN,
+                                 DISPATCH_HASH_INIT_VAL) % ctx->nb_workers;
+
+    if (unlikely(eth_hdr->ether_type != rte_cpu_to_be_16(ETHER_TYPE_IPv4)))
+        return 0;
+
+    if (unlikely(ip_hdr->next_proto_id != IPPROTO_GRE))
+        return 0;
+
+    if (gre_hdr->c) offset += GRE_CKSUM_SZ;
+    if (gre_hdr->k) offset += GRE_KEY_SZ;
+    if (gre_hdr->s) offset += GRE_SEQ_SZ;
+
+    if (unlikely(rte_pktmbuf_data_len(m) < offset + sizeof(struct ether_hdr)))
+        return 0;
+
+    inner_eth_hdr = rte_pktmbuf_mtod_offset(m, struct ether_hdr *, offset);
+
+    return DEFAULT_HASH_FUNC(&(inner_eth_hdr->d_addr), ETHER_ADDR_LEN,
+                             DISPATCH_HASH_INIT_VAL) % ctx->nb_workers;
+}
+
+static inline void
+dispatch_packets(struct dispatch_ctx *ctx, struct pkt_buffer *pkts_in)
+{
+    unsigned i, w;
+
+    for (i = 0; i < pkts_in->len; i++)
+        rte_prefetch0(rte_pktmbuf_mtod(pkts_in->buffer[i], void *));
+
+    /* sort the packets by worker, keeping their order */
+    for (i = 0; i < pkts_in->len; i++) {
+        struct rte_mbuf *m = pkts_in->buffer[i];
+        struct pkt_buffer *buf;
+
+        if (ctx->key == DISPATCH_KEY_DL_STA_MAC)
+            w = wag_tunnel_worker_get(ctx, m);
+        else
+            w = ap_tunnel_worker_get(ctx, m);
+        buf = &(ctx->worker_bufs[w]);
+        buf->buffer[buf->len++] = m;
+    }
+
+    /* pass the packets to the workers */
+    for (w = 0; w < ctx->nb_workers; w++) {
+        struct pkt_buffer *buf = &(ctx->worker_bufs[w]);
+        unsigned nb_enq;
+
+        if (buf->len == 0)
+            continue;
+
+        nb_enq = rte_ring_sp_enqueue_burst(ctx->workers[w],
+                                           (void **)buf->buffer,
+                                           buf->len, NULL);
+
+        ctx->nb_dispatched[w] += nb_enq;
+
+        /* worker is not keeping up, drop what didn't fit */
+        if (unlikely(nb_enq < buf->len)) {
+            ctx->nb_dropped[w] += buf->len - nb_enq;
+            for (i = nb_enq; i < buf->len; i++)
+                rte_pktmbuf_free(buf->buffer[i]);
+        }
+
+        buf->len = 0;
+    }
+}
+
+static void
+dispatch_main_loop(struct dispatch_ctx *ctx)
+{
+    struct pkt_buffer pkts_in __rte_cache_aligned;
+    unsigned i;
+
+    while (!force_quit) {
+        for (i = 0; i < ctx->nb_src_ports; i++) {
+            pkts_in.len = rte_eth_rx_burst(ctx->src_ports[i].port_id,
+                                           ctx->src_ports[i].queue_id,
+                                           pkts_in.buffer, MAX_PKT_BURST);
+
+            if (likely(pkts_in.len))
+                dispatch_packets(ctx, &pkts_in);
+        }
+    }
+}
+
+static int
+thread_dispatch_run(void *arg)
+{
+    struct dispatch_ctx *ctx = (struct dispatch_ctx *)arg;
+    unsigned lcore_id, socket_id;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    RTE_LOG(INFO, RWPA_DISPATCH,
+            "%s (%s): Entering main loop on lcore %u (socket %u)\n",
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
+
+    dispatch_main_loop(ctx);
+
+    return 0;
+}
+
+static int
+thread_dispatch_free(void *arg)
+{
+    struct dispatch_ctx *ctx = (struct dispatch_ctx *)arg;
+    unsigned lcore_id, socket_id, i;
+
+    lcore_id = rte_lcore_id();
+    socket_id = rte_socket_id();
+
+    RTE_LOG(INFO, RWPA_DISPATCH,
+            "%s (%s): Freeing on lcore %u (socket %u)\n",
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
+
+    for (i = 0; i < ctx->nb_workers; i++)
+        RTE_LOG(INFO, RWPA_DISPATCH,
+                "%s: worker %u dispatched %" PRIu64 " dropped %" PRIu64 "\n",
+                ctx->tp->name, i,
+                ctx->nb_dispatched[i], ctx->nb_dropped[i]);
+
+    rte_free(ctx);
+
+    return 0;
+}
+
+static struct thread_ops_s thread_dispatch_ops = {
+    .f_init = thread_dispatch_init,
+    .f_free = thread_dispatch_free,
+    .f_run  = thread_dispatch_run,
+};
+
+struct thread_type thread_dispatch = {
+    .name = "DISPATCH_THREAD",
+    .thread_ops = &thread_dispatch_ops,
+};
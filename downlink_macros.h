@@ -45,7 +45,7 @@
 
 #if !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define _STORE_STA_BULK_LOOKUP_STATS(n, f)                                     \
+#define _STORE_STA_BULK_LOOKUP_STATS(n, f, h)                                  \
 ({                                                                             \
      uint8_t matched = 0;                                                      \
      for (unsigned int i = 0; i < n; i++) {                                    \
@@ -60,6 +60,8 @@
          stats->matched += matched;                                            \
          stats->unmatched += n - matched;                                      \
          stats->num_pkts += n;                                                 \
+         stats->cache_hits += h;                                               \
+         stats->cache_misses += n - h;                                         \
          stats->last_burst[                                                    \
              stats->last_burst_index++ %                                       \
              STA_LOOKUP_BURST_LEN] = n;                                        \
@@ -69,7 +71,7 @@
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define _STORE_STA_BULK_LOOKUP_STATS(n, f)                                     \
+#define _STORE_STA_BULK_LOOKUP_STATS(n, f, h)                                  \
      do {} while(0)
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -426,8 +428,8 @@
 
 #define STORE_STA_BULK_LOOKUP(a, n, f)                                         \
 ({                                                                             \
-     store_sta_bulk_lookup(a, n, f);                                           \
-     _STORE_STA_BULK_LOOKUP_STATS(n, f);                                       \
+     uint32_t nb_hits = store_sta_bulk_lookup(a, n, f);                        \
+     _STORE_STA_BULK_LOOKUP_STATS(n, f, nb_hits);                              \
 })
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -437,8 +439,12 @@
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_LOCK(s)                    sta_read_lock(s)
-#define STA_ENCRYPT_DATA_GET(s, a, c, v)    sta_encrypt_data_get(s, a, c, v)
+#define STA_REF_GET(m, r)                                                      \
+({                                                                             \
+     (m)->store_idx = (r);                                                     \
+     store_read_ref_get(r);                                                    \
+})
+#define STA_ENCRYPT_DATA_GET(s, a, c, v, k) sta_encrypt_data_get(s, a, c, v, k)
 #define ETHER_TO_IEEE80211_CONVERT(m, meta) ether_to_ieee80211_convert(m, meta)
 #define CCMP_HDR_GENERATE(p, k, h) ccmp_hdr_generate(p, k, h)
 
@@ -451,9 +457,9 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _CCMP_BURST_DEQUEUE_CALL_STATS;                                           \
      deq;                                                                      \
 })
@@ -463,12 +469,12 @@
 #define CCMP_BURST_ENQUEUE(b, l, m, o, q, s)                                   \
      ccmp_burst_enqueue(b, l, m, o, q, s)
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
-     ccmp_burst_dequeue(b, l, q, n, s)
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
+     ccmp_burst_dequeue(b, m, l, q, n, s)
 
 #endif // !defined RWPA_STATS_CAPTURE_CRYPTO_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_UNLOCK(s)                  sta_read_unlock(s)
+#define STA_REF_PUT(m)                      store_read_ref_put((m)->store_idx)
 #define VAP_TLV_ENCAP(m)                    vap_tlv_encap(m)
 #define VAP_PAYLOAD_FRAGMENT(m, fo, nfo, hm, dm)                               \
                                             vap_payload_fragment(m, fo, nfo, hm ,dm)
@@ -518,9 +524,9 @@
 #define STORE_STA_BULK_LOOKUP(a, n, f)                                         \
 ({                                                                             \
      _DL_STA_LOOKUP_CYCLE_CAPTURE_START;                                       \
-     store_sta_bulk_lookup(a, n, f);                                           \
+     uint32_t nb_hits = store_sta_bulk_lookup(a, n, f);                        \
      _DL_STA_LOOKUP_CYCLE_CAPTURE_STOP;                                        \
-     _STORE_STA_BULK_LOOKUP_STATS(n, f);                                       \
+     _STORE_STA_BULK_LOOKUP_STATS(n, f, nb_hits);                              \
 })
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -534,17 +540,18 @@
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_LOCK(s)                                                       \
+#define STA_REF_GET(m, r)                                                      \
 ({                                                                             \
      _DL_STA_LOCK_CYCLE_CAPTURE_START;                                         \
-     sta_read_lock(s);                                                         \
+     (m)->store_idx = (r);                                                     \
+     store_read_ref_get(r);                                                    \
      _DL_STA_LOCK_CYCLE_CAPTURE_STOP;                                          \
 })
 
-#define STA_ENCRYPT_DATA_GET(s, a, c, v)                                       \
+#define STA_ENCRYPT_DATA_GET(s, a, c, v, k)                                    \
 ({                                                                             \
      _DL_STA_ENCRYPT_DATA_GET_CYCLE_CAPTURE_START;                             \
-     sta_encrypt_data_get(s, a, c, v);                                         \
+     sta_encrypt_data_get(s, a, c, v, k);                                      \
      _DL_STA_ENCRYPT_DATA_GET_CYCLE_CAPTURE_STOP;                              \
 })
 
@@ -575,10 +582,10 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
      _DL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_START;                                   \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _DL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_STOP;                                    \
      _CCMP_BURST_DEQUEUE_CALL_STATS;                                           \
      deq;                                                                      \
@@ -594,20 +601,20 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
      _DL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_START;                                   \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _DL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_STOP;                                    \
      deq;                                                                      \
 })
 
 #endif // !defined RWPA_STATS_CAPTURE_CRYPTO_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_UNLOCK(s)                                                     \
+#define STA_REF_PUT(m)                                                         \
 ({                                                                             \
      _DL_STA_UNLOCK_CYCLE_CAPTURE_START;                                       \
-     sta_read_unlock(s);                                                       \
+     store_read_ref_put((m)->store_idx);                                       \
      _DL_STA_UNLOCK_CYCLE_CAPTURE_STOP;                                        \
 })
 
@@ -61,6 +61,7 @@
 #include "ieee80211.h"
 #include "crypto.h"
 #include "ccmp.h"
+#include "ccmp_inline.h"
 #include "convert.h"
 #include "vap_frag.h"
 #include "cycle_capture.h"
@@ -82,35 +83,49 @@
 #define DL_TP_FRAG_HDR_MEMPOOL_ID  "frag_hdr_mempool_id"
 #define DL_TP_FRAG_DATA_MEMPOOL_ID "frag_data_mempool_id"
 
+/*
+ * Downlink thread context
+ * - one of these is allocated per DOWNLINK_THREAD instance, so that
+ *   several downlink threads can run in parallel, each one reading
+ *   its own RXQ and writing to its own TXQs and crypto qp
+ */
+struct downlink_ctx {
+    struct app_thread_params *tp;
+    struct src_port_params src_ports[DL_NUM_SRC_PORTS];
+    struct dst_port_params dst_ports[DL_NUM_DST_PORTS];
+    struct crypto_chan crypto_chan;
+    uint8_t crypto_async;
+    uint16_t nb_crypto_inflight;
+    struct rte_mempool *frag_hdr_mempool;
+    struct rte_mempool *frag_data_mempool;
+} __rte_cache_aligned;
+
 extern volatile int force_quit;
 struct app_params *g_app;
 
-static struct app_thread_params *tp_downlink;
 static struct app_addr_params *addr_params;
 
-static struct src_port_params src_ports[DL_NUM_SRC_PORTS];
-static struct dst_port_params dst_ports[DL_NUM_DST_PORTS];
-
 struct ether_addr *vnfd_eth_addr_to_ap;
 struct ether_addr *vnfd_eth_addr_to_wag;
 
-static uint32_t frag_hdr_mempool_id;
-static uint32_t frag_data_mempool_id;
+static uint8_t dl_src_port_id;
 
 static void *
 thread_downlink_init(struct app_thread_params *p, void *arg)
 {
     unsigned lcore_id, socket_id;
+    struct downlink_ctx *ctx;
+    uint32_t frag_hdr_mempool_id;
+    uint32_t frag_data_mempool_id;
 
     g_app = (struct app_params *)arg;
-    tp_downlink = p;
     addr_params = &g_app->addr_params;
 
     lcore_id = rte_lcore_id();
     socket_id = rte_socket_id();
 
-    unsigned n_ports_in = tp_downlink->n_ports_in;
-    unsigned n_ports_out = tp_downlink->n_ports_out;
+    unsigned n_ports_in = p->n_ports_in;
+    unsigned n_ports_out = p->n_ports_out;
 
     /* check number of ports */
     if (n_ports_in > DL_NUM_SRC_PORTS || n_ports_out > DL_NUM_DST_PORTS)
@@ -122,42 +137,68 @@ thread_downlink_init(struct app_thread_params *p, void *arg)
                  "Must be exactly %d ports assigned to downlink\n",
                  DL_NUM_PORTS);
 
+    ctx = rte_zmalloc_socket(p->name, sizeof(struct downlink_ctx),
+                             RTE_CACHE_LINE_SIZE, socket_id);
+    if (ctx == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Could not allocate context for %s\n", p->name);
+
+    ctx->tp = p;
+
+    if (crypto_chan_init(&ctx->crypto_chan, p->crypto_dev,
+                         p->crypto_qp) != RWPA_STS_OK)
+        rte_exit(EXIT_FAILURE,
+                 "Could not set up crypto qp %u for %s\n",
+                 p->crypto_qp, p->name);
+
+    ctx->crypto_async = g_app->crypto_params.async ? TRUE : FALSE;
+
+    /* create this lcore's queue of inline crypto results */
+    if (g_app->crypto_params.engine == CCMP_ENGINE_INLINE)
+        ccmp_inline_lcore_init();
+
     /* get src port info */
-    src_ports[DL_SRC_PORT].port_id =
-        thread_port_in_get_id(&tp_downlink->port_in[DL_SRC_PORT]);
+    ctx->src_ports[DL_SRC_PORT].port_id =
+        thread_port_in_get_id(&p->port_in[DL_SRC_PORT]);
+    ctx->src_ports[DL_SRC_PORT].ring =
+        thread_port_in_get_ring(&p->port_in[DL_SRC_PORT]);
+    if (ctx->src_ports[DL_SRC_PORT].ring == NULL)
+        ctx->src_ports[DL_SRC_PORT].queue_id =
+            thread_port_in_get_queue_id(&p->port_in[DL_SRC_PORT]);
+    dl_src_port_id = ctx->src_ports[DL_SRC_PORT].port_id;
 
     /* get AP dest port info */
-    dst_ports[DL_DST_PORT_AP].port_id =
-        thread_port_out_get_id(&tp_downlink->port_out[DL_DST_PORT_AP]);
-    dst_ports[DL_DST_PORT_AP].queue_id =
-        thread_port_out_get_queue_id(&tp_downlink->port_out[DL_DST_PORT_AP]);
-    dst_ports[DL_DST_PORT_AP].tx_buffer =
-        thread_port_out_get_tx_buffer(&tp_downlink->port_out[DL_DST_PORT_AP]);
+    ctx->dst_ports[DL_DST_PORT_AP].port_id =
+        thread_port_out_get_id(&p->port_out[DL_DST_PORT_AP]);
+    ctx->dst_ports[DL_DST_PORT_AP].queue_id =
+        thread_port_out_get_queue_id(&p->port_out[DL_DST_PORT_AP]);
+    ctx->dst_ports[DL_DST_PORT_AP].tx_buffer =
+        thread_port_out_get_tx_buffer(&p->port_out[DL_DST_PORT_AP]);
 
     /* get WAG dest port info */
-    dst_ports[DL_DST_PORT_WAG].port_id =
-        thread_port_out_get_id(&tp_downlink->port_out[DL_DST_PORT_WAG]);
-    dst_ports[DL_DST_PORT_WAG].queue_id =
-        thread_port_out_get_queue_id(&tp_downlink->port_out[DL_DST_PORT_WAG]);
-    dst_ports[DL_DST_PORT_WAG].tx_buffer =
-        thread_port_out_get_tx_buffer(&tp_downlink->port_out[DL_DST_PORT_WAG]);
+    ctx->dst_ports[DL_DST_PORT_WAG].port_id =
+        thread_port_out_get_id(&p->port_out[DL_DST_PORT_WAG]);
+    ctx->dst_ports[DL_DST_PORT_WAG].queue_id =
+        thread_port_out_get_queue_id(&p->port_out[DL_DST_PORT_WAG]);
+    ctx->dst_ports[DL_DST_PORT_WAG].tx_buffer =
+        thread_port_out_get_tx_buffer(&p->port_out[DL_DST_PORT_WAG]);
 
     /* save vnfd ethernet addresses from link parameters */
-    vnfd_eth_addr_to_ap = &g_app->link_params[dst_ports[DL_DST_PORT_AP].port_id].mac_addr;
-    vnfd_eth_addr_to_wag = &g_app->link_params[dst_ports[DL_DST_PORT_WAG].port_id].mac_addr;
+    vnfd_eth_addr_to_ap = &g_app->link_params[ctx->dst_ports[DL_DST_PORT_AP].port_id].mac_addr;
+    vnfd_eth_addr_to_wag = &g_app->link_params[ctx->dst_ports[DL_DST_PORT_WAG].port_id].mac_addr;
 
     /* find the fragmentation mempool ids */
     int frag_hdr_mempool_id_rd_sts = -1;
     int frag_data_mempool_id_rd_sts = -1;
-    for (uint32_t i = 0; i < tp_downlink->n_args; i++) {
-        if (strcmp(tp_downlink->args_name[i], DL_TP_FRAG_HDR_MEMPOOL_ID) == 0) {
+    for (uint32_t i = 0; i < p->n_args; i++) {
+        if (strcmp(p->args_name[i], DL_TP_FRAG_HDR_MEMPOOL_ID) == 0) {
             frag_hdr_mempool_id_rd_sts =
                                  parser_read_uint32(&frag_hdr_mempool_id,
-                                                    tp_downlink->args_value[i]);
-        } else if (strcmp(tp_downlink->args_name[i], DL_TP_FRAG_DATA_MEMPOOL_ID) == 0) {
+                                                    p->args_value[i]);
+        } else if (strcmp(p->args_name[i], DL_TP_FRAG_DATA_MEMPOOL_ID) == 0) {
             frag_data_mempool_id_rd_sts =
                                  parser_read_uint32(&frag_data_mempool_id,
-                                                    tp_downlink->args_value[i]);
+                                                    p->args_value[i]);
         }
     }
     if (frag_hdr_mempool_id_rd_sts != 0 ||
@@ -167,19 +208,258 @@ thread_downlink_init(struct app_thread_params *p, void *arg)
                  frag_hdr_mempool_id_rd_sts != 0 ?
                      DL_TP_FRAG_HDR_MEMPOOL_ID :
                      DL_TP_FRAG_DATA_MEMPOOL_ID,
-                 tp_downlink->name);
+                 p->name);
+
+    ctx->frag_hdr_mempool = g_app->mempool[frag_hdr_mempool_id];
+    ctx->frag_data_mempool = g_app->mempool[frag_data_mempool_id];
 
     RTE_LOG(INFO, RWPA_DL,
-            "%s (%s): Initializing on lcore %u (socket %u)\n",
-            tp_downlink->name, tp_downlink->type, lcore_id, socket_id);
+            "%s (%s): Initializing on lcore %u (socket %u), "
+            "RX %s (port %u), cryptodev %u qp %u (%s)\n",
+            p->name, p->type, lcore_id, socket_id,
+            p->pktq_in[DL_SRC_PORT].type == APP_PKTQ_IN_SWQ ?
+                g_app->swq_params[p->pktq_in[DL_SRC_PORT].id].name :
+                g_app->hwq_in_params[p->pktq_in[DL_SRC_PORT].id].name,
+            ctx->src_ports[DL_SRC_PORT].port_id,
+            ctx->crypto_chan.cdev_id, ctx->crypto_chan.qp,
+            ctx->crypto_async ? "async" : "sync");
+
+    return ctx;
+}
+
+/*
+ * POST CRYPTO PROCESSING
+ * - the station is still referenced, but the vAP is not locked, see
+ *   the NOTEs below on accessing it
+ */
+static inline void
+data_packet_post_crypto_process(struct downlink_ctx *ctx,
+                                struct rte_mbuf *m,
+                                struct rwpa_meta *meta)
+{
+    unsigned j;
+
+    rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+
+    /*
+     * VAP TLV ENCAP
+     * - add the vAP TLV
+     */
+    if (unlikely(VAP_TLV_ENCAP(m) != RWPA_STS_OK)) {
+        LOG_AND_DROP(m, ERR, RWPA_DL,
+                     "Error adding vAP TLV, dropping\n",
+                     STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
 
-    return NULL;
+    } else {
+        /*
+         * FRAGMENTATION NOT REQUIRED
+         */
+        if (likely(rte_pktmbuf_data_len(m) <= g_app->misc_params.max_vap_frag_sz)) {
+            /*
+             * VAP HEADER ENCAP
+             * - add the inner Ethernet and vAP headers
+             */
+            if (unlikely(VAP_HDR_ENCAP(m,
+                                       FALSE, FALSE, 0,
+                                       vnfd_eth_addr_to_ap,
+                                       meta->p_sta_addr) != RWPA_STS_OK)) {
+                LOG_AND_DROP(m, ERR, RWPA_DL,
+                             "Error adding vAP headers, dropping\n",
+                             STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
+
+            /*
+             * AP TUNNEL ENCAP
+             * - add the outer Ethernet, IP and UDP/GRE headers
+             * - NOTE: not locking the vap element before accessing the
+             *   tunnel addresses, as these addresses should hardly ever
+             *   change
+             *   - even if the vap element is being/has been reset and
+             *     garbage addresses are used, it's not a big deal as
+             *     that vap is no longer live and the packet won't be
+             *     delivered through it anyways
+             */
+            } else if (unlikely(meta->vap == NULL ||
+                                AP_TUNNEL_ENCAP(m,
+                                                addr_params->vnfd_port_to_ap,
+                                                addr_params->vnfd_ip_to_ap,
+                                                vnfd_eth_addr_to_ap,
+                                                meta->vap->tun_port,
+                                                meta->vap->tun_ip,
+                                                &(meta->vap->tun_mac)) != RWPA_STS_OK)) {
+                LOG_AND_DROP(m, ERR, RWPA_DL,
+                             "Error adding AP tunnel headers, dropping\n",
+                             STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
+
+            /*
+             * WRITE TO TX BUFFER
+             */
+            } else {
+                RTE_ETH_TX_BUFFER(ctx->dst_ports[DL_DST_PORT_AP].port_id,
+                                  ctx->dst_ports[DL_DST_PORT_AP].queue_id,
+                                  ctx->dst_ports[DL_DST_PORT_AP].tx_buffer, m);
+            }
+        /*
+         * FRAGMENTATION REQUIRED
+         */
+        } else {
+            struct rte_mbuf *frags[MAX_FRAGS_PER_PKT];
+
+            /*
+             * FRAGMENT
+             */
+            if (unlikely(VAP_PAYLOAD_FRAGMENT(
+                             m, frags, MAX_FRAGS_PER_PKT,
+                             ctx->frag_hdr_mempool,
+                             ctx->frag_data_mempool) != RWPA_STS_OK)) {
+                LOG_AND_DROP(m, ERR, RWPA_DL,
+                             "Error fragmenting packet, dropping\n",
+                             STATS_DL_DROPS_TYPE_FRAGMENTATION_ERROR);
+            } else {
+                /*
+                 * after fragmenting, each fragment will be made up
+                 * of 2 mbufs
+                 * - the 1st mbuf is a direct mbuf and will be empty
+                 *   - the remaining vAP and GRE headers will be
+                 *     put in this mbuf
+                 * - the 2nd mbuf is an indirect mbuf pointing to
+                 *   the vAP payload in the original mbuf
+                 */
+
+                /* free the original mbuf */
+                rte_pktmbuf_free(m);
+
+                /*
+                 * get the next fragment sequence number
+                 * for this station's vAP
+                 */
+                seq_num_val_t frag_seq_num =
+                                  vap_next_frag_seq_num_get(meta->vap);
+
+                /* loop through each fragment */
+                for (j = 0; j < MAX_FRAGS_PER_PKT && frags[j] != NULL; j++) {
+                    /*
+                     * VAP HEADER ENCAP
+                     * - add the inner Ethernet and vAP headers
+                     */
+                    uint8_t last = ((j + 1 == MAX_FRAGS_PER_PKT ||
+                                     frags[j + 1] == NULL) ? TRUE : FALSE);
+                    if (unlikely(VAP_HDR_ENCAP(frags[j],
+                                               TRUE, last, frag_seq_num,
+                                               vnfd_eth_addr_to_ap,
+                                               meta->p_sta_addr) != RWPA_STS_OK)) {
+                        LOG_AND_DROP(frags[j], ERR, RWPA_DL,
+                                     "Error adding vAP headers, dropping\n",
+                                     STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
+
+                    /*
+                     * AP TUNNEL ENCAP
+                     * - add the outer Ethernet, IP and UDP/GRE headers
+                     * - NOTE: not locking the vap element before accessing the
+                     *   tunnel addresses, as these addresses should hardly ever
+                     *   change
+                     *   - even if the vap element is being/has been reset and
+                     *     garbage addresses are used, it's not a big deal as
+                     *     that vap is no longer live and the packet won't be
+                     *     delivered through it anyways
+                     */
+                    } else if (unlikely(meta->vap == NULL ||
+                                        AP_TUNNEL_ENCAP(frags[j],
+                                                        addr_params->vnfd_port_to_ap,
+                                                        addr_params->vnfd_ip_to_ap,
+                                                        vnfd_eth_addr_to_ap,
+                                                        meta->vap->tun_port,
+                                                        meta->vap->tun_ip,
+                                                        &(meta->vap->tun_mac)) != RWPA_STS_OK)) {
+                        LOG_AND_DROP(frags[j], ERR, RWPA_DL,
+                                     "Error adding AP tunnel headers, dropping\n",
+                                     STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
+
+                    /*
+                     * WRITE TO TX BUFFER
+                     */
+                    } else {
+                        RTE_ETH_TX_BUFFER(ctx->dst_ports[DL_DST_PORT_AP].port_id,
+                                          ctx->dst_ports[DL_DST_PORT_AP].queue_id,
+                                          ctx->dst_ports[DL_DST_PORT_AP].tx_buffer,
+                                          frags[j]);
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+#ifndef RWPA_NO_CRYPTO
+/*
+ * CRYPTO COMPLETIONS
+ * - dequeue a burst of completed crypto ops, finish processing their
+ *   packets and drop the references on their stations
+ * - the meta info of each packet is returned with it, as the burst
+ *   the packet was received in may have been processed already
+ */
+static void
+crypto_completions_process(struct downlink_ctx *ctx)
+{
+    struct rte_mbuf *pkts_crypto_out[MAX_PKT_BURST];
+    struct rwpa_meta meta_crypto_out[MAX_PKT_BURST];
+    uint8_t crypto_deq_success[MAX_PKT_BURST];
+    uint16_t nb_crypto_deq, nb_crypto_deq_success = 0;
+    unsigned i;
+
+    if (ctx->nb_crypto_inflight == 0)
+        return;
+
+    nb_crypto_deq = CCMP_BURST_DEQUEUE(pkts_crypto_out, meta_crypto_out,
+                                       RTE_MIN(ctx->nb_crypto_inflight, MAX_PKT_BURST),
+                                       &ctx->crypto_chan, &nb_crypto_deq_success,
+                                       crypto_deq_success);
+
+    if (nb_crypto_deq == 0)
+        return;
+
+    ctx->nb_crypto_inflight -= nb_crypto_deq;
+
+    CCMP_BURST_DEQUEUE_STATS(nb_crypto_deq, nb_crypto_deq_success);
+
+    /* log error for any failed crypto ops */
+    if (unlikely(nb_crypto_deq_success < nb_crypto_deq)) {
+        DL_DATA_DROP_STAT_INC(STATS_DL_DROPS_TYPE_ENCRYPTION_ERROR,
+                              (nb_crypto_deq - nb_crypto_deq_success));
+
+#ifdef RWPA_EXTRA_DEBUG
+        RTE_LOG(ERR, RWPA_DL,
+                "CCMP encryption failed for %d out of %d "
+                "packets, dropping\n",
+                (nb_crypto_deq - nb_crypto_deq_success),
+                nb_crypto_deq);
+#endif
+    }
+
+    /* free mbuf for any failed crypto ops */
+    for (i = 0; i < nb_crypto_deq; i++) {
+        if (unlikely(crypto_deq_success[i] == FALSE))
+            DROP(pkts_crypto_out[i]);
+    }
+
+    for (i = 0; i < nb_crypto_deq; i++) {
+        if (likely(pkts_crypto_out[i] != NULL))
+            data_packet_post_crypto_process(ctx, pkts_crypto_out[i],
+                                            &meta_crypto_out[i]);
+    }
+
+    /* done with the stations, drop the references taken by their ops */
+    rte_smp_mb();
+    for (i = 0; i < nb_crypto_deq; i++)
+        STA_REF_PUT(&meta_crypto_out[i]);
 }
+#endif
 
 static void
-data_packets_process(struct pkt_buffer *pkts_in)
+data_packets_process(struct downlink_ctx *ctx, struct pkt_buffer *pkts_in)
 {
     unsigned i, j;
+    uint8_t rd;
     struct rte_mbuf *m;
     struct rwpa_meta meta[MAX_PKT_BURST] = {0};
     struct ether_addr *sta_addrs[MAX_PKT_BURST];
@@ -188,22 +468,23 @@ data_packets_process(struct pkt_buffer *pkts_in)
     struct pkt_buffer pkts_crypto_in __rte_cache_aligned;
     struct rwpa_meta *meta_crypto_in[MAX_PKT_BURST] = {0};
 #ifndef RWPA_NO_CRYPTO
-    struct pkt_buffer pkts_crypto_out __rte_cache_aligned;
-    uint16_t nb_crypto_enq, nb_crypto_deq;
-    uint16_t nb_crypto_deq_success, nb_crypto_deq_success_acc;
+    uint16_t nb_crypto_enq;
     uint8_t crypto_enq_success[MAX_PKT_BURST] = {0};
-    uint8_t crypto_deq_success[MAX_PKT_BURST] = {0};
-
-    pkts_crypto_out.len = 0;
 #endif
     pkts_crypto_in.len = 0;
 
     /*
      * RX PROCESSING
+     * - the headers are prefetched PREFETCH_OFFSET packets ahead
      */
-    for (i = 0; i < pkts_in->len; i++) {
+    for (i = 0; i < PREFETCH_OFFSET && i < pkts_in->len; i++)
         rte_prefetch0(rte_pktmbuf_mtod(pkts_in->buffer[i], void *));
 
+    for (i = 0; i < pkts_in->len; i++) {
+        if (i + PREFETCH_OFFSET < pkts_in->len)
+            rte_prefetch0(rte_pktmbuf_mtod(pkts_in->buffer[i + PREFETCH_OFFSET],
+                                           void *));
+
         /*
          * if packet was GRE encapsulated, the GRE headers have
          * already been removed
@@ -217,14 +498,31 @@ data_packets_process(struct pkt_buffer *pkts_in)
     /*
      * STORE LOOKUP
      * - search the store for each of the stations
+     * - the stations found stay valid until the end of the read
+     *   section, or while referenced by their crypto ops
      */
+    rd = store_read_lock();
     STORE_STA_BULK_LOOKUP(sta_addrs, nb_sta_addrs, found);
 
+    /*
+     * the stations are prefetched PREFETCH_STA_OFFSET packets ahead,
+     * and their TX PTKs and vAPs one packet ahead, once the station's
+     * first line is in
+     */
+    for (j = 0; j < PREFETCH_STA_OFFSET && j < nb_sta_addrs; j++)
+        if (found[j] >= 0)
+            sta_prefetch(store_sta_get(found[j]));
+
     for (i = 0, j = 0; i < pkts_in->len; i++) {
         m = pkts_in->buffer[i];
 
         if (likely(m != NULL && j < nb_sta_addrs)) {
-            rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+            if (j + PREFETCH_STA_OFFSET < nb_sta_addrs &&
+                found[j + PREFETCH_STA_OFFSET] >= 0)
+                sta_prefetch(store_sta_get(found[j + PREFETCH_STA_OFFSET]));
+
+            if (j + 1 < nb_sta_addrs && found[j + 1] >= 0)
+                sta_encrypt_data_prefetch(store_sta_get(found[j + 1]));
 
             if (unlikely(!is_unicast_ether_addr(sta_addrs[j]))) {
                 /*
@@ -239,13 +537,14 @@ data_packets_process(struct pkt_buffer *pkts_in)
                  * UNICAST PACKET AND STATION FOUND
                  */
 
-                /* get the station and lock it */
+                /* get the station and reference it */
                 meta[i].sta = store_sta_get(found[j]);
-                STA_READ_LOCK(meta[i].sta);
+                STA_REF_GET(&meta[i], rd);
 
-                /* get the PTK SA, PTK's encrypt counter and vAP */
+                /* get the TX PTK's SA, encrypt counter and KeyID, and vAP */
                 STA_ENCRYPT_DATA_GET(meta[i].sta, &(meta[i].sa),
-                                     &(meta[i].counter), &(meta[i].vap));
+                                     &(meta[i].counter), &(meta[i].vap),
+                                     &(meta[i].key_id));
 
                 /*
                  * check is there a key for this station
@@ -260,7 +559,7 @@ data_packets_process(struct pkt_buffer *pkts_in)
                      */
                     if (unlikely(ETHER_TO_IEEE80211_CONVERT(
                                          m, &meta[i]) != RWPA_STS_OK)) {
-                        STA_READ_UNLOCK(meta[i].sta);
+                        STA_REF_PUT(&meta[i]);
                         LOG_AND_DROP(m, ERR, RWPA_DL,
                                      "Error converting packet to 802.11, dropping\n",
                                      STATS_DL_DROPS_TYPE_WIFI_CONVERT_ERROR);
@@ -273,8 +572,9 @@ data_packets_process(struct pkt_buffer *pkts_in)
                                                     meta[i].wifi_hdr_sz);
 
                         if (unlikely(CCMP_HDR_GENERATE(
-                                         meta[i].counter, 0, ccmp_hdr) != RWPA_STS_OK)) {
-                            STA_READ_UNLOCK(meta[i].sta);
+                                         meta[i].counter, meta[i].key_id,
+                                         ccmp_hdr) != RWPA_STS_OK)) {
+                            STA_REF_PUT(&meta[i]);
                             LOG_AND_DROP(m, ERR, RWPA_DL,
                                          "Error adding CCMP header to packet, dropping\n",
                                          STATS_DL_DROPS_TYPE_WIFI_CONVERT_ERROR);
@@ -293,7 +593,7 @@ data_packets_process(struct pkt_buffer *pkts_in)
                      * NO KEY
                      * - drop the packet
                      */
-                    STA_READ_UNLOCK(meta[i].sta);
+                    STA_REF_PUT(&meta[i]);
                     LOG_AND_DROP(m, ERR, RWPA_DL,
                                  "No key set for station, dropping\n",
                                  STATS_DL_DROPS_TYPE_NO_STATION_KEY);
@@ -314,227 +614,60 @@ data_packets_process(struct pkt_buffer *pkts_in)
 #ifndef RWPA_NO_CRYPTO
     RWPA_CHECK_ARRAY_OFFSET(pkts_crypto_in.len, MAX_PKT_BURST);
 
+    /*
+     * in async mode, make room on the crypto qp for this burst by
+     * completing some of the ops already in flight
+     */
+    while (unlikely(ctx->crypto_async &&
+                    ctx->nb_crypto_inflight + pkts_crypto_in.len > CCMP_MAX_INFLIGHT_OPS))
+        crypto_completions_process(ctx);
+
     /*
      * CCMP ENCRYPTION
      * - enqueue packets for encryption
+     * - the stations stay referenced until their ops are dequeued
      */
     nb_crypto_enq = CCMP_BURST_ENQUEUE(pkts_crypto_in.buffer, pkts_crypto_in.len,
                                        meta_crypto_in, CCMP_OP_ENCRYPT,
-                                       tp_downlink->crypto_qp, crypto_enq_success);
+                                       &ctx->crypto_chan, crypto_enq_success);
 
-    /*
-     * dequeue packets from crypto devices
-     * - the same number of packets that were enqueued must be dequeued
-     * This loop will continue until all crypto ops are dequeued.
-     */
-    nb_crypto_deq_success_acc = 0;
-    do {
-        nb_crypto_deq_success = 0;
-        nb_crypto_deq = CCMP_BURST_DEQUEUE((pkts_crypto_out.buffer + pkts_crypto_out.len),
-                                           (nb_crypto_enq - pkts_crypto_out.len),
-                                           tp_downlink->crypto_qp, &nb_crypto_deq_success,
-                                           (crypto_deq_success + pkts_crypto_out.len));
+    ctx->nb_crypto_inflight += nb_crypto_enq;
 
-        pkts_crypto_out.len += nb_crypto_deq;
-        nb_crypto_deq_success_acc += nb_crypto_deq_success;
-    } while ((!force_quit) && (pkts_crypto_out.len < nb_crypto_enq));
-
-    CCMP_BURST_DEQUEUE_STATS(nb_crypto_enq, nb_crypto_deq_success_acc);
-
-    /*
-     * CRYPTO TIDYUP
-     */
-
-    /* log error for any failed crypto ops */
-    if (unlikely(nb_crypto_deq_success_acc < pkts_crypto_in.len)) {
+    if (unlikely(nb_crypto_enq < pkts_crypto_in.len))
         DL_DATA_DROP_STAT_INC(STATS_DL_DROPS_TYPE_ENCRYPTION_ERROR,
-                              (pkts_crypto_in.len - nb_crypto_deq_success_acc));
-
-#ifdef RWPA_EXTRA_DEBUG
-        RTE_LOG(ERR, RWPA_DL,
-                "CCMP encryption failed for %d out of %d "
-                "packets, dropping\n",
-                (pkts_crypto_in.len - nb_crypto_deq_success_acc),
-                pkts_crypto_in.len);
-#endif
-    }
-#endif
+                              (pkts_crypto_in.len - nb_crypto_enq));
 
-    /* unlock station and free mbuf for any failed crypto ops */
-    for (i = 0, j = 0; i < pkts_crypto_in.len; i++) {
-        STA_READ_UNLOCK(meta_crypto_in[i]->sta);
-
-#ifndef RWPA_NO_CRYPTO
-        if (crypto_enq_success[i] == FALSE) {
-            DROP(pkts_crypto_in.buffer[i]);
-        } else if (j < nb_crypto_enq &&
-                   crypto_deq_success[j++] == FALSE) {
+    /* drop the station reference and free mbuf for any ops not enqueued */
+    for (i = 0; i < pkts_crypto_in.len; i++) {
+        if (unlikely(crypto_enq_success[i] == FALSE)) {
+            STA_REF_PUT(meta_crypto_in[i]);
             DROP(pkts_crypto_in.buffer[i]);
         }
-#endif
     }
 
+    store_read_unlock(rd);
+
     /*
-     * POST CRYPTO PROCESSING
+     * in sync mode, wait for all the ops to be dequeued
+     * - in async mode they are dequeued on the next loop iterations
+     *   instead, while the next bursts are being received
      */
+    while (!ctx->crypto_async &&
+           ctx->nb_crypto_inflight > 0)
+        crypto_completions_process(ctx);
+#else
     for (i = 0; i < pkts_crypto_in.len; i++) {
-        m = pkts_crypto_in.buffer[i];
-
-        if (likely(m != NULL)) {
-            rte_prefetch0(rte_pktmbuf_mtod(m, void *));
-
-            /*
-             * VAP TLV ENCAP
-             * - add the vAP TLV
-             */
-            if (unlikely(VAP_TLV_ENCAP(m) != RWPA_STS_OK)) {
-                LOG_AND_DROP(m, ERR, RWPA_DL,
-                             "Error adding vAP TLV, dropping\n",
-                             STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
-
-            } else {
-                /*
-                 * FRAGMENTATION NOT REQUIRED
-                 */
-                if (likely(rte_pktmbuf_data_len(m) <= g_app->misc_params.max_vap_frag_sz)) {
-                    /*
-                     * VAP HEADER ENCAP
-                     * - add the inner Ethernet and vAP headers
-                     */
-                    if (unlikely(VAP_HDR_ENCAP(m,
-                                               FALSE, FALSE, 0,
-                                               vnfd_eth_addr_to_ap,
-                                               meta_crypto_in[i]->p_sta_addr) != RWPA_STS_OK)) {
-                        LOG_AND_DROP(m, ERR, RWPA_DL,
-                                     "Error adding vAP headers, dropping\n",
-                                     STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
-
-                    /*
-                     * AP TUNNEL ENCAP
-                     * - add the outer Ethernet, IP and UDP/GRE headers
-                     * - NOTE: not locking the vap element before accessing the
-                     *   tunnel addresses, as these addresses should hardly ever
-                     *   change
-                     *   - even if the vap element is being/has been reset and
-                     *     garbage addresses are used, it's not a big deal as
-                     *     that vap is no longer live and the packet won't be
-                     *     delivered through it anyways
-                     */
-                    } else if (unlikely(meta_crypto_in[i]->vap == NULL ||
-                                        AP_TUNNEL_ENCAP(m,
-                                                        addr_params->vnfd_port_to_ap,
-                                                        addr_params->vnfd_ip_to_ap,
-                                                        vnfd_eth_addr_to_ap,
-                                                        meta_crypto_in[i]->vap->tun_port,
-                                                        meta_crypto_in[i]->vap->tun_ip,
-                                                        &(meta_crypto_in[i]->vap->tun_mac)) != RWPA_STS_OK)) {
-                        LOG_AND_DROP(m, ERR, RWPA_DL,
-                                     "Error adding AP tunnel headers, dropping\n",
-                                     STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
-
-                    /*
-                     * WRITE TO TX BUFFER
-                     */
-                    } else {
-                        RTE_ETH_TX_BUFFER(dst_ports[DL_DST_PORT_AP].port_id,
-                                          dst_ports[DL_DST_PORT_AP].queue_id,
-                                          dst_ports[DL_DST_PORT_AP].tx_buffer, m);
-                    }
-                /*
-                 * FRAGMENTATION REQUIRED
-                 */
-                } else {
-                    struct rte_mbuf *frags[MAX_FRAGS_PER_PKT];
-
-                    /*
-                     * FRAGMENT
-                     */
-                    if (unlikely(VAP_PAYLOAD_FRAGMENT(
-                                     m, frags, MAX_FRAGS_PER_PKT,
-                                     g_app->mempool[frag_hdr_mempool_id],
-                                     g_app->mempool[frag_data_mempool_id]) != RWPA_STS_OK)) {
-                        LOG_AND_DROP(m, ERR, RWPA_DL,
-                                     "Error fragmenting packet, dropping\n",
-                                     STATS_DL_DROPS_TYPE_FRAGMENTATION_ERROR);
-                    } else {
-                        /*
-                         * after fragmenting, each fragment will be made up
-                         * of 2 mbufs
-                         * - the 1st mbuf is a direct mbuf and will be empty
-                         *   - the remaining vAP and GRE headers will be
-                         *     put in this mbuf
-                         * - the 2nd mbuf is an indirect mbuf pointing to
-                         *   the vAP payload in the original mbuf
-                         */
-
-                        /* free the original mbuf */
-                        rte_pktmbuf_free(m);
-
-                        /*
-                         * get the next fragment sequence number
-                         * for this station's vAP
-                         */
-                        seq_num_val_t frag_seq_num =
-                                          vap_next_frag_seq_num_get(meta_crypto_in[i]->vap);
-
-                        /* loop through each fragment */
-                        for (j = 0; j < MAX_FRAGS_PER_PKT && frags[j] != NULL; j++) {
-                            /*
-                             * VAP HEADER ENCAP
-                             * - add the inner Ethernet and vAP headers
-                             */
-                            uint8_t last = ((j + 1 == MAX_FRAGS_PER_PKT ||
-                                             frags[j + 1] == NULL) ? TRUE : FALSE);
-                            if (unlikely(VAP_HDR_ENCAP(frags[j],
-                                                       TRUE, last, frag_seq_num,
-                                                       vnfd_eth_addr_to_ap,
-                                                       meta_crypto_in[i]->p_sta_addr) != RWPA_STS_OK)) {
-                                LOG_AND_DROP(frags[j], ERR, RWPA_DL,
-                                             "Error adding vAP headers, dropping\n",
-                                             STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
-
-                            /*
-                             * AP TUNNEL ENCAP
-                             * - add the outer Ethernet, IP and UDP/GRE headers
-                             * - NOTE: not locking the vap element before accessing the
-                             *   tunnel addresses, as these addresses should hardly ever
-                             *   change
-                             *   - even if the vap element is being/has been reset and
-                             *     garbage addresses are used, it's not a big deal as
-                             *     that vap is no longer live and the packet won't be
-                             *     delivered through it anyways
-                             */
-                            } else if (unlikely(meta_crypto_in[i]->vap == NULL ||
-                                                AP_TUNNEL_ENCAP(frags[j],
-                                                                addr_params->vnfd_port_to_ap,
-                                                                addr_params->vnfd_ip_to_ap,
-                                                                vnfd_eth_addr_to_ap,
-                                                                meta_crypto_in[i]->vap->tun_port,
-                                                                meta_crypto_in[i]->vap->tun_ip,
-                                                                &(meta_crypto_in[i]->vap->tun_mac)) != RWPA_STS_OK)) {
-                                LOG_AND_DROP(frags[j], ERR, RWPA_DL,
-                                             "Error adding AP tunnel headers, dropping\n",
-                                             STATS_DL_DROPS_TYPE_PACKET_ENCAP_ERROR);
-
-                            /*
-                             * WRITE TO TX BUFFER
-                             */
-                            } else {
-                                RTE_ETH_TX_BUFFER(dst_ports[DL_DST_PORT_AP].port_id,
-                                                  dst_ports[DL_DST_PORT_AP].queue_id,
-                                                  dst_ports[DL_DST_PORT_AP].tx_buffer,
-                                                  frags[j]);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        data_packet_post_crypto_process(ctx, pkts_crypto_in.buffer[i],
+                                        meta_crypto_in[i]);
+        STA_REF_PUT(meta_crypto_in[i]);
     }
+
+    store_read_unlock(rd);
+#endif
 }
 
 static void
-downlink_packets_process(struct pkt_buffer *pkts_in)
+downlink_packets_process(struct downlink_ctx *ctx, struct pkt_buffer *pkts_in)
 {
     unsigned i;
     struct rte_mbuf *m;
@@ -562,10 +695,10 @@ downlink_packets_process(struct pkt_buffer *pkts_in)
                 if (g_app->misc_params.no_wag == FALSE ||
                     is_same_ether_addr(&(eth_hdr->d_addr),
                                        vnfd_eth_addr_to_wag)) {
-                    if (arp_reply(m, dst_ports[DL_DST_PORT_WAG].port_id, addr_params->vnfd_ip_to_wag))
-	                    rte_eth_tx_buffer(dst_ports[DL_DST_PORT_WAG].port_id,
-					      dst_ports[DL_DST_PORT_WAG].queue_id,
-					      dst_ports[DL_DST_PORT_WAG].tx_buffer, m);
+                    if (arp_reply(m, ctx->dst_ports[DL_DST_PORT_WAG].port_id, addr_params->vnfd_ip_to_wag))
+	                    rte_eth_tx_buffer(ctx->dst_ports[DL_DST_PORT_WAG].port_id,
+					      ctx->dst_ports[DL_DST_PORT_WAG].queue_id,
+					      ctx->dst_ports[DL_DST_PORT_WAG].tx_buffer, m);
                 } else {
                     pkts_data.buffer[pkts_data.len++] = m;
                 }
@@ -636,11 +769,11 @@ downlink_packets_process(struct pkt_buffer *pkts_in)
     /*
      * process the data packets
      */
-    data_packets_process(&pkts_data);
+    data_packets_process(ctx, &pkts_data);
 }
 
 static void
-downlink_main_loop(void)
+downlink_main_loop(struct downlink_ctx *ctx)
 {
     struct pkt_buffer pkts_in __rte_cache_aligned;
     uint64_t prev_tsc, diff_tsc, cur_tsc;
@@ -658,32 +791,63 @@ downlink_main_loop(void)
         diff_tsc = cur_tsc - prev_tsc;
         if (unlikely(diff_tsc > drain_tsc)) {
             for (int i = 0; i < DL_NUM_DST_PORTS; i++)
-                rte_eth_tx_buffer_flush(dst_ports[i].port_id,
-                                        dst_ports[i].queue_id,
-                                        dst_ports[i].tx_buffer);
+                rte_eth_tx_buffer_flush(ctx->dst_ports[i].port_id,
+                                        ctx->dst_ports[i].queue_id,
+                                        ctx->dst_ports[i].tx_buffer);
             prev_tsc = cur_tsc;
         }
 
+#ifndef RWPA_NO_CRYPTO
+        /*
+         * complete the crypto ops of previous bursts
+         */
+        if (ctx->crypto_async)
+            crypto_completions_process(ctx);
+#endif
+
         /*
-         * read packet from RX queues
+         * read packet from RX queues, or from the SWQ when a dispatch
+         * thread is steering the packets to this thread
          */
-        pkts_in.len = RTE_ETH_RX_BURST(src_ports[DL_SRC_PORT].port_id, 0,
-                                       pkts_in.buffer, MAX_PKT_BURST);
+        if (ctx->src_ports[DL_SRC_PORT].ring != NULL)
+            pkts_in.len = rte_ring_sc_dequeue_burst(ctx->src_ports[DL_SRC_PORT].ring,
+                                                    (void **)pkts_in.buffer,
+                                                    MAX_PKT_BURST, NULL);
+        else
+            pkts_in.len = RTE_ETH_RX_BURST(ctx->src_ports[DL_SRC_PORT].port_id,
+                                           ctx->src_ports[DL_SRC_PORT].queue_id,
+                                           pkts_in.buffer, MAX_PKT_BURST);
 
         if (likely(pkts_in.len)) {
             DL_DATA_PMD_READ_STAT_INC(STATS_PMD_READS_TYPE_NON_EMPTY, 1);
             DL_PROCESS_FULL_CYCLE_CAPTURE_START;
-            downlink_packets_process(&pkts_in);
+            downlink_packets_process(ctx, &pkts_in);
             DL_PROCESS_FULL_CYCLE_CAPTURE_STOP;
         } else {
             DL_DATA_PMD_READ_STAT_INC(STATS_PMD_READS_TYPE_EMPTY, 1);
         }
     }
+
+#ifndef RWPA_NO_CRYPTO
+    /*
+     * complete the ops still in flight in async mode
+     * - they hold mbufs and station references, which have to be
+     *   released before the store is synchronized and freed
+     */
+    while (ctx->nb_crypto_inflight > 0)
+        crypto_completions_process(ctx);
+#endif
+
+    for (int i = 0; i < DL_NUM_DST_PORTS; i++)
+        rte_eth_tx_buffer_flush(ctx->dst_ports[i].port_id,
+                                ctx->dst_ports[i].queue_id,
+                                ctx->dst_ports[i].tx_buffer);
 }
 
 static int
-thread_downlink_run(__rte_unused void *arg)
+thread_downlink_run(void *arg)
 {
+    struct downlink_ctx *ctx = (struct downlink_ctx *)arg;
     unsigned lcore_id, socket_id;
 
     lcore_id = rte_lcore_id();
@@ -691,16 +855,17 @@ thread_downlink_run(__rte_unused void *arg)
 
     RTE_LOG(INFO, RWPA_DL,
             "%s (%s): Entering main loop on lcore %u (socket %u)\n",
-            tp_downlink->name, tp_downlink->type, lcore_id, socket_id);
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
 
-    downlink_main_loop();
+    downlink_main_loop(ctx);
 
     return 0;
 }
 
 static int
-thread_downlink_free(__rte_unused void *arg)
+thread_downlink_free(void *arg)
 {
+    struct downlink_ctx *ctx = (struct downlink_ctx *)arg;
     unsigned lcore_id, socket_id;
 
     lcore_id = rte_lcore_id();
@@ -708,7 +873,9 @@ thread_downlink_free(__rte_unused void *arg)
 
     RTE_LOG(INFO, RWPA_DL,
             "%s (%s): Freeing on lcore %u (socket %u)\n",
-            tp_downlink->name, tp_downlink->type, lcore_id, socket_id);
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
+
+    rte_free(ctx);
 
     return 0;
 }
@@ -716,7 +883,7 @@ thread_downlink_free(__rte_unused void *arg)
 uint8_t
 downlink_thread_src_port_get(void)
 {
-    return src_ports[DL_SRC_PORT].port_id;
+    return dl_src_port_id;
 }
 
 static struct thread_ops_s thread_downlink_ops = {
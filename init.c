@@ -43,6 +43,8 @@
 #include "r-wpa_global_vars.h"
 #include "downlink_thread.h"
 #include "uplink_thread.h"
+#include "dispatch_thread.h"
+#include "control_thread.h"
 #ifdef RWPA_STATS_CAPTURE
 #include "thread_statistics_handler.h"
 #endif
@@ -399,7 +401,16 @@ static void
 app_init_link_set_config(struct app_link_params *p)
 {
     if (p->n_rss_qs) {
+        /*
+         * by default hash on the outer IP addresses only, so all traffic
+         * from an AP tunnel (and so from each of its stations) is received
+         * by the same thread, keeping per station ordering for the
+         * replay check and vAP fragment reassembly
+         * - the UDP ports may be added to the hash (rss_hash = udp) when
+         *   the APs keep the tunnel UDP source port fixed per station
+         */
         p->conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+        p->conf.rx_adv_conf.rss_conf.rss_hf = p->rss_hf;
     }
 }
 
@@ -572,6 +583,26 @@ app_init_link(struct app_params *app)
     app_check_link(app);
 }
 
+static void
+app_init_swq(struct app_params *app)
+{
+    uint32_t i;
+
+    for (i = 0; i < app->n_pktq_swq; i++) {
+        struct app_pktq_swq_params *p = &app->swq_params[i];
+
+        /* each SWQ has exactly one reader and one writer */
+        RTE_LOG(INFO, RWPA_INIT, "Initializing %s...\n", p->name);
+        app->swq[i] = rte_ring_create(p->name,
+                                      p->size,
+                                      p->cpu_socket_id,
+                                      RING_F_SP_ENQ | RING_F_SC_DEQ);
+
+        if (app->swq[i] == NULL)
+            rte_exit(EXIT_FAILURE, "%s init error\n", p->name);
+    }
+}
+
 struct thread_type *app_thread_type_find(struct app_params *app, char *name)
 {
     uint32_t i;
@@ -609,6 +640,27 @@ void app_thread_params_set(struct app_params *app, struct app_thread_params *p)
             out->burst_size = p_hwq_in->burst;
             break;
         }
+        case APP_PKTQ_IN_SWQ:
+        {
+            struct app_pktq_swq_params *p_swq = &app->swq_params[in->id];
+            struct app_thread_params *p_writer = app_swq_get_writer(app, p_swq);
+
+            out->type = THREAD_PORT_IN_RING_READER;
+            out->params.ring.ring = app->swq[in->id];
+            out->params.ring.port_id = 0;
+            out->burst_size = p_swq->burst_read;
+
+            /* the NIC port is the one the writing thread reads from */
+            if (p_writer != NULL && p_writer->n_pktq_in > 0 &&
+                p_writer->pktq_in[0].type == APP_PKTQ_IN_HWQ) {
+                struct app_pktq_hwq_in_params *p_hwq_in =
+                    &app->hwq_in_params[p_writer->pktq_in[0].id];
+
+                out->params.ring.port_id =
+                    app_get_link_for_rxq(app, p_hwq_in)->pmd_id;
+            }
+            break;
+        }
         default:
             break;
         }
@@ -655,6 +707,17 @@ void app_thread_params_set(struct app_params *app, struct app_thread_params *p)
             }
         }
             break;
+        case APP_PKTQ_OUT_SWQ:
+        {
+            struct app_pktq_swq_params *p_swq = &app->swq_params[in->id];
+
+            out->type = THREAD_PORT_OUT_RING_WRITER;
+            out->tx_buffer = NULL;
+            out->burst_size = p_swq->burst_write;
+            out->params.ring.ring = app->swq[in->id];
+            out->params.ring.tx_burst_sz = p_swq->burst_write;
+        }
+            break;
         default:
             break;
         }
@@ -758,8 +821,11 @@ app_init(struct app_params *app)
     app_init_eal(app);
     app_init_mempool(app);
     app_init_link(app);
+    app_init_swq(app);
     app_thread_type_register(app, &thread_uplink);
     app_thread_type_register(app, &thread_downlink);
+    app_thread_type_register(app, &thread_dispatch);
+    app_thread_type_register(app, &thread_control);
 #ifdef RWPA_STATS_CAPTURE
     app_thread_type_register(app, &thread_statistics_handler);
 #endif
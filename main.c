@@ -48,9 +48,14 @@
 #include "seq_num.h"
 #include "meta.h"
 #include "ccmp_sa.h"
+#include "ieee80211.h"
+#include "ccmp.h"
 #include "crypto.h"
+#include "sess_cache.h"
+#include "ccmp_inline.h"
 #include "ap_config.h"
 #include "store.h"
+#include "store_snapshot.h"
 #include "vap_frag.h"
 #include "cycle_capture.h"
 #ifdef RWPA_STATS_CAPTURE
@@ -93,7 +98,7 @@ app_thread_init(void *arg) {
             continue;
 
         if (lcore_id == params->lcore_id) {
-            ttype->thread_ops->f_init(params, (void*)app);
+            params->thread_ctx = ttype->thread_ops->f_init(params, (void*)app);
         }
     }
 
@@ -117,7 +122,7 @@ app_thread_run(void *arg) {
             continue;
 
         if (lcore_id == params->lcore_id) {
-            ttype->thread_ops->f_run((void*)app);
+            ttype->thread_ops->f_run(params->thread_ctx);
         }
     }
 
@@ -141,13 +146,35 @@ app_thread_free(void *arg) {
             continue;
 
         if (lcore_id == params->lcore_id) {
-            ttype->thread_ops->f_free((void*)app);
+            ttype->thread_ops->f_free(params->thread_ctx);
         }
     }
 
     return 0;
 }
 
+/*
+ * Socket of the store memory
+ * - the packet processing threads read it on every packet, so it is
+ *   allocated on the socket of the first of them, unless configured
+ */
+static int
+app_store_socket_get(struct app_params *app) {
+    uint32_t i;
+
+    if (app->store_params.socket_id != APP_STORE_SOCKET_ANY)
+        return app->store_params.socket_id;
+
+    for (i = 0; i < app->n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+
+        if (p->n_pktq_in > 0)
+            return rte_lcore_to_socket_id(p->lcore_id);
+    }
+
+    return rte_socket_id();
+}
+
 /* Run function fun on each logical core */
 static int
 app_launch_thread(struct app_params *app, void *fun) {
@@ -177,6 +204,7 @@ app_launch_thread_no_wait(struct app_params *app, void *fun) {
 int
 main(int argc, char **argv) {
     int lcoreid;
+    uint32_t snapshot_s = 0;
 
     memset(&app, 0, sizeof(struct app_params));
 
@@ -220,16 +248,25 @@ main(int argc, char **argv) {
     signal(SIGUSR1, signal_handler);
 
     /* Initialize vAP and station store */
-    store_init(rte_socket_id(), &app.addr_params);
+    store_init(app_store_socket_get(&app), &app.store_params,
+               &app.addr_params);
 
     /* Initialize store for static AP address configuration */
     ap_config_init(rte_socket_id(), &app.addr_params);
 
-    /* Initialize crypto library */
-    crypto_init(&app.crypto_params, CCMP_MAX_SESSIONS);
+    /*
+     * Initialize crypto library, and the session cache with the
+     * number of sessions the crypto devices support
+     */
+    crypto_init(&app.crypto_params,
+                app.crypto_params.max_sessions ?
+                    app.crypto_params.max_sessions :
+                    CCMP_MAX_SESSIONS(store_vap_max(), store_sta_max()));
+    sess_cache_init(crypto_max_sessions_get());
+    ccmp_engine_set(app.crypto_params.engine);
 
     /* Initialize vAP native fragmentation library */
-    vap_frag_init(NUM_STA_MAX, app.misc_params.frag_ttl_ms,
+    vap_frag_init(store_sta_max(), app.misc_params.frag_ttl_ms,
                   app.misc_params.max_vap_frag_sz);
 
 #ifdef RWPA_STATS_CAPTURE
@@ -238,6 +275,14 @@ main(int argc, char **argv) {
 
     CYCLE_CAPTURE_INIT();
 
+    /*
+     * Restore the vAP and station store saved by the previous run,
+     * so that stations keep forwarding without reauthenticating
+     */
+    if (app.misc_params.store_snapshot[0] != '\0')
+        store_snapshot_restore(app.misc_params.store_snapshot,
+                               app.misc_params.store_snapshot_pn_margin);
+
 #ifdef RWPA_PRELOAD_STORE
     store_load(app.misc_params.preloaded_key_store);
 #endif
@@ -254,10 +299,21 @@ main(int argc, char **argv) {
      */
     app_launch_thread_no_wait(&app, app_thread_run);
 
-    /* ..and wait and sleep here */
-    while (!force_quit)
+    /*
+     * ..and wait and sleep here, saving the store snapshot periodically
+     * in case the process does not exit cleanly
+     */
+    while (!force_quit) {
         sleep(1);
 
+        if (app.misc_params.store_snapshot[0] != '\0' &&
+            app.misc_params.store_snapshot_interval_s != 0 &&
+            ++snapshot_s >= app.misc_params.store_snapshot_interval_s) {
+            store_snapshot_save(app.misc_params.store_snapshot);
+            snapshot_s = 0;
+        }
+    }
+
     /*
      * If we are here the program received quit signal, wait for
      * threads to finish
@@ -267,12 +323,19 @@ main(int argc, char **argv) {
             return -1;
         }
     }
+
+    /* Save the store snapshot, with the final counters, for the next run */
+    if (app.misc_params.store_snapshot[0] != '\0')
+        store_snapshot_save(app.misc_params.store_snapshot);
+
     /* Launch threads free() functions on chosen cores */
     app_launch_thread(&app, app_thread_free);
 
     /* Global data cleanup */
     vap_frag_destroy();
     crypto_destroy();
+    sess_cache_destroy();
+    ccmp_inline_destroy();
     ap_config_cleanup();
     store_cleanup();
 #ifdef RWPA_STATS_CAPTURE
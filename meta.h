@@ -36,6 +36,8 @@
 #ifndef __INCLUDE_META_H__
 #define __INCLUDE_META_H__
 
+struct sess_cache_entry;
+
 /*
  * R-WPA Meta Info
  */
@@ -53,9 +55,12 @@ struct rwpa_meta {
 
     struct sta_elem *sta;
     struct vap_elem *vap;
+    uint8_t store_idx; /* store reader index the station is referenced on */
 
     struct ccmp_sa *sa;
+    struct sess_cache_entry *sess; /* held while the crypto op is in flight */
     counter_val_t counter;
+    uint8_t key_id; /* KeyID of the CCMP header */
 
     int wep;
 
@@ -38,7 +38,7 @@
 
 #include <rte_mbuf.h>
 
-typedef void (*poll_func)(uint64_t);
+typedef void (*poll_func)(void *ctx, uint64_t cur_tsc);
 
 struct poll_wrr_elem {
     uint64_t allocated_tsc;
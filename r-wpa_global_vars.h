@@ -50,6 +50,7 @@
 #define RTE_LOGTYPE_RWPA_UL         RTE_LOGTYPE_USER2
 #define RTE_LOGTYPE_RWPA_DL         RTE_LOGTYPE_USER3
 #define RTE_LOGTYPE_RWPA_TLS        RTE_LOGTYPE_USER4
+#define RTE_LOGTYPE_RWPA_CTRL       RTE_LOGTYPE_USER4
 #define RTE_LOGTYPE_RWPA_STORE      RTE_LOGTYPE_USER5
 #ifdef RWPA_PRELOAD_STORE
 #define RTE_LOGTYPE_RWPA_STORE_LOAD RTE_LOGTYPE_USER5
@@ -57,6 +58,7 @@
 #define RTE_LOGTYPE_RWPA_CRYPTO     RTE_LOGTYPE_USER6
 #define RTE_LOGTYPE_RWPA_CCMP       RTE_LOGTYPE_USER6
 #define RTE_LOGTYPE_RWPA_STATS      RTE_LOGTYPE_USER7
+#define RTE_LOGTYPE_RWPA_DISPATCH   RTE_LOGTYPE_USER8
 
 /* Boolean flags */
 #define TRUE                        1
@@ -71,8 +73,17 @@
 #define BURST_TX_DRAIN_US           100
 #define MAX_PKT_BURST               32
 
+/*
+ * distances ahead, in packets, of the prefetches in the burst loops
+ * - packet headers are prefetched furthest ahead, then the stations
+ *   found for them, then the PTKs and vAPs read from the stations
+ */
+#define PREFETCH_OFFSET             4
+#define PREFETCH_STA_OFFSET         2
+
 #define MAX_UL_WRR_ELEMS            2
 
+/* default store capacities, see the [STORE] section of the config */
 #define NUM_VAP_MAX                 16000
 #define NUM_STA_PER_VAP_MAX         10
 #define NUM_STA_MAX                 NUM_VAP_MAX * NUM_STA_PER_VAP_MAX
@@ -134,6 +145,8 @@ enum rwpa_status {
 
 struct src_port_params {
     uint8_t port_id;
+    uint16_t queue_id;
+    struct rte_ring *ring; /* set when reading a SWQ rather than a RXQ */
 };
 
 struct dst_port_params {
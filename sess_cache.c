@@ -0,0 +1,372 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_atomic.h>
+#include <rte_branch_prediction.h>
+#include <rte_common.h>
+#include <rte_cryptodev.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_spinlock.h>
+
+#include "app.h"
+#include "r-wpa_global_vars.h"
+#include "crypto.h"
+#include "sess_cache.h"
+
+/*
+ * the cache holds at most n_entries sessions, so that the crypto
+ * devices' session limits are never exceeded
+ * - hits are lock free, while taking an entry on a miss (and evicting
+ *   one to make room) is done under cache_lock, but not the creation
+ *   of its session
+ * - entries are evicted in approximate LRU order, using a clock:
+ *   an entry used since the hand last passed it gets a second chance
+ */
+static struct sess_cache_entry *entries = NULL;
+static uint32_t *free_stack = NULL;
+static uint32_t n_entries = 0;
+static uint32_t n_free = 0;
+static uint32_t clock_hand = 0;
+static rte_spinlock_t cache_lock;
+
+/* updated under cache_lock */
+static uint64_t cache_misses = 0;
+static uint64_t cache_evictions = 0;
+static uint64_t cache_failures = 0;
+
+/* hits are counted per lcore, as they are not under cache_lock */
+struct sess_cache_lcore_stats {
+    uint64_t hits;
+} __rte_cache_aligned;
+
+static struct sess_cache_lcore_stats lcore_stats[RTE_MAX_LCORE];
+
+static inline int
+entry_acquire(struct sess_cache_entry *entry);
+
+static struct sess_cache_entry *
+entry_bind(struct sess_cache_entry    **slot,
+           struct rte_crypto_sym_xform *xform);
+
+static struct sess_cache_entry *
+entry_evict(void);
+
+static void
+entry_free(struct sess_cache_entry *entry);
+
+void
+sess_cache_init(uint32_t max_sessions)
+{
+    uint32_t i;
+
+    /* slots are published with a 64 bit compare and set */
+    RTE_BUILD_BUG_ON(sizeof(struct sess_cache_entry *) != sizeof(uint64_t));
+
+    if (max_sessions == 0)
+        rte_exit(EXIT_FAILURE, "Session cache size is 0\n");
+
+    entries = rte_zmalloc("sess_cache_entries",
+                          sizeof(entries[0]) * max_sessions, 0);
+    free_stack = rte_zmalloc("sess_cache_free_stack",
+                             sizeof(free_stack[0]) * max_sessions, 0);
+
+    if (entries == NULL || free_stack == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Cannot allocate session cache of %u entries\n",
+                 max_sessions);
+
+    n_entries = max_sessions;
+    for (i = 0; i < n_entries; i++)
+        entry_free(&entries[n_entries - 1 - i]);
+
+    clock_hand = 0;
+    rte_spinlock_init(&cache_lock);
+    memset(lcore_stats, 0, sizeof(lcore_stats));
+
+    RTE_LOG(INFO, RWPA_CRYPTO,
+            "Session cache of %u sessions\n", n_entries);
+}
+
+void
+sess_cache_destroy(void)
+{
+    rte_free(entries);
+    rte_free(free_stack);
+    entries = NULL;
+    free_stack = NULL;
+    n_entries = n_free = 0;
+}
+
+struct sess_cache_entry *
+sess_cache_get(struct sess_cache_entry    **slot,
+               struct rte_crypto_sym_xform *xform)
+{
+    struct sess_cache_entry *entry;
+    unsigned lcore_id;
+
+    if (unlikely(slot == NULL || xform == NULL))
+        return NULL;
+
+    /*
+     * the entry may be evicted and rebound to another slot between
+     * reading the slot and taking the reference, so check the slot
+     * still points to it once the reference is held
+     */
+    entry = *(struct sess_cache_entry * volatile *)slot;
+    if (likely(entry != NULL) && likely(entry_acquire(entry) == 0)) {
+        if (likely(*(struct sess_cache_entry * volatile *)slot == entry)) {
+            if (unlikely(!entry->referenced))
+                entry->referenced = TRUE;
+
+            lcore_id = rte_lcore_id();
+            if (likely(lcore_id < RTE_MAX_LCORE))
+                lcore_stats[lcore_id].hits++;
+
+            return entry;
+        }
+
+        sess_cache_put(entry);
+    }
+
+    return entry_bind(slot, xform);
+}
+
+void
+sess_cache_release(struct sess_cache_entry **slot)
+{
+    struct sess_cache_entry *entry;
+
+    if (unlikely(slot == NULL || *slot == NULL))
+        return;
+
+    rte_spinlock_lock(&cache_lock);
+
+    /* the entry may have been evicted since the check above */
+    entry = *slot;
+    if (entry != NULL) {
+        *slot = NULL;
+        crypto_session_free(entry->session);
+        entry_free(entry);
+    }
+
+    rte_spinlock_unlock(&cache_lock);
+}
+
+void
+sess_cache_stats_get(struct sess_cache_stats *stats)
+{
+    unsigned i;
+
+    if (unlikely(stats == NULL))
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < RTE_MAX_LCORE; i++)
+        stats->hits += lcore_stats[i].hits;
+
+    stats->misses = cache_misses;
+    stats->evictions = cache_evictions;
+    stats->failures = cache_failures;
+    stats->in_use = n_entries - n_free;
+    stats->size = n_entries;
+}
+
+/* take a reference, unless the entry is free or being evicted */
+static inline int
+entry_acquire(struct sess_cache_entry *entry)
+{
+    int32_t cnt;
+
+    do {
+        cnt = rte_atomic32_read(&entry->refcnt);
+        if (unlikely(cnt < 0))
+            return -1;
+    } while (unlikely(!rte_atomic32_cmpset(
+                          (volatile uint32_t *)&entry->refcnt.cnt,
+                          (uint32_t)cnt, (uint32_t)(cnt + 1))));
+
+    return 0;
+}
+
+/*
+ * bind a new session to the slot
+ * - a free entry is used if there is one, otherwise the least recently
+ *   used entry with no ops in flight is evicted
+ * - only the entry is taken under cache_lock, the session is created
+ *   outside of it, as that initialises it on every qp of every device,
+ *   and published with a compare and set of the slot
+ * - if the session cannot be created (e.g. the device has run out of
+ *   sessions before the cache did), one more entry is evicted to make
+ *   room and the session creation is retried
+ * - if another thread bound the slot meanwhile, its entry is used and
+ *   the new session freed
+ */
+static struct sess_cache_entry *
+entry_bind(struct sess_cache_entry    **slot,
+           struct rte_crypto_sym_xform *xform)
+{
+    struct sess_cache_entry *entry, *bound, *victim;
+    struct rte_cryptodev_sym_session *session;
+
+    rte_spinlock_lock(&cache_lock);
+    cache_misses++;
+
+    if (likely(n_free > 0))
+        entry = &entries[free_stack[--n_free]];
+    else
+        entry = entry_evict();
+
+    if (unlikely(entry == NULL)) {
+        cache_failures++;
+        rte_spinlock_unlock(&cache_lock);
+        RTE_LOG(DEBUG, RWPA_CRYPTO,
+                "No crypto session available, all are in use\n");
+        return NULL;
+    }
+    rte_spinlock_unlock(&cache_lock);
+
+    /*
+     * the entry is not bound to a slot and cannot be taken by anyone
+     * else (its refcnt is -1) while the session is created
+     */
+    session = crypto_session_alloc(xform);
+    if (unlikely(session == NULL)) {
+        rte_spinlock_lock(&cache_lock);
+        victim = entry_evict();
+        if (victim != NULL)
+            entry_free(victim);
+        rte_spinlock_unlock(&cache_lock);
+
+        if (victim != NULL)
+            session = crypto_session_alloc(xform);
+    }
+
+    if (unlikely(session == NULL)) {
+        rte_spinlock_lock(&cache_lock);
+        cache_failures++;
+        entry_free(entry);
+        rte_spinlock_unlock(&cache_lock);
+        return NULL;
+    }
+
+    /* publish the entry once it is set up, with the caller's reference */
+    entry->session = session;
+    entry->slot = slot;
+    entry->referenced = TRUE;
+    rte_atomic32_set(&entry->refcnt, 1);
+
+    if (likely(rte_atomic64_cmpset((volatile uint64_t *)slot, 0,
+                                   (uint64_t)(uintptr_t)entry)))
+        return entry;
+
+    /*
+     * lost the race to bind the slot, the entry cannot have been
+     * evicted as it holds a reference
+     */
+    bound = *(struct sess_cache_entry * volatile *)slot;
+
+    rte_spinlock_lock(&cache_lock);
+    crypto_session_free(entry->session);
+    entry_free(entry);
+    rte_spinlock_unlock(&cache_lock);
+
+    if (bound != NULL && entry_acquire(bound) == 0) {
+        if (likely(*(struct sess_cache_entry * volatile *)slot == bound))
+            return bound;
+        sess_cache_put(bound);
+    }
+
+    /* the winner was evicted already, start over */
+    return sess_cache_get(slot, xform);
+}
+
+/*
+ * evict the least recently used entry with no ops in flight, returning
+ * it with its session freed (cache_lock must be held)
+ * - the hand goes round at most twice, as the first pass clears the
+ *   referenced flags
+ */
+static struct sess_cache_entry *
+entry_evict(void)
+{
+    struct sess_cache_entry *entry;
+    uint32_t i;
+
+    for (i = 0; i < 2 * n_entries; i++) {
+        entry = &entries[clock_hand];
+        if (++clock_hand == n_entries)
+            clock_hand = 0;
+
+        if (entry->slot == NULL)
+            continue;
+
+        if (entry->referenced) {
+            entry->referenced = FALSE;
+            continue;
+        }
+
+        /* stop new references being taken, if there are none */
+        if (!rte_atomic32_cmpset((volatile uint32_t *)&entry->refcnt.cnt,
+                                 0, (uint32_t)-1))
+            continue;
+
+        /* the SA rebinds the session on its next packet */
+        *(struct sess_cache_entry * volatile *)entry->slot = NULL;
+        crypto_session_free(entry->session);
+        entry->session = NULL;
+        entry->slot = NULL;
+        cache_evictions++;
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+/* return the entry to the free stack (cache_lock must be held) */
+static void
+entry_free(struct sess_cache_entry *entry)
+{
+    entry->session = NULL;
+    entry->slot = NULL;
+    entry->referenced = FALSE;
+    rte_atomic32_set(&entry->refcnt, -1);
+    free_stack[n_free++] = (uint32_t)(entry - entries);
+}
@@ -0,0 +1,101 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#ifndef __INCLUDE_SESS_CACHE_H__
+#define __INCLUDE_SESS_CACHE_H__
+
+#include <rte_atomic.h>
+#include <rte_branch_prediction.h>
+#include <rte_cryptodev.h>
+
+/*
+ * Session Cache Entry
+ * - binds a cryptodev session to the SA slot it was created for
+ * - refcnt counts the crypto ops in flight with the session, and is
+ *   -1 while the entry is free or being evicted
+ * - referenced is set on each use, and cleared by the eviction clock
+ */
+struct sess_cache_entry {
+    struct rte_cryptodev_sym_session *session;
+    struct sess_cache_entry **slot;
+    rte_atomic32_t refcnt;
+    volatile uint8_t referenced;
+};
+
+struct sess_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t failures;
+    uint32_t in_use;
+    uint32_t size;
+};
+
+void
+sess_cache_init(uint32_t max_sessions);
+
+void
+sess_cache_destroy(void);
+
+/*
+ * Get the session bound to the slot, creating it from the xform if it
+ * is not bound (i.e. on first use, or after it has been evicted)
+ * - the entry is returned with a reference held, which must be
+ *   dropped with sess_cache_put() once the op using it has completed
+ */
+struct sess_cache_entry *
+sess_cache_get(struct sess_cache_entry    **slot,
+               struct rte_crypto_sym_xform *xform);
+
+static inline void
+sess_cache_put(struct sess_cache_entry *entry)
+{
+    if (likely(entry != NULL))
+        rte_atomic32_dec(&entry->refcnt);
+}
+
+/*
+ * Unbind and free the session bound to the slot
+ * - the caller must ensure no ops are in flight with it, i.e. the SA
+ *   owner has been unpublished and the store readers waited for, see
+ *   store_synchronize()
+ */
+void
+sess_cache_release(struct sess_cache_entry **slot);
+
+void
+sess_cache_stats_get(struct sess_cache_stats *stats);
+
+#endif // __INCLUDE_SESS_CACHE_H__
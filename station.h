@@ -39,10 +39,13 @@
 #include <rte_branch_prediction.h>
 #include <rte_memcpy.h>
 #include <rte_rwlock.h>
+#include <rte_cycles.h>
+#include <rte_prefetch.h>
 
 #include "key.h"
 #include "counter.h"
 #include "vap.h"
+#include "store.h"
 
 #define TID_NUM  9
 
@@ -53,33 +56,81 @@
 #define _STA_WRITE_LOCK(lock)   rte_rwlock_write_lock(&(lock))
 #define _STA_WRITE_UNLOCK(lock) rte_rwlock_write_unlock(&(lock))
 
+/*
+ * PTK slots, indexed by the KeyID of the CCMP header
+ * - with Extended Key ID (IEEE 802.11-2016, 12.7.6) a new PTK is
+ *   installed in the slot not used for TX, and used for RX at once,
+ *   then TX switches to it, and the old PTK stays valid for RX for an
+ *   overlap, so that a rekey does not break the frames in flight
+ * - without it, the PTK always has KeyID 0
+ */
+#define PTK_KEY_ID_NUM  2
+
+struct sta_ptk {
+    counter_t encrypt_ctr;
+
+    struct ccmp_sa sa;
+
+    /* TSC after which the PTK is no longer valid for RX, 0 for never */
+    uint64_t rx_until;
+
+    counter_t decrypt_ctr[TID_NUM];
+};
+
 /*
  * Station
+ * - ordered by how often the data path reads each field, the raw keys
+ *   and the xforms are in the SAs' cold parts, see struct ccmp_sa_cold
  */
 struct sta_elem {
-    struct ccmp_sa ptk_sa;
+    struct vap_elem *parent_vap;
 
-    counter_t ptk_encrypt_ctr;
-    counter_t ptk_decrypt_ctr[TID_NUM];
+    /* KeyID of the PTK used for TX */
+    volatile uint8_t ptk_tx_key_id;
 
-    struct vap_elem *parent_vap;
+    /* aging clock tick a frame was last received at, see sta_seen() */
+    volatile uint32_t last_seen;
+
+    struct sta_ptk ptk[PTK_KEY_ID_NUM];
 
     _STA_LOCK_T lock;
 } __rte_cache_aligned;
 
 /*
- * Init STA
+ * Reset PTK Slot
+ * - the slot's key must be unpublished, and the readers synchronized,
+ *   beforehand
  */
 static inline void
-sta_init(struct sta_elem *sta)
+sta_ptk_slot_reset(struct sta_ptk *ptk)
 {
     unsigned int i;
 
+    ccmp_sa_reset(&(ptk->sa));
+    ptk->rx_until = 0;
+    counter_set(&(ptk->encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
+    for (i = 0; i < TID_NUM; i++)
+        counter_set(&(ptk->decrypt_ctr[i]), DECRYPT_CTR_DEFAULT_VAL);
+}
+
+/*
+ * Init STA
+ * - binds the PTK SAs to their cold parts, an array of PTK_KEY_ID_NUM
+ *   which the store allocates separately from the station
+ */
+static inline void
+sta_init(struct sta_elem *sta, struct ccmp_sa_cold *ptk_cold)
+{
+    unsigned int k;
+
     if (likely(sta != NULL)) {
-        memset(&(sta->ptk_sa), 0, sizeof(struct ccmp_sa));
-        counter_set(&(sta->ptk_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
-        for (i = 0; i < TID_NUM; i++)
-            counter_set(&(sta->ptk_decrypt_ctr[i]), DECRYPT_CTR_DEFAULT_VAL);
+        for (k = 0; k < PTK_KEY_ID_NUM; k++) {
+            memset(&(sta->ptk[k].sa), 0, sizeof(struct ccmp_sa));
+            ccmp_sa_bind(&(sta->ptk[k].sa), &(ptk_cold[k]));
+            sta_ptk_slot_reset(&(sta->ptk[k]));
+        }
+        sta->ptk_tx_key_id = 0;
+        sta->last_seen = 0;
         sta->parent_vap = NULL;
         _STA_LOCK_INIT(sta->lock);
     }
@@ -87,6 +138,8 @@ sta_init(struct sta_elem *sta)
 
 /*
  * Lock Station for Reads
+ * - the data path does not take this lock, but a store read section,
+ *   see store_read_lock()
  */
 static inline void
 sta_read_lock(struct sta_elem *sta)
@@ -131,14 +184,13 @@ sta_write_unlock(struct sta_elem *sta)
 static inline void
 sta_reset(struct sta_elem *sta)
 {
-    unsigned i;
+    unsigned int k;
 
     if (likely(sta != NULL)) {
         _STA_WRITE_LOCK(sta->lock);
-        ccmp_sa_reset(&(sta->ptk_sa));
-        counter_set(&(sta->ptk_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
-        for (i = 0; i < TID_NUM; i++)
-            counter_set(&(sta->ptk_decrypt_ctr[i]), DECRYPT_CTR_DEFAULT_VAL);
+        for (k = 0; k < PTK_KEY_ID_NUM; k++)
+            sta_ptk_slot_reset(&(sta->ptk[k]));
+        sta->ptk_tx_key_id = 0;
         sta->parent_vap = NULL;
         _STA_WRITE_UNLOCK(sta->lock);
     }
@@ -146,69 +198,251 @@ sta_reset(struct sta_elem *sta)
 
 /*
  * Set PTK
+ * - replaces both PTK slots with a PTK with KeyID 0, as a station not
+ *   using Extended Key ID is rekeyed
  */
 static inline void
-sta_ptk_set(struct sta_elem *sta, const uint8_t *ptk, const uint8_t ptk_len)
+sta_ptk_set(struct sta_elem *sta,
+            const uint8_t *ptk,
+            const uint8_t ptk_len,
+            enum ccmp_cipher cipher)
 {
-    unsigned int i;
+    unsigned int k;
+    int had_key = 0;
 
     if (likely(sta != NULL && ptk != NULL)) {
         _STA_WRITE_LOCK(sta->lock);
-        ccmp_sa_reset(&(sta->ptk_sa));
-        ccmp_sa_init(ptk, ptk_len, &(sta->ptk_sa));
-        counter_set(&(sta->ptk_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
-        for (i = 0; i < TID_NUM; i++)
-            counter_set(&(sta->ptk_decrypt_ctr[i]), DECRYPT_CTR_DEFAULT_VAL);
+
+        /*
+         * rekeying, unpublish the old keys and wait for the packets in
+         * flight with them before their sessions are freed
+         */
+        for (k = 0; k < PTK_KEY_ID_NUM; k++) {
+            if (sta->ptk[k].sa.tk_len != 0) {
+                sta->ptk[k].sa.tk_len = 0;
+                had_key = 1;
+            }
+        }
+        if (had_key) {
+            rte_smp_wmb();
+            store_synchronize();
+        }
+
+        for (k = 0; k < PTK_KEY_ID_NUM; k++)
+            sta_ptk_slot_reset(&(sta->ptk[k]));
+        sta->ptk_tx_key_id = 0;
+
+        /* publishes the new key */
+        ccmp_sa_init(ptk, ptk_len, cipher, &(sta->ptk[0].sa));
         _STA_WRITE_UNLOCK(sta->lock);
     }
 }
 
+/*
+ * Set PTK for RX
+ * - installs a PTK with Extended Key ID, for RX only, in the slot of
+ *   its KeyID, which must not be the slot used for TX, unless that has
+ *   no key yet (i.e. the station's first PTK)
+ * - the other slot, and so the frames in flight with it, are left as
+ *   they are
+ */
+static inline enum rwpa_status
+sta_ptk_rx_set(struct sta_elem *sta,
+               uint8_t key_id,
+               const uint8_t *ptk,
+               const uint8_t ptk_len,
+               enum ccmp_cipher cipher)
+{
+    struct sta_ptk *slot;
+    enum rwpa_status sts = RWPA_STS_ERR;
+
+    if (unlikely(sta == NULL || ptk == NULL || key_id >= PTK_KEY_ID_NUM))
+        return RWPA_STS_ERR;
+
+    _STA_WRITE_LOCK(sta->lock);
+    slot = &(sta->ptk[key_id]);
+
+    if (key_id != sta->ptk_tx_key_id || slot->sa.tk_len == 0) {
+        /* replacing a retired key, wait for its packets in flight */
+        if (slot->sa.tk_len != 0) {
+            slot->sa.tk_len = 0;
+            rte_smp_wmb();
+            store_synchronize();
+        }
+
+        sta_ptk_slot_reset(slot);
+
+        /* publishes the new key */
+        sts = ccmp_sa_init(ptk, ptk_len, cipher, &(slot->sa));
+    }
+    _STA_WRITE_UNLOCK(sta->lock);
+
+    return sts;
+}
+
+/*
+ * Set PTK for TX
+ * - switches TX to the PTK of KeyID, and leaves the PTK used for TX so
+ *   far valid for RX for rx_overlap TSC cycles
+ */
+static inline enum rwpa_status
+sta_ptk_tx_set(struct sta_elem *sta,
+               uint8_t key_id,
+               uint64_t rx_overlap)
+{
+    struct sta_ptk *old;
+    enum rwpa_status sts = RWPA_STS_ERR;
+
+    if (unlikely(sta == NULL || key_id >= PTK_KEY_ID_NUM))
+        return RWPA_STS_ERR;
+
+    _STA_WRITE_LOCK(sta->lock);
+    if (sta->ptk[key_id].sa.tk_len != 0) {
+        if (key_id != sta->ptk_tx_key_id) {
+            old = &(sta->ptk[sta->ptk_tx_key_id]);
+
+            sta->ptk[key_id].rx_until = 0;
+            rte_smp_wmb();
+            sta->ptk_tx_key_id = key_id;
+
+            if (old->sa.tk_len != 0)
+                old->rx_until = rte_rdtsc() + rx_overlap;
+        }
+        sts = RWPA_STS_OK;
+    }
+    _STA_WRITE_UNLOCK(sta->lock);
+
+    return sts;
+}
+
 /*
  * Set PTK Decrypt Counter
  */
 static inline void
-sta_ptk_decrypt_counter_set(struct sta_elem *sta, uint8_t tid, counter_val_t value)
+sta_ptk_decrypt_counter_set(struct sta_elem *sta, uint8_t key_id,
+                            uint8_t tid, counter_val_t value)
+{
+    if (likely(sta != NULL && key_id < PTK_KEY_ID_NUM && tid < TID_NUM)) {
+        counter_set(&(sta->ptk[key_id].decrypt_ctr[tid]), value);
+    }
+}
+
+/*
+ * Mark Station Seen
+ * - now is the store's aging clock, see store_tick_get(), so the
+ *   station's line is written at most once per tick
+ * - only frames received from the station count, as frames sent to a
+ *   station which has left keep coming until their senders give up
+ */
+static inline void
+sta_seen(struct sta_elem *sta, uint32_t now)
+{
+    if (unlikely(sta->last_seen != now))
+        sta->last_seen = now;
+}
+
+/*
+ * Prefetch Station
+ * - the first line holds the parent vAP and the TX KeyID, which the
+ *   encrypt and decrypt data prefetches below read
+ */
+static inline void
+sta_prefetch(struct sta_elem *sta)
+{
+    if (likely(sta != NULL))
+        rte_prefetch0(sta);
+}
+
+/*
+ * Prefetch Encrypt Data
+ * - prefetches the TX PTK and the parent vAP, the station's first line
+ *   should have been prefetched first, see sta_prefetch()
+ */
+static inline void
+sta_encrypt_data_prefetch(struct sta_elem *sta)
+{
+    if (likely(sta != NULL)) {
+        rte_prefetch0(&(sta->ptk[sta->ptk_tx_key_id]));
+        rte_prefetch0(sta->parent_vap);
+    }
+}
+
+/*
+ * Prefetch Decrypt Data
+ * - prefetches the PTK of KeyID, its decrypt counter for TID and the
+ *   parent vAP, the station's first line should have been prefetched
+ *   first, see sta_prefetch()
+ */
+static inline void
+sta_decrypt_data_prefetch(struct sta_elem *sta, uint8_t key_id, uint8_t tid)
 {
-    UNUSED(value);
-    if (likely(sta != NULL && tid < TID_NUM)) {
-        counter_set(&(sta->ptk_decrypt_ctr[tid]), value);
+    if (likely(sta != NULL && key_id < PTK_KEY_ID_NUM && tid < TID_NUM)) {
+        rte_prefetch0(&(sta->ptk[key_id].sa));
+        rte_prefetch0(&(sta->ptk[key_id].decrypt_ctr[tid]));
+        rte_prefetch0(sta->parent_vap);
     }
 }
 
 /*
  * Get Encrypt Data
- * - read lock must be taken before calling this function
+ * - a store read section must be entered before calling this function
+ * - all of a station's downlink packets are processed by the same
+ *   downlink thread (see the RSS and dispatch thread setup), so the
+ *   increment of the encrypt counter is never contended
+ * - key_id is the KeyID to put in the CCMP header
  */
 static inline void
 sta_encrypt_data_get(struct sta_elem *sta,
                      struct ccmp_sa **sa,
                      counter_val_t *ctr,
-                     struct vap_elem **vap)
+                     struct vap_elem **vap,
+                     uint8_t *key_id)
 {
+    struct sta_ptk *ptk;
+
     if (likely(sta != NULL && sa != NULL &&
-               ctr != NULL && vap != NULL)) {
-        *sa = &(sta->ptk_sa);
-        *ctr = counter_increment(&(sta->ptk_encrypt_ctr));
+               ctr != NULL && vap != NULL && key_id != NULL)) {
+        *key_id = sta->ptk_tx_key_id;
+        ptk = &(sta->ptk[*key_id]);
+        *sa = &(ptk->sa);
+        *ctr = counter_increment(&(ptk->encrypt_ctr));
         *vap = sta->parent_vap;
     }
 }
 
 /*
  * Get Decrypt Data
- * - read lock must be taken before calling this function
+ * - a store read section must be entered before calling this function
+ * - key_id is the KeyID of the CCMP header, and the SA is NULL if it
+ *   has no PTK, or the PTK is past its RX overlap
  */
 static inline void
 sta_decrypt_data_get(struct sta_elem *sta,
+                     uint8_t key_id,
                      uint8_t tid,
                      struct ccmp_sa **sa,
                      counter_val_t *ctr,
                      struct vap_elem **vap)
 {
+    struct sta_ptk *ptk;
+
     if (likely(sta != NULL && sa != NULL && ctr != NULL &&
                vap != NULL && tid < TID_NUM)) {
-        *sa = &(sta->ptk_sa);
-        *ctr = counter_get(&(sta->ptk_decrypt_ctr[tid]));
         *vap = sta->parent_vap;
+
+        if (unlikely(key_id >= PTK_KEY_ID_NUM)) {
+            *sa = NULL;
+            return;
+        }
+
+        ptk = &(sta->ptk[key_id]);
+        if (unlikely(ptk->rx_until != 0 && rte_rdtsc() > ptk->rx_until)) {
+            *sa = NULL;
+            return;
+        }
+
+        *sa = &(ptk->sa);
+        *ctr = counter_get(&(ptk->decrypt_ctr[tid]));
     }
 }
 
@@ -33,7 +33,10 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#include <string.h>
+
 #include <rte_common.h>
+#include <rte_lcore.h>
 
 #include "statistics_capture_common.h"
 
@@ -42,3 +45,34 @@ stats_capture_common_pmd_reads_get_mem_info_size(void)
 {
     return sizeof(struct stats_pmd_reads);
 }
+
+/*
+ * add up the per lcore copies of a struct of uint64_t counters
+ * - the copy for lcore n is at lcore_stats + n * stride
+ * - base (if not NULL) is taken off the total, so the counters can be
+ *   cleared by the stats thread without writing to the lcores' copies
+ */
+void
+stats_capture_common_sum(void *sum, const void *base,
+                         const void *lcore_stats, size_t stride,
+                         size_t size)
+{
+    uint64_t *s = sum;
+    const uint64_t *b = base;
+    const volatile uint64_t *c;
+    unsigned lcore_id;
+    size_t i, n = size / sizeof(uint64_t);
+
+    memset(sum, 0, size);
+
+    for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        c = (const volatile uint64_t *)
+            ((const uint8_t *)lcore_stats + lcore_id * stride);
+        for (i = 0; i < n; i++)
+            s[i] += c[i];
+    }
+
+    if (b != NULL)
+        for (i = 0; i < n; i++)
+            s[i] -= b[i];
+}
@@ -52,4 +52,9 @@ struct stats_pmd_reads {
 size_t
 stats_capture_common_pmd_reads_get_mem_info_size(void);
 
+void
+stats_capture_common_sum(void *sum, const void *base,
+                         const void *lcore_stats, size_t stride,
+                         size_t size);
+
 #endif // __INCLUDE_STATISTICS_CAPTURE_COMMON_H__
@@ -33,14 +33,32 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#include <string.h>
+
 #include <rte_common.h>
+#include <rte_lcore.h>
 #include <rte_malloc.h>
 
 #include "app.h"
 #include "r-wpa_global_vars.h"
+#include "statistics_capture_common.h"
 #include "statistics_capture_control.h"
 
-static struct stats_control_drops *stats_control_drops = NULL;
+/*
+ * drops are counted per lcore, as uplink threads count the control
+ * frames they drop here too, and summed when the stats handler reads
+ * them
+ */
+struct stats_control_lcore {
+    struct stats_control_drops drops;
+} __rte_cache_aligned;
+
+static struct stats_control_lcore *stats_control = NULL;
+
+/* totals when the stats were last cleared */
+static struct stats_control_drops stats_control_drops_base;
+
+static struct stats_control_tls_tx *stats_control_tls_tx = NULL;
 
 /* flag that lets other components check if this class is ready for use */
 static uint8_t is_stats_capture_control_initialised = 0;
@@ -54,13 +72,23 @@ stats_capture_control_init(__attribute__((unused)) struct app_params *app)
         return;
     }
 
-    stats_control_drops = rte_zmalloc("control_drops_stats_capture",
-                                      sizeof(struct stats_control_drops),
-                                      RTE_CACHE_LINE_SIZE);
+    stats_control = rte_zmalloc("control_stats_capture",
+                                sizeof(stats_control[0]) * RTE_MAX_LCORE,
+                                RTE_CACHE_LINE_SIZE);
 
-    if (NULL == stats_control_drops)
+    if (NULL == stats_control)
         rte_exit(EXIT_FAILURE,
-                 "Failed to allocate mem for Control Drop stats\n");
+                 "Failed to allocate mem for Control stats\n");
+
+    memset(&stats_control_drops_base, 0, sizeof(stats_control_drops_base));
+
+    stats_control_tls_tx = rte_zmalloc("control_tls_tx_stats_capture",
+                                       sizeof(struct stats_control_tls_tx),
+                                       RTE_CACHE_LINE_SIZE);
+
+    if (NULL == stats_control_tls_tx)
+        rte_exit(EXIT_FAILURE,
+                 "Failed to allocate mem for Control TLS TX stats\n");
 
     is_stats_capture_control_initialised = 1;
 }
@@ -68,8 +96,11 @@ stats_capture_control_init(__attribute__((unused)) struct app_params *app)
 void
 stats_capture_control_free(void)
 {
-    if (NULL != stats_control_drops)
-        rte_free(stats_control_drops);
+    if (NULL != stats_control)
+        rte_free(stats_control);
+
+    if (NULL != stats_control_tls_tx)
+        rte_free(stats_control_tls_tx);
 
     is_stats_capture_control_initialised = 0;
 }
@@ -80,10 +111,12 @@ stats_capture_control_is_inited(void)
     return is_stats_capture_control_initialised;
 }
 
-struct stats_control_drops *
-stats_capture_control_drops_get_mem_info(void)
+void
+stats_capture_control_drops_get(struct stats_control_drops *drops)
 {
-    return stats_control_drops;
+    stats_capture_common_sum(drops, &stats_control_drops_base,
+                             &stats_control[0].drops, sizeof(stats_control[0]),
+                             sizeof(*drops));
 }
 
 size_t
@@ -96,7 +129,14 @@ void
 stats_capture_control_drops_inc(enum stats_control_drops_type type,
                                 uint64_t amt)
 {
-    if (is_stats_capture_control_initialised) {
+    struct stats_control_drops *stats_control_drops;
+    unsigned lcore_id = rte_lcore_id();
+
+    /* the threads counting these always run on EAL lcores */
+    if (is_stats_capture_control_initialised &&
+        likely(lcore_id < RTE_MAX_LCORE)) {
+        stats_control_drops = &stats_control[lcore_id].drops;
+
         switch (type) {
         case STATS_CTRL_DROPS_TYPE_MSG_HANDLING_ERROR:
             stats_control_drops->msg_handling_error += amt;
@@ -119,6 +159,12 @@ stats_capture_control_drops_inc(enum stats_control_drops_type type,
         case STATS_CTRL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE:
             stats_control_drops->unexpected_packet_type += amt;
             break;
+        case STATS_CTRL_DROPS_TYPE_RING_FULL:
+            stats_control_drops->ring_full += amt;
+            break;
+        case STATS_CTRL_DROPS_TYPE_TLS_TX_FULL:
+            stats_control_drops->tls_tx_full += amt;
+            break;
         default:
             break;
         }
@@ -126,3 +172,55 @@ stats_capture_control_drops_inc(enum stats_control_drops_type type,
 
     return;
 }
+
+struct stats_control_tls_tx *
+stats_capture_control_tls_tx_get_mem_info(void)
+{
+    return stats_control_tls_tx;
+}
+
+size_t
+stats_capture_control_tls_tx_get_mem_info_size(void)
+{
+    return sizeof(struct stats_control_tls_tx);
+}
+
+void
+stats_capture_control_tls_tx_queued(uint64_t depth)
+{
+    if (is_stats_capture_control_initialised) {
+        stats_control_tls_tx->msgs++;
+        stats_control_tls_tx->depth = depth;
+        if (depth > stats_control_tls_tx->max_depth)
+            stats_control_tls_tx->max_depth = depth;
+    }
+}
+
+void
+stats_capture_control_tls_tx_written(uint64_t bytes, uint64_t cycles)
+{
+    if (is_stats_capture_control_initialised) {
+        stats_control_tls_tx->records++;
+        stats_control_tls_tx->bytes += bytes;
+        stats_control_tls_tx->cycles += cycles;
+        if (cycles > stats_control_tls_tx->max_cycles)
+            stats_control_tls_tx->max_cycles = cycles;
+        stats_control_tls_tx->depth -= RTE_MIN(bytes, stats_control_tls_tx->depth);
+    }
+}
+
+void
+stats_capture_control_tls_tx_blocked(void)
+{
+    if (is_stats_capture_control_initialised)
+        stats_control_tls_tx->blocked++;
+}
+
+void
+stats_capture_control_clear(void)
+{
+    stats_capture_common_sum(&stats_control_drops_base, NULL,
+                             &stats_control[0].drops, sizeof(stats_control[0]),
+                             sizeof(stats_control_drops_base));
+    memset(stats_control_tls_tx, 0, sizeof(*stats_control_tls_tx));
+}
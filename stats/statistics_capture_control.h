@@ -44,6 +44,8 @@ enum stats_control_drops_type {
     STATS_CTRL_DROPS_TYPE_PACKET_ENCAP_ERROR,
     STATS_CTRL_DROPS_TYPE_NO_AP_TUNNEL_PORT,
     STATS_CTRL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE,
+    STATS_CTRL_DROPS_TYPE_RING_FULL,
+    STATS_CTRL_DROPS_TYPE_TLS_TX_FULL,
 
     /* add new types before this one */
     STATS_CTRL_DROPS_TYPE_DELIM
@@ -57,6 +59,25 @@ struct stats_control_drops {
     uint64_t packet_encap_error;
     uint64_t no_ap_tunnel_port;
     uint64_t unexpected_packet_type;
+    uint64_t ring_full;
+    uint64_t tls_tx_full;
+};
+
+/*
+ * writes to the TLS connection
+ * - messages are queued and written together, a record at a time
+ * - cycles are from the oldest message in a record being queued to
+ *   the record being written
+ */
+struct stats_control_tls_tx {
+    uint64_t msgs;
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint64_t depth;
+    uint64_t max_depth;
+    uint64_t blocked;
 };
 
 void
@@ -68,8 +89,8 @@ stats_capture_control_free(void);
 uint8_t
 stats_capture_control_is_inited(void);
 
-struct stats_control_drops *
-stats_capture_control_drops_get_mem_info(void);
+void
+stats_capture_control_drops_get(struct stats_control_drops *drops);
 
 size_t
 stats_capture_control_drops_get_mem_info_size(void);
@@ -78,4 +99,22 @@ void
 stats_capture_control_drops_inc(enum stats_control_drops_type type,
                                 uint64_t amt);
 
+struct stats_control_tls_tx *
+stats_capture_control_tls_tx_get_mem_info(void);
+
+size_t
+stats_capture_control_tls_tx_get_mem_info_size(void);
+
+void
+stats_capture_control_tls_tx_queued(uint64_t depth);
+
+void
+stats_capture_control_tls_tx_written(uint64_t bytes, uint64_t cycles);
+
+void
+stats_capture_control_tls_tx_blocked(void);
+
+void
+stats_capture_control_clear(void);
+
 #endif // __INCLUDE_STATISTICS_CAPTURE_CONTROL_H__
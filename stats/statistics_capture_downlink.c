@@ -33,7 +33,10 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#include <string.h>
+
 #include <rte_common.h>
+#include <rte_lcore.h>
 #include <rte_malloc.h>
 
 #include "app.h"
@@ -41,8 +44,20 @@
 #include "statistics_capture_common.h"
 #include "statistics_capture_downlink.h"
 
-static struct stats_downlink_drops *stats_downlink_drops = NULL;
-static struct stats_pmd_reads *stats_downlink_pmd_reads = NULL;
+/*
+ * counters are kept per lcore, as there may be several downlink threads,
+ * and summed when the stats handler reads them
+ */
+struct stats_downlink_lcore {
+    struct stats_downlink_drops drops;
+    struct stats_pmd_reads pmd_reads;
+} __rte_cache_aligned;
+
+static struct stats_downlink_lcore *stats_downlink = NULL;
+
+/* totals when the stats were last cleared */
+static struct stats_downlink_drops stats_downlink_drops_base;
+static struct stats_pmd_reads stats_downlink_pmd_reads_base;
 
 /* flag that lets other components check if this class is ready for use */
 static uint8_t is_stats_capture_downlink_initialised = 0;
@@ -56,21 +71,16 @@ stats_capture_downlink_init(__attribute__((unused)) struct app_params *app)
         return;
     }
 
-    stats_downlink_drops = rte_zmalloc("downlink_drops_stats_capture",
-                                       sizeof(struct stats_downlink_drops),
-                                       RTE_CACHE_LINE_SIZE);
+    stats_downlink = rte_zmalloc("downlink_stats_capture",
+                                 sizeof(stats_downlink[0]) * RTE_MAX_LCORE,
+                                 RTE_CACHE_LINE_SIZE);
 
-    if (NULL == stats_downlink_drops)
+    if (NULL == stats_downlink)
         rte_exit(EXIT_FAILURE,
-                 "Failed to allocate mem for Downlink Drop stats\n");
+                 "Failed to allocate mem for Downlink stats\n");
 
-    stats_downlink_pmd_reads = rte_zmalloc("downlink_pmd_reads_stats_capture",
-                                           sizeof(struct stats_pmd_reads),
-                                           RTE_CACHE_LINE_SIZE);
-
-    if (NULL == stats_downlink_pmd_reads)
-        rte_exit(EXIT_FAILURE,
-                 "Failed to allocate mem for Downlink PMD Read stats\n");
+    memset(&stats_downlink_drops_base, 0, sizeof(stats_downlink_drops_base));
+    memset(&stats_downlink_pmd_reads_base, 0, sizeof(stats_downlink_pmd_reads_base));
 
     is_stats_capture_downlink_initialised = 1;
 }
@@ -78,11 +88,8 @@ stats_capture_downlink_init(__attribute__((unused)) struct app_params *app)
 void
 stats_capture_downlink_free(void)
 {
-    if (NULL != stats_downlink_drops)
-        rte_free(stats_downlink_drops);
-
-    if (NULL != stats_downlink_pmd_reads)
-        rte_free(stats_downlink_pmd_reads);
+    if (NULL != stats_downlink)
+        rte_free(stats_downlink);
 
     is_stats_capture_downlink_initialised = 0;
 }
@@ -93,10 +100,12 @@ stats_capture_downlink_is_inited(void)
     return is_stats_capture_downlink_initialised;
 }
 
-struct stats_downlink_drops *
-stats_capture_downlink_drops_get_mem_info(void)
+void
+stats_capture_downlink_drops_get(struct stats_downlink_drops *drops)
 {
-    return stats_downlink_drops;
+    stats_capture_common_sum(drops, &stats_downlink_drops_base,
+                             &stats_downlink[0].drops, sizeof(stats_downlink[0]),
+                             sizeof(*drops));
 }
 
 size_t
@@ -109,7 +118,14 @@ void
 stats_capture_downlink_drops_inc(enum stats_downlink_drops_type type,
                                  uint64_t amt)
 {
-    if (is_stats_capture_downlink_initialised) {
+    struct stats_downlink_drops *stats_downlink_drops;
+    unsigned lcore_id = rte_lcore_id();
+
+    /* the threads counting these always run on EAL lcores */
+    if (is_stats_capture_downlink_initialised &&
+        likely(lcore_id < RTE_MAX_LCORE)) {
+        stats_downlink_drops = &stats_downlink[lcore_id].drops;
+
         switch (type) {
         case STATS_DL_DROPS_TYPE_PACKET_DECAP_ERROR:
             stats_downlink_drops->packet_decap_error += amt;
@@ -146,17 +162,25 @@ stats_capture_downlink_drops_inc(enum stats_downlink_drops_type type,
     return;
 }
 
-struct stats_pmd_reads *
-stats_capture_downlink_pmd_reads_get_mem_info(void)
+void
+stats_capture_downlink_pmd_reads_get(struct stats_pmd_reads *pmd_reads)
 {
-    return stats_downlink_pmd_reads;
+    stats_capture_common_sum(pmd_reads, &stats_downlink_pmd_reads_base,
+                             &stats_downlink[0].pmd_reads, sizeof(stats_downlink[0]),
+                             sizeof(*pmd_reads));
 }
 
 void
 stats_capture_downlink_pmd_reads_inc(enum stats_pmd_reads_type type,
                                      uint64_t amt)
 {
-    if (is_stats_capture_downlink_initialised) {
+    struct stats_pmd_reads *stats_downlink_pmd_reads;
+    unsigned lcore_id = rte_lcore_id();
+
+    if (is_stats_capture_downlink_initialised &&
+        likely(lcore_id < RTE_MAX_LCORE)) {
+        stats_downlink_pmd_reads = &stats_downlink[lcore_id].pmd_reads;
+
         switch (type) {
         case STATS_PMD_READS_TYPE_EMPTY:
             stats_downlink_pmd_reads->empty += amt;
@@ -171,3 +195,14 @@ stats_capture_downlink_pmd_reads_inc(enum stats_pmd_reads_type type,
 
     return;
 }
+
+void
+stats_capture_downlink_clear(void)
+{
+    stats_capture_common_sum(&stats_downlink_drops_base, NULL,
+                             &stats_downlink[0].drops, sizeof(stats_downlink[0]),
+                             sizeof(stats_downlink_drops_base));
+    stats_capture_common_sum(&stats_downlink_pmd_reads_base, NULL,
+                             &stats_downlink[0].pmd_reads, sizeof(stats_downlink[0]),
+                             sizeof(stats_downlink_pmd_reads_base));
+}
@@ -72,8 +72,8 @@ stats_capture_downlink_free(void);
 uint8_t
 stats_capture_downlink_is_inited(void);
 
-struct stats_downlink_drops *
-stats_capture_downlink_drops_get_mem_info(void);
+void
+stats_capture_downlink_drops_get(struct stats_downlink_drops *drops);
 
 size_t
 stats_capture_downlink_drops_get_mem_info_size(void);
@@ -82,11 +82,14 @@ void
 stats_capture_downlink_drops_inc(enum stats_downlink_drops_type type,
                                  uint64_t amt);
 
-struct stats_pmd_reads *
-stats_capture_downlink_pmd_reads_get_mem_info(void);
+void
+stats_capture_downlink_pmd_reads_get(struct stats_pmd_reads *pmd_reads);
 
 void
 stats_capture_downlink_pmd_reads_inc(enum stats_pmd_reads_type type,
                                      uint64_t amt);
 
+void
+stats_capture_downlink_clear(void);
+
 #endif // __INCLUDE_STATISTICS_CAPTURE_DOWNLINK_H__
@@ -55,6 +55,8 @@ struct stats_sta_lookup {
     uint64_t matched;
     uint64_t unmatched;
     uint64_t num_pkts;
+    uint64_t cache_hits;  /* found in the station cache, see store.c */
+    uint64_t cache_misses;
     uint32_t last_burst_index;
     uint32_t last_burst[STA_LOOKUP_BURST_LEN];
 };
@@ -74,8 +74,8 @@ stats_capture_uplink_free(void);
 uint8_t
 stats_capture_uplink_is_inited(void);
 
-struct stats_uplink_drops *
-stats_capture_uplink_drops_get_mem_info(void);
+void
+stats_capture_uplink_drops_get(struct stats_uplink_drops *drops);
 
 size_t
 stats_capture_uplink_drops_get_mem_info_size(void);
@@ -84,11 +84,14 @@ void
 stats_capture_uplink_drops_inc(enum stats_uplink_drops_type type,
                                uint64_t amt);
 
-struct stats_pmd_reads *
-stats_capture_uplink_pmd_reads_get_mem_info(void);
+void
+stats_capture_uplink_pmd_reads_get(struct stats_pmd_reads *pmd_reads);
 
 void
 stats_capture_uplink_pmd_reads_inc(enum stats_pmd_reads_type type,
                                    uint64_t amt);
 
+void
+stats_capture_uplink_clear(void);
+
 #endif // __INCLUDE_STATISTICS_CAPTURE_UPLINK_H__
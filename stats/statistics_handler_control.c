@@ -44,18 +44,23 @@
 #include "statistics_capture_control.h"
 #include "statistics_handler_control.h"
 
-/* reference to original mem locations of Control stats */
-static struct stats_control_drops *original_control_drops_sts = NULL;
+/* reference to original mem location of Control TLS TX stats */
+static struct stats_control_tls_tx *original_control_tls_tx_sts = NULL;
 
 /* 
  * mem where shadow copy of original data is kept.
  * - memcpy is performed between original and shadow copy regions, as
  *   original stat counters change continuously as application runs
+ * - drops are counted per lcore, so their shadow copy is
+ *   the sum of the lcores' counters instead
  */
 static struct stats_control_drops *shadow_control_drops_sts = NULL;
 static size_t shadow_control_drops_sts_sz = 0;
+static struct stats_control_tls_tx *shadow_control_tls_tx_sts = NULL;
+static size_t shadow_control_tls_tx_sts_sz = 0;
 
 static struct parsed_stats_control_drops *parsed_control_drops_sts = NULL;
+static struct parsed_stats_control_tls_tx *parsed_control_tls_tx_sts = NULL;
 
 static void
 init_parsed_mem_control(void)
@@ -67,14 +72,23 @@ init_parsed_mem_control(void)
     if (NULL == parsed_control_drops_sts)
         rte_exit(EXIT_FAILURE,
                  "Failed to allocate parsed mem for Control Drop stats\n");
+
+    parsed_control_tls_tx_sts = rte_zmalloc("control_tls_tx_parsed_stats",
+                                            sizeof(struct parsed_stats_control_tls_tx),
+                                            RTE_CACHE_LINE_SIZE);
+
+    if (NULL == parsed_control_tls_tx_sts)
+        rte_exit(EXIT_FAILURE,
+                 "Failed to allocate parsed mem for Control TLS TX stats\n");
 }
 
 static void
 init_shadow_mem_control(void)
 {
-    /* grab pointers to mem locations of original stats */
-    original_control_drops_sts = stats_capture_control_drops_get_mem_info();
+    /* grab sizes (and pointers to mem locations) of original stats */
     shadow_control_drops_sts_sz = stats_capture_control_drops_get_mem_info_size();
+    original_control_tls_tx_sts = stats_capture_control_tls_tx_get_mem_info();
+    shadow_control_tls_tx_sts_sz = stats_capture_control_tls_tx_get_mem_info_size();
 
     /*
      * allocate memory for shadow stats, during the runtime original stats
@@ -88,6 +102,14 @@ init_shadow_mem_control(void)
     if (NULL == shadow_control_drops_sts)
         rte_exit(EXIT_FAILURE,
                  "Failed to allocate shadow mem for Control Drop stats\n");
+
+    shadow_control_tls_tx_sts = rte_zmalloc("control_tls_tx_shadow_stats_capture",
+                                            shadow_control_tls_tx_sts_sz,
+                                            RTE_CACHE_LINE_SIZE);
+
+    if (NULL == shadow_control_tls_tx_sts)
+        rte_exit(EXIT_FAILURE,
+                 "Failed to allocate shadow mem for Control TLS TX stats\n");
 }
 
 static void
@@ -116,6 +138,38 @@ print_stats_control_drops(void)
     printf("|  Unexpected Packet Type  | %20lu (%6.2f%%) |\n",
            shadow_control_drops_sts->unexpected_packet_type,
            parsed_control_drops_sts->unexpected_packet_type_percent);
+    printf("|    Control Ring Full     | %20lu (%6.2f%%) |\n",
+           shadow_control_drops_sts->ring_full,
+           parsed_control_drops_sts->ring_full_percent);
+    printf("|    TLS TX Queue Full     | %20lu (%6.2f%%) |\n",
+           shadow_control_drops_sts->tls_tx_full,
+           parsed_control_drops_sts->tls_tx_full_percent);
+    printf("+-----------------------------------------------------------+\n\n");
+}
+
+static void
+print_stats_control_tls_tx(void)
+{
+    printf("|          TLS TX          |               #                |\n");
+    printf("+------------------------- +--------------------------------+\n");
+    printf("|     Messages Queued      | %30lu |\n",
+           shadow_control_tls_tx_sts->msgs);
+    printf("|     Records Written      | %30lu |\n",
+           shadow_control_tls_tx_sts->records);
+    printf("|      Bytes Written       | %30lu |\n",
+           shadow_control_tls_tx_sts->bytes);
+    printf("|     Bytes per Record     | %30lu |\n",
+           parsed_control_tls_tx_sts->bytes_per_record);
+    printf("| Flush Cycles per Record  | %30lu |\n",
+           parsed_control_tls_tx_sts->cycles_per_record);
+    printf("|     Max Flush Cycles     | %30lu |\n",
+           shadow_control_tls_tx_sts->max_cycles);
+    printf("|   Queue Depth (bytes)    | %30lu |\n",
+           shadow_control_tls_tx_sts->depth);
+    printf("| Max Queue Depth (bytes)  | %30lu |\n",
+           shadow_control_tls_tx_sts->max_depth);
+    printf("|  Socket Not Writable     | %30lu |\n",
+           shadow_control_tls_tx_sts->blocked);
     printf("+-----------------------------------------------------------+\n\n");
 }
 
@@ -136,15 +190,26 @@ sts_hdlr_control_free(void)
     if (NULL != parsed_control_drops_sts) {
         rte_free(parsed_control_drops_sts);
     }
+
+    if (NULL != shadow_control_tls_tx_sts) {
+        rte_free(shadow_control_tls_tx_sts);
+    }
+
+    if (NULL != parsed_control_tls_tx_sts) {
+        rte_free(parsed_control_tls_tx_sts);
+    }
 }
 
 void
 sts_hdlr_control_update_shadow_stats(void)
 {
+    /* sum of the per lcore counters */
+    stats_capture_control_drops_get(shadow_control_drops_sts);
+
     /* simple struct copy - no underlying pointers, just plain data */
-    rte_memcpy(shadow_control_drops_sts,
-               original_control_drops_sts,
-               shadow_control_drops_sts_sz);
+    rte_memcpy(shadow_control_tls_tx_sts,
+               original_control_tls_tx_sts,
+               shadow_control_tls_tx_sts_sz);
 }
 
 void
@@ -161,7 +226,9 @@ sts_hdlr_control_update_parsed_stats(void)
         od->encryption_error +
         od->packet_encap_error +
         od->no_ap_tunnel_port +
-        od->unexpected_packet_type;
+        od->unexpected_packet_type +
+        od->ring_full +
+        od->tls_tx_full;
 
     pd->msg_handling_error_percent = PERCENT(od->msg_handling_error, total_drops);
     pd->packet_decap_error_percent = PERCENT(od->packet_decap_error, total_drops);
@@ -170,12 +237,21 @@ sts_hdlr_control_update_parsed_stats(void)
     pd->packet_encap_error_percent = PERCENT(od->packet_encap_error, total_drops);
     pd->no_ap_tunnel_port_percent = PERCENT(od->no_ap_tunnel_port, total_drops);
     pd->unexpected_packet_type_percent = PERCENT(od->unexpected_packet_type, total_drops);
+    pd->ring_full_percent = PERCENT(od->ring_full, total_drops);
+    pd->tls_tx_full_percent = PERCENT(od->tls_tx_full, total_drops);
+
+    /* tls tx */
+    struct stats_control_tls_tx *ot = shadow_control_tls_tx_sts;
+    struct parsed_stats_control_tls_tx *pt = parsed_control_tls_tx_sts;
+
+    pt->bytes_per_record = ot->records ? ot->bytes / ot->records : 0;
+    pt->cycles_per_record = ot->records ? ot->cycles / ot->records : 0;
 }
 
 void
 sts_hdlr_control_clear_stats(void)
 {
-    memset(original_control_drops_sts, 0, shadow_control_drops_sts_sz);
+    stats_capture_control_clear();
 }
 
 void
@@ -187,8 +263,11 @@ sts_hdlr_control_print(enum rwpa_stats_lvl sts_lvl)
 
     switch (sts_lvl) {
     case RWPA_STS_LVL_APP:
+        print_stats_control_drops();
+        break;
     case RWPA_STS_LVL_DETAILED:
         print_stats_control_drops();
+        print_stats_control_tls_tx();
         break;
     case RWPA_STS_LVL_OFF:
     case RWPA_STS_LVL_PORTS_ONLY:
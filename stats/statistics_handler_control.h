@@ -44,6 +44,13 @@ struct parsed_stats_control_drops {
     float packet_encap_error_percent;
     float no_ap_tunnel_port_percent;
     float unexpected_packet_type_percent;
+    float ring_full_percent;
+    float tls_tx_full_percent;
+};
+
+struct parsed_stats_control_tls_tx {
+    uint64_t bytes_per_record;
+    uint64_t cycles_per_record;
 };
 
 void
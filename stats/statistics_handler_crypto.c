@@ -43,6 +43,8 @@
 #include "statistics_capture_crypto.h"
 #include "statistics_handler_crypto.h"
 #include "cycle_capture.h"
+#include "crypto.h"
+#include "sess_cache.h"
 
 /* reference to original mem locations of Crypto stats */
 static struct stats_crypto *original_crypto_sts = NULL;
@@ -57,6 +59,20 @@ static size_t shadow_crypto_sts_sz = 0;
 
 static struct parsed_stats_crypto *parsed_crypto_sts = NULL;
 
+/*
+ * shadow copy of the per-device stats, kept by the cryptodev PMDs
+ * - ops spilled over from a full qp are counted by the spillover device
+ */
+static struct rte_cryptodev_stats shadow_crypto_dev_sts[RTE_CRYPTO_MAX_DEVS];
+
+/*
+ * shadow copy of the session cache stats
+ * - the cache counters are not cleared, so the values at the last
+ *   clear are kept and subtracted
+ */
+static struct sess_cache_stats shadow_sess_cache_sts;
+static struct sess_cache_stats cleared_sess_cache_sts;
+
 static void
 init_parsed_stats_mem(void)
 {
@@ -246,6 +262,57 @@ print_parsed_stats_crypto(enum stats_crypto_type type)
     }
 }
 
+static void
+print_stats_crypto_devs(void)
+{
+    uint8_t i, n_devs = crypto_dev_count();
+
+    printf("| %-120s |\n"
+           "+--------------------------------------------------------------------------------------------------------------------------+\n"
+           "|  Device |           Driver           |     Ops enqueued    |     Ops dequeued    |   Enqueue errors  |   Dequeue errors  |\n"
+           "+--------------------------------------------------------------------------------------------------------------------------+\n",
+           "DEVICES");
+
+    for (i = 0; i < n_devs; i++) {
+        struct rte_cryptodev_info dev_info;
+        struct rte_cryptodev_stats *o = &shadow_crypto_dev_sts[i];
+        uint8_t cdev_id = crypto_dev_id_get(i);
+
+        rte_cryptodev_info_get(cdev_id, &dev_info);
+
+        printf("|%8u |%27s |%20lu |%20lu |%18lu |%18lu |\n",
+               cdev_id,
+               dev_info.driver_name != NULL ? dev_info.driver_name : "unknown",
+               o->enqueued_count,
+               o->dequeued_count,
+               o->enqueue_err_count,
+               o->dequeue_err_count);
+    }
+
+    printf("+--------------------------------------------------------------------------------------------------------------------------+\n");
+}
+
+static void
+print_stats_sess_cache(void)
+{
+    struct sess_cache_stats *o = &shadow_sess_cache_sts;
+    struct sess_cache_stats *c = &cleared_sess_cache_sts;
+
+    printf("| %-120s |\n"
+           "+--------------------------------------------------------------------------------------------------------------------------+\n"
+           "|      Size      |     In use     |         Hits         |        Misses        |      Evictions       |      Failures     |\n"
+           "+--------------------------------------------------------------------------------------------------------------------------+\n"
+           "|%15u |%15u |%21lu |%21lu |%21lu |%18lu |\n"
+           "+--------------------------------------------------------------------------------------------------------------------------+\n",
+           "SESSION CACHE",
+           o->size,
+           o->in_use,
+           o->hits - c->hits,
+           o->misses - c->misses,
+           o->evictions - c->evictions,
+           o->failures - c->failures);
+}
+
 void
 sts_hdlr_crypto_init(__attribute__((unused)) struct app_params *app)
 {
@@ -278,6 +345,11 @@ sts_hdlr_crypto_update_shadow_stats(void)
         shadow_crypto_sts[i].total_dequeue_cycles =
             CYCLE_CAPTURE_GET_TOTAL_CYCLES(stats_capture_crypto_get_dequeue_cycle_id(i));
     }
+
+    for (i = 0; i < crypto_dev_count(); i++)
+        rte_cryptodev_stats_get(crypto_dev_id_get(i), &shadow_crypto_dev_sts[i]);
+
+    sess_cache_stats_get(&shadow_sess_cache_sts);
 }
 
 void
@@ -292,10 +364,19 @@ sts_hdlr_crypto_update_parsed_stats(void)
 void
 sts_hdlr_crypto_clear_stats(void)
 {
+    unsigned i;
+
     memset(original_crypto_sts, 0, shadow_crypto_sts_sz);
     memset(parsed_crypto_sts,
            0,
            sizeof(parsed_crypto_sts[0]) * STATS_CRYPTO_TYPE_U_DELIM);
+
+    for (i = 0; i < crypto_dev_count(); i++)
+        rte_cryptodev_stats_reset(crypto_dev_id_get(i));
+    memset(shadow_crypto_dev_sts, 0, sizeof(shadow_crypto_dev_sts));
+
+    sess_cache_stats_get(&cleared_sess_cache_sts);
+    shadow_sess_cache_sts = cleared_sess_cache_sts;
 }
 
 void
@@ -312,6 +393,8 @@ sts_hdlr_crypto_print(enum rwpa_stats_lvl sts_lvl)
     case RWPA_STS_LVL_DETAILED:
         for (i = 0; i < STATS_CRYPTO_TYPE_U_DELIM; i++)
             print_parsed_stats_crypto(i);
+        print_stats_crypto_devs();
+        print_stats_sess_cache();
         break;
     case RWPA_STS_LVL_OFF:
     case RWPA_STS_LVL_PORTS_ONLY:
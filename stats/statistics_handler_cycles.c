@@ -289,19 +289,28 @@ calculate_parsed_stats_cycle(void)
             o[CYCLE_CAPTURE_UL_STA_LOOKUP].total_cycles;
         p->ul_sta_lookup_calls_total =
             o[CYCLE_CAPTURE_UL_STA_LOOKUP].call_count;
+        p->ul_sta_lookup_misses_total =
+            o[CYCLE_CAPTURE_UL_STA_LOOKUP].total_misses;
     } else {
         p->ul_sta_lookup_cycles_total = 0;
         p->ul_sta_lookup_calls_total = 0;
+        p->ul_sta_lookup_misses_total = 0;
     }
     if (p->ul_sta_lookup_calls_total) {
         p->ul_sta_lookup_cycles_per_call =
             p->ul_sta_lookup_cycles_total /
             p->ul_sta_lookup_calls_total;
+        p->ul_sta_lookup_misses_per_call =
+            p->ul_sta_lookup_misses_total /
+            p->ul_sta_lookup_calls_total;
     }
     if (parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_UL].num_pkts) {
         p->ul_sta_lookup_cycles_per_mbuf =
             p->ul_sta_lookup_cycles_total /
             parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_UL].num_pkts;
+        p->ul_sta_lookup_misses_per_mbuf =
+            p->ul_sta_lookup_misses_total /
+            parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_UL].num_pkts;
     }
 
     /* UL_STA_LOCK */
@@ -329,9 +338,12 @@ calculate_parsed_stats_cycle(void)
             o[CYCLE_CAPTURE_UL_STA_DECRYPT_DATA_GET].total_cycles;
         p->ul_sta_decrypt_data_get_calls_total =
             o[CYCLE_CAPTURE_UL_STA_DECRYPT_DATA_GET].call_count;
+        p->ul_sta_decrypt_data_get_misses_total =
+            o[CYCLE_CAPTURE_UL_STA_DECRYPT_DATA_GET].total_misses;
     } else {
         p->ul_sta_decrypt_data_get_cycles_total = 0;
         p->ul_sta_decrypt_data_get_calls_total = 0;
+        p->ul_sta_decrypt_data_get_misses_total = 0;
     }
     if (p->ul_sta_decrypt_data_get_calls_total) {
         p->ul_sta_decrypt_data_get_cycles_per_call =
@@ -340,6 +352,12 @@ calculate_parsed_stats_cycle(void)
         p->ul_sta_decrypt_data_get_cycles_per_mbuf =
             p->ul_sta_decrypt_data_get_cycles_total /
             p->ul_sta_decrypt_data_get_calls_total;
+        p->ul_sta_decrypt_data_get_misses_per_call =
+            p->ul_sta_decrypt_data_get_misses_total /
+            p->ul_sta_decrypt_data_get_calls_total;
+        p->ul_sta_decrypt_data_get_misses_per_mbuf =
+            p->ul_sta_decrypt_data_get_misses_total /
+            p->ul_sta_decrypt_data_get_calls_total;
     }
 
     /* UL_CCMP_REPLAY_DETECT */
@@ -690,19 +708,28 @@ calculate_parsed_stats_cycle(void)
             o[CYCLE_CAPTURE_DL_STA_LOOKUP].total_cycles;
         p->dl_sta_lookup_calls_total =
             o[CYCLE_CAPTURE_DL_STA_LOOKUP].call_count;
+        p->dl_sta_lookup_misses_total =
+            o[CYCLE_CAPTURE_DL_STA_LOOKUP].total_misses;
     } else {
         p->dl_sta_lookup_cycles_total = 0;
         p->dl_sta_lookup_calls_total = 0;
+        p->dl_sta_lookup_misses_total = 0;
     }
     if (p->dl_sta_lookup_calls_total) {
         p->dl_sta_lookup_cycles_per_call =
             p->dl_sta_lookup_cycles_total /
             p->dl_sta_lookup_calls_total;
+        p->dl_sta_lookup_misses_per_call =
+            p->dl_sta_lookup_misses_total /
+            p->dl_sta_lookup_calls_total;
     }
     if (parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_DL].num_pkts) {
         p->dl_sta_lookup_cycles_per_mbuf =
             p->dl_sta_lookup_cycles_total /
             parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_DL].num_pkts;
+        p->dl_sta_lookup_misses_per_mbuf =
+            p->dl_sta_lookup_misses_total /
+            parsed_sts_sta_lookup[STATS_STA_LOOKUP_TYPE_DL].num_pkts;
     }
 
     /* DL_STA_LOCK */
@@ -730,9 +757,12 @@ calculate_parsed_stats_cycle(void)
             o[CYCLE_CAPTURE_DL_STA_ENCRYPT_DATA_GET].total_cycles;
         p->dl_sta_encrypt_data_get_calls_total =
             o[CYCLE_CAPTURE_DL_STA_ENCRYPT_DATA_GET].call_count;
+        p->dl_sta_encrypt_data_get_misses_total =
+            o[CYCLE_CAPTURE_DL_STA_ENCRYPT_DATA_GET].total_misses;
     } else {
         p->dl_sta_encrypt_data_get_cycles_total = 0;
         p->dl_sta_encrypt_data_get_calls_total = 0;
+        p->dl_sta_encrypt_data_get_misses_total = 0;
     }
     if (p->dl_sta_encrypt_data_get_calls_total) {
         p->dl_sta_encrypt_data_get_cycles_per_call =
@@ -741,6 +771,12 @@ calculate_parsed_stats_cycle(void)
         p->dl_sta_encrypt_data_get_cycles_per_mbuf =
             p->dl_sta_encrypt_data_get_cycles_total /
             p->dl_sta_encrypt_data_get_calls_total;
+        p->dl_sta_encrypt_data_get_misses_per_call =
+            p->dl_sta_encrypt_data_get_misses_total /
+            p->dl_sta_encrypt_data_get_calls_total;
+        p->dl_sta_encrypt_data_get_misses_per_mbuf =
+            p->dl_sta_encrypt_data_get_misses_total /
+            p->dl_sta_encrypt_data_get_calls_total;
     }
 
     /* DL_ETHER_TO_IEEE80211_CONV */
@@ -1408,6 +1444,14 @@ sts_hdlr_cycle_print(__attribute__((unused)) enum rwpa_stats_lvl sts_lvl)
            p->ul_sta_lookup_cycles_total,
            p->ul_sta_lookup_cycles_per_call,
            p->ul_sta_lookup_cycles_per_mbuf);
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+    printf("|%-40s| `--%-23"PRIu64" | `--%-23"PRIu64" | `--%-16"PRIu64" | `--%-16"PRIu64" |\n",
+           " |  `--cache misses",
+           p->ul_sta_lookup_calls_total,
+           p->ul_sta_lookup_misses_total,
+           p->ul_sta_lookup_misses_per_call,
+           p->ul_sta_lookup_misses_per_mbuf);
+#endif
 #endif
 
     printf("|%-40s| %-26"PRIu64" | %-26"PRIu64" | %-19"PRIu64" | %-19"PRIu64" |\n",
@@ -1423,6 +1467,14 @@ sts_hdlr_cycle_print(__attribute__((unused)) enum rwpa_stats_lvl sts_lvl)
            p->ul_sta_decrypt_data_get_cycles_total,
            p->ul_sta_decrypt_data_get_cycles_per_call,
            p->ul_sta_decrypt_data_get_cycles_per_mbuf);
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+    printf("|%-40s| `--%-23"PRIu64" | `--%-23"PRIu64" | `--%-16"PRIu64" | `--%-16"PRIu64" |\n",
+           " |  `--cache misses",
+           p->ul_sta_decrypt_data_get_calls_total,
+           p->ul_sta_decrypt_data_get_misses_total,
+           p->ul_sta_decrypt_data_get_misses_per_call,
+           p->ul_sta_decrypt_data_get_misses_per_mbuf);
+#endif
 
     printf("|%-40s| %-26"PRIu64" | %-26"PRIu64" | %-19"PRIu64" | %-19"PRIu64" |\n",
            " |--UL_CCMP_REPLAY_DETECT",
@@ -1611,6 +1663,14 @@ sts_hdlr_cycle_print(__attribute__((unused)) enum rwpa_stats_lvl sts_lvl)
            p->dl_sta_lookup_cycles_total,
            p->dl_sta_lookup_cycles_per_call,
            p->dl_sta_lookup_cycles_per_mbuf);
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+    printf("|%-40s| `--%-23"PRIu64" | `--%-23"PRIu64" | `--%-16"PRIu64" | `--%-16"PRIu64" |\n",
+           " |  `--cache misses",
+           p->dl_sta_lookup_calls_total,
+           p->dl_sta_lookup_misses_total,
+           p->dl_sta_lookup_misses_per_call,
+           p->dl_sta_lookup_misses_per_mbuf);
+#endif
 #endif
 
     printf("|%-40s| %-26"PRIu64" | %-26"PRIu64" | %-19"PRIu64" | %-19"PRIu64" |\n",
@@ -1626,6 +1686,14 @@ sts_hdlr_cycle_print(__attribute__((unused)) enum rwpa_stats_lvl sts_lvl)
            p->dl_sta_encrypt_data_get_cycles_total,
            p->dl_sta_encrypt_data_get_cycles_per_call,
            p->dl_sta_encrypt_data_get_cycles_per_mbuf);
+#ifdef RWPA_CYCLE_CAPTURE_PMC
+    printf("|%-40s| `--%-23"PRIu64" | `--%-23"PRIu64" | `--%-16"PRIu64" | `--%-16"PRIu64" |\n",
+           " |  `--cache misses",
+           p->dl_sta_encrypt_data_get_calls_total,
+           p->dl_sta_encrypt_data_get_misses_total,
+           p->dl_sta_encrypt_data_get_misses_per_call,
+           p->dl_sta_encrypt_data_get_misses_per_mbuf);
+#endif
 
     printf("|%-40s| %-26"PRIu64" | %-26"PRIu64" | %-19"PRIu64" | %-19"PRIu64" |\n",
            " |--DL_ETHER_TO_IEEE80211_CONV",
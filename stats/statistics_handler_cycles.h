@@ -97,6 +97,9 @@ struct parsed_statistics_cycle {
     uint64_t ul_sta_lookup_calls_total;
     uint64_t ul_sta_lookup_cycles_per_call;
     uint64_t ul_sta_lookup_cycles_per_mbuf;
+    uint64_t ul_sta_lookup_misses_total;
+    uint64_t ul_sta_lookup_misses_per_call;
+    uint64_t ul_sta_lookup_misses_per_mbuf;
 
     uint64_t ul_sta_lock_cycles_total;
     uint64_t ul_sta_lock_calls_total;
@@ -107,6 +110,9 @@ struct parsed_statistics_cycle {
     uint64_t ul_sta_decrypt_data_get_calls_total;
     uint64_t ul_sta_decrypt_data_get_cycles_per_call;
     uint64_t ul_sta_decrypt_data_get_cycles_per_mbuf;
+    uint64_t ul_sta_decrypt_data_get_misses_total;
+    uint64_t ul_sta_decrypt_data_get_misses_per_call;
+    uint64_t ul_sta_decrypt_data_get_misses_per_mbuf;
 
     uint64_t ul_ccmp_replay_detect_cycles_total;
     uint64_t ul_ccmp_replay_detect_calls_total;
@@ -227,6 +233,9 @@ struct parsed_statistics_cycle {
     uint64_t dl_sta_lookup_calls_total;
     uint64_t dl_sta_lookup_cycles_per_call;
     uint64_t dl_sta_lookup_cycles_per_mbuf;
+    uint64_t dl_sta_lookup_misses_total;
+    uint64_t dl_sta_lookup_misses_per_call;
+    uint64_t dl_sta_lookup_misses_per_mbuf;
 
     uint64_t dl_sta_lock_cycles_total;
     uint64_t dl_sta_lock_calls_total;
@@ -237,6 +246,9 @@ struct parsed_statistics_cycle {
     uint64_t dl_sta_encrypt_data_get_calls_total;
     uint64_t dl_sta_encrypt_data_get_cycles_per_call;
     uint64_t dl_sta_encrypt_data_get_cycles_per_mbuf;
+    uint64_t dl_sta_encrypt_data_get_misses_total;
+    uint64_t dl_sta_encrypt_data_get_misses_per_call;
+    uint64_t dl_sta_encrypt_data_get_misses_per_mbuf;
 
     uint64_t dl_ether_to_ieee80211_conv_cycles_total;
     uint64_t dl_ether_to_ieee80211_conv_calls_total;
@@ -45,14 +45,12 @@
 #include "statistics_handler_common.h"
 #include "statistics_handler_downlink.h"
 
-/* reference to original mem locations of Downlink stats */
-static struct stats_downlink_drops *original_downlink_drops_sts = NULL;
-static struct stats_pmd_reads *original_downlink_pmd_reads_sts = NULL;
-
 /* 
  * mem where shadow copy of original data is kept.
  * - memcpy is performed between original and shadow copy regions, as
  *   original stat counters change continuously as application runs
+ * - drops and PMD reads are counted per lcore, so their shadow copy is
+ *   the sum of the lcores' counters instead
  */
 static struct stats_downlink_drops *shadow_downlink_drops_sts = NULL;
 static size_t shadow_downlink_drops_sts_sz = 0;
@@ -86,11 +84,9 @@ init_parsed_mem_downlink(void)
 static void
 init_shadow_mem_downlink(void)
 {
-    /* grab pointers to mem locations of original stats */
-    original_downlink_drops_sts = stats_capture_downlink_drops_get_mem_info();
+    /* grab sizes of original stats */
     shadow_downlink_drops_sts_sz = stats_capture_downlink_drops_get_mem_info_size();
 
-    original_downlink_pmd_reads_sts = stats_capture_downlink_pmd_reads_get_mem_info();
     shadow_downlink_pmd_reads_sts_sz = stats_capture_common_pmd_reads_get_mem_info_size();
 
     /*
@@ -194,13 +190,9 @@ sts_hdlr_downlink_free(void)
 void
 sts_hdlr_downlink_update_shadow_stats(void)
 {
-    /* simple struct copy - no underlying pointers, just plain data */
-    rte_memcpy(shadow_downlink_drops_sts,
-               original_downlink_drops_sts,
-               shadow_downlink_drops_sts_sz);
-    rte_memcpy(shadow_downlink_pmd_reads_sts,
-               original_downlink_pmd_reads_sts,
-               shadow_downlink_pmd_reads_sts_sz);
+    /* sums of the per lcore counters */
+    stats_capture_downlink_drops_get(shadow_downlink_drops_sts);
+    stats_capture_downlink_pmd_reads_get(shadow_downlink_pmd_reads_sts);
 }
 
 void
@@ -244,8 +236,7 @@ sts_hdlr_downlink_update_parsed_stats(void)
 void
 sts_hdlr_downlink_clear_stats(void)
 {
-    memset(original_downlink_drops_sts, 0, shadow_downlink_drops_sts_sz);
-    memset(original_downlink_pmd_reads_sts, 0, shadow_downlink_pmd_reads_sts_sz);
+    stats_capture_downlink_clear();
 }
 
 void
@@ -79,6 +79,7 @@ static void
 print_stats_sta_lookup(void)
 {
     unsigned i, j;
+    uint64_t total;
 
     printf("+---------------------------------------------------------------------------------------------------------------------------------+\n");
     printf("|   STA LOOKUP   |     MATCHED    |    UNMATCHED   | AVG NO PKTS PER LOOKUP | LAST RX BURST SIZE                                  |\n");
@@ -103,6 +104,24 @@ print_stats_sta_lookup(void)
     }
 
     printf("+---------------------------------------------------------------------------------------------------------------------------------+\n\n");
+
+    printf("+---------------------------------------------------------------------+\n");
+    printf("|   STA CACHE    |      HITS      |     MISSES     |     HIT RATE     |\n");
+    printf("+----------------+----------------+----------------+------------------+\n");
+
+    for (j = 0; j < STATS_STA_LOOKUP_TYPE_U_DELIM; j++) {
+        total = shadow_sta_lookup_sts[j].cache_hits +
+                shadow_sta_lookup_sts[j].cache_misses;
+
+        printf("|%15s |%15lu |%15lu |%16.2f%% |\n",
+               stats_capture_sta_lookup_get_type_str(j),
+               shadow_sta_lookup_sts[j].cache_hits,
+               shadow_sta_lookup_sts[j].cache_misses,
+               total == 0 ? 0.0 :
+                   (double)shadow_sta_lookup_sts[j].cache_hits * 100 / total);
+    }
+
+    printf("+---------------------------------------------------------------------+\n\n");
 }
 
 void
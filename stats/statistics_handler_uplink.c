@@ -45,14 +45,12 @@
 #include "statistics_capture_uplink.h"
 #include "statistics_handler_uplink.h"
 
-/* reference to original mem locations of Uplink stats */
-static struct stats_uplink_drops *original_uplink_drops_sts = NULL;
-static struct stats_pmd_reads *original_uplink_pmd_reads_sts = NULL;
-
 /* 
  * mem where shadow copy of original data is kept.
  * - memcpy is performed between original and shadow copy regions, as
  *   original stat counters change continuously as application runs
+ * - drops and PMD reads are counted per lcore, so their shadow copy is
+ *   the sum of the lcores' counters instead
  */
 static struct stats_uplink_drops *shadow_uplink_drops_sts = NULL;
 static size_t shadow_uplink_drops_sts_sz = 0;
@@ -86,11 +84,9 @@ init_parsed_mem_uplink(void)
 static void
 init_shadow_mem_uplink(void)
 {
-    /* grab pointers to mem locations of original stats */
-    original_uplink_drops_sts = stats_capture_uplink_drops_get_mem_info();
+    /* grab sizes of original stats */
     shadow_uplink_drops_sts_sz = stats_capture_uplink_drops_get_mem_info_size();
 
-    original_uplink_pmd_reads_sts = stats_capture_uplink_pmd_reads_get_mem_info();
     shadow_uplink_pmd_reads_sts_sz = stats_capture_common_pmd_reads_get_mem_info_size();
 
     /*
@@ -197,13 +193,9 @@ sts_hdlr_uplink_free(void)
 void
 sts_hdlr_uplink_update_shadow_stats(void)
 {
-    /* simple struct copy - no underlying pointers, just plain data */
-    rte_memcpy(shadow_uplink_drops_sts,
-               original_uplink_drops_sts,
-               shadow_uplink_drops_sts_sz);
-    rte_memcpy(shadow_uplink_pmd_reads_sts,
-               original_uplink_pmd_reads_sts,
-               shadow_uplink_pmd_reads_sts_sz);
+    /* sums of the per lcore counters */
+    stats_capture_uplink_drops_get(shadow_uplink_drops_sts);
+    stats_capture_uplink_pmd_reads_get(shadow_uplink_pmd_reads_sts);
 }
 
 void
@@ -249,8 +241,7 @@ sts_hdlr_uplink_update_parsed_stats(void)
 void
 sts_hdlr_uplink_clear_stats(void)
 {
-    memset(original_uplink_drops_sts, 0, shadow_uplink_drops_sts_sz);
-    memset(original_uplink_pmd_reads_sts, 0, shadow_uplink_pmd_reads_sts_sz);
+    stats_capture_uplink_clear();
 }
 
 void
@@ -33,12 +33,19 @@
  *  version: RWPA_VNF.L.18.02.0-42
  */
 
+#include <errno.h>
+#include <inttypes.h>
+
 #include <rte_common.h>
 #include <rte_ip.h>
 #include <rte_tcp.h>
 #include <rte_udp.h>
 #include <rte_hash.h>
-#include <rte_rwlock.h>
+#include <rte_malloc.h>
+#include <rte_spinlock.h>
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
 
 #ifdef RTE_MACHINE_CPUFLAG_SSE4_2
 #include <rte_hash_crc.h>
@@ -61,34 +68,213 @@ static struct app_addr_params *addr_params;
 static struct rte_hash *vap_store = NULL;
 static struct rte_hash *sta_store = NULL;
 
-static struct vap_elem vaps[NUM_VAP_MAX];
-static struct sta_elem stas[NUM_STA_MAX];
+/*
+ * the entries are allocated at startup, for the configured capacities,
+ * and initialised on their first add
+ * - a bit set in the inited bitmaps for each entry initialised
+ * - the SAs' cold parts (raw keys and xforms) are kept in arrays of
+ *   their own, so that the entries the data path reads stay small,
+ *   two per vAP (GTK1 and GTK2) and two per station (PTK KeyIDs)
+ */
+static struct vap_elem *vaps = NULL;
+static struct sta_elem *stas = NULL;
+static struct ccmp_sa_cold *vap_colds = NULL;
+static struct ccmp_sa_cold *sta_colds = NULL;
+static uint64_t *vaps_inited = NULL;
+static uint64_t *stas_inited = NULL;
+static uint32_t vaps_max = 0;
+static uint32_t stas_max = 0;
+
+/* in TSC cycles, see sta_ptk_tx_set() */
+static uint64_t ptk_rx_overlap = 0;
+
+/*
+ * vAP membership
+ * - the stations of each vAP are on a list, linked by store index in
+ *   an array of their own, so that a vAP's stations are found without
+ *   scanning the store, and the entries the data path reads stay small
+ * - a station keeps its address in its link, for the delete of its
+ *   vAP to remove it from the hash
+ * - the lists are only changed under the station store lock
+ */
+#define STORE_INDEX_NONE        (-1)
+
+struct store_sta_link {
+    struct ether_addr addr;
+    int32_t vap;
+    int32_t prev;
+    int32_t next;
+
+    /* aging wheel slot, see below, expiry is 0 while off the wheel */
+    uint32_t expiry;
+    int32_t age_prev;
+    int32_t age_next;
+};
+
+struct store_vap_stas {
+    int32_t head;
+    uint32_t num_stas;
+};
+
+static struct store_sta_link *sta_links = NULL;
+static struct store_vap_stas *vap_stas = NULL;
+
+/*
+ * station aging
+ * - a hashed timing wheel of one tick (second) slots, each station
+ *   being in the slot of the tick it expires at if it is not seen
+ *   again
+ * - the data path only stamps the stations with the tick they are
+ *   seen at, and a station seen since it was scheduled is moved to the
+ *   slot of its new expiry when its slot comes up, so most stations
+ *   are visited once per timeout
+ * - the wheel is only changed under the station store lock
+ */
+#define STORE_AGING_WHEEL_SIZE  256
+#define STORE_AGING_WHEEL_MASK  (STORE_AGING_WHEEL_SIZE - 1)
+
+static int32_t aging_wheel[STORE_AGING_WHEEL_SIZE];
+static uint32_t sta_idle_timeout = 0;   /* in ticks, 0 if aging is off */
+static uint32_t aged_tick = 0;          /* last tick whose slot is done */
+static uint64_t tick_tsc = 0;
+static uint64_t next_tick_tsc = 0;
+
+volatile uint32_t store_tick = 0;
+
+#define STORE_INITED_WORDS(n)   (((n) + 63) / 64)
+#define STORE_INITED_TEST_AND_SET(b, i)                                        \
+({                                                                             \
+    uint64_t mask = 1ULL << ((i) & 63);                                        \
+    int inited = ((b)[(i) >> 6] & mask) != 0;                                  \
+    (b)[(i) >> 6] |= mask;                                                     \
+    inited;                                                                    \
+})
+
+struct store_reader store_readers[RTE_MAX_LCORE];
+struct store_shared_reader store_shared_reader;
+volatile uint32_t store_reader_idx = 0;
+
+/*
+ * each store's sequence number is bumped around each change to its
+ * hash, so it is even, and changes, whenever the hash has changed,
+ * which makes it the generation number of the station cache too
+ */
+static volatile uint32_t vap_store_seq = 0;
+static volatile uint32_t sta_store_seq = 0;
+
+/*
+ * station cache
+ * - a small direct mapped cache of the lookups made by each lcore, as
+ *   most packets are for a few stations
+ * - the not found results are cached too, so that floods of packets
+ *   for unknown stations are cheap
+ * - an entry is valid while its generation is the store's sequence
+ *   number, i.e. the whole cache is invalidated on any add or delete,
+ *   and each entry starts with an odd generation, which is never valid
+ */
+#define STORE_STA_CACHE_BITS    8
+#define STORE_STA_CACHE_SIZE    (1 << STORE_STA_CACHE_BITS)
+#define STORE_STA_CACHE_GEN_NONE 1
+
+struct store_sta_cache_entry {
+    struct ether_addr addr;
+    int32_t index;
+    uint32_t gen;
+};
+
+struct store_sta_cache {
+    struct store_sta_cache_entry entries[STORE_STA_CACHE_SIZE];
+} __rte_cache_aligned;
+
+static struct store_sta_cache *sta_caches = NULL;
+
+static inline uint32_t
+store_sta_cache_slot(const struct ether_addr *addr)
+{
+    const uint8_t *b = addr->addr_bytes;
+    uint32_t h = ((uint32_t)b[2] << 24) | ((uint32_t)b[3] << 16) |
+                 ((uint32_t)b[4] << 8) | (uint32_t)b[5];
+
+    /* the NIC specific bytes, mixed by a multiplicative hash */
+    return (h * 2654435761u) >> (32 - STORE_STA_CACHE_BITS);
+}
 
 #ifndef RWPA_STORE_NO_LOCKS
-static rte_rwlock_t vap_store_lock = RTE_RWLOCK_INITIALIZER;
-static rte_rwlock_t sta_store_lock = RTE_RWLOCK_INITIALIZER;
+/*
+ * writers are serialized by each store's lock, and bump its sequence
+ * number around each change to its hash (odd while changing), so that
+ * the lock free lookups which raced with a change are retried
+ */
+static rte_spinlock_t vap_store_lock = RTE_SPINLOCK_INITIALIZER;
+static rte_spinlock_t sta_store_lock = RTE_SPINLOCK_INITIALIZER;
+
+/* serializes the writers waiting for the readers */
+static rte_spinlock_t sync_lock = RTE_SPINLOCK_INITIALIZER;
+
+static inline uint32_t
+store_hash_read_begin(volatile uint32_t *seq)
+{
+    uint32_t s;
+
+    while (unlikely((s = *seq) & 1))
+        rte_pause();
+    rte_smp_rmb();
 
-#define STORE_READ_LOCK(lock)    rte_rwlock_read_lock(&(lock))
-#define STORE_READ_UNLOCK(lock)  rte_rwlock_read_unlock(&(lock))
-#define STORE_WRITE_LOCK(lock)   rte_rwlock_write_lock(&(lock))
-#define STORE_WRITE_UNLOCK(lock) rte_rwlock_write_unlock(&(lock))
+    return s;
+}
+
+static inline int
+store_hash_read_retry(volatile uint32_t *seq, uint32_t s)
+{
+    rte_smp_rmb();
+
+    return unlikely(*seq != s);
+}
+
+#define STORE_WRITE_LOCK(lock)          rte_spinlock_lock(&(lock))
+#define STORE_WRITE_UNLOCK(lock)        rte_spinlock_unlock(&(lock))
+#define STORE_HASH_WRITE_BEGIN(seq)                                            \
+do {                                                                           \
+    (seq)++;                                                                   \
+    rte_smp_wmb();                                                             \
+} while (0)
+#define STORE_HASH_WRITE_END(seq)                                              \
+do {                                                                           \
+    rte_smp_wmb();                                                             \
+    (seq)++;                                                                   \
+} while (0)
+#define STORE_HASH_READ_BEGIN(seq)      store_hash_read_begin(&(seq))
+#define STORE_HASH_READ_RETRY(seq, s)   store_hash_read_retry(&(seq), s)
 #else
-#define STORE_READ_LOCK(lock)
-#define STORE_READ_UNLOCK(lock)
 #define STORE_WRITE_LOCK(lock)
 #define STORE_WRITE_UNLOCK(lock)
+#define STORE_HASH_WRITE_BEGIN(seq)     (seq)++
+#define STORE_HASH_WRITE_END(seq)       (seq)++
+#define STORE_HASH_READ_BEGIN(seq)      (seq)
+#define STORE_HASH_READ_RETRY(seq, s)   ((void)(s), 0)
 #endif
 
 void
-store_init(int socket_id, struct app_addr_params *app_addr_params)
+store_init(int socket_id, struct app_store_params *app_store_params,
+           struct app_addr_params *app_addr_params)
 {
     char name[RTE_HASH_NAMESIZE];
-    int i;
+    uint64_t start_tsc = rte_rdtsc();
+    size_t sz;
+    uint32_t i, j;
+
+    vaps_max = app_store_params->vaps_max;
+    stas_max = app_store_params->stas_max;
+    ptk_rx_overlap = ((uint64_t)app_store_params->ptk_rx_overlap_ms *
+                      rte_get_tsc_hz()) / 1000;
+    sta_idle_timeout = app_store_params->sta_idle_timeout_s;
+    tick_tsc = rte_get_tsc_hz();
+    next_tick_tsc = start_tsc + tick_tsc;
 
     snprintf(name, sizeof(name), "vap_store_%d", socket_id);
     struct rte_hash_parameters vap_store_hash_params = {
             .name = name,
-            .entries = NUM_VAP_MAX,
+            .entries = vaps_max,
             .socket_id = socket_id,
             .key_len = sizeof(struct ether_addr)
     };
@@ -100,7 +286,7 @@ store_init(int socket_id, struct app_addr_params *app_addr_params)
     snprintf(name, sizeof(name), "sta_store_%d", socket_id);
     struct rte_hash_parameters sta_store_hash_params = {
             .name = name,
-            .entries = NUM_STA_MAX,
+            .entries = stas_max,
             .socket_id = socket_id,
             .key_len = sizeof(struct ether_addr)
     };
@@ -109,16 +295,84 @@ store_init(int socket_id, struct app_addr_params *app_addr_params)
     if (sta_store == NULL)
         rte_exit(EXIT_FAILURE, "Error creating Station store, exiting\n");
 
-    memset(&vaps, 0x0, sizeof(vaps));
-    memset(&stas, 0x0, sizeof(stas));
+    /*
+     * the entries come zeroed from the hugepages, which is how a
+     * reader finds an entry that is added but not yet initialised
+     * (i.e. no key and no parent vAP)
+     */
+    sz = ((size_t)vaps_max * sizeof(struct vap_elem)) +
+         ((size_t)stas_max * sizeof(struct sta_elem)) +
+         ((size_t)vaps_max * 2 * sizeof(struct ccmp_sa_cold)) +
+         ((size_t)stas_max * PTK_KEY_ID_NUM * sizeof(struct ccmp_sa_cold)) +
+         ((size_t)vaps_max * sizeof(struct store_vap_stas)) +
+         ((size_t)stas_max * sizeof(struct store_sta_link));
 
-    for (i = 0; i < NUM_VAP_MAX; i++)
-       vap_init(&vaps[i]);
+    vaps = rte_zmalloc_socket("vap_store_elems",
+                              (size_t)vaps_max * sizeof(struct vap_elem),
+                              RTE_CACHE_LINE_SIZE, socket_id);
+    stas = rte_zmalloc_socket("sta_store_elems",
+                              (size_t)stas_max * sizeof(struct sta_elem),
+                              RTE_CACHE_LINE_SIZE, socket_id);
+    vap_colds = rte_zmalloc_socket("vap_store_colds",
+                                   (size_t)vaps_max * 2 *
+                                   sizeof(struct ccmp_sa_cold),
+                                   RTE_CACHE_LINE_SIZE, socket_id);
+    sta_colds = rte_zmalloc_socket("sta_store_colds",
+                                   (size_t)stas_max * PTK_KEY_ID_NUM *
+                                   sizeof(struct ccmp_sa_cold),
+                                   RTE_CACHE_LINE_SIZE, socket_id);
+    vaps_inited = rte_zmalloc_socket("vap_store_inited",
+                                     STORE_INITED_WORDS(vaps_max) *
+                                     sizeof(uint64_t), 0, socket_id);
+    stas_inited = rte_zmalloc_socket("sta_store_inited",
+                                     STORE_INITED_WORDS(stas_max) *
+                                     sizeof(uint64_t), 0, socket_id);
+    sta_caches = rte_zmalloc_socket("sta_store_caches",
+                                    RTE_MAX_LCORE *
+                                    sizeof(struct store_sta_cache),
+                                    RTE_CACHE_LINE_SIZE, socket_id);
+    vap_stas = rte_malloc_socket("vap_store_stas",
+                                 (size_t)vaps_max *
+                                 sizeof(struct store_vap_stas),
+                                 RTE_CACHE_LINE_SIZE, socket_id);
+    sta_links = rte_malloc_socket("sta_store_links",
+                                  (size_t)stas_max *
+                                  sizeof(struct store_sta_link),
+                                  RTE_CACHE_LINE_SIZE, socket_id);
+    if (vaps == NULL || stas == NULL || sta_caches == NULL ||
+        vap_colds == NULL || sta_colds == NULL ||
+        vaps_inited == NULL || stas_inited == NULL ||
+        vap_stas == NULL || sta_links == NULL)
+        rte_exit(EXIT_FAILURE, "Error allocating %zu MB for the store on "
+                 "socket %d, exiting\n", sz >> 20, socket_id);
 
-    for (i = 0; i < NUM_STA_MAX; i++)
-       sta_init(&stas[i]);
+    for (i = 0; i < RTE_MAX_LCORE; i++)
+        for (j = 0; j < STORE_STA_CACHE_SIZE; j++)
+            sta_caches[i].entries[j].gen = STORE_STA_CACHE_GEN_NONE;
+
+    for (i = 0; i < vaps_max; i++) {
+        vap_stas[i].head = STORE_INDEX_NONE;
+        vap_stas[i].num_stas = 0;
+    }
+
+    for (i = 0; i < stas_max; i++) {
+        sta_links[i].vap = STORE_INDEX_NONE;
+        sta_links[i].prev = STORE_INDEX_NONE;
+        sta_links[i].next = STORE_INDEX_NONE;
+        sta_links[i].expiry = 0;
+        sta_links[i].age_prev = STORE_INDEX_NONE;
+        sta_links[i].age_next = STORE_INDEX_NONE;
+    }
+
+    for (i = 0; i < STORE_AGING_WHEEL_SIZE; i++)
+        aging_wheel[i] = STORE_INDEX_NONE;
 
     addr_params = app_addr_params;
+
+    RTE_LOG(INFO, RWPA_STORE,
+            "Store of %u vAPs and %u stations, %zu MB on socket %d, "
+            "created in %"PRIu64" ms\n", vaps_max, stas_max, sz >> 20,
+            socket_id, ((rte_rdtsc() - start_tsc) * 1000) / rte_get_tsc_hz());
 }
 
 void
@@ -126,6 +380,263 @@ store_cleanup(void)
 {
     rte_hash_free(vap_store);
     rte_hash_free(sta_store);
+    rte_free(vaps);
+    rte_free(stas);
+    rte_free(vap_colds);
+    rte_free(sta_colds);
+    rte_free(sta_caches);
+    rte_free(vaps_inited);
+    rte_free(stas_inited);
+    rte_free(vap_stas);
+    rte_free(sta_links);
+}
+
+uint32_t
+store_vap_max(void)
+{
+    return vaps_max;
+}
+
+uint32_t
+store_sta_max(void)
+{
+    return stas_max;
+}
+
+uint64_t
+store_ptk_rx_overlap_get(void)
+{
+    return ptk_rx_overlap;
+}
+
+void
+store_parallel_fill(int (*fill)(void *), void *arg)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    unsigned lcore_id;
+
+    rte_eal_mp_remote_launch(fill, arg, CALL_MASTER);
+    RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+        rte_eal_wait_lcore(lcore_id);
+    }
+#else
+    /* without its locks, only one lcore can add to the store */
+    fill(arg);
+#endif
+}
+
+void
+store_synchronize(void)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    unsigned lcore_id;
+    uint8_t idx;
+
+    rte_spinlock_lock(&sync_lock);
+
+    /*
+     * flip the index, so that new references are taken on the other
+     * one, and wait for the references on the old one to be dropped
+     * - a reader which took its reference on the old index after the
+     *   flip sees the flip and retries, see store_read_lock()
+     */
+    rte_smp_mb();
+    idx = store_reader_idx & 1;
+    store_reader_idx++;
+    rte_smp_mb();
+
+    /*
+     * the wait is not cut short on force_quit, as the callers free
+     * the keys and sessions of the entries the readers may still use
+     */
+    RTE_LCORE_FOREACH(lcore_id) {
+        while (store_readers[lcore_id].refs[idx] != 0)
+            rte_pause();
+    }
+
+    while (rte_atomic32_read(&(store_shared_reader.refs[idx])) != 0)
+        rte_pause();
+
+    rte_smp_mb();
+    rte_spinlock_unlock(&sync_lock);
+#endif
+}
+
+/*
+ * remove a station from its vAP's list, if it is on one
+ * - the station store lock must be held
+ */
+static void
+store_vap_sta_unlink(int32_t sta)
+{
+    struct store_sta_link *link = &(sta_links[sta]);
+    struct store_vap_stas *members;
+
+    if (link->vap == STORE_INDEX_NONE)
+        return;
+
+    members = &(vap_stas[link->vap]);
+
+    if (link->prev != STORE_INDEX_NONE)
+        sta_links[link->prev].next = link->next;
+    else
+        members->head = link->next;
+
+    if (link->next != STORE_INDEX_NONE)
+        sta_links[link->next].prev = link->prev;
+
+    members->num_stas--;
+
+    link->vap = STORE_INDEX_NONE;
+    link->prev = STORE_INDEX_NONE;
+    link->next = STORE_INDEX_NONE;
+}
+
+/*
+ * put a station on its vAP's list, moving it from the list of its
+ * previous vAP if it is re-added to another one
+ * - the station store lock must be held
+ */
+static void
+store_vap_sta_link(int32_t sta, int32_t vap, const struct ether_addr *addr)
+{
+    struct store_sta_link *link = &(sta_links[sta]);
+    struct store_vap_stas *members = &(vap_stas[vap]);
+
+    if (link->vap == vap)
+        return;
+
+    store_vap_sta_unlink(sta);
+
+    ether_addr_copy(addr, &(link->addr));
+    link->vap = vap;
+    link->prev = STORE_INDEX_NONE;
+    link->next = members->head;
+
+    if (members->head != STORE_INDEX_NONE)
+        sta_links[members->head].prev = sta;
+
+    members->head = sta;
+    members->num_stas++;
+}
+
+/*
+ * take a station off the aging wheel, if it is on it
+ * - the station store lock must be held
+ */
+static void
+store_aging_unlink(int32_t sta)
+{
+    struct store_sta_link *link = &(sta_links[sta]);
+
+    if (link->expiry == 0)
+        return;
+
+    if (link->age_prev != STORE_INDEX_NONE)
+        sta_links[link->age_prev].age_next = link->age_next;
+    else
+        aging_wheel[link->expiry & STORE_AGING_WHEEL_MASK] = link->age_next;
+
+    if (link->age_next != STORE_INDEX_NONE)
+        sta_links[link->age_next].age_prev = link->age_prev;
+
+    link->expiry = 0;
+    link->age_prev = STORE_INDEX_NONE;
+    link->age_next = STORE_INDEX_NONE;
+}
+
+/*
+ * put a station on the aging wheel, in the slot of its expiry tick
+ * - the station store lock must be held
+ */
+static void
+store_aging_schedule(int32_t sta, uint32_t expiry)
+{
+    struct store_sta_link *link = &(sta_links[sta]);
+    int32_t *slot;
+
+    store_aging_unlink(sta);
+
+    /* 0 means off the wheel, which a wrapped clock could give */
+    if (unlikely(expiry == 0))
+        expiry = 1;
+
+    slot = &(aging_wheel[expiry & STORE_AGING_WHEEL_MASK]);
+
+    link->expiry = expiry;
+    link->age_prev = STORE_INDEX_NONE;
+    link->age_next = *slot;
+
+    if (*slot != STORE_INDEX_NONE)
+        sta_links[*slot].age_prev = sta;
+
+    *slot = sta;
+}
+
+/*
+ * start aging a station just added, as if it had just been seen
+ * - the station store lock must be held
+ */
+static inline void
+store_aging_start(int32_t sta)
+{
+    uint32_t now = store_tick;
+
+    if (sta_idle_timeout == 0)
+        return;
+
+    stas[sta].last_seen = now;
+    store_aging_schedule(sta, now + sta_idle_timeout);
+}
+
+/*
+ * delete the stations of a vAP from the station hash
+ * - the stations stay on the vAP's list, to be reset once the readers
+ *   which may have found them are waited for
+ * - the station store lock must be held
+ */
+static uint32_t
+store_vap_stas_del(int32_t vap)
+{
+    int32_t sta;
+    uint32_t nb_stas = 0;
+
+    STORE_HASH_WRITE_BEGIN(sta_store_seq);
+    for (sta = vap_stas[vap].head; sta != STORE_INDEX_NONE;
+         sta = sta_links[sta].next) {
+        rte_hash_del_key(sta_store, &(sta_links[sta].addr));
+        nb_stas++;
+    }
+    STORE_HASH_WRITE_END(sta_store_seq);
+
+    return nb_stas;
+}
+
+/*
+ * reset the stations deleted by store_vap_stas_del(), which frees
+ * their keys and sessions, and empty the vAP's list
+ * - the station store lock must be held
+ */
+static void
+store_vap_stas_reset(int32_t vap)
+{
+    struct store_sta_link *link;
+    int32_t sta, next;
+
+    for (sta = vap_stas[vap].head; sta != STORE_INDEX_NONE; sta = next) {
+        link = &(sta_links[sta]);
+        next = link->next;
+
+        sta_reset(&(stas[sta]));
+        store_aging_unlink(sta);
+
+        link->vap = STORE_INDEX_NONE;
+        link->prev = STORE_INDEX_NONE;
+        link->next = STORE_INDEX_NONE;
+    }
+
+    vap_stas[vap].head = STORE_INDEX_NONE;
+    vap_stas[vap].num_stas = 0;
 }
 
 struct vap_elem *
@@ -140,11 +651,17 @@ store_vap_add(struct ether_addr *vap_addr)
     }
 
     STORE_WRITE_LOCK(vap_store_lock);
-    if ((index = rte_hash_add_key(vap_store, vap_addr)) < 0) {
+    STORE_HASH_WRITE_BEGIN(vap_store_seq);
+    index = rte_hash_add_key(vap_store, vap_addr);
+    STORE_HASH_WRITE_END(vap_store_seq);
+    if (index < 0) {
         STORE_WRITE_UNLOCK(vap_store_lock);
         RTE_LOG(ERR, RWPA_STORE, "Error adding entry to vAP store\n");
         return NULL;
     }
+    if (!STORE_INITED_TEST_AND_SET(vaps_inited, index))
+        vap_init(&(vaps[index]), &(vap_colds[index * 2]),
+                 &(vap_colds[index * 2 + 1]));
     STORE_WRITE_UNLOCK(vap_store_lock);
 
     vap_address_set(&(vaps[index]), vap_addr,
@@ -155,14 +672,65 @@ store_vap_add(struct ether_addr *vap_addr)
     return &(vaps[index]);
 }
 
+uint32_t
+store_vap_bulk_add(struct ether_addr **vap_addr, uint32_t num_keys,
+                   struct vap_elem **vap)
+{
+    uint32_t sig[STORE_BULK_ADD_MAX];
+    int32_t index[STORE_BULK_ADD_MAX];
+    uint32_t i, nb_added = 0;
+
+    /* check params */
+    if (vap_addr == NULL || vap == NULL || num_keys > STORE_BULK_ADD_MAX) {
+        RTE_LOG(ERR, RWPA_STORE, "Invalid parameters to %s\n", __FUNCTION__);
+        return 0;
+    }
+
+    /* hash the keys before taking the lock */
+    for (i = 0; i < num_keys; i++)
+        sig[i] = rte_hash_hash(vap_store, vap_addr[i]);
+
+    STORE_WRITE_LOCK(vap_store_lock);
+    STORE_HASH_WRITE_BEGIN(vap_store_seq);
+    for (i = 0; i < num_keys; i++)
+        index[i] = rte_hash_add_key_with_hash(vap_store, vap_addr[i], sig[i]);
+    STORE_HASH_WRITE_END(vap_store_seq);
+    for (i = 0; i < num_keys; i++) {
+        if (index[i] >= 0 &&
+            !STORE_INITED_TEST_AND_SET(vaps_inited, index[i]))
+            vap_init(&(vaps[index[i]]), &(vap_colds[index[i] * 2]),
+                     &(vap_colds[index[i] * 2 + 1]));
+    }
+    STORE_WRITE_UNLOCK(vap_store_lock);
+
+    for (i = 0; i < num_keys; i++) {
+        if (index[i] < 0) {
+            vap[i] = NULL;
+            continue;
+        }
+
+        vap_address_set(&(vaps[index[i]]), vap_addr[i],
+                        &(addr_params->vap_tun_def_mac),
+                        addr_params->vap_tun_def_ip,
+                        addr_params->vap_tun_def_port);
+
+        vap[i] = &(vaps[index[i]]);
+        nb_added++;
+    }
+
+    return nb_added;
+}
+
 struct vap_elem *
 store_vap_lookup(struct ether_addr *vap_addr)
 {
+    uint32_t seq;
     int32_t index;
 
-    STORE_READ_LOCK(vap_store_lock);
-    index = rte_hash_lookup(vap_store, vap_addr);
-    STORE_READ_UNLOCK(vap_store_lock);
+    do {
+        seq = STORE_HASH_READ_BEGIN(vap_store_seq);
+        index = rte_hash_lookup(vap_store, vap_addr);
+    } while (STORE_HASH_READ_RETRY(vap_store_seq, seq));
 
     if (likely(index >= 0))
         return &(vaps[index]);
@@ -173,7 +741,7 @@ store_vap_lookup(struct ether_addr *vap_addr)
 struct vap_elem *
 store_vap_get(int32_t index)
 {
-    if (likely(index < NUM_VAP_MAX))
+    if (likely(index >= 0 && (uint32_t)index < vaps_max))
         return &(vaps[index]);
 
     return NULL;
@@ -182,26 +750,71 @@ store_vap_get(int32_t index)
 void
 store_vap_bulk_lookup(struct ether_addr **vap_addr, uint32_t num_keys, int32_t *found)
 {
-    STORE_READ_LOCK(vap_store_lock);
-    rte_hash_lookup_bulk(vap_store, (const void **)vap_addr, num_keys, found);
-    STORE_READ_UNLOCK(vap_store_lock);
+    uint32_t seq;
+
+    do {
+        seq = STORE_HASH_READ_BEGIN(vap_store_seq);
+        rte_hash_lookup_bulk(vap_store, (const void **)vap_addr, num_keys, found);
+    } while (STORE_HASH_READ_RETRY(vap_store_seq, seq));
 }
 
 enum rwpa_status
 store_vap_del(struct ether_addr *vap_addr)
 {
     int32_t index;
+    uint32_t nb_stas = 0;
 
     STORE_WRITE_LOCK(vap_store_lock);
+    STORE_HASH_WRITE_BEGIN(vap_store_seq);
     index = rte_hash_del_key(vap_store, vap_addr);
-    STORE_WRITE_UNLOCK(vap_store_lock);
+    STORE_HASH_WRITE_END(vap_store_seq);
 
+    /*
+     * delete the vAP's stations with it, and wait once for the readers
+     * which may have found the vAP or its stations before they are
+     * reset, which is done under the locks so their slots are not
+     * reused until then
+     */
     if (likely(index >= 0)) {
+       STORE_WRITE_LOCK(sta_store_lock);
+       nb_stas = store_vap_stas_del(index);
+       store_synchronize();
+       store_vap_stas_reset(index);
+       STORE_WRITE_UNLOCK(sta_store_lock);
        vap_reset(&(vaps[index]));
-       return RWPA_STS_OK;
     }
+    STORE_WRITE_UNLOCK(vap_store_lock);
+
+    if (nb_stas > 0)
+        RTE_LOG(DEBUG, RWPA_STORE, "Deleted %u stations with their vAP\n",
+                nb_stas);
+
+    return index >= 0 ? RWPA_STS_OK : RWPA_STS_ERR;
+}
+
+int32_t
+store_vap_iterate(struct ether_addr *vap_addr, struct vap_elem **vap,
+                  uint32_t *next)
+{
+    const void *key;
+    void *data;
+    int32_t index;
+
+    /* check params */
+    if (vap_addr == NULL || vap == NULL || next == NULL)
+        return -EINVAL;
 
-    return RWPA_STS_ERR;
+    /* iterate under the lock, as the key is copied from the hash */
+    STORE_WRITE_LOCK(vap_store_lock);
+    index = rte_hash_iterate(vap_store, &key, &data, next);
+    if (index >= 0)
+        ether_addr_copy((const struct ether_addr *)key, vap_addr);
+    STORE_WRITE_UNLOCK(vap_store_lock);
+
+    if (likely(index >= 0))
+        *vap = &(vaps[index]);
+
+    return index;
 }
 
 struct sta_elem *
@@ -221,15 +834,23 @@ store_sta_add(struct ether_addr *sta_addr, struct ether_addr *vap_addr)
     if (likely(vap != NULL)) {
         /* add the station to the store */
         STORE_WRITE_LOCK(sta_store_lock);
-        if ((index = rte_hash_add_key(sta_store, sta_addr)) < 0) {
+        STORE_HASH_WRITE_BEGIN(sta_store_seq);
+        index = rte_hash_add_key(sta_store, sta_addr);
+        STORE_HASH_WRITE_END(sta_store_seq);
+        if (index < 0) {
             STORE_WRITE_UNLOCK(sta_store_lock);
             RTE_LOG(ERR, RWPA_STORE, "Error adding entry to Station store\n");
             return NULL;
         }
-        STORE_WRITE_UNLOCK(sta_store_lock);
+        if (!STORE_INITED_TEST_AND_SET(stas_inited, index))
+            sta_init(&(stas[index]),
+                     &(sta_colds[index * PTK_KEY_ID_NUM]));
 
         /* assign parent vap */
         stas[index].parent_vap = vap;
+        store_vap_sta_link(index, (int32_t)(vap - vaps), sta_addr);
+        store_aging_start(index);
+        STORE_WRITE_UNLOCK(sta_store_lock);
     } else {
         RTE_LOG(ERR, RWPA_STORE, "vAP not found when adding station to store\n");
         return NULL;
@@ -238,14 +859,81 @@ store_sta_add(struct ether_addr *sta_addr, struct ether_addr *vap_addr)
     return &(stas[index]);
 }
 
+uint32_t
+store_sta_bulk_add(struct ether_addr **sta_addr, struct ether_addr **vap_addr,
+                   uint32_t num_keys, struct sta_elem **sta)
+{
+    uint32_t vap_sig[STORE_BULK_ADD_MAX], sta_sig[STORE_BULK_ADD_MAX];
+    int32_t vap_index[STORE_BULK_ADD_MAX], sta_index[STORE_BULK_ADD_MAX];
+    uint32_t i, seq, nb_added = 0;
+
+    /* check params */
+    if (sta_addr == NULL || vap_addr == NULL || sta == NULL ||
+        num_keys > STORE_BULK_ADD_MAX) {
+        RTE_LOG(ERR, RWPA_STORE, "Invalid parameters to %s\n", __FUNCTION__);
+        return 0;
+    }
+
+    /* hash the keys before taking the locks */
+    for (i = 0; i < num_keys; i++) {
+        vap_sig[i] = rte_hash_hash(vap_store, vap_addr[i]);
+        sta_sig[i] = rte_hash_hash(sta_store, sta_addr[i]);
+    }
+
+    /* lookup parent vaps */
+    do {
+        seq = STORE_HASH_READ_BEGIN(vap_store_seq);
+        for (i = 0; i < num_keys; i++)
+            vap_index[i] = rte_hash_lookup_with_hash(vap_store, vap_addr[i],
+                                                     vap_sig[i]);
+    } while (STORE_HASH_READ_RETRY(vap_store_seq, seq));
+
+    /* add the stations, whose vap was found, to the store */
+    STORE_WRITE_LOCK(sta_store_lock);
+    STORE_HASH_WRITE_BEGIN(sta_store_seq);
+    for (i = 0; i < num_keys; i++)
+        sta_index[i] = vap_index[i] < 0 ? vap_index[i] :
+                       rte_hash_add_key_with_hash(sta_store, sta_addr[i],
+                                                  sta_sig[i]);
+    STORE_HASH_WRITE_END(sta_store_seq);
+    for (i = 0; i < num_keys; i++) {
+        if (sta_index[i] < 0)
+            continue;
+
+        if (!STORE_INITED_TEST_AND_SET(stas_inited, sta_index[i]))
+            sta_init(&(stas[sta_index[i]]),
+                     &(sta_colds[sta_index[i] * PTK_KEY_ID_NUM]));
+
+        /* assign parent vap */
+        stas[sta_index[i]].parent_vap = &(vaps[vap_index[i]]);
+        store_vap_sta_link(sta_index[i], vap_index[i], sta_addr[i]);
+        store_aging_start(sta_index[i]);
+    }
+    STORE_WRITE_UNLOCK(sta_store_lock);
+
+    for (i = 0; i < num_keys; i++) {
+        if (sta_index[i] < 0) {
+            sta[i] = NULL;
+            continue;
+        }
+
+        sta[i] = &(stas[sta_index[i]]);
+        nb_added++;
+    }
+
+    return nb_added;
+}
+
 struct sta_elem *
 store_sta_lookup(struct ether_addr *sta_addr)
 {
+    uint32_t seq;
     int32_t index;
 
-    STORE_READ_LOCK(sta_store_lock);
-    index = rte_hash_lookup(sta_store, sta_addr);
-    STORE_READ_UNLOCK(sta_store_lock);
+    do {
+        seq = STORE_HASH_READ_BEGIN(sta_store_seq);
+        index = rte_hash_lookup(sta_store, sta_addr);
+    } while (STORE_HASH_READ_RETRY(sta_store_seq, seq));
 
     if (likely(index >= 0))
         return &(stas[index]);
@@ -256,18 +944,76 @@ store_sta_lookup(struct ether_addr *sta_addr)
 struct sta_elem *
 store_sta_get(int32_t index)
 {
-    if (likely(index < NUM_STA_MAX))
+    if (likely(index >= 0 && (uint32_t)index < stas_max))
         return &(stas[index]);
 
     return NULL;
 }
 
-void
+uint32_t
 store_sta_bulk_lookup(struct ether_addr **sta_addr, uint32_t num_keys, int32_t *found)
 {
-    STORE_READ_LOCK(sta_store_lock);
-    rte_hash_lookup_bulk(sta_store, (const void **)sta_addr, num_keys, found);
-    STORE_READ_UNLOCK(sta_store_lock);
+    struct ether_addr *miss_addr[RTE_HASH_LOOKUP_BULK_MAX];
+    int32_t miss_found[RTE_HASH_LOOKUP_BULK_MAX];
+    uint32_t miss_pos[RTE_HASH_LOOKUP_BULK_MAX];
+    struct store_sta_cache_entry *e;
+    struct store_sta_cache *cache;
+    unsigned lcore_id = rte_lcore_id();
+    uint32_t i, seq, gen, nb_misses = 0;
+
+    /*
+     * the hash is read without locking it, and the lookup is retried
+     * if a writer changed it meanwhile, which is rare
+     */
+    if (unlikely(lcore_id >= RTE_MAX_LCORE ||
+                 num_keys > RTE_HASH_LOOKUP_BULK_MAX)) {
+        do {
+            seq = STORE_HASH_READ_BEGIN(sta_store_seq);
+            rte_hash_lookup_bulk(sta_store, (const void **)sta_addr,
+                                 num_keys, found);
+        } while (STORE_HASH_READ_RETRY(sta_store_seq, seq));
+
+        return 0;
+    }
+
+    /*
+     * serve what the cache can, which stays valid for the current read
+     * section like a hash lookup does
+     */
+    cache = &(sta_caches[lcore_id]);
+    gen = STORE_HASH_READ_BEGIN(sta_store_seq);
+
+    for (i = 0; i < num_keys; i++) {
+        e = &(cache->entries[store_sta_cache_slot(sta_addr[i])]);
+        if (likely(e->gen == gen &&
+                   is_same_ether_addr(&(e->addr), sta_addr[i]))) {
+            found[i] = e->index;
+        } else {
+            miss_addr[nb_misses] = sta_addr[i];
+            miss_pos[nb_misses++] = i;
+        }
+    }
+
+    if (likely(nb_misses == 0))
+        return num_keys;
+
+    /* look the rest up in the hash, and cache the results */
+    do {
+        seq = STORE_HASH_READ_BEGIN(sta_store_seq);
+        rte_hash_lookup_bulk(sta_store, (const void **)miss_addr,
+                             nb_misses, miss_found);
+    } while (STORE_HASH_READ_RETRY(sta_store_seq, seq));
+
+    for (i = 0; i < nb_misses; i++) {
+        found[miss_pos[i]] = miss_found[i];
+
+        e = &(cache->entries[store_sta_cache_slot(miss_addr[i])]);
+        ether_addr_copy(miss_addr[i], &(e->addr));
+        e->index = miss_found[i];
+        e->gen = seq;
+    }
+
+    return num_keys - nb_misses;
 }
 
 enum rwpa_status
@@ -276,13 +1022,252 @@ store_sta_del(struct ether_addr *sta_addr)
     int32_t index;
 
     STORE_WRITE_LOCK(sta_store_lock);
+    STORE_HASH_WRITE_BEGIN(sta_store_seq);
     index = rte_hash_del_key(sta_store, sta_addr);
-    STORE_WRITE_UNLOCK(sta_store_lock);
+    STORE_HASH_WRITE_END(sta_store_seq);
 
+    /*
+     * wait for the packets in flight with the station before its key
+     * and sessions are freed, which is done under the lock so its slot
+     * is not reused until then
+     */
     if (likely(index >= 0)) {
+       store_vap_sta_unlink(index);
+       store_aging_unlink(index);
+       store_synchronize();
        sta_reset(&(stas[index]));
-       return RWPA_STS_OK;
     }
+    STORE_WRITE_UNLOCK(sta_store_lock);
+
+    return index >= 0 ? RWPA_STS_OK : RWPA_STS_ERR;
+}
+
+int32_t
+store_sta_iterate(struct ether_addr *sta_addr, struct sta_elem **sta,
+                  uint32_t *next)
+{
+    const void *key;
+    void *data;
+    int32_t index;
+
+    /* check params */
+    if (sta_addr == NULL || sta == NULL || next == NULL)
+        return -EINVAL;
+
+    /* iterate under the lock, as the key is copied from the hash */
+    STORE_WRITE_LOCK(sta_store_lock);
+    index = rte_hash_iterate(sta_store, &key, &data, next);
+    if (index >= 0)
+        ether_addr_copy((const struct ether_addr *)key, sta_addr);
+    STORE_WRITE_UNLOCK(sta_store_lock);
+
+    if (likely(index >= 0))
+        *sta = &(stas[index]);
+
+    return index;
+}
+
+uint32_t
+store_sta_age(uint64_t cur_tsc,
+              void (*expired)(const struct ether_addr *sta_addr,
+                              const struct ether_addr *vap_addr,
+                              void *arg),
+              void *arg)
+{
+    struct ether_addr sta_addrs[STORE_AGING_BATCH_MAX];
+    struct ether_addr vap_addrs[STORE_AGING_BATCH_MAX];
+    int32_t idle[STORE_AGING_BATCH_MAX];
+    struct store_sta_link *link;
+    int32_t sta = STORE_INDEX_NONE, next;
+    uint32_t tick, expiry, i, nb_idle = 0;
+
+    /* advance the clock by one tick at most per call */
+    if (unlikely(cur_tsc >= next_tick_tsc)) {
+        next_tick_tsc += tick_tsc;
+        store_tick++;
+    }
+
+    /* nothing to do until the next tick, unless a batch was full */
+    if (likely(aged_tick == store_tick))
+        return 0;
+
+    if (sta_idle_timeout == 0) {
+        aged_tick = store_tick;
+        return 0;
+    }
+
+    STORE_WRITE_LOCK(sta_store_lock);
+
+    /*
+     * go through the slots of the ticks since the last call, leaving
+     * the stations which expire on a later turn of the wheel, and
+     * rescheduling the ones seen since they were scheduled
+     */
+    while (aged_tick != store_tick) {
+        tick = aged_tick + 1;
+
+        for (sta = aging_wheel[tick & STORE_AGING_WHEEL_MASK];
+             sta != STORE_INDEX_NONE && nb_idle < STORE_AGING_BATCH_MAX;
+             sta = next) {
+            link = &(sta_links[sta]);
+            next = link->age_next;
+
+            if (link->expiry != tick)
+                continue;
+
+            expiry = stas[sta].last_seen + sta_idle_timeout;
+            if ((int32_t)(expiry - tick) > 0) {
+                store_aging_schedule(sta, expiry);
+                continue;
+            }
+
+            idle[nb_idle++] = sta;
+        }
+
+        /* the batch is full, finish the slot on the next call */
+        if (sta != STORE_INDEX_NONE)
+            break;
+
+        aged_tick = tick;
+    }
+
+    /*
+     * delete the idle stations, waiting once for the readers which may
+     * have found them before they are reset
+     */
+    if (nb_idle > 0) {
+        STORE_HASH_WRITE_BEGIN(sta_store_seq);
+        for (i = 0; i < nb_idle; i++) {
+            link = &(sta_links[idle[i]]);
+
+            ether_addr_copy(&(link->addr), &(sta_addrs[i]));
+            ether_addr_copy(&(vaps[link->vap].address), &(vap_addrs[i]));
+
+            rte_hash_del_key(sta_store, &(link->addr));
+            store_vap_sta_unlink(idle[i]);
+            store_aging_unlink(idle[i]);
+        }
+        STORE_HASH_WRITE_END(sta_store_seq);
+
+        store_synchronize();
+
+        for (i = 0; i < nb_idle; i++)
+            sta_reset(&(stas[idle[i]]));
+    }
+
+    STORE_WRITE_UNLOCK(sta_store_lock);
+
+    if (expired != NULL)
+        for (i = 0; i < nb_idle; i++)
+            expired(&(sta_addrs[i]), &(vap_addrs[i]), arg);
+
+    return nb_idle;
+}
+
+uint32_t
+store_vap_sta_foreach(struct vap_elem *vap,
+                      void (*fn)(struct sta_elem *sta, void *arg),
+                      void *arg)
+{
+    int32_t index, sta, next;
+    uint32_t nb_stas;
+
+    /* check params */
+    if (vap == NULL || vap < vaps || vap >= &(vaps[vaps_max]))
+        return 0;
+
+    index = (int32_t)(vap - vaps);
+
+    STORE_WRITE_LOCK(sta_store_lock);
+    nb_stas = vap_stas[index].num_stas;
+    if (fn != NULL) {
+        for (sta = vap_stas[index].head; sta != STORE_INDEX_NONE;
+             sta = next) {
+            next = sta_links[sta].next;
+            fn(&(stas[sta]), arg);
+        }
+    }
+    STORE_WRITE_UNLOCK(sta_store_lock);
+
+    return nb_stas;
+}
+
+enum rwpa_status
+store_check(void)
+{
+    const void *key;
+    void *data;
+    struct store_sta_link *link;
+    int32_t sta, prev, index;
+    uint32_t i, n, next = 0, nb_listed = 0, nb_hashed = 0;
+    enum rwpa_status sts = RWPA_STS_OK;
+
+    STORE_WRITE_LOCK(vap_store_lock);
+    STORE_WRITE_LOCK(sta_store_lock);
+
+    /*
+     * each vAP's list is well formed, and holds stations in the hash
+     * whose parent is the vAP, and only a vAP in the hash has any
+     */
+    for (i = 0; i < vaps_max; i++) {
+        if (vap_stas[i].head == STORE_INDEX_NONE &&
+            vap_stas[i].num_stas == 0)
+            continue;
+
+        if (rte_hash_lookup(vap_store, &(vaps[i].address)) != (int32_t)i) {
+            RTE_LOG(ERR, RWPA_STORE, "vAP %u not in the store has %u "
+                    "stations\n", i, vap_stas[i].num_stas);
+            sts = RWPA_STS_ERR;
+        }
+
+        prev = STORE_INDEX_NONE;
+        for (sta = vap_stas[i].head, n = 0;
+             sta != STORE_INDEX_NONE && n <= stas_max;
+             prev = sta, sta = sta_links[sta].next, n++) {
+            link = &(sta_links[sta]);
+            if (link->vap != (int32_t)i || link->prev != prev ||
+                stas[sta].parent_vap != &(vaps[i]) ||
+                rte_hash_lookup(sta_store, &(link->addr)) != sta) {
+                RTE_LOG(ERR, RWPA_STORE, "Station %d on the list of vAP "
+                        "%u is inconsistent\n", sta, i);
+                sts = RWPA_STS_ERR;
+            }
+        }
+
+        if (n != vap_stas[i].num_stas) {
+            RTE_LOG(ERR, RWPA_STORE, "vAP %u has %u stations listed, for a "
+                    "count of %u\n", i, n, vap_stas[i].num_stas);
+            sts = RWPA_STS_ERR;
+        }
+
+        nb_listed += n;
+    }
+
+    /* each station in the hash is on the list of its parent vAP */
+    while ((index = rte_hash_iterate(sta_store, &key, &data, &next)) >= 0) {
+        link = &(sta_links[index]);
+        if (link->vap == STORE_INDEX_NONE ||
+            stas[index].parent_vap != &(vaps[link->vap])) {
+            RTE_LOG(ERR, RWPA_STORE, "Station %d is not on the list of "
+                    "its vAP\n", index);
+            sts = RWPA_STS_ERR;
+        }
+        if (sta_idle_timeout != 0 && link->expiry == 0) {
+            RTE_LOG(ERR, RWPA_STORE, "Station %d is not being aged\n",
+                    index);
+            sts = RWPA_STS_ERR;
+        }
+        nb_hashed++;
+    }
+
+    if (nb_listed != nb_hashed) {
+        RTE_LOG(ERR, RWPA_STORE, "%u stations listed by the vAPs, for %u "
+                "in the store\n", nb_listed, nb_hashed);
+        sts = RWPA_STS_ERR;
+    }
+
+    STORE_WRITE_UNLOCK(sta_store_lock);
+    STORE_WRITE_UNLOCK(vap_store_lock);
 
-    return RWPA_STS_ERR;
+    return sts;
 }
@@ -37,6 +37,177 @@
 #define __INCLUDE_STORE_H__
 
 #include <rte_ether.h>
+#include <rte_atomic.h>
+#include <rte_lcore.h>
+#include <rte_branch_prediction.h>
+
+struct vap_elem;
+struct sta_elem;
+
+/* maximum number of entries added by one bulk add */
+#define STORE_BULK_ADD_MAX      128
+
+/* maximum number of idle stations deleted by one store_sta_age() */
+#define STORE_AGING_BATCH_MAX   64
+
+/**********************************************************
+ * Read side
+ *
+ * The data path looks up and reads the stores' entries without locking
+ * them. Each lcore counts the references it holds, in its own cache
+ * line, against one of 2 indexes. A writer removing or rekeying an
+ * entry flips the index and waits, in store_synchronize(), for the
+ * references on the old index to be dropped, before the entry's key
+ * and crypto sessions are freed (i.e. SRCU).
+ */
+
+struct store_reader {
+    volatile uint32_t refs[2];
+} __rte_cache_aligned;
+
+/*
+ * the threads which are not EAL lcores (i.e. rte_lcore_id() is
+ * LCORE_ID_ANY) share one set of references, updated atomically
+ */
+struct store_shared_reader {
+    rte_atomic32_t refs[2];
+} __rte_cache_aligned;
+
+extern struct store_reader store_readers[RTE_MAX_LCORE];
+extern struct store_shared_reader store_shared_reader;
+extern volatile uint32_t store_reader_idx;
+
+/*
+ * add to the calling thread's references on the index
+ */
+static inline void
+store_reader_refs_add(uint8_t idx, int32_t n)
+{
+    unsigned lcore_id = rte_lcore_id();
+
+    if (likely(lcore_id < RTE_MAX_LCORE))
+        store_readers[lcore_id].refs[idx] += n;
+    else
+        rte_atomic32_add(&(store_shared_reader.refs[idx]), n);
+}
+
+/**
+ * @brief Enters a read side critical section on this lcore
+ *
+ * @return Reader index, for store_read_unlock() and store_read_ref_get()
+ *
+ * @note
+ *   Entries found by lookups in the critical section stay valid until
+ *   it is exited, or until the references taken on them are dropped
+ */
+static inline uint8_t
+store_read_lock(void)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    uint8_t idx;
+
+    for (;;) {
+        idx = store_reader_idx & 1;
+        store_reader_refs_add(idx, 1);
+        rte_smp_mb();
+
+        /* retry if a writer flipped the index before seeing the reference */
+        if (likely((store_reader_idx & 1) == idx))
+            return idx;
+
+        store_reader_refs_add(idx, -1);
+    }
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Exits a read side critical section on this lcore
+ *
+ * @param [in] idx Reader index returned by store_read_lock()
+ */
+static inline void
+store_read_unlock(uint8_t idx)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    rte_smp_mb();
+    store_reader_refs_add(idx, -1);
+#else
+    RTE_SET_USED(idx);
+#endif
+}
+
+/**
+ * @brief Takes a reference on an entry, to use it beyond the critical
+ *        section it was found in (e.g. while its crypto op is in flight)
+ *
+ * @param [in] idx Reader index of the enclosing critical section
+ */
+static inline void
+store_read_ref_get(uint8_t idx)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    store_reader_refs_add(idx, 1);
+#else
+    RTE_SET_USED(idx);
+#endif
+}
+
+/**
+ * @brief Drops a reference taken with store_read_ref_get()
+ *
+ * @param [in] idx Reader index the reference was taken on
+ *
+ * @note
+ *   Must be called in the critical section the reference was taken in,
+ *   or after a full barrier (rte_smp_mb()) following the last use of
+ *   the entry, so that no use is seen after the reference is dropped
+ */
+static inline void
+store_read_ref_put(uint8_t idx)
+{
+#ifndef RWPA_STORE_NO_LOCKS
+    store_reader_refs_add(idx, -1);
+#else
+    RTE_SET_USED(idx);
+#endif
+}
+
+/**********************************************************
+ * Aging clock
+ *
+ * The data path stamps each station it receives a frame from with the
+ * aging clock, a count of seconds advanced by store_sta_age(), which
+ * finds the stations idle for longer than the configured timeout.
+ */
+
+extern volatile uint32_t store_tick;
+
+/**
+ * @brief Gets the aging clock, to stamp the stations seen with
+ *
+ * @return Current tick, in seconds
+ */
+static inline uint32_t
+store_tick_get(void)
+{
+    return store_tick;
+}
+
+/**
+ * @brief Waits until no lcore holds a reference taken before the call
+ *
+ * @note
+ *   Must not be called in a read side critical section, or with a
+ *   reference held, by the calling lcore
+ *
+ * @note
+ *   The wait is not cut short on shutdown, so the readers must drop
+ *   their references (i.e. complete their crypto ops) before exiting
+ */
+void
+store_synchronize(void);
 
 /**********************************************************
  * Init/cleanup
@@ -46,10 +217,16 @@
  * @brief Initialises the vAP and station store
  *
  * @param [in] socket_id ID of socket for memory allocation
+ * @param [in] app_store_params Store capacities from config
  * @param [in] app_addr_params Address params from config
+ *
+ * @note
+ *   The hash tables cannot grow, so the capacities are fixed until the
+ *   next restart (see the README on resizing the store)
  */
 void
-store_init(int socket_id, struct app_addr_params *app_addr_params);
+store_init(int socket_id, struct app_store_params *app_store_params,
+           struct app_addr_params *app_addr_params);
 
 /**
  * @brief Cleans up the store
@@ -57,6 +234,46 @@ store_init(int socket_id, struct app_addr_params *app_addr_params);
 void
 store_cleanup(void);
 
+/**
+ * @brief Gets the vAP capacity of the store
+ *
+ * @return Maximum number of vAPs
+ */
+uint32_t
+store_vap_max(void);
+
+/**
+ * @brief Gets the station capacity of the store
+ *
+ * @return Maximum number of stations
+ */
+uint32_t
+store_sta_max(void);
+
+/**
+ * @brief Gets how long a station's old PTK stays valid for RX once TX
+ *        has switched to a new PTK
+ *
+ * @return Overlap in TSC cycles
+ */
+uint64_t
+store_ptk_rx_overlap_get(void);
+
+/**
+ * @brief Runs a function on all the lcores, to fill the store in parallel
+ *
+ * @param [in] fill Function run on each lcore, which adds its share of
+ *                  the entries (e.g. using the bulk add functions)
+ * @param [in] arg Argument passed to fill
+ *
+ * @note
+ *   Only for use at start-up, before the threads are launched, as the
+ *   lcores must be idle. fill is only run on the master lcore when
+ *   built with RWPA_STORE_NO_LOCKS.
+ */
+void
+store_parallel_fill(int (*fill)(void *), void *arg);
+
 /**********************************************************
  * vAP Store
  */
@@ -71,6 +288,24 @@ store_cleanup(void);
 struct vap_elem *
 store_vap_add(struct ether_addr *vap_addr);
 
+/**
+ * @brief Adds several vAPs to the store
+ *
+ * @param [in]  vap_addr Array of vAP MAC addresses
+ * @param [in]  num_keys Number of keys in the array, at most
+ *                       STORE_BULK_ADD_MAX
+ * @param [out] vap Array of pointers to the new vAP entries, NULL
+ *                  for any vAP which could not be added
+ *
+ * @return Number of vAPs added
+ *
+ * @note
+ *   The store is write locked once for all the vAPs
+ */
+uint32_t
+store_vap_bulk_add(struct ether_addr **vap_addr, uint32_t num_keys,
+                   struct vap_elem **vap);
+
 /**
  * @brief Checks the store for the specified vAP
  *
@@ -111,12 +346,73 @@ store_vap_bulk_lookup(struct ether_addr **vap_addr, uint32_t num_keys, int32_t *
  * @return STORE_STS_OK if deleted successfully, STORE_STS_FAIL otherwise
  *
  * @note
- *   All stations associated with this vAP must be deleted
- *   from the store before deleting the vAP itself
+ *   The Stations of the vAP are deleted with it, and their keys and
+ *   sessions freed
  */
 enum rwpa_status
 store_vap_del(struct ether_addr *vap_addr);
 
+/**
+ * @brief Iterates over the vAPs in the store
+ *
+ * @param [out]   vap_addr MAC address of the next vAP
+ * @param [out]   vap Pointer to the next vAP entry
+ * @param [inout] next Iterator state, must be 0 for the first call
+ *
+ * @return Store index of the next vAP, -ENOENT once all the vAPs
+ *         have been returned
+ *
+ * @note
+ *   The store is only read locked for each call, so vAPs added or
+ *   deleted during the iteration may or may not be returned
+ */
+int32_t
+store_vap_iterate(struct ether_addr *vap_addr, struct vap_elem **vap,
+                  uint32_t *next);
+
+/**
+ * @brief Deletes the Stations idle for longer than the configured
+ *        timeout, and advances the aging clock
+ *
+ * @param [in] cur_tsc Current TSC
+ * @param [in] expired Function called for each Station deleted, once
+ *                     the store is unlocked
+ * @param [in] arg Argument passed to expired
+ *
+ * @return Number of Stations deleted
+ *
+ * @note
+ *   Meant to be called often from one lcore (the control thread),
+ *   it returns straight away until the next tick, and deletes at most
+ *   STORE_AGING_BATCH_MAX Stations per call, leaving the rest to the
+ *   next calls
+ */
+uint32_t
+store_sta_age(uint64_t cur_tsc,
+              void (*expired)(const struct ether_addr *sta_addr,
+                              const struct ether_addr *vap_addr,
+                              void *arg),
+              void *arg);
+
+/**
+ * @brief Calls a function for each Station of a vAP
+ *
+ * @param [in] vap Pointer to the vAP entry
+ * @param [in] fn Function called for each Station, may be NULL to only
+ *                count the Stations
+ * @param [in] arg Argument passed to fn
+ *
+ * @return Number of Stations of the vAP
+ *
+ * @note
+ *   The Station store is write locked for the walk, so fn must not
+ *   add or delete Stations
+ */
+uint32_t
+store_vap_sta_foreach(struct vap_elem *vap,
+                      void (*fn)(struct sta_elem *sta, void *arg),
+                      void *arg);
+
 /**********************************************************
  * Station Store
  */
@@ -132,6 +428,26 @@ store_vap_del(struct ether_addr *vap_addr);
 struct sta_elem *
 store_sta_add(struct ether_addr *sta_addr, struct ether_addr *vap_addr);
 
+/**
+ * @brief Adds several Stations to the store
+ *
+ * @param [in]  sta_addr Array of Station MAC addresses
+ * @param [in]  vap_addr Array of MAC addresses of the Stations' vAPs
+ * @param [in]  num_keys Number of keys in the arrays, at most
+ *                       STORE_BULK_ADD_MAX
+ * @param [out] sta Array of pointers to the new Station entries, NULL
+ *                  for any Station which could not be added
+ *
+ * @return Number of Stations added
+ *
+ * @note
+ *   The vAP and Station stores are each locked once for all the
+ *   Stations
+ */
+uint32_t
+store_sta_bulk_add(struct ether_addr **sta_addr, struct ether_addr **vap_addr,
+                   uint32_t num_keys, struct sta_elem **sta);
+
 /**
  * @brief Checks the store for the specified Station
  *
@@ -153,15 +469,21 @@ struct sta_elem *
 store_sta_get(int32_t index);
 
 /**
- * @brief Does a bulk lookup of the Station store
+ * @brief Does a bulk lookup of the Station store, through the calling
+ *        lcore's station cache
  *
  * @param [in]  sta_addr MAC address of the Station
  * @param [in]  num_keys Number of keys in the array
  * @param [out] found Array of found Station indexes. Values can be passed
  *                    to store_sta_get() to get the actual station. Value
  *                    -ENOENT means station was not found.
+ *
+ * @return Number of keys found in the station cache, whether the
+ *         Station exists or not
+ *
+ * @note Must be called in a read section, see store_read_lock()
  */
-void
+uint32_t
 store_sta_bulk_lookup(struct ether_addr **sta_addr, uint32_t num_keys, int32_t *found);
 
 /**
@@ -174,4 +496,39 @@ store_sta_bulk_lookup(struct ether_addr **sta_addr, uint32_t num_keys, int32_t *
 enum rwpa_status
 store_sta_del(struct ether_addr *sta_addr);
 
+/**
+ * @brief Iterates over the Stations in the store
+ *
+ * @param [out]   sta_addr MAC address of the next Station
+ * @param [out]   sta Pointer to the next Station entry
+ * @param [inout] next Iterator state, must be 0 for the first call
+ *
+ * @return Store index of the next Station, -ENOENT once all the
+ *         Stations have been returned
+ *
+ * @note
+ *   The store is only read locked for each call, so Stations added
+ *   or deleted during the iteration may or may not be returned
+ */
+int32_t
+store_sta_iterate(struct ether_addr *sta_addr, struct sta_elem **sta,
+                  uint32_t *next);
+
+/**********************************************************
+ * Consistency
+ */
+
+/**
+ * @brief Checks that the vAPs' Station lists match the Station store
+ *
+ * @return STORE_STS_OK if consistent, STORE_STS_FAIL otherwise, with
+ *         each inconsistency logged
+ *
+ * @note
+ *   Both stores are write locked for the whole check, so it is only
+ *   meant for validation builds and tests
+ */
+enum rwpa_status
+store_check(void);
+
 #endif // __INCLUDE_STORE_H__
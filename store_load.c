@@ -35,9 +35,17 @@
 
 #include <rte_common.h>
 #include <rte_ether.h>
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+#include <rte_hash.h>
 
+#include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "r-wpa_global_vars.h"
 #include "app.h"
@@ -55,6 +63,17 @@
 #define FILE_VAP_MAC_IDX    1
 #define FILE_KEY_IDX        2
 
+/*
+ * shared by the lcores loading the stations of a binary preload file
+ * - each lcore takes the next chunk of STORE_BULK_ADD_MAX stations
+ */
+struct bin_load {
+    struct store_load_bin_rec *rec;
+    uint32_t nb_recs;
+    rte_atomic32_t next_chunk;
+    rte_atomic32_t nb_loaded;
+};
+
 static uint32_t
 split(char *string, char *tokens[], uint32_t nb_tokens, const char *delim)
 {
@@ -159,10 +178,10 @@ station_add(char *sta_mac_c, char *vap_mac_c, char *key_c)
                 sta_mac.addr_bytes[5],
                 key_c);
         sta = store_sta_add(&sta_mac, &vap_mac);
-        sta_ptk_set(sta, key_b, key_len);
+        sta_ptk_set(sta, key_b, key_len, CCMP_CIPHER_CCMP);
     } else {
-        if (!((sta->ptk_sa.tk_len == key_len) &&
-              (memcmp(sta->ptk_sa.tk, key_b, key_len) == 0))) {
+        if (!((sta->ptk[0].sa.tk_len == key_len) &&
+              (memcmp(sta->ptk[0].sa.cold->tk, key_b, key_len) == 0))) {
            RTE_LOG(WARNING, RWPA_STORE_LOAD,
                    "Resetting key for station %02x:%02x:%02x:%02x:%02x:%02x "
                    "to %s, which may cause packets encrypted with the old key "
@@ -174,19 +193,192 @@ station_add(char *sta_mac_c, char *vap_mac_c, char *key_c)
                    sta_mac.addr_bytes[4],
                    sta_mac.addr_bytes[5],
                    key_c);
-           sta_ptk_set(sta, key_b, key_len);
+           sta_ptk_set(sta, key_b, key_len, CCMP_CIPHER_CCMP);
         }
     }
 
     return 0;
 }
 
+static inline int
+bin_key_valid(const struct store_load_bin_rec *rec)
+{
+    return rec->key_len == CCMP_128_KEY_LEN ||
+           rec->key_len == CCMP_256_KEY_LEN;
+}
+
+/*
+ * Add the vAPs of a binary preload file
+ * - there are far fewer vAPs than stations, so each chunk is looked
+ *   up first and only the vAPs not yet in the store are added, once
+ */
+static void
+bin_vaps_add(struct store_load_bin_rec *rec, uint32_t nb_recs)
+{
+    struct ether_addr *addr[RTE_HASH_LOOKUP_BULK_MAX];
+    struct ether_addr *missing[RTE_HASH_LOOKUP_BULK_MAX];
+    struct vap_elem *vap[RTE_HASH_LOOKUP_BULK_MAX];
+    int32_t found[RTE_HASH_LOOKUP_BULK_MAX];
+    uint32_t i, j, k, n, nb_missing;
+
+    for (i = 0; i < nb_recs; i += n) {
+        n = RTE_MIN(nb_recs - i, (uint32_t)RTE_HASH_LOOKUP_BULK_MAX);
+
+        for (j = 0; j < n; j++)
+            addr[j] = (struct ether_addr *)rec[i + j].vap_mac;
+
+        store_vap_bulk_lookup(addr, n, found);
+
+        nb_missing = 0;
+        for (j = 0; j < n; j++) {
+            if (found[j] >= 0)
+                continue;
+
+            for (k = 0; k < nb_missing; k++)
+                if (is_same_ether_addr(addr[j], missing[k]))
+                    break;
+
+            if (k == nb_missing)
+                missing[nb_missing++] = addr[j];
+        }
+
+        if (nb_missing > 0 &&
+            store_vap_bulk_add(missing, nb_missing, vap) != nb_missing)
+            RTE_LOG(ERR, RWPA_STORE_LOAD,
+                    "Failed to add %u vAPs to the store\n",
+                    nb_missing);
+    }
+}
+
+/*
+ * Add the stations of a binary preload file, run on each lcore
+ * - a station already in the store keeps its counters if its key is
+ *   unchanged
+ * - the crypto sessions are only created on the station's first
+ *   packet, so setting the key is just the key schedule
+ */
+static int
+bin_stas_add(void *arg)
+{
+    struct bin_load *load = (struct bin_load *)arg;
+    struct ether_addr *sta_addr[STORE_BULK_ADD_MAX];
+    struct ether_addr *vap_addr[STORE_BULK_ADD_MAX];
+    struct store_load_bin_rec *valid[STORE_BULK_ADD_MAX];
+    struct sta_elem *sta[STORE_BULK_ADD_MAX];
+    struct store_load_bin_rec *rec;
+    uint32_t chunk, first, j, n, nb_valid, nb_loaded;
+
+    for (;;) {
+        chunk = rte_atomic32_add_return(&(load->next_chunk), 1) - 1;
+        first = chunk * STORE_BULK_ADD_MAX;
+        if (first >= load->nb_recs)
+            break;
+
+        rec = &(load->rec[first]);
+        n = RTE_MIN(load->nb_recs - first, (uint32_t)STORE_BULK_ADD_MAX);
+
+        nb_valid = 0;
+        for (j = 0; j < n; j++) {
+            if (unlikely(!bin_key_valid(&rec[j])))
+                continue;
+
+            sta_addr[nb_valid] = (struct ether_addr *)rec[j].sta_mac;
+            vap_addr[nb_valid] = (struct ether_addr *)rec[j].vap_mac;
+            valid[nb_valid++] = &rec[j];
+        }
+
+        store_sta_bulk_add(sta_addr, vap_addr, nb_valid, sta);
+
+        nb_loaded = 0;
+        for (j = 0; j < nb_valid; j++) {
+            if (unlikely(sta[j] == NULL))
+                continue;
+
+            if (!((sta[j]->ptk[0].sa.tk_len == valid[j]->key_len) &&
+                  (memcmp(sta[j]->ptk[0].sa.cold->tk, valid[j]->key,
+                          valid[j]->key_len) == 0)))
+                sta_ptk_set(sta[j], valid[j]->key, valid[j]->key_len,
+                            CCMP_CIPHER_CCMP);
+
+            nb_loaded++;
+        }
+
+        rte_atomic32_add(&(load->nb_loaded), nb_loaded);
+    }
+
+    return 0;
+}
+
+static void
+store_load_bin(const char *filename)
+{
+    struct store_load_bin_hdr *hdr;
+    struct bin_load load;
+    uint64_t start_tsc;
+    struct stat st;
+    uint8_t *mem;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        RTE_LOG(ERR, RWPA_STORE_LOAD,
+                "Failed to open store preload file: %s\n",
+                filename);
+        return;
+    }
+
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(struct store_load_bin_hdr) ||
+        (mem = mmap(NULL, st.st_size, PROT_READ,
+                    MAP_PRIVATE | MAP_POPULATE, fd, 0)) == MAP_FAILED) {
+        RTE_LOG(ERR, RWPA_STORE_LOAD,
+                "Failed to map store preload file: %s\n",
+                filename);
+        close(fd);
+        return;
+    }
+
+    close(fd);
+
+    hdr = (struct store_load_bin_hdr *)mem;
+    if (hdr->version != STORE_LOAD_BIN_VERSION ||
+        hdr->rec_len != sizeof(struct store_load_bin_rec) ||
+        (size_t)st.st_size != sizeof(struct store_load_bin_hdr) +
+                  ((size_t)hdr->nb_recs * sizeof(struct store_load_bin_rec))) {
+        RTE_LOG(ERR, RWPA_STORE_LOAD,
+                "Invalid format of binary store preload file: %s\n",
+                filename);
+        munmap(mem, st.st_size);
+        return;
+    }
+
+    start_tsc = rte_rdtsc();
+
+    load.rec = (struct store_load_bin_rec *)(hdr + 1);
+    load.nb_recs = hdr->nb_recs;
+    rte_atomic32_set(&(load.next_chunk), 0);
+    rte_atomic32_set(&(load.nb_loaded), 0);
+
+    /* vAPs first, as the stations are added to their parent vAP */
+    bin_vaps_add(load.rec, load.nb_recs);
+    store_parallel_fill(bin_stas_add, &load);
+
+    RTE_LOG(INFO, RWPA_STORE_LOAD,
+            "Loaded %u/%u stations from binary preload file %s in "
+            "%"PRIu64" ms\n",
+            (uint32_t)rte_atomic32_read(&(load.nb_loaded)), load.nb_recs,
+            filename, ((rte_rdtsc() - start_tsc) * 1000) / rte_get_tsc_hz());
+
+    munmap(mem, st.st_size);
+}
+
 void
 store_load(const char *filename)
 {
     FILE *fp;
     const char *mode = "r";
     char line[1024], line_save[1024];
+    uint32_t magic = 0;
 
     RTE_LOG(INFO, RWPA_STORE_LOAD,
             "Loading vAP and station store from preload file %s\n",
@@ -195,6 +387,16 @@ store_load(const char *filename)
     fp = fopen(filename, mode);
 
     if (fp) {
+        /* binary preload file, from tools/store_convert.c */
+        if (fread(&magic, sizeof(magic), 1, fp) == 1 &&
+            magic == STORE_LOAD_BIN_MAGIC) {
+            fclose(fp);
+            store_load_bin(filename);
+            return;
+        }
+
+        rewind(fp);
+
         while (fgets(line, sizeof(line), fp)) {
             char *tokens[FILE_LINE_NUM_ELEMS] = {0};
             strcpy(line_save, line);
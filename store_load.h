@@ -36,6 +36,40 @@
 #ifndef __INCLUDE_STORE_LOAD_H__
 #define __INCLUDE_STORE_LOAD_H__
 
+#include <stdint.h>
+
+#include "key.h"
+
+/*
+ * Binary preload file
+ * - header, then nb_recs station records, in host byte order
+ * - written from the text format (sta_mac,vap_mac,key per line) by
+ *   tools/store_convert.c, and loaded in parallel by store_load()
+ * - only depends on key.h, so that the converter builds without DPDK
+ */
+#define STORE_LOAD_BIN_MAGIC    (0x4c535752) /* "RWSL" */
+#define STORE_LOAD_BIN_VERSION  (1)
+#define STORE_LOAD_BIN_MAC_LEN  (6)
+
+struct store_load_bin_hdr {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_len;
+    uint32_t nb_recs;
+} __attribute__((__packed__));
+
+struct store_load_bin_rec {
+    uint8_t sta_mac[STORE_LOAD_BIN_MAC_LEN];
+    uint8_t vap_mac[STORE_LOAD_BIN_MAC_LEN];
+    uint8_t key_len;
+    uint8_t key[KEY_LEN_MAX];
+} __attribute__((__packed__));
+
+/*
+ * Load the store from a preload file
+ * - the binary format is detected by its magic, otherwise the file is
+ *   read as text
+ */
 void
 store_load(const char *filename);
 
@@ -0,0 +1,537 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <rte_common.h>
+#include <rte_ether.h>
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+
+#ifdef RTE_MACHINE_CPUFLAG_SSE4_2
+#include <rte_hash_crc.h>
+#define DEFAULT_HASH_FUNC rte_hash_crc
+#else
+#include <rte_jhash.h>
+#define DEFAULT_HASH_FUNC rte_jhash
+#endif
+
+#include "r-wpa_global_vars.h"
+#include "app.h"
+#include "key.h"
+#include "ccmp_defns.h"
+#include "ccmp_sa.h"
+#include "vap.h"
+#include "station.h"
+#include "store.h"
+#include "store_snapshot.h"
+
+#define SNAPSHOT_MAGIC      (0x53415752) /* "RWAS" */
+#define SNAPSHOT_VERSION    (2)
+
+/*
+ * snapshot file layout
+ * - header, then nb_vaps vAP records, then nb_stas station records
+ * - the record lengths are stored so that a snapshot from a build
+ *   with a different layout (e.g. TID_NUM) is rejected
+ */
+struct snapshot_hdr {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t vap_rec_len;
+    uint32_t sta_rec_len;
+    uint32_t nb_vaps;
+    uint32_t nb_stas;
+    uint32_t crc;
+} __attribute__((__packed__));
+
+struct snapshot_key {
+    uint8_t tk[KEY_LEN_MAX];
+    uint8_t tk_len;
+    uint8_t cipher;
+} __attribute__((__packed__));
+
+struct snapshot_vap {
+    struct ether_addr address;
+    struct ether_addr tun_mac;
+    uint8_t tun_mac_set;
+    uint8_t current_gtk_index;
+    uint16_t tun_port;
+    uint32_t tun_ip;
+    struct snapshot_key gtk1;
+    struct snapshot_key gtk2;
+    uint64_t gtk1_encrypt_ctr;
+    uint64_t gtk2_encrypt_ctr;
+} __attribute__((__packed__));
+
+/*
+ * only the PTK used for TX is saved, with its KeyID, and a PTK only
+ * valid for RX (i.e. during an Extended Key ID rekey) is not
+ */
+struct snapshot_sta {
+    struct ether_addr address;
+    struct ether_addr vap_address;
+    uint8_t ptk_key_id;
+    struct snapshot_key ptk;
+    uint64_t ptk_encrypt_ctr;
+    uint64_t ptk_decrypt_ctr[TID_NUM];
+} __attribute__((__packed__));
+
+/*
+ * shared by the lcores restoring the stations
+ * - each lcore takes the next chunk of STORE_BULK_ADD_MAX stations
+ */
+struct snapshot_sta_restore {
+    struct snapshot_sta *rec;
+    uint32_t nb_recs;
+    uint64_t pn_margin;
+    rte_atomic32_t next_chunk;
+    rte_atomic32_t nb_restored;
+};
+
+static void
+snapshot_key_save(const struct ccmp_sa *sa, struct snapshot_key *key)
+{
+    if (sa->cold == NULL) {
+        memset(key, 0, sizeof(*key));
+        return;
+    }
+
+    rte_memcpy(key->tk, sa->cold->tk, sizeof(key->tk));
+    key->tk_len = sa->tk_len;
+    key->cipher = sa->cipher;
+}
+
+static inline int
+snapshot_key_valid(const struct snapshot_key *key)
+{
+    return (key->tk_len == CCMP_128_KEY_LEN ||
+            key->tk_len == CCMP_256_KEY_LEN) &&
+           key->cipher < CCMP_CIPHER_MAX;
+}
+
+static uint32_t
+snapshot_vaps_save(struct snapshot_vap *rec, uint32_t max_recs)
+{
+    struct ether_addr addr;
+    struct vap_elem *vap;
+    uint32_t next = 0, nb_recs = 0;
+
+    while (nb_recs < max_recs &&
+           store_vap_iterate(&addr, &vap, &next) >= 0) {
+        struct snapshot_vap *r = &rec[nb_recs++];
+
+        memset(r, 0, sizeof(*r));
+        ether_addr_copy(&addr, &(r->address));
+
+        vap_read_lock(vap);
+        snapshot_key_save(&(vap->gtk1_sa), &(r->gtk1));
+        snapshot_key_save(&(vap->gtk2_sa), &(r->gtk2));
+        r->gtk1_encrypt_ctr = counter_get(&(vap->gtk1_encrypt_ctr));
+        r->gtk2_encrypt_ctr = counter_get(&(vap->gtk2_encrypt_ctr));
+        r->current_gtk_index = vap->current_gtk_index;
+        r->tun_mac_set = vap->tun_mac_set;
+        ether_addr_copy(&(vap->tun_mac), &(r->tun_mac));
+        r->tun_ip = vap->tun_ip;
+        r->tun_port = vap->tun_port;
+        vap_read_unlock(vap);
+    }
+
+    return nb_recs;
+}
+
+static uint32_t
+snapshot_stas_save(struct snapshot_sta *rec, uint32_t max_recs)
+{
+    struct ether_addr addr;
+    struct sta_elem *sta;
+    uint32_t next = 0, nb_recs = 0;
+    struct sta_ptk *ptk;
+    unsigned i;
+
+    while (nb_recs < max_recs &&
+           store_sta_iterate(&addr, &sta, &next) >= 0) {
+        struct snapshot_sta *r = &rec[nb_recs];
+
+        sta_read_lock(sta);
+        if (unlikely(sta->parent_vap == NULL)) {
+            sta_read_unlock(sta);
+            continue;
+        }
+
+        memset(r, 0, sizeof(*r));
+        ether_addr_copy(&addr, &(r->address));
+        ether_addr_copy(&(sta->parent_vap->address), &(r->vap_address));
+        ptk = &(sta->ptk[sta->ptk_tx_key_id]);
+        r->ptk_key_id = sta->ptk_tx_key_id;
+        snapshot_key_save(&(ptk->sa), &(r->ptk));
+        r->ptk_encrypt_ctr = counter_get(&(ptk->encrypt_ctr));
+        for (i = 0; i < TID_NUM; i++)
+            r->ptk_decrypt_ctr[i] = counter_get(&(ptk->decrypt_ctr[i]));
+        sta_read_unlock(sta);
+
+        nb_recs++;
+    }
+
+    return nb_recs;
+}
+
+enum rwpa_status
+store_snapshot_save(const char *filename)
+{
+    char tmp_filename[PATH_MAX];
+    struct snapshot_hdr *hdr;
+    struct snapshot_vap *vap_rec;
+    struct snapshot_sta *sta_rec;
+    size_t max_len, len;
+    uint8_t *mem;
+    int fd;
+
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+
+    fd = open(tmp_filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        RTE_LOG(ERR, RWPA_STORE,
+                "Failed to open store snapshot file %s: %s\n",
+                tmp_filename, strerror(errno));
+        return RWPA_STS_ERR;
+    }
+
+    /*
+     * size the file for a full store, it is sparse and is truncated
+     * to the records actually written
+     */
+    max_len = sizeof(struct snapshot_hdr) +
+              ((size_t)store_vap_max() * sizeof(struct snapshot_vap)) +
+              ((size_t)store_sta_max() * sizeof(struct snapshot_sta));
+
+    if (ftruncate(fd, max_len) != 0 ||
+        (mem = mmap(NULL, max_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        RTE_LOG(ERR, RWPA_STORE,
+                "Failed to map store snapshot file %s: %s\n",
+                tmp_filename, strerror(errno));
+        close(fd);
+        unlink(tmp_filename);
+        return RWPA_STS_ERR;
+    }
+
+    hdr = (struct snapshot_hdr *)mem;
+    vap_rec = (struct snapshot_vap *)(hdr + 1);
+    hdr->nb_vaps = snapshot_vaps_save(vap_rec, store_vap_max());
+    sta_rec = (struct snapshot_sta *)(vap_rec + hdr->nb_vaps);
+    hdr->nb_stas = snapshot_stas_save(sta_rec, store_sta_max());
+
+    len = (uint8_t *)(sta_rec + hdr->nb_stas) - mem;
+
+    hdr->magic = SNAPSHOT_MAGIC;
+    hdr->version = SNAPSHOT_VERSION;
+    hdr->hdr_len = sizeof(struct snapshot_hdr);
+    hdr->vap_rec_len = sizeof(struct snapshot_vap);
+    hdr->sta_rec_len = sizeof(struct snapshot_sta);
+    hdr->crc = DEFAULT_HASH_FUNC(hdr + 1, len - sizeof(struct snapshot_hdr),
+                                 0);
+
+    RTE_LOG(INFO, RWPA_STORE,
+            "Saving %u vAPs and %u stations to store snapshot %s\n",
+            hdr->nb_vaps, hdr->nb_stas, filename);
+
+    munmap(mem, max_len);
+
+    if (ftruncate(fd, len) != 0 || fsync(fd) != 0 ||
+        rename(tmp_filename, filename) != 0) {
+        RTE_LOG(ERR, RWPA_STORE,
+                "Failed to write store snapshot file %s: %s\n",
+                filename, strerror(errno));
+        close(fd);
+        unlink(tmp_filename);
+        return RWPA_STS_ERR;
+    }
+
+    close(fd);
+
+    return RWPA_STS_OK;
+}
+
+static int
+snapshot_hdr_check(const struct snapshot_hdr *hdr, size_t len)
+{
+    if (len < sizeof(struct snapshot_hdr) ||
+        hdr->magic != SNAPSHOT_MAGIC ||
+        hdr->version != SNAPSHOT_VERSION ||
+        hdr->hdr_len != sizeof(struct snapshot_hdr) ||
+        hdr->vap_rec_len != sizeof(struct snapshot_vap) ||
+        hdr->sta_rec_len != sizeof(struct snapshot_sta))
+        return -1;
+
+    if (len != sizeof(struct snapshot_hdr) +
+               ((size_t)hdr->nb_vaps * sizeof(struct snapshot_vap)) +
+               ((size_t)hdr->nb_stas * sizeof(struct snapshot_sta)))
+        return -1;
+
+    if (hdr->crc != DEFAULT_HASH_FUNC(hdr + 1,
+                                      len - sizeof(struct snapshot_hdr), 0))
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Restore a vAP's keys and tunnel addresses
+ * - the GTK encrypt counters are moved past any value used since the
+ *   snapshot was saved, so that no PN is reused with the same key
+ */
+static void
+snapshot_vap_restore(const struct snapshot_vap *rec,
+                     struct vap_elem *vap,
+                     uint64_t pn_margin)
+{
+    if (snapshot_key_valid(&(rec->gtk1)))
+        vap_gtk_set(vap, GTK1, rec->gtk1.tk, rec->gtk1.tk_len,
+                    (enum ccmp_cipher)rec->gtk1.cipher,
+                    rec->current_gtk_index == GTK1);
+
+    if (snapshot_key_valid(&(rec->gtk2)))
+        vap_gtk_set(vap, GTK2, rec->gtk2.tk, rec->gtk2.tk_len,
+                    (enum ccmp_cipher)rec->gtk2.cipher,
+                    rec->current_gtk_index == GTK2);
+
+    vap_write_lock(vap);
+    vap->current_gtk_index = rec->current_gtk_index;
+    counter_set(&(vap->gtk1_encrypt_ctr), rec->gtk1_encrypt_ctr + pn_margin);
+    counter_set(&(vap->gtk2_encrypt_ctr), rec->gtk2_encrypt_ctr + pn_margin);
+    ether_addr_copy(&(rec->tun_mac), &(vap->tun_mac));
+    vap->tun_mac_set = rec->tun_mac_set;
+    vap->tun_ip = rec->tun_ip;
+    vap->tun_port = rec->tun_port;
+    vap_write_unlock(vap);
+}
+
+static uint32_t
+snapshot_vaps_restore(struct snapshot_vap *rec, uint32_t nb_recs,
+                      uint64_t pn_margin)
+{
+    struct ether_addr *addr[STORE_BULK_ADD_MAX];
+    struct vap_elem *vap[STORE_BULK_ADD_MAX];
+    uint32_t i, j, n, nb_restored = 0;
+
+    for (i = 0; i < nb_recs; i += n) {
+        n = RTE_MIN(nb_recs - i, (uint32_t)STORE_BULK_ADD_MAX);
+
+        for (j = 0; j < n; j++)
+            addr[j] = &(rec[i + j].address);
+
+        store_vap_bulk_add(addr, n, vap);
+
+        for (j = 0; j < n; j++) {
+            if (unlikely(vap[j] == NULL))
+                continue;
+
+            snapshot_vap_restore(&rec[i + j], vap[j], pn_margin);
+            nb_restored++;
+        }
+    }
+
+    return nb_restored;
+}
+
+/*
+ * Restore a station's PTK and counters
+ * - the encrypt counter is moved past any value used since the
+ *   snapshot was saved, the replay counters are restored as saved
+ */
+static void
+snapshot_sta_restore(const struct snapshot_sta *rec,
+                     struct sta_elem *sta,
+                     uint64_t pn_margin)
+{
+    struct sta_ptk *ptk;
+    unsigned i;
+
+    if (unlikely(rec->ptk_key_id >= PTK_KEY_ID_NUM))
+        return;
+
+    /* the PTK goes back in the slot of its KeyID, and is used for TX */
+    if (snapshot_key_valid(&(rec->ptk))) {
+        if (rec->ptk_key_id == 0) {
+            sta_ptk_set(sta, rec->ptk.tk, rec->ptk.tk_len,
+                        (enum ccmp_cipher)rec->ptk.cipher);
+        } else {
+            sta_ptk_rx_set(sta, rec->ptk_key_id, rec->ptk.tk,
+                           rec->ptk.tk_len,
+                           (enum ccmp_cipher)rec->ptk.cipher);
+            sta_ptk_tx_set(sta, rec->ptk_key_id, 0);
+        }
+    }
+
+    sta_write_lock(sta);
+    ptk = &(sta->ptk[rec->ptk_key_id]);
+    counter_set(&(ptk->encrypt_ctr), rec->ptk_encrypt_ctr + pn_margin);
+    for (i = 0; i < TID_NUM; i++)
+        counter_set(&(ptk->decrypt_ctr[i]), rec->ptk_decrypt_ctr[i]);
+    sta_write_unlock(sta);
+}
+
+static int
+snapshot_stas_restore(void *arg)
+{
+    struct snapshot_sta_restore *args = (struct snapshot_sta_restore *)arg;
+    struct ether_addr *sta_addr[STORE_BULK_ADD_MAX];
+    struct ether_addr *vap_addr[STORE_BULK_ADD_MAX];
+    struct sta_elem *sta[STORE_BULK_ADD_MAX];
+    struct snapshot_sta *rec;
+    uint32_t chunk, first, j, n, nb_restored;
+
+    for (;;) {
+        chunk = rte_atomic32_add_return(&(args->next_chunk), 1) - 1;
+        first = chunk * STORE_BULK_ADD_MAX;
+        if (first >= args->nb_recs)
+            break;
+
+        rec = &(args->rec[first]);
+        n = RTE_MIN(args->nb_recs - first, (uint32_t)STORE_BULK_ADD_MAX);
+
+        for (j = 0; j < n; j++) {
+            sta_addr[j] = &(rec[j].address);
+            vap_addr[j] = &(rec[j].vap_address);
+        }
+
+        store_sta_bulk_add(sta_addr, vap_addr, n, sta);
+
+        nb_restored = 0;
+        for (j = 0; j < n; j++) {
+            if (unlikely(sta[j] == NULL))
+                continue;
+
+            snapshot_sta_restore(&rec[j], sta[j], args->pn_margin);
+            nb_restored++;
+        }
+
+        rte_atomic32_add(&(args->nb_restored), nb_restored);
+    }
+
+    return 0;
+}
+
+enum rwpa_status
+store_snapshot_restore(const char *filename, uint64_t pn_margin)
+{
+    struct snapshot_sta_restore sta_args;
+    struct snapshot_hdr *hdr;
+    struct snapshot_vap *vap_rec;
+    uint32_t nb_vaps;
+    uint64_t start_tsc;
+    struct stat st;
+    uint8_t *mem;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        RTE_LOG(INFO, RWPA_STORE,
+                "No store snapshot %s to restore, starting with an "
+                "empty store\n", filename);
+        return RWPA_STS_ERR;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0 ||
+        (mem = mmap(NULL, st.st_size, PROT_READ,
+                    MAP_PRIVATE | MAP_POPULATE, fd, 0)) == MAP_FAILED) {
+        RTE_LOG(ERR, RWPA_STORE,
+                "Failed to map store snapshot %s\n", filename);
+        close(fd);
+        return RWPA_STS_ERR;
+    }
+
+    close(fd);
+
+    hdr = (struct snapshot_hdr *)mem;
+    if (snapshot_hdr_check(hdr, st.st_size) != 0) {
+        RTE_LOG(ERR, RWPA_STORE,
+                "Store snapshot %s is invalid, not restoring it\n",
+                filename);
+        munmap(mem, st.st_size);
+        return RWPA_STS_ERR;
+    }
+
+    /*
+     * a store resized smaller than the snapshot only keeps the entries
+     * which fit, the others fail to be added
+     */
+    if (hdr->nb_vaps > store_vap_max() || hdr->nb_stas > store_sta_max())
+        RTE_LOG(WARNING, RWPA_STORE,
+                "Store snapshot %s has %u vAPs and %u stations, more than "
+                "the store's capacity of %u and %u\n", filename,
+                hdr->nb_vaps, hdr->nb_stas, store_vap_max(),
+                store_sta_max());
+
+    start_tsc = rte_rdtsc();
+
+    /* vAPs first, as the stations are added to their parent vAP */
+    vap_rec = (struct snapshot_vap *)(hdr + 1);
+    nb_vaps = snapshot_vaps_restore(vap_rec, hdr->nb_vaps, pn_margin);
+
+    sta_args.rec = (struct snapshot_sta *)(vap_rec + hdr->nb_vaps);
+    sta_args.nb_recs = hdr->nb_stas;
+    sta_args.pn_margin = pn_margin;
+    rte_atomic32_set(&(sta_args.next_chunk), 0);
+    rte_atomic32_set(&(sta_args.nb_restored), 0);
+
+    /*
+     * the stations' key setup dominates the restore time, so spread
+     * it over all the lcores
+     */
+    store_parallel_fill(snapshot_stas_restore, &sta_args);
+
+    RTE_LOG(INFO, RWPA_STORE,
+            "Restored %u/%u vAPs and %u/%u stations from store snapshot "
+            "%s in %"PRIu64" ms\n",
+            nb_vaps, hdr->nb_vaps,
+            (uint32_t)rte_atomic32_read(&(sta_args.nb_restored)),
+            hdr->nb_stas, filename,
+            ((rte_rdtsc() - start_tsc) * 1000) / rte_get_tsc_hz());
+
+    munmap(mem, st.st_size);
+
+    return RWPA_STS_OK;
+}
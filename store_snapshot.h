@@ -0,0 +1,75 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#ifndef __INCLUDE_STORE_SNAPSHOT_H__
+#define __INCLUDE_STORE_SNAPSHOT_H__
+
+#include <stdint.h>
+
+/**
+ * @brief Saves the vAP and station store to a snapshot file
+ *
+ * @param [in] filename Path of the snapshot file
+ *
+ * @return RWPA_STS_OK if the snapshot was saved, RWPA_STS_ERR otherwise
+ *
+ * @note
+ *   The snapshot is written to a temporary file which is renamed
+ *   over filename, so a previous snapshot is only replaced by a
+ *   complete one. Placing it on tmpfs (e.g. /dev/shm) keeps it in
+ *   memory across process restarts.
+ */
+enum rwpa_status
+store_snapshot_save(const char *filename);
+
+/**
+ * @brief Restores the vAP and station store from a snapshot file
+ *
+ * @param [in] filename Path of the snapshot file
+ * @param [in] pn_margin Amount added to each saved encrypt counter
+ *
+ * @return RWPA_STS_OK if the snapshot was restored, RWPA_STS_ERR
+ *         otherwise
+ *
+ * @note
+ *   Must be called after the store and crypto are initialised, and
+ *   before the threads are launched, as the stations are restored
+ *   in parallel on all the lcores. The crypto sessions are created
+ *   on first use, as for keys set by the controller.
+ */
+enum rwpa_status
+store_snapshot_restore(const char *filename, uint64_t pn_margin);
+
+#endif // __INCLUDE_STORE_SNAPSHOT_H__
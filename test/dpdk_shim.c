@@ -0,0 +1,313 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include "dpdk_shim.h"
+
+unsigned shim_log_level = RTE_LOG_ERR;
+
+/* the main thread is the master lcore */
+__thread unsigned shim_lcore_id = 0;
+unsigned shim_lcore_count = 1;
+
+void
+rte_exit(int exit_code, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+
+    exit(exit_code);
+}
+
+int
+rte_eal_mp_remote_launch(lcore_function_t *f, void *arg,
+                         enum rte_rmt_call_master_t call_master)
+{
+    if (call_master == CALL_MASTER)
+        f(arg);
+
+    return 0;
+}
+
+int
+rte_eal_wait_lcore(unsigned slave_id)
+{
+    RTE_SET_USED(slave_id);
+
+    return 0;
+}
+
+/*
+ * Hash
+ */
+#define SHIM_HASH_EMPTY 0
+
+struct rte_hash {
+    uint32_t entries;
+    uint32_t key_len;
+    uint32_t init_val;
+    rte_hash_function hash_func;
+
+    /* probed table of key slot + 1, SHIM_HASH_EMPTY if empty */
+    uint32_t table_mask;
+    volatile uint32_t *table;
+
+    /* key slots, their use and the free list */
+    uint8_t *keys;
+    volatile uint8_t *used;
+    uint32_t *free_slots;
+    uint32_t nb_free;
+};
+
+static inline const uint8_t *
+hash_key(const struct rte_hash *h, uint32_t slot)
+{
+    return &(h->keys[(size_t)slot * h->key_len]);
+}
+
+struct rte_hash *
+rte_hash_create(const struct rte_hash_parameters *params)
+{
+    struct rte_hash *h;
+    uint32_t size = 2, i;
+
+    if (params == NULL || params->entries == 0 || params->key_len == 0)
+        return NULL;
+
+    /* at most half full */
+    while (size < params->entries * 2)
+        size <<= 1;
+
+    h = calloc(1, sizeof(*h));
+    if (h == NULL)
+        return NULL;
+
+    h->entries = params->entries;
+    h->key_len = params->key_len;
+    h->init_val = params->hash_func_init_val;
+    h->hash_func = params->hash_func != NULL ? params->hash_func : rte_jhash;
+    h->table_mask = size - 1;
+    h->table = calloc(size, sizeof(uint32_t));
+    h->keys = calloc(h->entries, h->key_len);
+    h->used = calloc(h->entries, sizeof(uint8_t));
+    h->free_slots = calloc(h->entries, sizeof(uint32_t));
+    if (h->table == NULL || h->keys == NULL ||
+        h->used == NULL || h->free_slots == NULL) {
+        rte_hash_free(h);
+        return NULL;
+    }
+
+    /* the lowest slots are handed out first */
+    for (i = 0; i < h->entries; i++)
+        h->free_slots[i] = h->entries - 1 - i;
+    h->nb_free = h->entries;
+
+    return h;
+}
+
+void
+rte_hash_free(struct rte_hash *h)
+{
+    if (h == NULL)
+        return;
+
+    free((void *)h->table);
+    free(h->keys);
+    free((void *)h->used);
+    free(h->free_slots);
+    free(h);
+}
+
+hash_sig_t
+rte_hash_hash(const struct rte_hash *h, const void *key)
+{
+    return h->hash_func(key, h->key_len, h->init_val);
+}
+
+/* the table position of the key, or of the empty entry ending its probe */
+static uint32_t
+hash_probe(const struct rte_hash *h, const void *key, hash_sig_t sig,
+           int *found)
+{
+    uint32_t pos = sig & h->table_mask, n, e;
+
+    for (n = 0; n <= h->table_mask; n++, pos = (pos + 1) & h->table_mask) {
+        e = h->table[pos];
+        if (e == SHIM_HASH_EMPTY)
+            break;
+
+        if (e <= h->entries &&
+            memcmp(hash_key(h, e - 1), key, h->key_len) == 0) {
+            *found = 1;
+            return pos;
+        }
+    }
+
+    *found = 0;
+
+    return pos;
+}
+
+int32_t
+rte_hash_lookup_with_hash(const struct rte_hash *h, const void *key,
+                          hash_sig_t sig)
+{
+    uint32_t pos;
+    int found;
+
+    if (h == NULL || key == NULL)
+        return -EINVAL;
+
+    pos = hash_probe(h, key, sig, &found);
+
+    return found ? (int32_t)(h->table[pos] - 1) : -ENOENT;
+}
+
+int32_t
+rte_hash_lookup(const struct rte_hash *h, const void *key)
+{
+    return rte_hash_lookup_with_hash(h, key, rte_hash_hash(h, key));
+}
+
+int
+rte_hash_lookup_bulk(const struct rte_hash *h, const void **keys,
+                     uint32_t num_keys, int32_t *positions)
+{
+    uint32_t i;
+
+    if (h == NULL || keys == NULL || positions == NULL ||
+        num_keys == 0 || num_keys > RTE_HASH_LOOKUP_BULK_MAX)
+        return -EINVAL;
+
+    for (i = 0; i < num_keys; i++)
+        positions[i] = rte_hash_lookup(h, keys[i]);
+
+    return 0;
+}
+
+int32_t
+rte_hash_add_key_with_hash(const struct rte_hash *h_const, const void *key,
+                           hash_sig_t sig)
+{
+    struct rte_hash *h = (struct rte_hash *)h_const;
+    uint32_t pos, slot;
+    int found;
+
+    if (h == NULL || key == NULL)
+        return -EINVAL;
+
+    pos = hash_probe(h, key, sig, &found);
+    if (found)
+        return (int32_t)(h->table[pos] - 1);
+
+    if (h->nb_free == 0)
+        return -ENOSPC;
+
+    /* the key is written before its slot is published */
+    slot = h->free_slots[--h->nb_free];
+    memcpy(&(h->keys[(size_t)slot * h->key_len]), key, h->key_len);
+    h->used[slot] = 1;
+    __atomic_store_n(&(h->table[pos]), slot + 1, __ATOMIC_RELEASE);
+
+    return (int32_t)slot;
+}
+
+int32_t
+rte_hash_add_key(const struct rte_hash *h, const void *key)
+{
+    return rte_hash_add_key_with_hash(h, key, rte_hash_hash(h, key));
+}
+
+int32_t
+rte_hash_del_key(const struct rte_hash *h_const, const void *key)
+{
+    struct rte_hash *h = (struct rte_hash *)h_const;
+    uint32_t pos, next, home, slot;
+    int found;
+
+    if (h == NULL || key == NULL)
+        return -EINVAL;
+
+    pos = hash_probe(h, key, rte_hash_hash(h, key), &found);
+    if (!found)
+        return -ENOENT;
+
+    slot = h->table[pos] - 1;
+
+    /* shift back the keys which probed past the deleted one */
+    for (next = (pos + 1) & h->table_mask;
+         h->table[next] != SHIM_HASH_EMPTY;
+         next = (next + 1) & h->table_mask) {
+        home = rte_hash_hash(h, hash_key(h, h->table[next] - 1)) &
+               h->table_mask;
+
+        /* the key at next can fill the hole if its home is not in (pos, next] */
+        if (((next - home) & h->table_mask) >= ((next - pos) & h->table_mask)) {
+            h->table[pos] = h->table[next];
+            pos = next;
+        }
+    }
+    h->table[pos] = SHIM_HASH_EMPTY;
+
+    h->used[slot] = 0;
+    h->free_slots[h->nb_free++] = slot;
+
+    return (int32_t)slot;
+}
+
+int32_t
+rte_hash_iterate(const struct rte_hash *h, const void **key, void **data,
+                 uint32_t *next)
+{
+    uint32_t slot;
+
+    if (h == NULL || key == NULL || data == NULL || next == NULL)
+        return -EINVAL;
+
+    for (slot = *next; slot < h->entries; slot++) {
+        if (h->used[slot]) {
+            *key = hash_key(h, slot);
+            *data = NULL;
+            *next = slot + 1;
+            return (int32_t)slot;
+        }
+    }
+
+    *next = slot;
+
+    return -ENOENT;
+}
@@ -0,0 +1,950 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * DPDK shim for the unit tests
+ * - the subset of the DPDK 17.11 API used by the sources under test,
+ *   on libc, pthreads and the GCC atomics, so that the tests build and
+ *   run without DPDK, hugepages or NICs
+ * - every rte_*.h the sources include is generated by the Makefile as
+ *   an include of this file
+ * - lcores are pthreads, which set their lcore id with
+ *   shim_lcore_id_set(), and the TSC is the monotonic clock in ns
+ */
+
+#ifndef __INCLUDE_DPDK_SHIM_H__
+#define __INCLUDE_DPDK_SHIM_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/**********************************************************
+ * rte_common.h, rte_branch_prediction.h
+ */
+
+#define RTE_MAX_LCORE           128
+#define RTE_CACHE_LINE_SIZE     64
+#define __rte_aligned(a)        __attribute__((__aligned__(a)))
+#define __rte_cache_aligned     __rte_aligned(RTE_CACHE_LINE_SIZE)
+#define __rte_unused            __attribute__((__unused__))
+
+#define likely(x)               __builtin_expect(!!(x), 1)
+#define unlikely(x)             __builtin_expect(!!(x), 0)
+
+#define RTE_MIN(a, b)           ((a) < (b) ? (a) : (b))
+#define RTE_MAX(a, b)           ((a) > (b) ? (a) : (b))
+#define RTE_DIM(a)              (sizeof(a) / sizeof((a)[0]))
+#define RTE_SET_USED(x)         (void)(x)
+#define RTE_BUILD_BUG_ON(c)     ((void)sizeof(char[1 - 2 * !!(c)]))
+#define RTE_ALIGN_CEIL(v, a)    (((v) + (a) - 1) & ~((typeof(v))(a) - 1))
+
+/**********************************************************
+ * rte_log.h, rte_eal.h
+ */
+
+#define RTE_LOG_EMERG           1U
+#define RTE_LOG_ALERT           2U
+#define RTE_LOG_CRIT            3U
+#define RTE_LOG_ERR             4U
+#define RTE_LOG_WARNING         5U
+#define RTE_LOG_NOTICE          6U
+#define RTE_LOG_INFO            7U
+#define RTE_LOG_DEBUG           8U
+
+#define RTE_LOGTYPE_USER1       24
+#define RTE_LOGTYPE_USER2       25
+#define RTE_LOGTYPE_USER3       26
+#define RTE_LOGTYPE_USER4       27
+#define RTE_LOGTYPE_USER5       28
+#define RTE_LOGTYPE_USER6       29
+#define RTE_LOGTYPE_USER7       30
+#define RTE_LOGTYPE_USER8       31
+
+/* the sources' errors are what a test wants to see */
+extern unsigned shim_log_level;
+
+#define RTE_LOG(l, t, ...)                                                     \
+    ((void)RTE_LOGTYPE_ ## t,                                                  \
+     RTE_LOG_ ## l <= shim_log_level ?                                         \
+         fprintf(stderr, #t ": " __VA_ARGS__) : 0)
+
+void
+rte_exit(int exit_code, const char *format, ...)
+    __attribute__((noreturn, format(printf, 2, 3)));
+
+/**********************************************************
+ * rte_lcore.h, rte_launch.h
+ */
+
+#define LCORE_ID_ANY            UINT32_MAX
+#define SOCKET_ID_ANY           -1
+
+extern __thread unsigned shim_lcore_id;
+extern unsigned shim_lcore_count;
+
+/* the calling thread is lcore_id, LCORE_ID_ANY for a non-EAL thread */
+static inline void
+shim_lcore_id_set(unsigned lcore_id)
+{
+    shim_lcore_id = lcore_id;
+}
+
+static inline unsigned
+rte_lcore_id(void)
+{
+    return shim_lcore_id;
+}
+
+static inline unsigned
+rte_socket_id(void)
+{
+    return 0;
+}
+
+#define RTE_LCORE_FOREACH(i)                                                   \
+    for ((i) = 0; (i) < shim_lcore_count; (i)++)
+
+#define RTE_LCORE_FOREACH_SLAVE(i)                                             \
+    for ((i) = 1; (i) < shim_lcore_count; (i)++)
+
+enum rte_rmt_call_master_t {
+    SKIP_MASTER = 0,
+    CALL_MASTER,
+};
+
+typedef int (lcore_function_t)(void *);
+
+/* runs f on the calling thread only, the tests start their own lcores */
+int
+rte_eal_mp_remote_launch(lcore_function_t *f, void *arg,
+                         enum rte_rmt_call_master_t call_master);
+
+int
+rte_eal_wait_lcore(unsigned slave_id);
+
+/**********************************************************
+ * rte_atomic.h, rte_pause.h
+ */
+
+#define rte_compiler_barrier()  __asm__ volatile ("" : : : "memory")
+#define rte_smp_mb()            __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define rte_smp_wmb()           __atomic_thread_fence(__ATOMIC_RELEASE)
+#define rte_smp_rmb()           __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define rte_mb()                rte_smp_mb()
+#define rte_wmb()               rte_smp_wmb()
+#define rte_rmb()               rte_smp_rmb()
+
+/* yields, as the tests may have more lcores than CPUs */
+static inline void
+rte_pause(void)
+{
+    sched_yield();
+}
+
+#define SHIM_ATOMIC(n)                                                         \
+typedef struct {                                                               \
+    volatile int ## n ## _t cnt;                                               \
+} rte_atomic ## n ## _t;                                                       \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _init(rte_atomic ## n ## _t *v)                             \
+{                                                                              \
+    __atomic_store_n(&v->cnt, 0, __ATOMIC_SEQ_CST);                            \
+}                                                                              \
+                                                                               \
+static inline int ## n ## _t                                                   \
+rte_atomic ## n ## _read(const rte_atomic ## n ## _t *v)                       \
+{                                                                              \
+    return __atomic_load_n(&v->cnt, __ATOMIC_SEQ_CST);                         \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _set(rte_atomic ## n ## _t *v, int ## n ## _t new_value)    \
+{                                                                              \
+    __atomic_store_n(&v->cnt, new_value, __ATOMIC_SEQ_CST);                    \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _add(rte_atomic ## n ## _t *v, int ## n ## _t inc)          \
+{                                                                              \
+    __atomic_add_fetch(&v->cnt, inc, __ATOMIC_SEQ_CST);                        \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _sub(rte_atomic ## n ## _t *v, int ## n ## _t dec)          \
+{                                                                              \
+    __atomic_sub_fetch(&v->cnt, dec, __ATOMIC_SEQ_CST);                        \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _inc(rte_atomic ## n ## _t *v)                              \
+{                                                                              \
+    rte_atomic ## n ## _add(v, 1);                                             \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+rte_atomic ## n ## _dec(rte_atomic ## n ## _t *v)                              \
+{                                                                              \
+    rte_atomic ## n ## _sub(v, 1);                                             \
+}                                                                              \
+                                                                               \
+static inline int ## n ## _t                                                   \
+rte_atomic ## n ## _add_return(rte_atomic ## n ## _t *v, int ## n ## _t inc)   \
+{                                                                              \
+    return __atomic_add_fetch(&v->cnt, inc, __ATOMIC_SEQ_CST);                 \
+}                                                                              \
+                                                                               \
+static inline int ## n ## _t                                                   \
+rte_atomic ## n ## _sub_return(rte_atomic ## n ## _t *v, int ## n ## _t dec)   \
+{                                                                              \
+    return __atomic_sub_fetch(&v->cnt, dec, __ATOMIC_SEQ_CST);                 \
+}                                                                              \
+                                                                               \
+static inline int                                                              \
+rte_atomic ## n ## _cmpset(volatile uint ## n ## _t *dst,                      \
+                           uint ## n ## _t exp, uint ## n ## _t src)           \
+{                                                                              \
+    return __atomic_compare_exchange_n(dst, &exp, src, 0,                      \
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);    \
+}
+
+SHIM_ATOMIC(16)
+SHIM_ATOMIC(32)
+SHIM_ATOMIC(64)
+
+/**********************************************************
+ * rte_spinlock.h, rte_rwlock.h
+ */
+
+typedef struct {
+    volatile int locked;
+} rte_spinlock_t;
+
+#define RTE_SPINLOCK_INITIALIZER { 0 }
+
+static inline void
+rte_spinlock_init(rte_spinlock_t *sl)
+{
+    sl->locked = 0;
+}
+
+static inline void
+rte_spinlock_lock(rte_spinlock_t *sl)
+{
+    while (__atomic_exchange_n(&sl->locked, 1, __ATOMIC_ACQUIRE))
+        rte_pause();
+}
+
+static inline void
+rte_spinlock_unlock(rte_spinlock_t *sl)
+{
+    __atomic_store_n(&sl->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline int
+rte_spinlock_trylock(rte_spinlock_t *sl)
+{
+    return __atomic_exchange_n(&sl->locked, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+/* cnt is -1 when write locked, the number of readers otherwise */
+typedef struct {
+    volatile int32_t cnt;
+} rte_rwlock_t;
+
+#define RTE_RWLOCK_INITIALIZER { 0 }
+
+static inline void
+rte_rwlock_init(rte_rwlock_t *rwl)
+{
+    rwl->cnt = 0;
+}
+
+static inline void
+rte_rwlock_read_lock(rte_rwlock_t *rwl)
+{
+    int32_t x;
+
+    for (;;) {
+        x = __atomic_load_n(&rwl->cnt, __ATOMIC_RELAXED);
+        if (x >= 0 &&
+            __atomic_compare_exchange_n(&rwl->cnt, &x, x + 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+        rte_pause();
+    }
+}
+
+static inline void
+rte_rwlock_read_unlock(rte_rwlock_t *rwl)
+{
+    __atomic_sub_fetch(&rwl->cnt, 1, __ATOMIC_RELEASE);
+}
+
+static inline void
+rte_rwlock_write_lock(rte_rwlock_t *rwl)
+{
+    int32_t x;
+
+    for (;;) {
+        x = 0;
+        if (__atomic_compare_exchange_n(&rwl->cnt, &x, -1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+        rte_pause();
+    }
+}
+
+static inline void
+rte_rwlock_write_unlock(rte_rwlock_t *rwl)
+{
+    __atomic_store_n(&rwl->cnt, 0, __ATOMIC_RELEASE);
+}
+
+/**********************************************************
+ * rte_cycles.h, rte_prefetch.h, rte_memcpy.h, rte_byteorder.h
+ */
+
+#define MS_PER_S                1000
+#define US_PER_S                1000000
+#define NS_PER_S                1000000000
+
+static inline uint64_t
+rte_rdtsc(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t
+rte_get_tsc_hz(void)
+{
+    return 1000000000ULL;
+}
+
+#define rte_get_timer_cycles()  rte_rdtsc()
+#define rte_get_timer_hz()      rte_get_tsc_hz()
+
+static inline void
+rte_prefetch0(const volatile void *p)
+{
+    __builtin_prefetch((const void *)p, 0, 3);
+}
+
+#define rte_memcpy(dst, src, n) memcpy((dst), (src), (n))
+
+#define rte_cpu_to_be_16(x)     __builtin_bswap16((uint16_t)(x))
+#define rte_be_to_cpu_16(x)     __builtin_bswap16((uint16_t)(x))
+#define rte_cpu_to_be_32(x)     __builtin_bswap32((uint32_t)(x))
+#define rte_be_to_cpu_32(x)     __builtin_bswap32((uint32_t)(x))
+
+/**********************************************************
+ * rte_malloc.h
+ */
+
+static inline void *
+rte_malloc_socket(const char *type, size_t size, unsigned align, int socket)
+{
+    void *p;
+
+    RTE_SET_USED(type);
+    RTE_SET_USED(socket);
+
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+
+    if (posix_memalign(&p, align, size == 0 ? 1 : size) != 0)
+        return NULL;
+
+    return p;
+}
+
+static inline void *
+rte_zmalloc_socket(const char *type, size_t size, unsigned align, int socket)
+{
+    void *p = rte_malloc_socket(type, size, align, socket);
+
+    if (p != NULL)
+        memset(p, 0, size);
+
+    return p;
+}
+
+#define rte_malloc(type, size, align)                                          \
+    rte_malloc_socket(type, size, align, SOCKET_ID_ANY)
+#define rte_zmalloc(type, size, align)                                         \
+    rte_zmalloc_socket(type, size, align, SOCKET_ID_ANY)
+
+static inline void
+rte_free(void *p)
+{
+    free(p);
+}
+
+/**********************************************************
+ * rte_ether.h, rte_ip.h, rte_udp.h, rte_tcp.h, rte_gre.h
+ */
+
+#define ETHER_ADDR_LEN          6
+#define ETHER_TYPE_IPv4         0x0800
+#define ETHER_TYPE_ARP          0x0806
+#define ETHER_TYPE_TEB          0x6558
+
+struct ether_addr {
+    uint8_t addr_bytes[ETHER_ADDR_LEN];
+} __attribute__((__aligned__(2)));
+
+struct ether_hdr {
+    struct ether_addr d_addr;
+    struct ether_addr s_addr;
+    uint16_t ether_type;
+} __attribute__((__aligned__(2)));
+
+static inline void
+ether_addr_copy(const struct ether_addr *ea_from, struct ether_addr *ea_to)
+{
+    memcpy(ea_to, ea_from, sizeof(*ea_to));
+}
+
+static inline int
+is_same_ether_addr(const struct ether_addr *ea1, const struct ether_addr *ea2)
+{
+    return memcmp(ea1, ea2, sizeof(*ea1)) == 0;
+}
+
+static inline int
+is_unicast_ether_addr(const struct ether_addr *ea)
+{
+    return (ea->addr_bytes[0] & 0x01) == 0;
+}
+
+struct ipv4_hdr {
+    uint8_t  version_ihl;
+    uint8_t  type_of_service;
+    uint16_t total_length;
+    uint16_t packet_id;
+    uint16_t fragment_offset;
+    uint8_t  time_to_live;
+    uint8_t  next_proto_id;
+    uint16_t hdr_checksum;
+    uint32_t src_addr;
+    uint32_t dst_addr;
+} __attribute__((__packed__));
+
+#define IPv4(a, b, c, d)        ((uint32_t)(((a) & 0xff) << 24) |              \
+                                 (((b) & 0xff) << 16) |                        \
+                                 (((c) & 0xff) << 8) |                         \
+                                 ((d) & 0xff))
+
+struct udp_hdr {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t dgram_len;
+    uint16_t dgram_cksum;
+} __attribute__((__packed__));
+
+struct tcp_hdr {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint32_t sent_seq;
+    uint32_t recv_ack;
+    uint8_t  data_off;
+    uint8_t  tcp_flags;
+    uint16_t rx_win;
+    uint16_t cksum;
+    uint16_t tcp_urp;
+} __attribute__((__packed__));
+
+/* little endian layout */
+struct gre_hdr {
+    uint16_t res2:4;
+    uint16_t s:1;
+    uint16_t k:1;
+    uint16_t res1:1;
+    uint16_t c:1;
+    uint16_t ver:3;
+    uint16_t res3:5;
+    uint16_t proto;
+} __attribute__((__packed__));
+
+/**********************************************************
+ * rte_mbuf.h
+ * - an mbuf is one malloc'd block, the data following the header
+ *   and its headroom, and followed by some tailroom
+ * - mbufs are not chained
+ */
+
+#define RTE_PKTMBUF_HEADROOM    128
+#define SHIM_PKTMBUF_TAILROOM   64
+
+#define PKT_TX_IP_CKSUM         (1ULL << 54)
+#define PKT_TX_IPV4             (1ULL << 55)
+
+typedef uint64_t phys_addr_t;
+
+/* mbufs are allocated with shim_pktmbuf_alloc() rather than from a pool */
+struct rte_mempool;
+
+struct rte_mbuf {
+    void *buf_addr;
+    uint16_t data_off;
+    uint16_t buf_len;
+    uint16_t data_len;
+    uint32_t pkt_len;
+    uint16_t port;
+    uint64_t ol_flags;
+    uint64_t l2_len:7;
+    uint64_t l3_len:9;
+    uint64_t udata64;
+};
+
+#define rte_pktmbuf_mtod_offset(m, t, o)                                       \
+    ((t)((char *)(m)->buf_addr + (m)->data_off + (o)))
+#define rte_pktmbuf_mtod(m, t)  rte_pktmbuf_mtod_offset(m, t, 0)
+#define rte_pktmbuf_mtophys_offset(m, o)                                       \
+    ((phys_addr_t)(uintptr_t)rte_pktmbuf_mtod_offset(m, char *, o))
+#define rte_pktmbuf_data_len(m) ((m)->data_len)
+#define rte_pktmbuf_pkt_len(m)  ((m)->pkt_len)
+
+static inline struct rte_mbuf *
+shim_pktmbuf_alloc(uint16_t data_len)
+{
+    uint16_t buf_len = RTE_PKTMBUF_HEADROOM + data_len + SHIM_PKTMBUF_TAILROOM;
+    struct rte_mbuf *m = calloc(1, sizeof(*m) + buf_len);
+
+    if (m != NULL) {
+        m->buf_addr = &m[1];
+        m->data_off = RTE_PKTMBUF_HEADROOM;
+        m->buf_len = buf_len;
+        m->data_len = data_len;
+        m->pkt_len = data_len;
+    }
+
+    return m;
+}
+
+static inline char *
+rte_pktmbuf_prepend(struct rte_mbuf *m, uint16_t len)
+{
+    if (unlikely(len > m->data_off))
+        return NULL;
+
+    m->data_off -= len;
+    m->data_len += len;
+    m->pkt_len += len;
+
+    return rte_pktmbuf_mtod(m, char *);
+}
+
+static inline char *
+rte_pktmbuf_append(struct rte_mbuf *m, uint16_t len)
+{
+    char *tail = rte_pktmbuf_mtod_offset(m, char *, m->data_len);
+
+    if (unlikely(m->data_off + m->data_len + len > m->buf_len))
+        return NULL;
+
+    m->data_len += len;
+    m->pkt_len += len;
+
+    return tail;
+}
+
+static inline char *
+rte_pktmbuf_adj(struct rte_mbuf *m, uint16_t len)
+{
+    if (unlikely(len > m->data_len))
+        return NULL;
+
+    m->data_off += len;
+    m->data_len -= len;
+    m->pkt_len -= len;
+
+    return rte_pktmbuf_mtod(m, char *);
+}
+
+static inline int
+rte_pktmbuf_trim(struct rte_mbuf *m, uint16_t len)
+{
+    if (unlikely(len > m->data_len))
+        return -1;
+
+    m->data_len -= len;
+    m->pkt_len -= len;
+
+    return 0;
+}
+
+static inline int
+rte_pktmbuf_linearize(struct rte_mbuf *m)
+{
+    RTE_SET_USED(m);
+
+    return 0;
+}
+
+static inline void
+rte_pktmbuf_free(struct rte_mbuf *m)
+{
+    free(m);
+}
+
+/**********************************************************
+ * rte_ring.h
+ * - single producer, single consumer, which is how the SWQs are used
+ */
+
+#define RING_F_SP_ENQ           0x0001
+#define RING_F_SC_DEQ           0x0002
+
+struct rte_ring {
+    unsigned size;
+    unsigned mask;
+    volatile unsigned head __rte_cache_aligned;
+    volatile unsigned tail __rte_cache_aligned;
+    void *objs[] __rte_cache_aligned;
+};
+
+/* count must be a power of 2, and the ring holds count - 1 objects */
+static inline struct rte_ring *
+rte_ring_create(const char *name, unsigned count, int socket_id,
+                unsigned flags)
+{
+    struct rte_ring *r;
+
+    RTE_SET_USED(flags);
+
+    if (count == 0 || (count & (count - 1)) != 0)
+        return NULL;
+
+    r = rte_zmalloc_socket(name, sizeof(*r) + count * sizeof(void *),
+                           RTE_CACHE_LINE_SIZE, socket_id);
+    if (r != NULL) {
+        r->size = count;
+        r->mask = count - 1;
+    }
+
+    return r;
+}
+
+static inline void
+rte_ring_free(struct rte_ring *r)
+{
+    rte_free(r);
+}
+
+static inline unsigned
+rte_ring_sp_enqueue_burst(struct rte_ring *r, void * const *obj_table,
+                          unsigned n, unsigned *free_space)
+{
+    unsigned head = r->head;
+    unsigned tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    unsigned room = r->mask - (head - tail);
+    unsigned i;
+
+    n = RTE_MIN(n, room);
+    for (i = 0; i < n; i++)
+        r->objs[(head + i) & r->mask] = obj_table[i];
+    __atomic_store_n(&r->head, head + n, __ATOMIC_RELEASE);
+
+    if (free_space != NULL)
+        *free_space = room - n;
+
+    return n;
+}
+
+static inline unsigned
+rte_ring_sc_dequeue_burst(struct rte_ring *r, void **obj_table,
+                          unsigned n, unsigned *available)
+{
+    unsigned tail = r->tail;
+    unsigned head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    unsigned entries = head - tail;
+    unsigned i;
+
+    n = RTE_MIN(n, entries);
+    for (i = 0; i < n; i++)
+        obj_table[i] = r->objs[(tail + i) & r->mask];
+    __atomic_store_n(&r->tail, tail + n, __ATOMIC_RELEASE);
+
+    if (available != NULL)
+        *available = entries - n;
+
+    return n;
+}
+
+static inline unsigned
+rte_ring_count(const struct rte_ring *r)
+{
+    return r->head - r->tail;
+}
+
+/**********************************************************
+ * rte_ethdev.h, rte_port_ethdev.h
+ * - the tests which poll an RXQ define rte_eth_rx_burst(), and the
+ *   tests which transmit define rte_eth_tx_buffer() and
+ *   rte_eth_tx_buffer_flush()
+ */
+
+struct rte_eth_dev_tx_buffer;
+
+uint16_t
+rte_eth_rx_burst(uint8_t port_id, uint16_t queue_id,
+                 struct rte_mbuf **rx_pkts, const uint16_t nb_pkts);
+
+uint16_t
+rte_eth_tx_buffer(uint8_t port_id, uint16_t queue_id,
+                  struct rte_eth_dev_tx_buffer *buffer,
+                  struct rte_mbuf *tx_pkt);
+
+uint16_t
+rte_eth_tx_buffer_flush(uint8_t port_id, uint16_t queue_id,
+                        struct rte_eth_dev_tx_buffer *buffer);
+
+struct rte_port_ethdev_reader_params {
+    uint16_t port_id;
+    uint16_t queue_id;
+};
+
+struct rte_port_ethdev_writer_params {
+    uint16_t port_id;
+    uint16_t queue_id;
+    uint32_t tx_burst_sz;
+};
+
+struct rte_port_ethdev_writer_nodrop_params {
+    uint16_t port_id;
+    uint16_t queue_id;
+    uint32_t tx_burst_sz;
+    uint32_t n_retries;
+};
+
+/**********************************************************
+ * rte_cryptodev.h, rte_crypto.h
+ * - the xforms and ops are set up by the sources under test, but
+ *   never processed, as the tests which run the crypto use the
+ *   inline engine
+ */
+
+struct rte_cryptodev_sym_session;
+
+enum rte_crypto_sym_xform_type {
+    RTE_CRYPTO_SYM_XFORM_NOT_SPECIFIED = 0,
+    RTE_CRYPTO_SYM_XFORM_AUTH,
+    RTE_CRYPTO_SYM_XFORM_CIPHER,
+    RTE_CRYPTO_SYM_XFORM_AEAD,
+};
+
+enum rte_crypto_aead_algorithm {
+    RTE_CRYPTO_AEAD_AES_CCM = 1,
+    RTE_CRYPTO_AEAD_AES_GCM,
+};
+
+enum rte_crypto_aead_operation {
+    RTE_CRYPTO_AEAD_OP_ENCRYPT,
+    RTE_CRYPTO_AEAD_OP_DECRYPT,
+};
+
+struct rte_crypto_aead_xform {
+    enum rte_crypto_aead_operation op;
+    enum rte_crypto_aead_algorithm algo;
+    struct {
+        uint8_t *data;
+        uint16_t length;
+    } key;
+    struct {
+        uint16_t offset;
+        uint16_t length;
+    } iv;
+    uint16_t digest_length;
+    uint16_t aad_length;
+};
+
+struct rte_crypto_sym_xform {
+    struct rte_crypto_sym_xform *next;
+    enum rte_crypto_sym_xform_type type;
+    struct rte_crypto_aead_xform aead;
+};
+
+enum rte_crypto_op_status {
+    RTE_CRYPTO_OP_STATUS_SUCCESS,
+    RTE_CRYPTO_OP_STATUS_NOT_PROCESSED,
+    RTE_CRYPTO_OP_STATUS_ERROR,
+};
+
+struct rte_crypto_sym_op {
+    struct rte_mbuf *m_src;
+    struct rte_cryptodev_sym_session *session;
+    struct {
+        struct {
+            uint32_t offset;
+            uint32_t length;
+        } data;
+        struct {
+            uint8_t *data;
+            phys_addr_t phys_addr;
+        } digest;
+        struct {
+            uint8_t *data;
+            phys_addr_t phys_addr;
+        } aad;
+    } aead;
+};
+
+struct rte_crypto_op {
+    uint8_t status;
+    struct rte_crypto_sym_op *sym;
+};
+
+#define rte_crypto_op_ctod_offset(c, t, o)                                     \
+    ((t)((char *)(c) + (o)))
+#define rte_crypto_op_ctophys_offset(c, o)                                     \
+    ((phys_addr_t)(uintptr_t)rte_crypto_op_ctod_offset(c, char *, o))
+
+static inline void
+rte_crypto_op_free(struct rte_crypto_op *op)
+{
+    free(op);
+}
+
+static inline int
+rte_crypto_op_attach_sym_session(struct rte_crypto_op *op,
+                                 struct rte_cryptodev_sym_session *sess)
+{
+    op->sym->session = sess;
+
+    return 0;
+}
+
+/**********************************************************
+ * rte_hash.h, rte_jhash.h
+ * - a linearly probed table of key slot indexes, the slots being
+ *   allocated from a free list, so that the positions returned are
+ *   below the number of entries like DPDK's
+ * - deletes shift the following keys back rather than leave
+ *   tombstones, so churn does not slow the lookups down
+ * - lookups racing with a writer may miss, or not return, as the
+ *   store's own sequence numbers are there to retry them
+ */
+
+#define RTE_HASH_NAMESIZE           32
+#define RTE_HASH_LOOKUP_BULK_MAX    64
+
+typedef uint32_t hash_sig_t;
+typedef uint32_t (*rte_hash_function)(const void *key, uint32_t key_len,
+                                      uint32_t init_val);
+
+struct rte_hash_parameters {
+    const char *name;
+    uint32_t entries;
+    uint32_t reserved;
+    uint32_t key_len;
+    rte_hash_function hash_func;
+    uint32_t hash_func_init_val;
+    int socket_id;
+    uint8_t extra_flag;
+};
+
+struct rte_hash;
+
+struct rte_hash *
+rte_hash_create(const struct rte_hash_parameters *params);
+
+void
+rte_hash_free(struct rte_hash *h);
+
+hash_sig_t
+rte_hash_hash(const struct rte_hash *h, const void *key);
+
+int32_t
+rte_hash_add_key(const struct rte_hash *h, const void *key);
+
+int32_t
+rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
+                           hash_sig_t sig);
+
+int32_t
+rte_hash_del_key(const struct rte_hash *h, const void *key);
+
+int32_t
+rte_hash_lookup(const struct rte_hash *h, const void *key);
+
+int32_t
+rte_hash_lookup_with_hash(const struct rte_hash *h, const void *key,
+                          hash_sig_t sig);
+
+int
+rte_hash_lookup_bulk(const struct rte_hash *h, const void **keys,
+                     uint32_t num_keys, int32_t *positions);
+
+int32_t
+rte_hash_iterate(const struct rte_hash *h, const void **key, void **data,
+                 uint32_t *next);
+
+/* FNV-1a, finished with a murmur3 mix */
+static inline uint32_t
+rte_jhash(const void *key, uint32_t length, uint32_t initval)
+{
+    const uint8_t *k = key;
+    uint32_t h = 2166136261u ^ initval;
+    uint32_t i;
+
+    for (i = 0; i < length; i++)
+        h = (h ^ k[i]) * 16777619u;
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+#define rte_hash_crc(key, length, initval) rte_jhash(key, length, initval)
+
+#endif // __INCLUDE_DPDK_SHIM_H__
@@ -0,0 +1,300 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * GTK rekey test
+ * - the store (store.c) and the vAP's GTK slots (vap.h) are the real
+ *   ones, the SAs are mocked, see mocks.h
+ * - a downlink thread gets the TX GTK of the vAP with
+ *   vap_gtk_encrypt_data_get() in a store read section, as it would
+ *   for each group frame, and checks the SA, counter and index it gets
+ *   are those of one slot: the key installed in the slot of the index,
+ *   and the next PN of that key
+ * - it then checks the key does not change under it before it leaves
+ *   the read section
+ * - the controller installs GTK 1, then GTK 2, and so on, each in the
+ *   slot not used for TX, switching TX to it, and checks the PN of the
+ *   other slot is not reset by the install, and that the TX GTK cannot
+ *   be retired
+ * - the GTKs are installed in pairs, each while the downlink is in its
+ *   read section, so that the second replaces the GTK it may still
+ *   hold
+ * - every few rekeys, the GTK kept for RX is retired before the next
+ *   install
+ * - last, checks no sessions are left behind once the vAP is deleted
+ */
+
+#include <pthread.h>
+
+#include "r-wpa_global_vars.h"
+#include "key.h"
+#include "ccmp_sa.h"
+#include "vap.h"
+#include "store.h"
+
+#define NB_REKEYS       2000
+#define READS_PER_REKEY 32
+#define RETIRE_EVERY    4
+
+#define LCORE_CONTROL   0
+#define LCORE_DOWNLINK  1
+
+#define NB_GTKS         2
+
+static struct ether_addr vap_addr = {
+    .addr_bytes = { 0x06, 0, 0, 0, 0, 1 } };
+
+static volatile int stop;
+static volatile int gtk_installed;
+static volatile int in_section;
+static volatile uint64_t nb_reads;
+static uint64_t nb_no_key, nb_mixed, nb_wrong_pn, nb_key_changed;
+
+/* the key of each install: its slot, then a generation number */
+static void
+key_build(uint8_t *key, uint8_t gtk_index, uint32_t gen)
+{
+    memset(key, 0, CCMP_128_KEY_LEN);
+    key[0] = gtk_index;
+    memcpy(&key[1], &gen, sizeof(gen));
+}
+
+static uint32_t
+key_gen(const uint8_t *key)
+{
+    uint32_t gen;
+
+    memcpy(&gen, &key[1], sizeof(gen));
+
+    return gen;
+}
+
+/*
+ * Downlink
+ * - the only one to take PNs, so it knows the next PN of each key
+ */
+static void *
+downlink_main(void *arg)
+{
+    uint32_t gen[NB_GTKS] = { 0 };
+    counter_val_t last_pn[NB_GTKS] = { 0 };
+    uint8_t key[CCMP_128_KEY_LEN];
+    struct vap_elem *vap;
+    struct ccmp_sa *sa;
+    counter_val_t pn;
+    uint8_t gtk_index, rd, slot;
+    int keyed;
+
+    RTE_SET_USED(arg);
+
+    shim_lcore_id_set(LCORE_DOWNLINK);
+
+    while (!stop) {
+        keyed = gtk_installed;
+        rte_smp_rmb();
+
+        rd = store_read_lock();
+        in_section = 1;
+        vap = store_vap_lookup(&vap_addr);
+        sa = NULL;
+        if (vap != NULL)
+            vap_gtk_encrypt_data_get(vap, &sa, &pn, &gtk_index);
+
+        if (sa == NULL) {
+            if (keyed)
+                nb_no_key++;
+            in_section = 0;
+            store_read_unlock(rd);
+            rte_pause();
+            continue;
+        }
+
+        memcpy(key, sa->cold->tk, CCMP_128_KEY_LEN);
+        slot = gtk_index - GTK1;
+
+        /* the SA, PN and index of one slot */
+        if (sa != vap_gtk_sa_select(vap, gtk_index) ||
+            key[0] != gtk_index) {
+            nb_mixed++;
+        } else {
+            /* each install restarts the PN of its slot */
+            if (key_gen(key) != gen[slot]) {
+                gen[slot] = key_gen(key);
+                last_pn[slot] = ENCRYPT_CTR_DEFAULT_VAL;
+            }
+            if (pn != last_pn[slot] + 1)
+                nb_wrong_pn++;
+            last_pn[slot] = pn;
+        }
+
+        /* let the controller run, it must wait for this section */
+        rte_pause();
+
+        if (sa->tk_len != CCMP_128_KEY_LEN ||
+            memcmp(sa->cold->tk, key, CCMP_128_KEY_LEN) != 0)
+            nb_key_changed++;
+        in_section = 0;
+        store_read_unlock(rd);
+
+        nb_reads++;
+        rte_pause();
+    }
+
+    return NULL;
+}
+
+/* install the GTK of rekey n in its slot and switch TX to it */
+static int
+rekey(struct vap_elem *vap, uint32_t n)
+{
+    uint8_t gtk_index = (n & 1) ? GTK2 : GTK1;
+    uint8_t other = (n & 1) ? GTK1 : GTK2;
+    counter_t *other_pn = vap_gtk_counter_select(vap, other);
+    uint8_t key[CCMP_128_KEY_LEN];
+    counter_val_t before;
+
+    /* the GTK kept for RX is removed once no longer needed */
+    if (n % RETIRE_EVERY == RETIRE_EVERY - 1) {
+        if (vap_gtk_retire(vap, gtk_index) != RWPA_STS_OK ||
+            vap_gtk_sa_select(vap, gtk_index)->tk_len != 0) {
+            fprintf(stderr, "Rekey %u: GTK %u kept for RX not retired\n",
+                    n, gtk_index);
+            return -1;
+        }
+    }
+
+    key_build(key, gtk_index, n + 1);
+    before = counter_get(other_pn);
+
+    if (vap_gtk_set(vap, gtk_index, key, CCMP_128_KEY_LEN,
+                    CCMP_CIPHER_CCMP, TRUE) != RWPA_STS_OK) {
+        fprintf(stderr, "Rekey %u: cannot install GTK %u\n", n, gtk_index);
+        return -1;
+    }
+
+    if (counter_get(other_pn) < before) {
+        fprintf(stderr, "Rekey %u: PN of GTK %u reset by the install of "
+                "GTK %u\n", n, other, gtk_index);
+        return -1;
+    }
+
+    if (vap->current_gtk_index != gtk_index) {
+        fprintf(stderr, "Rekey %u: TX not switched to GTK %u\n",
+                n, gtk_index);
+        return -1;
+    }
+
+    /* the TX GTK can only be replaced */
+    if (vap_gtk_retire(vap, gtk_index) == RWPA_STS_OK) {
+        fprintf(stderr, "Rekey %u: TX GTK %u retired\n", n, gtk_index);
+        return -1;
+    }
+
+    rte_smp_wmb();
+    gtk_installed = 1;
+
+    return 0;
+}
+
+int
+main(void)
+{
+    struct app_store_params store_params = {
+        .vaps_max = 4,
+        .stas_max = 16,
+    };
+    struct app_addr_params addr_params;
+    struct vap_elem *vap;
+    pthread_t downlink;
+    uint64_t reads;
+    uint32_t n;
+    int sts = 0;
+
+    shim_lcore_id_set(LCORE_CONTROL);
+    shim_lcore_count = 2;
+
+    memset(&addr_params, 0, sizeof(addr_params));
+    store_init(0, &store_params, &addr_params);
+
+    vap = store_vap_add(&vap_addr);
+    if (vap == NULL)
+        rte_exit(EXIT_FAILURE, "Cannot add vAP\n");
+
+    pthread_create(&downlink, NULL, downlink_main, NULL);
+
+    for (n = 0; n < NB_REKEYS && sts == 0; n++) {
+        /* let the downlink use each pair of GTKs */
+        if (n > 0 && n % 2 == 0) {
+            reads = nb_reads;
+            while (nb_reads < reads + READS_PER_REKEY)
+                rte_pause();
+        }
+
+        /*
+         * rekey while the downlink is in its read section, so that
+         * the second of each pair replaces the GTK it may still hold
+         */
+        while (n > 0 && !in_section)
+            rte_pause();
+
+        if (rekey(vap, n) != 0)
+            sts = 1;
+    }
+
+    stop = 1;
+    pthread_join(downlink, NULL);
+
+    printf("%u rekeys: %" PRIu64 " GTKs read, %" PRIu64 " no key, %" PRIu64
+           " mixed, %" PRIu64 " wrong PN, %" PRIu64 " key changed\n",
+           n, (uint64_t)nb_reads, nb_no_key, nb_mixed, nb_wrong_pn,
+           nb_key_changed);
+
+    if (nb_no_key != 0 || nb_mixed != 0 || nb_wrong_pn != 0 ||
+        nb_key_changed != 0)
+        sts = 1;
+
+    store_vap_del(&vap_addr);
+
+    if (mock_sessions_live() != 0) {
+        fprintf(stderr, "%" PRId64 " sessions left behind\n",
+                mock_sessions_live());
+        sts = 1;
+    }
+
+    store_cleanup();
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
@@ -0,0 +1,134 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include "mocks.h"
+#include "ap_config.h"
+
+#ifndef MOCKS_REAL_CCMP_SA
+
+/*
+ * the sessions are not used, only counted, each SA with a key holding
+ * one in its first slot, which is this
+ */
+static rte_atomic64_t sessions_live;
+static char mock_session;
+
+enum rwpa_status
+ccmp_sa_init(const uint8_t    *tk,
+             const uint8_t     tk_len,
+             enum ccmp_cipher  cipher,
+             struct ccmp_sa   *sa)
+{
+    if (unlikely(tk == NULL || sa == NULL || sa->cold == NULL ||
+                 cipher >= CCMP_CIPHER_MAX))
+        return RWPA_STS_ERR;
+
+    if (unlikely(!(tk_len == CCMP_128_KEY_LEN ||
+                   tk_len == CCMP_256_KEY_LEN)))
+        return RWPA_STS_ERR;
+
+    rte_memcpy(sa->cold->tk, tk, tk_len);
+    sa->cipher = (uint8_t)cipher;
+    sa->mic_len = (cipher == CCMP_CIPHER_GCMP ?
+                       GCMP_MIC_LEN : tk_len >> 1);
+
+    if (sa->sess[0] == NULL) {
+        sa->sess[0] = (struct sess_cache_entry *)&mock_session;
+        rte_atomic64_inc(&sessions_live);
+    }
+
+    /* tk_len is set last, as the data path treats 0 as no key */
+    rte_smp_wmb();
+    sa->tk_len = tk_len;
+
+    return RWPA_STS_OK;
+}
+
+void
+ccmp_sa_reset(struct ccmp_sa *sa)
+{
+    unsigned i;
+
+    if (unlikely(sa == NULL))
+        return;
+
+    for (i = 0; i < CCMP_SESSION_TYPE_MAX; i++) {
+        if (sa->sess[i] != NULL) {
+            sa->sess[i] = NULL;
+            rte_atomic64_dec(&sessions_live);
+        }
+    }
+
+    if (sa->cold != NULL)
+        memset(sa->cold, 0, sizeof(struct ccmp_sa_cold));
+    sa->tk_len = 0;
+    sa->cipher = 0;
+    sa->mic_len = 0;
+}
+
+struct sess_cache_entry *
+ccmp_sa_session_select(struct ccmp_sa *sa,
+                       enum ccmp_op    op,
+                       uint8_t         aad_len)
+{
+    RTE_SET_USED(sa);
+    RTE_SET_USED(op);
+    RTE_SET_USED(aad_len);
+
+    return NULL;
+}
+
+int64_t
+mock_sessions_live(void)
+{
+    return rte_atomic64_read(&sessions_live);
+}
+
+#endif // MOCKS_REAL_CCMP_SA
+
+/* no vAP is preconfigured, the defaults are used */
+uint8_t
+ap_config_get(struct ether_addr bssid,
+              struct ether_addr *ap_tun_mac,
+              uint32_t *ap_tun_ip,
+              uint16_t *ap_tun_port)
+{
+    RTE_SET_USED(bssid);
+    RTE_SET_USED(ap_tun_mac);
+    RTE_SET_USED(ap_tun_ip);
+    RTE_SET_USED(ap_tun_port);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Mocks for the unit tests
+ * - included ahead of each source under test (gcc -include), so that
+ *   the headers mocked here are skipped by their include guards
+ * - app.h: only the params the sources under test read
+ * - ccmp_sa.h: an SA whose key is what the tests check the frames
+ *   against, and whose sessions are counted rather than created, so
+ *   that a test can check none are left behind
+ *   - not with MOCKS_REAL_CCMP_SA, for the tests running the real
+ *     ccmp_sa.c and ccmp.c
+ */
+
+#ifndef __INCLUDE_MOCKS_H__
+#define __INCLUDE_MOCKS_H__
+
+#include "dpdk_shim.h"
+
+#include "r-wpa_global_vars.h"
+#include "key.h"
+#include "ccmp_defns.h"
+#include "thread.h"
+
+/**********************************************************
+ * app.h
+ */
+#define __INCLUDE_APP_H__
+
+#define APP_MAX_LINKS           16
+#define APP_MAX_HWQ_IN          128
+#define APP_MAX_PKTQ_SWQ        64
+#define APP_MAX_THREADS         16
+
+struct app_link_params {
+    char *name;
+    struct ether_addr mac_addr;
+};
+
+struct app_pktq_hwq_in_params {
+    char *name;
+};
+
+struct app_pktq_swq_params {
+    char *name;
+    uint32_t parsed;
+    uint32_t size;
+    uint32_t burst_read;
+    uint32_t burst_write;
+    uint32_t cpu_socket_id;
+};
+
+struct app_crypto_params {
+    int async;
+    enum ccmp_engine engine;
+};
+
+struct app_addr_params {
+    uint16_t vnfd_port_to_ap;
+    uint32_t vnfd_ip_to_ap;
+    uint32_t vnfd_ip_to_wag;
+    uint32_t wag_tun_ip;
+    struct ether_addr wag_tun_mac;
+    struct ether_addr vap_tun_def_mac;
+    uint32_t vap_tun_def_ip;
+    uint16_t vap_tun_def_port;
+};
+
+struct app_misc_params {
+    uint32_t uplink_pmd_us;
+    uint32_t uplink_tls_us;
+    uint32_t no_wag;
+};
+
+struct app_store_params {
+    uint32_t vaps_max;
+    uint32_t stas_max;
+    uint32_t socket_id;
+    uint32_t ptk_rx_overlap_ms;
+    uint32_t sta_idle_timeout_s;
+};
+
+struct app_params {
+    struct app_link_params link_params[APP_MAX_LINKS];
+    struct app_pktq_hwq_in_params hwq_in_params[APP_MAX_HWQ_IN];
+    struct app_crypto_params crypto_params;
+    struct app_addr_params addr_params;
+    struct app_misc_params misc_params;
+    struct app_store_params store_params;
+    struct app_pktq_swq_params swq_params[APP_MAX_PKTQ_SWQ];
+    struct app_thread_params thread_params[APP_MAX_THREADS];
+    uint32_t n_pktq_swq;
+    uint32_t n_threads;
+};
+
+static inline struct app_thread_params *
+app_swq_get_reader(struct app_params *app, struct app_pktq_swq_params *swq)
+{
+    uint32_t pos = swq - app->swq_params;
+    uint32_t i, j;
+
+    for (i = 0; i < app->n_threads; i++) {
+        struct app_thread_params *p = &app->thread_params[i];
+
+        for (j = 0; j < p->n_pktq_in; j++)
+            if (p->pktq_in[j].type == APP_PKTQ_IN_SWQ &&
+                p->pktq_in[j].id == pos)
+                return p;
+    }
+
+    return NULL;
+}
+
+#ifndef MOCKS_REAL_CCMP_SA
+
+/**********************************************************
+ * ccmp_sa.h
+ */
+#define __INCLUDE_CCMP_SA_H__
+
+struct sess_cache_entry;
+
+#define CCMP_SESSION_TYPE_MAX   8
+
+struct ccmp_sa_cold {
+    uint8_t tk[KEY_LEN_MAX];
+} __rte_cache_aligned;
+
+struct ccmp_sa {
+    uint8_t tk_len;
+    uint8_t cipher;
+    uint8_t mic_len;
+
+    struct ccmp_sa_cold *cold;
+
+    struct sess_cache_entry *sess[CCMP_SESSION_TYPE_MAX];
+};
+
+static inline void
+ccmp_sa_bind(struct ccmp_sa *sa, struct ccmp_sa_cold *cold)
+{
+    sa->cold = cold;
+}
+
+/* copies the key, then sets tk_len, like the real one, and takes a session */
+enum rwpa_status
+ccmp_sa_init(const uint8_t    *tk,
+             const uint8_t     tk_len,
+             enum ccmp_cipher  cipher,
+             struct ccmp_sa   *sa);
+
+/* releases the sessions, then clears the key, like the real one */
+void
+ccmp_sa_reset(struct ccmp_sa *sa);
+
+struct sess_cache_entry *
+ccmp_sa_session_select(struct ccmp_sa *sa,
+                       enum ccmp_op    op,
+                       uint8_t         aad_len);
+
+/* sessions taken by ccmp_sa_init() and not yet released */
+int64_t
+mock_sessions_live(void);
+
+#endif // MOCKS_REAL_CCMP_SA
+
+#endif // __INCLUDE_MOCKS_H__
@@ -0,0 +1,661 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * PTK rekey under traffic test
+ * - the store (store.c) and the stations' PTK slots (station.h) are
+ *   the real ones, the SAs are mocked, see mocks.h
+ * - a radio thread sends uplink frames from NB_STAS stations, each
+ *   tagged with the key it was encrypted with, and checks the
+ *   downlink frames it receives were encrypted with the key it holds
+ *   for their KeyID
+ * - an uplink thread looks the stations up and gets the PTK SAs of
+ *   the frames' KeyIDs in a store read section, does the replay
+ *   check, and then "decrypts" each frame outside of the read section,
+ *   holding a store reference, as it would be with the crypto op in
+ *   flight
+ * - a downlink thread encrypts frames to the stations with their TX
+ *   PTKs
+ * - the controller rekeys the stations, as the Extended Key ID 4-way
+ *   handshake does: the new PTK is set for RX in the slot not used for
+ *   TX and installed at the station, then TX is switched, the old PTK
+ *   being left valid for RX for the overlap, while the station goes on
+ *   sending with it for TX_SWITCH_DELAY_US
+ * - paced, with each station rekeyed well after the frames with its
+ *   retired PTK are gone, no frame may fail to decrypt, on either
+ *   side, and frames with the old PTK must have been decrypted in the
+ *   overlap
+ * - then rekeyed back to back, frames with a retired PTK are lost, but
+ *   the key of a frame being decrypted must never change under it
+ * - last, checks the old PTK is no longer valid for RX once the overlap
+ *   is over, that replays are still detected, and that no sessions are
+ *   left behind once the stations are deleted
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "r-wpa_global_vars.h"
+#include "ccmp_sa.h"
+#include "station.h"
+#include "store.h"
+#include "store_helpers.h"
+
+#define NB_STAS             4
+#define PTK_RX_OVERLAP_MS   100
+#define TX_SWITCH_DELAY_US  2000
+#define RING_SIZE           256
+#define BURST               32
+
+#define PACED_REKEYS        400
+#define PACED_INTERVAL_US   10000
+#define STORM_REKEYS        2000
+
+#define LCORE_CONTROL       0
+#define LCORE_UPLINK        1
+#define LCORE_DOWNLINK      2
+
+struct frame {
+    uint32_t sta;
+    uint8_t key_id;
+    uint64_t pn;
+    uint8_t tag[CCMP_128_KEY_LEN];
+    uint64_t sent_tsc;
+};
+
+/* the station side of each station, only touched by the radio thread */
+struct radio_sta {
+    int has_key;
+    uint8_t keys[PTK_KEY_ID_NUM][CCMP_128_KEY_LEN];
+    uint64_t pn[PTK_KEY_ID_NUM];
+    uint8_t tx_key_id;
+    uint8_t next_tx_key_id;
+    uint64_t tx_switch_tsc;
+};
+
+/* new PTK from the controller to the radio, pending until installed */
+struct radio_mailbox {
+    volatile int pending;
+    uint32_t sta;
+    uint8_t key_id;
+    uint8_t key[CCMP_128_KEY_LEN];
+};
+
+static struct ether_addr vap_addr = {
+    .addr_bytes = { 0x06, 0, 0, 0, 0, 1 } };
+static struct ether_addr sta_addrs[NB_STAS];
+
+static struct radio_sta radio_stas[NB_STAS];
+static struct radio_mailbox mailbox;
+
+/* the controller's view of the TX KeyIDs, and the rekeys done */
+static uint8_t ctl_tx_key_id[NB_STAS];
+static uint32_t nb_rekeys;
+
+static struct rte_ring *ul_ring;
+static struct rte_ring *dl_ring;
+
+static volatile int stop;
+static volatile int radio_running;
+static volatile int radio_done;
+static volatile int downlink_done;
+
+/* results of a run */
+static uint64_t ul_ok, ul_old_key, ul_no_key, ul_replay, ul_bad_key;
+static uint64_t ul_key_changed, ul_not_found, ul_max_latency;
+static uint64_t dl_sent, dl_no_key, dl_ok, dl_bad_key;
+
+/*
+ * Radio
+ */
+static void
+radio_key_install(void)
+{
+    struct radio_sta *rs;
+
+    if (!mailbox.pending)
+        return;
+
+    rte_smp_rmb();
+    rs = &(radio_stas[mailbox.sta]);
+    memcpy(rs->keys[mailbox.key_id], mailbox.key, CCMP_128_KEY_LEN);
+    rs->pn[mailbox.key_id] = 0;
+
+    /* TX switches once the 4-way handshake is over */
+    if (rs->has_key) {
+        rs->next_tx_key_id = mailbox.key_id;
+        rs->tx_switch_tsc = rte_rdtsc() +
+            TX_SWITCH_DELAY_US * rte_get_tsc_hz() / 1000000;
+    } else {
+        rs->tx_key_id = mailbox.key_id;
+        rs->has_key = 1;
+    }
+
+    rte_smp_wmb();
+    mailbox.pending = 0;
+}
+
+static unsigned
+radio_receive(void)
+{
+    struct frame *frames[BURST];
+    unsigned nb, i;
+
+    nb = rte_ring_sc_dequeue_burst(dl_ring, (void **)frames, BURST, NULL);
+    for (i = 0; i < nb; i++) {
+        struct radio_sta *rs = &(radio_stas[frames[i]->sta]);
+
+        if (memcmp(rs->keys[frames[i]->key_id], frames[i]->tag,
+                   CCMP_128_KEY_LEN) == 0)
+            dl_ok++;
+        else
+            dl_bad_key++;
+        free(frames[i]);
+    }
+
+    return nb;
+}
+
+static unsigned
+radio_send(void)
+{
+    struct frame *frames[BURST];
+    uint64_t now = rte_rdtsc();
+    unsigned nb, i;
+
+    for (nb = 0; nb < BURST; nb++) {
+        uint32_t s = test_rand() % NB_STAS;
+        struct radio_sta *rs = &(radio_stas[s]);
+
+        /* not associated yet */
+        if (!rs->has_key)
+            break;
+
+        if (rs->tx_switch_tsc != 0 && now >= rs->tx_switch_tsc) {
+            rs->tx_key_id = rs->next_tx_key_id;
+            rs->tx_switch_tsc = 0;
+        }
+
+        frames[nb] = malloc(sizeof(struct frame));
+        frames[nb]->sta = s;
+        frames[nb]->key_id = rs->tx_key_id;
+        frames[nb]->pn = ++rs->pn[rs->tx_key_id];
+        memcpy(frames[nb]->tag, rs->keys[rs->tx_key_id], CCMP_128_KEY_LEN);
+        frames[nb]->sent_tsc = now;
+    }
+
+    /* the frames which do not fit are lost on the air, PN gaps are ok */
+    i = rte_ring_sp_enqueue_burst(ul_ring, (void **)frames, nb, NULL);
+    for (; i < nb; i++)
+        free(frames[i]);
+
+    return nb;
+}
+
+static void *
+radio_main(void *arg)
+{
+    RTE_SET_USED(arg);
+
+    shim_lcore_id_set(LCORE_ID_ANY);
+    test_rand_seed(1);
+
+    while (!stop) {
+        unsigned nb = 0;
+
+        radio_key_install();
+        nb += radio_receive();
+        if (rte_ring_count(ul_ring) < RING_SIZE / 2)
+            nb += radio_send();
+        if (nb == 0)
+            rte_pause();
+    }
+
+    rte_smp_wmb();
+    radio_done = 1;
+
+    /* the downlink frames in flight are still decrypted */
+    while (!downlink_done || rte_ring_count(dl_ring) != 0)
+        if (radio_receive() == 0)
+            rte_pause();
+
+    return NULL;
+}
+
+/*
+ * Uplink
+ * - as uplink_thread.c: the SA and the replay check in a read section,
+ *   then the decrypt with a reference held
+ */
+static void
+uplink_burst(struct frame **frames, unsigned nb)
+{
+    struct ether_addr *addrs[BURST];
+    int32_t found[BURST];
+    struct ccmp_sa *sas[BURST];
+    struct frame *decrypt[BURST];
+    uint8_t keys[BURST][CCMP_128_KEY_LEN];
+    unsigned i, nb_decrypt = 0;
+    uint64_t now = rte_rdtsc();
+    uint8_t idx;
+
+    for (i = 0; i < nb; i++)
+        addrs[i] = &(sta_addrs[frames[i]->sta]);
+
+    idx = store_read_lock();
+    store_sta_bulk_lookup(addrs, nb, found);
+
+    for (i = 0; i < nb; i++) {
+        struct sta_elem *sta = store_sta_get(found[i]);
+        struct ccmp_sa *sa = NULL;
+        struct vap_elem *vap;
+        counter_val_t ctr = 0;
+
+        if (now - frames[i]->sent_tsc > ul_max_latency)
+            ul_max_latency = now - frames[i]->sent_tsc;
+
+        if (sta == NULL) {
+            ul_not_found++;
+            continue;
+        }
+
+        sta_decrypt_data_get(sta, frames[i]->key_id, 0, &sa, &ctr, &vap);
+        if (sa == NULL || sa->tk_len == 0) {
+            ul_no_key++;
+            continue;
+        }
+
+        if (frames[i]->pn <= ctr) {
+            ul_replay++;
+            continue;
+        }
+        sta_ptk_decrypt_counter_set(sta, frames[i]->key_id, 0,
+                                    frames[i]->pn);
+
+        /* a retired PTK, in its overlap */
+        if (sta->ptk[frames[i]->key_id].rx_until != 0)
+            ul_old_key++;
+
+        /* the key the crypto op is enqueued with */
+        store_read_ref_get(idx);
+        memcpy(keys[nb_decrypt], sa->cold->tk, CCMP_128_KEY_LEN);
+        sas[nb_decrypt] = sa;
+        decrypt[nb_decrypt++] = frames[i];
+    }
+
+    store_read_unlock(idx);
+
+    /* the crypto ops complete, later */
+    rte_pause();
+
+    for (i = 0; i < nb_decrypt; i++) {
+        if (memcmp(sas[i]->cold->tk, keys[i], CCMP_128_KEY_LEN) != 0)
+            ul_key_changed++;
+        else if (memcmp(keys[i], decrypt[i]->tag, CCMP_128_KEY_LEN) == 0)
+            ul_ok++;
+        else
+            ul_bad_key++;
+    }
+
+    rte_smp_mb();
+    for (i = 0; i < nb_decrypt; i++)
+        store_read_ref_put(idx);
+}
+
+static void *
+uplink_main(void *arg)
+{
+    struct frame *frames[BURST];
+    unsigned nb, i;
+
+    RTE_SET_USED(arg);
+
+    shim_lcore_id_set(LCORE_UPLINK);
+
+    for (;;) {
+        int done = radio_done;
+
+        rte_smp_rmb();
+        nb = rte_ring_sc_dequeue_burst(ul_ring, (void **)frames, BURST, NULL);
+        if (nb == 0) {
+            if (done)
+                break;
+            rte_pause();
+            continue;
+        }
+
+        uplink_burst(frames, nb);
+        for (i = 0; i < nb; i++)
+            free(frames[i]);
+    }
+
+    return NULL;
+}
+
+/*
+ * Downlink
+ * - as downlink_thread.c: the TX PTK SA and PN in a read section, the
+ *   frame being "encrypted" with the key before the section is left
+ */
+static void *
+downlink_main(void *arg)
+{
+    struct frame *frames[BURST];
+    unsigned nb, i;
+    uint8_t idx;
+
+    RTE_SET_USED(arg);
+
+    shim_lcore_id_set(LCORE_DOWNLINK);
+    test_rand_seed(2);
+
+    while (!stop) {
+        if (rte_ring_count(dl_ring) >= RING_SIZE / 2) {
+            rte_pause();
+            continue;
+        }
+
+        idx = store_read_lock();
+        for (nb = 0, i = 0; i < BURST / 4; i++) {
+            uint32_t s = test_rand() % NB_STAS;
+            struct sta_elem *sta = store_sta_lookup(&(sta_addrs[s]));
+            struct ccmp_sa *sa = NULL;
+            struct vap_elem *vap;
+            counter_val_t ctr;
+            uint8_t key_id;
+
+            sta_encrypt_data_get(sta, &sa, &ctr, &vap, &key_id);
+            if (sa == NULL || sa->tk_len == 0) {
+                dl_no_key++;
+                continue;
+            }
+
+            frames[nb] = malloc(sizeof(struct frame));
+            frames[nb]->sta = s;
+            frames[nb]->key_id = key_id;
+            frames[nb]->pn = ctr;
+            memcpy(frames[nb]->tag, sa->cold->tk, CCMP_128_KEY_LEN);
+            nb++;
+        }
+        store_read_unlock(idx);
+
+        i = rte_ring_sp_enqueue_burst(dl_ring, (void **)frames, nb, NULL);
+        dl_sent += i;
+        for (; i < nb; i++)
+            free(frames[i]);
+    }
+
+    rte_smp_wmb();
+    downlink_done = 1;
+
+    return NULL;
+}
+
+/*
+ * Controller
+ */
+
+/* the 4-way handshake, with the new PTK installed at the station */
+static int
+rekey(uint32_t s, uint8_t key_id)
+{
+    struct sta_elem *sta = store_sta_lookup(&(sta_addrs[s]));
+    uint8_t key[CCMP_128_KEY_LEN];
+    uint32_t seq = ++nb_rekeys;
+    unsigned i;
+
+    /* never the key of another rekey */
+    for (i = 0; i < CCMP_128_KEY_LEN; i++)
+        key[i] = (uint8_t)test_rand();
+    memcpy(key, &seq, sizeof(seq));
+
+    if (sta_ptk_rx_set(sta, key_id, key, CCMP_128_KEY_LEN,
+                       CCMP_CIPHER_CCMP) != RWPA_STS_OK) {
+        fprintf(stderr, "Could not set PTK %u for RX\n", key_id);
+        return -1;
+    }
+
+    mailbox.sta = s;
+    mailbox.key_id = key_id;
+    memcpy(mailbox.key, key, CCMP_128_KEY_LEN);
+    rte_smp_wmb();
+    mailbox.pending = 1;
+    while (mailbox.pending) {
+        /* no radio, the station is the controller's */
+        if (!radio_running)
+            radio_key_install();
+        else
+            rte_pause();
+    }
+
+    if (sta_ptk_tx_set(sta, key_id,
+                       store_ptk_rx_overlap_get()) != RWPA_STS_OK) {
+        fprintf(stderr, "Could not switch TX to PTK %u\n", key_id);
+        return -1;
+    }
+    ctl_tx_key_id[s] = key_id;
+
+    return 0;
+}
+
+/*
+ * rekeys the stations in turn, under traffic
+ * - strict, no frame may fail to decrypt
+ */
+static int
+run(const char *name, unsigned rekeys, unsigned interval_us, int strict)
+{
+    pthread_t radio, uplink, downlink;
+    uint64_t start_tsc;
+    unsigned r;
+    int sts = 0;
+
+    ul_ok = ul_old_key = ul_no_key = ul_replay = ul_bad_key = 0;
+    ul_key_changed = ul_not_found = ul_max_latency = 0;
+    dl_sent = dl_no_key = dl_ok = dl_bad_key = 0;
+    stop = radio_done = downlink_done = 0;
+
+    radio_running = 1;
+    rte_smp_mb();
+    pthread_create(&radio, NULL, radio_main, NULL);
+    pthread_create(&uplink, NULL, uplink_main, NULL);
+    pthread_create(&downlink, NULL, downlink_main, NULL);
+
+    start_tsc = rte_rdtsc();
+    for (r = 0; r < rekeys; r++) {
+        uint32_t s = r % NB_STAS;
+
+        if (interval_us != 0)
+            usleep(interval_us);
+
+        if (rekey(s, 1 - ctl_tx_key_id[s]) != 0) {
+            sts = -1;
+            break;
+        }
+    }
+
+    stop = 1;
+    pthread_join(downlink, NULL);
+    pthread_join(radio, NULL);
+    pthread_join(uplink, NULL);
+    radio_running = 0;
+
+    printf("%s: %u rekeys of %u stations in %" PRIu64 " ms\n"
+           "uplink: %" PRIu64 " decrypted (%" PRIu64 " with the old PTK), "
+           "%" PRIu64 " no key, %" PRIu64 " replayed, %" PRIu64 " wrong key, "
+           "%" PRIu64 " key changed, %" PRIu64 " not found, "
+           "max %" PRIu64 " us in flight\n"
+           "downlink: %" PRIu64 " sent, %" PRIu64 " decrypted, %" PRIu64
+           " wrong key, %" PRIu64 " no key\n",
+           name, rekeys, NB_STAS, (rte_rdtsc() - start_tsc) / 1000000,
+           ul_ok, ul_old_key, ul_no_key, ul_replay, ul_bad_key,
+           ul_key_changed, ul_not_found, ul_max_latency / 1000,
+           dl_sent, dl_ok, dl_bad_key, dl_no_key);
+
+    if (ul_key_changed + ul_not_found != 0 || dl_no_key != 0) {
+        fprintf(stderr, "Keys changed under frames in flight\n");
+        sts = -1;
+    }
+
+    if (ul_ok == 0 || dl_ok == 0) {
+        fprintf(stderr, "No traffic\n");
+        sts = -1;
+    }
+
+    if (!strict)
+        return sts;
+
+    if (ul_no_key + ul_replay + ul_bad_key != 0) {
+        fprintf(stderr, "Uplink frames failed to decrypt\n");
+        sts = -1;
+    }
+
+    if (dl_bad_key != 0 || dl_ok != dl_sent) {
+        fprintf(stderr, "Downlink frames failed to decrypt\n");
+        sts = -1;
+    }
+
+    if (ul_ok < (uint64_t)rekeys * BURST || dl_ok < rekeys) {
+        fprintf(stderr, "Too little traffic to test the rekeys\n");
+        sts = -1;
+    }
+
+    if (ul_old_key == 0) {
+        fprintf(stderr, "No frame was decrypted with the old PTK\n");
+        sts = -1;
+    }
+
+    return sts;
+}
+
+/*
+ * with the traffic stopped, the old PTK is valid for RX until the end
+ * of the overlap, and replays are still detected
+ */
+static int
+overlap_check(void)
+{
+    struct sta_elem *sta = store_sta_lookup(&(sta_addrs[0]));
+    uint8_t old = ctl_tx_key_id[0], new = 1 - old;
+    struct ccmp_sa *sa;
+    struct vap_elem *vap;
+    counter_val_t ctr;
+    int sts = 0;
+
+    if (rekey(0, new) != 0)
+        return -1;
+
+    sta_decrypt_data_get(sta, old, 0, &sa, &ctr, &vap);
+    if (sa == NULL || sa->tk_len == 0) {
+        fprintf(stderr, "Old PTK not valid for RX in the overlap\n");
+        sts = -1;
+    }
+
+    usleep((PTK_RX_OVERLAP_MS + 10) * 1000);
+
+    sta_decrypt_data_get(sta, old, 0, &sa, &ctr, &vap);
+    if (sa != NULL) {
+        fprintf(stderr, "Old PTK still valid for RX after the overlap\n");
+        sts = -1;
+    }
+
+    sta_ptk_decrypt_counter_set(sta, new, 0, 100);
+    sta_decrypt_data_get(sta, new, 0, &sa, &ctr, &vap);
+    if (sa == NULL || ctr != 100) {
+        fprintf(stderr, "New PTK's decrypt counter not kept\n");
+        sts = -1;
+    }
+
+    return sts;
+}
+
+int
+main(void)
+{
+    struct app_store_params store_params = {
+        .vaps_max = 4,
+        .stas_max = 16,
+        .ptk_rx_overlap_ms = PTK_RX_OVERLAP_MS,
+    };
+    struct app_addr_params addr_params;
+    uint32_t s;
+    int sts = 0;
+
+    shim_lcore_id_set(LCORE_CONTROL);
+    shim_lcore_count = 3;
+    test_rand_seed(3);
+
+    memset(&addr_params, 0, sizeof(addr_params));
+    store_init(0, &store_params, &addr_params);
+
+    ul_ring = rte_ring_create("UL", RING_SIZE, 0, 0);
+    dl_ring = rte_ring_create("DL", RING_SIZE, 0, 0);
+
+    if (store_vap_add(&vap_addr) == NULL)
+        rte_exit(EXIT_FAILURE, "Cannot add vAP\n");
+
+    /* associated, with their first PTKs, KeyID 0 */
+    for (s = 0; s < NB_STAS; s++) {
+        sta_addrs[s].addr_bytes[0] = 0x02;
+        sta_addrs[s].addr_bytes[5] = (uint8_t)s;
+        if (store_sta_add(&(sta_addrs[s]), &vap_addr) == NULL ||
+            rekey(s, 0) != 0)
+            rte_exit(EXIT_FAILURE, "Cannot add station %u\n", s);
+    }
+
+    if (run("paced", PACED_REKEYS, PACED_INTERVAL_US, 1) != 0)
+        sts = 1;
+
+    if (run("back to back", STORM_REKEYS, 0, 0) != 0)
+        sts = 1;
+
+    if (overlap_check() != 0)
+        sts = 1;
+
+    for (s = 0; s < NB_STAS; s++)
+        store_sta_del(&(sta_addrs[s]));
+    store_vap_del(&vap_addr);
+
+    if (mock_sessions_live() != 0) {
+        fprintf(stderr, "%" PRId64 " sessions left behind\n",
+                mock_sessions_live());
+        sts = 1;
+    }
+
+    store_cleanup();
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
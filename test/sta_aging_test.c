@@ -0,0 +1,376 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Station aging churn soak
+ * - the store (store.c) is the real one, and the SAs are mocked, see
+ *   mocks.h
+ * - the aging clock is driven with a synthetic TSC, one tick per
+ *   second, while stations are added, moved, deleted, deleted with
+ *   their vAP, and seen, at random, with bursts of adds expiring
+ *   together in more than one aging batch
+ * - the stations' last seen ticks are modelled, and on each tick
+ *   exactly the stations idle for IDLE_TIMEOUT ticks must be reported
+ *   expired, with their vAP, and be gone
+ * - store_check() must pass after each tick, and there must be one
+ *   crypto session per station left, i.e. none leaked
+ * - meanwhile a reader looks the stations up, and checks the key of
+ *   a station it found is not reset before it leaves its read section
+ * - build with -DIDLE_TIMEOUT=<ticks> for a timeout longer than the
+ *   aging wheel
+ */
+
+#include <pthread.h>
+
+#include "r-wpa_global_vars.h"
+#include "ccmp_sa.h"
+#include "station.h"
+#include "store.h"
+#include "store_helpers.h"
+
+#ifndef IDLE_TIMEOUT
+#define IDLE_TIMEOUT    5
+#endif
+
+#define NB_TICKS        (IDLE_TIMEOUT * 10 + 1000)
+#define NB_VAPS         4
+#define NB_ADDRS        4096
+#define STAS_MAX        2048
+#define NB_ADDS         (STAS_MAX / (2 * IDLE_TIMEOUT) + 1)
+#define NB_DELS         (NB_ADDS / 4)
+#define ADD_BURST       200
+#define ADD_BURST_EVERY 97
+#define VAP_DEL_EVERY   211
+#define ACTIVE_TICKS    (IDLE_TIMEOUT * 2)
+#define SEEN_PERCENT    70
+
+#define LCORE_CONTROL   0
+#define LCORE_READER    1
+
+static struct ether_addr vap_addrs[NB_VAPS];
+static struct ether_addr sta_addrs[NB_ADDRS];
+
+/* the model: each station's vAP or -1, and the tick it was last seen */
+static int sta_vap[NB_ADDRS];
+static uint32_t sta_last_seen[NB_ADDRS];
+static uint32_t nb_model_stas;
+
+/* the stations reported expired on the current tick */
+static uint32_t expired_addrs[STAS_MAX];
+static int expired_vaps[STAS_MAX];
+static uint32_t nb_expired;
+
+static uint64_t nb_expired_total, nb_seen_total, max_expired;
+static uint64_t nb_added_total, nb_deleted_total, nb_cascaded_total;
+
+static struct test_reader reader = {
+    .addrs = sta_addrs,
+    .nb_addrs = NB_ADDRS,
+    .lcore_id = LCORE_READER,
+};
+
+/* logs what failed, at the tick */
+static int
+fail(const char *what, uint32_t i, uint32_t tick)
+{
+    fprintf(stderr, "Tick %u: ", tick);
+
+    return test_fail(what, i);
+}
+
+/*
+ * Controller
+ */
+static void
+sta_expired(const struct ether_addr *sta_addr,
+            const struct ether_addr *vap_addr,
+            void *arg)
+{
+    RTE_SET_USED(arg);
+
+    if (nb_expired < STAS_MAX) {
+        expired_addrs[nb_expired] = test_addr_index(sta_addr);
+        expired_vaps[nb_expired] = (int)test_addr_index(vap_addr);
+    }
+    nb_expired++;
+}
+
+/* ages the store at the tick, and checks against the model */
+static int
+age(uint64_t start_tsc, uint32_t tick)
+{
+    uint64_t cur_tsc = start_tsc + tick * rte_get_tsc_hz();
+    uint32_t i, a, nb_expected = 0;
+
+    /* until the tick's slot is done, over as many batches as needed */
+    nb_expired = 0;
+    while (store_sta_age(cur_tsc, sta_expired, NULL) != 0)
+        ;
+
+    if (store_tick_get() != tick)
+        return fail("Aging clock not advanced", store_tick_get(), tick);
+
+    for (a = 0; a < NB_ADDRS; a++)
+        if (sta_vap[a] >= 0 && sta_last_seen[a] + IDLE_TIMEOUT == tick)
+            nb_expected++;
+
+    if (nb_expired != nb_expected)
+        return fail("Wrong number of stations expired", nb_expired, tick);
+
+    for (i = 0; i < nb_expired; i++) {
+        a = expired_addrs[i];
+
+        if (a >= NB_ADDRS || sta_vap[a] < 0 ||
+            sta_last_seen[a] + IDLE_TIMEOUT != tick)
+            return fail("Station expired early, or twice", a, tick);
+        if (expired_vaps[i] != sta_vap[a])
+            return fail("Station expired with the wrong vAP", a, tick);
+        if (store_sta_lookup(&(sta_addrs[a])) != NULL)
+            return fail("Expired station still found", a, tick);
+
+        sta_vap[a] = -1;
+        nb_model_stas--;
+    }
+
+    nb_expired_total += nb_expired;
+    if (nb_expired > max_expired)
+        max_expired = nb_expired;
+
+    return 0;
+}
+
+static int
+sta_add(uint32_t a, uint32_t v, uint32_t tick)
+{
+    struct sta_elem *sta = store_sta_add(&(sta_addrs[a]), &(vap_addrs[v]));
+    uint8_t key[CCMP_128_KEY_LEN];
+
+    if (sta == NULL) {
+        if (sta_vap[a] < 0 && nb_model_stas == STAS_MAX)
+            return 0;
+        return fail("Could not add station", a, tick);
+    }
+
+    /* re-added, it is moved to the vAP, and aged from now */
+    sta_last_seen[a] = tick;
+    if (sta_vap[a] >= 0) {
+        sta_vap[a] = (int)v;
+        return 0;
+    }
+
+    memset(key, (uint8_t)a, CCMP_128_KEY_LEN);
+    if (sta_ptk_rx_set(sta, 0, key, CCMP_128_KEY_LEN,
+                       CCMP_CIPHER_CCMP) != RWPA_STS_OK ||
+        sta_ptk_tx_set(sta, 0, 0) != RWPA_STS_OK)
+        return fail("Could not set the station's PTK", a, tick);
+
+    sta_vap[a] = (int)v;
+    nb_model_stas++;
+    nb_added_total++;
+
+    return 0;
+}
+
+static int
+sta_del(uint32_t a, uint32_t tick)
+{
+    if (sta_vap[a] < 0)
+        return 0;
+
+    if (store_sta_del(&(sta_addrs[a])) != RWPA_STS_OK)
+        return fail("Could not delete station", a, tick);
+
+    sta_vap[a] = -1;
+    nb_model_stas--;
+    nb_deleted_total++;
+
+    return 0;
+}
+
+static int
+vap_del(uint32_t v, uint32_t tick)
+{
+    uint32_t a;
+
+    if (store_vap_del(&(vap_addrs[v])) != RWPA_STS_OK ||
+        store_vap_add(&(vap_addrs[v])) == NULL)
+        return fail("Could not delete and re-add vAP", v, tick);
+
+    for (a = 0; a < NB_ADDRS; a++) {
+        if (sta_vap[a] != (int)v)
+            continue;
+
+        sta_vap[a] = -1;
+        nb_model_stas--;
+        nb_cascaded_total++;
+    }
+
+    return 0;
+}
+
+/*
+ * the data path, without its frames: the active stations are seen,
+ * each station being active and idle in turn, for ACTIVE_TICKS each
+ */
+static void
+stas_seen(uint32_t tick)
+{
+    uint32_t a;
+
+    for (a = 0; a < NB_ADDRS; a++) {
+        struct sta_elem *sta;
+
+        if (sta_vap[a] < 0 || ((a + tick / ACTIVE_TICKS) & 1) != 0 ||
+            test_rand() % 100 >= SEEN_PERCENT)
+            continue;
+
+        sta = store_sta_lookup(&(sta_addrs[a]));
+        sta_seen(sta, store_tick_get());
+        sta_last_seen[a] = tick;
+        nb_seen_total++;
+    }
+}
+
+static int
+churn(uint32_t tick)
+{
+    uint32_t i, n;
+    int sts = 0;
+
+    n = tick % ADD_BURST_EVERY == 0 ? ADD_BURST : NB_ADDS;
+    for (i = 0; i < n && sts == 0; i++) {
+        sts = sta_add(test_rand() % NB_ADDRS, test_rand() % NB_VAPS, tick);
+
+        /* let the reader run */
+        rte_pause();
+    }
+
+    for (i = 0; i < NB_DELS && sts == 0; i++) {
+        sts = sta_del(test_rand() % NB_ADDRS, tick);
+        rte_pause();
+    }
+
+    if (sts == 0 && tick % VAP_DEL_EVERY == 0)
+        sts = vap_del(test_rand() % NB_VAPS, tick);
+
+    stas_seen(tick);
+
+    return sts;
+}
+
+int
+main(void)
+{
+    struct app_store_params store_params = {
+        .vaps_max = NB_VAPS,
+        .stas_max = STAS_MAX,
+        .sta_idle_timeout_s = IDLE_TIMEOUT,
+    };
+    struct app_addr_params addr_params;
+    uint64_t start_tsc;
+    uint32_t i, tick;
+    int sts = 0;
+
+    shim_lcore_id_set(LCORE_CONTROL);
+    shim_lcore_count = 2;
+    test_rand_seed(2);
+
+    /* the adds to a full store are logged as errors */
+    shim_log_level = RTE_LOG_CRIT;
+
+    memset(&addr_params, 0, sizeof(addr_params));
+    store_init(0, &store_params, &addr_params);
+    start_tsc = rte_rdtsc();
+
+    test_addrs_init(vap_addrs, NB_VAPS, sta_addrs, NB_ADDRS);
+    for (i = 0; i < NB_VAPS; i++)
+        if (store_vap_add(&(vap_addrs[i])) == NULL)
+            rte_exit(EXIT_FAILURE, "Cannot add vAP %u\n", i);
+    for (i = 0; i < NB_ADDRS; i++)
+        sta_vap[i] = -1;
+
+    test_reader_start(&reader);
+
+    for (tick = 1; tick <= NB_TICKS && sts == 0; tick++) {
+        if (age(start_tsc, tick) != 0 || churn(tick) != 0) {
+            sts = 1;
+            break;
+        }
+
+        if (store_check() != RWPA_STS_OK) {
+            fail("Store inconsistent", 0, tick);
+            sts = 1;
+        }
+
+        if (mock_sessions_live() != (int64_t)nb_model_stas) {
+            fail("Sessions leaked", (uint32_t)mock_sessions_live(), tick);
+            sts = 1;
+        }
+    }
+
+    test_reader_stop(&reader);
+
+    printf("%u ticks, timeout %u: %" PRIu64 " stations added, %" PRIu64
+           " deleted, %" PRIu64 " deleted with their vAP, %" PRIu64
+           " expired (%" PRIu64 " at most on a tick), %" PRIu64 " seen, "
+           "%u left, %" PRIu64 " stations read, %" PRIu64 " reset under "
+           "their reader\n",
+           NB_TICKS, IDLE_TIMEOUT, nb_added_total, nb_deleted_total,
+           nb_cascaded_total, nb_expired_total, max_expired, nb_seen_total,
+           nb_model_stas, reader.nb_reads, reader.nb_reset);
+
+    if (reader.nb_reset != 0)
+        sts = 1;
+
+    /* the expiries took more than one aging batch on some tick */
+    if (max_expired <= STORE_AGING_BATCH_MAX) {
+        fprintf(stderr, "No tick expired more than a batch\n");
+        sts = 1;
+    }
+
+    for (i = 0; i < NB_VAPS; i++)
+        store_vap_del(&(vap_addrs[i]));
+
+    if (mock_sessions_live() != 0) {
+        fprintf(stderr, "%" PRId64 " sessions left behind\n",
+                mock_sessions_live());
+        sts = 1;
+    }
+
+    store_cleanup();
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
@@ -0,0 +1,456 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Dispatch thread steering test
+ * - runs the dispatch thread (dispatch_thread.c, built in here) on a
+ *   generated RXQ of tunnel frames from many stations, interleaved,
+ *   with a few frames which are not tunnelled, and workers reading
+ *   its SWQs on threads of their own
+ * - each frame carries its station's next sequence number, standing
+ *   in for the CCMP PN the uplink's replay check needs in order
+ * - checks every frame of a station is received by the same worker,
+ *   and in the order it was sent, that the frames not tunnelled go to
+ *   the first worker, and that each frame is either received or
+ *   counted as dropped by the dispatch thread
+ * - run with the RXQ as fast as the dispatch thread reads it, so that
+ *   the workers fall behind and frames are dropped, and paced by the
+ *   workers, so that none are
+ * - run for the uplink (AP tunnel, inner source MAC, UDP or GRE with
+ *   RWPA_AP_TUNNELLING_GRE) and the downlink (WAG GRE tunnel, inner
+ *   destination MAC)
+ */
+
+#include <pthread.h>
+
+#include "dispatch_thread.c"
+
+#define NB_WORKERS      4
+#define NB_STAS         1024
+#define NB_FRAMES       (1 << 21)
+#define RING_SIZE       1024
+
+/* one in this many frames is not tunnelled */
+#define NON_TUNNEL_RATIO 64
+
+#define NO_WORKER       UINT32_MAX
+
+volatile int force_quit = 0;
+
+struct frame_data {
+    uint32_t sta;
+    uint64_t seq;
+} __attribute__((__packed__));
+
+struct test_sta {
+    struct ether_addr addr;
+    uint64_t next_seq;          /* generator */
+    volatile uint32_t worker;   /* workers */
+    uint64_t last_seq;
+    uint64_t nb_rx;
+};
+
+static struct test_sta stas[NB_STAS];
+static struct rte_ring *rings[NB_WORKERS];
+static int downlink;
+static int paced;
+static uint64_t nb_sent;
+static uint64_t nb_non_tunnel_sent;
+static uint32_t rand_state = 1;
+
+static volatile int workers_done;
+static rte_atomic64_t nb_received;
+static rte_atomic64_t nb_errors;
+
+static inline uint32_t
+test_rand(void)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+
+    return rand_state >> 8;
+}
+
+/*
+ * build a tunnel frame for the station, uplink frames from it in an
+ * AP tunnel, downlink frames to it in a WAG GRE tunnel
+ */
+static struct rte_mbuf *
+frame_build(uint32_t sta)
+{
+    uint16_t len = sizeof(struct ether_hdr) + sizeof(struct ipv4_hdr);
+    struct rte_mbuf *m;
+    struct ether_hdr *eth_hdr, *inner_eth_hdr;
+    struct ipv4_hdr *ip_hdr;
+    struct gre_hdr *gre_hdr;
+    struct frame_data *data;
+    int gre = downlink;
+    int gre_key = (sta & 1);
+
+#ifdef RWPA_AP_TUNNELLING_GRE
+    gre = 1;
+#endif
+
+    len += gre ? sizeof(struct gre_hdr) + (gre_key ? GRE_KEY_SZ : 0) :
+                 sizeof(struct udp_hdr);
+    len += sizeof(struct ether_hdr) + sizeof(struct frame_data);
+
+    m = shim_pktmbuf_alloc(len);
+    if (m == NULL)
+        rte_exit(EXIT_FAILURE, "Out of memory\n");
+
+    eth_hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
+    eth_hdr->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+
+    ip_hdr = (struct ipv4_hdr *)&eth_hdr[1];
+    ip_hdr->version_ihl = 0x45;
+    ip_hdr->next_proto_id = gre ? IPPROTO_GRE : IPPROTO_UDP;
+
+    if (gre) {
+        gre_hdr = (struct gre_hdr *)&ip_hdr[1];
+        gre_hdr->k = gre_key;
+        inner_eth_hdr = (struct ether_hdr *)((char *)&gre_hdr[1] +
+                                             (gre_key ? GRE_KEY_SZ : 0));
+    } else {
+        inner_eth_hdr = (struct ether_hdr *)
+            ((char *)&ip_hdr[1] + sizeof(struct udp_hdr));
+    }
+
+    if (downlink)
+        ether_addr_copy(&(stas[sta].addr), &(inner_eth_hdr->d_addr));
+    else
+        ether_addr_copy(&(stas[sta].addr), &(inner_eth_hdr->s_addr));
+
+    data = (struct frame_data *)&inner_eth_hdr[1];
+    data->sta = sta;
+    data->seq = ++stas[sta].next_seq;
+
+    return m;
+}
+
+/* an ARP frame, which is not tunnelled */
+static struct rte_mbuf *
+frame_non_tunnel_build(void)
+{
+    struct rte_mbuf *m = shim_pktmbuf_alloc(60);
+    struct ether_hdr *eth_hdr;
+
+    if (m == NULL)
+        rte_exit(EXIT_FAILURE, "Out of memory\n");
+
+    eth_hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
+    eth_hdr->ether_type = rte_cpu_to_be_16(ETHER_TYPE_ARP);
+    m->udata64 = UINT64_MAX;
+
+    return m;
+}
+
+/*
+ * the dispatch thread's RXQ
+ * - bursts of frames from stations picked at random, so that each
+ *   burst interleaves the frames of many stations, until all are sent
+ * - when paced, nothing is received while a worker's SWQ is over half
+ *   full
+ */
+uint16_t
+rte_eth_rx_burst(uint8_t port_id, uint16_t queue_id,
+                 struct rte_mbuf **rx_pkts, const uint16_t nb_pkts)
+{
+    uint16_t i;
+
+    RTE_SET_USED(port_id);
+    RTE_SET_USED(queue_id);
+
+    if (nb_sent >= NB_FRAMES) {
+        force_quit = 1;
+        return 0;
+    }
+
+    if (paced) {
+        for (i = 0; i < NB_WORKERS; i++) {
+            if (rte_ring_count(rings[i]) > RING_SIZE / 2) {
+                rte_pause();
+                return 0;
+            }
+        }
+    }
+
+    for (i = 0; i < nb_pkts && nb_sent < NB_FRAMES; i++, nb_sent++) {
+        if (test_rand() % NON_TUNNEL_RATIO == 0) {
+            rx_pkts[i] = frame_non_tunnel_build();
+            nb_non_tunnel_sent++;
+        } else {
+            rx_pkts[i] = frame_build(test_rand() % NB_STAS);
+        }
+    }
+
+    return i;
+}
+
+static void
+frame_check(uint32_t worker, struct rte_mbuf *m)
+{
+    struct frame_data *data;
+    struct test_sta *sta;
+    uint32_t no_worker = NO_WORKER;
+
+    if (m->udata64 == UINT64_MAX) {
+        if (worker != 0) {
+            fprintf(stderr, "Frame not tunnelled on worker %u\n", worker);
+            rte_atomic64_inc(&nb_errors);
+        }
+        return;
+    }
+
+    data = rte_pktmbuf_mtod_offset(m, struct frame_data *,
+                                   m->data_len - sizeof(struct frame_data));
+    sta = &(stas[data->sta]);
+
+    /* the first worker to receive a frame of the station owns it */
+    if (!__atomic_compare_exchange_n(&(sta->worker), &no_worker, worker, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) &&
+        no_worker != worker) {
+        fprintf(stderr, "Station %u on workers %u and %u\n",
+                data->sta, no_worker, worker);
+        rte_atomic64_inc(&nb_errors);
+        return;
+    }
+
+    /* frames may be dropped, but not reordered */
+    if (data->seq <= sta->last_seq) {
+        fprintf(stderr, "Station %u frame %" PRIu64 " after %" PRIu64 "\n",
+                data->sta, data->seq, sta->last_seq);
+        rte_atomic64_inc(&nb_errors);
+    }
+    sta->last_seq = data->seq;
+    sta->nb_rx++;
+}
+
+struct worker_args {
+    uint32_t id;
+    struct rte_ring *ring;
+};
+
+static void *
+worker_main(void *arg)
+{
+    struct worker_args *args = arg;
+    struct rte_mbuf *pkts[MAX_PKT_BURST];
+    unsigned nb, i;
+
+    shim_lcore_id_set(1 + args->id);
+
+    for (;;) {
+        int done = workers_done;
+
+        rte_smp_rmb();
+        nb = rte_ring_sc_dequeue_burst(args->ring, (void **)pkts,
+                                       MAX_PKT_BURST, NULL);
+        if (nb == 0) {
+            if (done)
+                break;
+            rte_pause();
+            continue;
+        }
+
+        for (i = 0; i < nb; i++) {
+            frame_check(args->id, pkts[i]);
+            rte_pktmbuf_free(pkts[i]);
+        }
+        rte_atomic64_add(&nb_received, nb);
+    }
+
+    return NULL;
+}
+
+/*
+ * set up a dispatch thread reading port 0, with a SWQ to each of the
+ * workers, as the config parser would
+ */
+static void
+app_setup(struct app_params *app)
+{
+    struct app_thread_params *p = &(app->thread_params[0]);
+    uint32_t i;
+
+    memset(app, 0, sizeof(*app));
+    app->n_threads = 1 + NB_WORKERS;
+    app->n_pktq_swq = NB_WORKERS;
+
+    p->name = "DISPATCH_THREAD0";
+    strcpy(p->type, "DISPATCH_THREAD");
+    p->n_ports_in = 1;
+    p->port_in[0].type = THREAD_PORT_IN_ETHDEV_READER;
+    p->n_ports_out = NB_WORKERS;
+    p->n_pktq_out = NB_WORKERS;
+
+    for (i = 0; i < NB_WORKERS; i++) {
+        struct app_thread_params *w = &(app->thread_params[1 + i]);
+
+        rings[i] = rte_ring_create("SWQ", RING_SIZE, 0,
+                                   RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (rings[i] == NULL)
+            rte_exit(EXIT_FAILURE, "Cannot create SWQ %u\n", i);
+
+        p->port_out[i].type = THREAD_PORT_OUT_RING_WRITER;
+        p->port_out[i].params.ring.ring = rings[i];
+        p->pktq_out[i].type = APP_PKTQ_OUT_SWQ;
+        p->pktq_out[i].id = i;
+
+        w->name = "WORKER";
+        strcpy(w->type, downlink ? "DOWNLINK_THREAD" : "UPLINK_THREAD");
+        w->n_pktq_in = 1;
+        w->pktq_in[0].type = APP_PKTQ_IN_SWQ;
+        w->pktq_in[0].id = i;
+    }
+}
+
+static int
+run(int dl, int pace)
+{
+    struct app_params app;
+    struct worker_args args[NB_WORKERS];
+    pthread_t workers[NB_WORKERS];
+    struct dispatch_ctx *ctx;
+    uint64_t nb_dropped = 0, nb_stas_seen = 0;
+    uint32_t i, stas_per_worker[NB_WORKERS] = { 0 };
+    int sts = 0;
+
+    downlink = dl;
+    paced = pace;
+    nb_sent = 0;
+    nb_non_tunnel_sent = 0;
+    force_quit = 0;
+    workers_done = 0;
+    rte_atomic64_set(&nb_received, 0);
+    rte_atomic64_set(&nb_errors, 0);
+
+    memset(stas, 0, sizeof(stas));
+    for (i = 0; i < NB_STAS; i++) {
+        stas[i].addr.addr_bytes[0] = 0x02;
+        stas[i].addr.addr_bytes[3] = (uint8_t)(i >> 16);
+        stas[i].addr.addr_bytes[4] = (uint8_t)(i >> 8);
+        stas[i].addr.addr_bytes[5] = (uint8_t)i;
+        stas[i].worker = NO_WORKER;
+    }
+
+    app_setup(&app);
+
+    ctx = thread_dispatch_init(&(app.thread_params[0]), &app);
+    if (ctx->key != (dl ? DISPATCH_KEY_DL_STA_MAC : DISPATCH_KEY_UL_STA_MAC)) {
+        fprintf(stderr, "Wrong steering key for the workers\n");
+        return -1;
+    }
+
+    shim_lcore_count = 1 + NB_WORKERS;
+    for (i = 0; i < NB_WORKERS; i++) {
+        args[i].id = i;
+        args[i].ring = rings[i];
+        pthread_create(&workers[i], NULL, worker_main, &args[i]);
+    }
+
+    thread_dispatch_run(ctx);
+
+    rte_smp_wmb();
+    workers_done = 1;
+    for (i = 0; i < NB_WORKERS; i++)
+        pthread_join(workers[i], NULL);
+
+    for (i = 0; i < NB_WORKERS; i++)
+        nb_dropped += ctx->nb_dropped[i];
+
+    for (i = 0; i < NB_STAS; i++) {
+        if (stas[i].worker == NO_WORKER)
+            continue;
+        stas_per_worker[stas[i].worker]++;
+        nb_stas_seen++;
+    }
+
+    printf("%s, %s: %" PRIu64 " frames (%" PRIu64 " not tunnelled) from %u "
+           "stations to %u workers, %" PRIu64 " received, %" PRIu64
+           " dropped, stations per worker",
+           dl ? "downlink" : "uplink", pace ? "paced" : "flat out",
+           nb_sent, nb_non_tunnel_sent,
+           NB_STAS, NB_WORKERS, (uint64_t)rte_atomic64_read(&nb_received),
+           nb_dropped);
+    for (i = 0; i < NB_WORKERS; i++)
+        printf(" %u", stas_per_worker[i]);
+    printf("\n");
+
+    if (rte_atomic64_read(&nb_errors) != 0) {
+        fprintf(stderr, "%" PRIu64 " frames misrouted or out of order\n",
+                (uint64_t)rte_atomic64_read(&nb_errors));
+        sts = -1;
+    }
+
+    if ((uint64_t)rte_atomic64_read(&nb_received) + nb_dropped != nb_sent) {
+        fprintf(stderr, "Frames lost without being counted as dropped\n");
+        sts = -1;
+    }
+
+    if (pace && nb_dropped != 0) {
+        fprintf(stderr, "Frames dropped with the RXQ paced\n");
+        sts = -1;
+    }
+
+    /* the stations are spread, rather than all steered to one worker */
+    for (i = 0; i < NB_WORKERS; i++) {
+        if (stas_per_worker[i] < nb_stas_seen / (NB_WORKERS * 2)) {
+            fprintf(stderr, "Worker %u has %u stations only\n",
+                    i, stas_per_worker[i]);
+            sts = -1;
+        }
+    }
+
+    thread_dispatch_free(ctx);
+    for (i = 0; i < NB_WORKERS; i++)
+        rte_ring_free(rings[i]);
+
+    return sts;
+}
+
+int
+main(void)
+{
+    int dl, pace, sts = 0;
+
+    for (dl = 0; dl <= 1; dl++)
+        for (pace = 0; pace <= 1; pace++)
+            if (run(dl, pace) != 0)
+                sts = 1;
+
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
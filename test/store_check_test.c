@@ -0,0 +1,409 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * vAP station list and store checker test
+ * - the store (store.c) is the real one, included to reach its lists,
+ *   and the SAs are mocked, see mocks.h
+ * - vAPs and stations are added, moved and deleted at random, and
+ *   after each batch store_check() must pass, and the store must
+ *   agree with a model of it: each station found, on the list of its
+ *   vAP, and one crypto session per station with a key
+ * - a vAP deleted takes its stations with it, whose keys are reset
+ * - meanwhile a reader looks the stations up, and checks the key of
+ *   a station it found is not reset before it leaves its read section
+ * - last, store_check() must catch inconsistencies planted in the
+ *   lists
+ */
+
+#include <pthread.h>
+
+#include "../store.c"
+#include "store_helpers.h"
+
+#define NB_VAPS         16
+#define NB_ADDRS        512
+#define STAS_MAX        256
+#define NB_BATCHES      2000
+#define BATCH           64
+
+#define LCORE_WRITER    0
+#define LCORE_READER    1
+
+static struct ether_addr vap_addrs[NB_VAPS];
+static struct ether_addr sta_addrs[NB_ADDRS];
+
+/* the model: the vAPs present, and each station's vAP or -1 */
+static int vap_present[NB_VAPS];
+static int sta_vap[NB_ADDRS];
+static struct sta_elem *sta_ptrs[NB_ADDRS];
+static uint32_t nb_model_stas;
+static uint32_t nb_cascaded;
+
+static struct test_reader reader = {
+    .addrs = sta_addrs,
+    .nb_addrs = NB_ADDRS,
+    .lcore_id = LCORE_READER,
+};
+
+static void
+sta_key(uint32_t a, uint8_t *key)
+{
+    memset(key, (uint8_t)a, CCMP_128_KEY_LEN);
+    key[0] = (uint8_t)(a >> 8);
+    key[1] = 0xa5;
+}
+
+/*
+ * Writer
+ */
+static int
+vap_add(uint32_t v)
+{
+    if (store_vap_add(&(vap_addrs[v])) == NULL)
+        return test_fail("Could not add vAP", v);
+
+    vap_present[v] = 1;
+
+    return 0;
+}
+
+static void
+vap_sta_count(struct sta_elem *sta, void *arg)
+{
+    uint32_t *counts = arg;
+
+    counts[sta->parent_vap - vaps]++;
+}
+
+static int
+vap_del(uint32_t v)
+{
+    struct vap_elem *vap = store_vap_lookup(&(vap_addrs[v]));
+    uint32_t counts[NB_VAPS] = { 0 };
+    uint32_t a, nb_stas = 0;
+
+    for (a = 0; a < NB_ADDRS; a++)
+        nb_stas += sta_vap[a] == (int)v;
+
+    if (store_vap_sta_foreach(vap, vap_sta_count, counts) != nb_stas ||
+        counts[vap - vaps] != nb_stas)
+        return test_fail("Wrong number of stations on the vAP", v);
+
+    if (store_vap_del(&(vap_addrs[v])) != RWPA_STS_OK)
+        return test_fail("Could not delete vAP", v);
+
+    vap_present[v] = 0;
+    if (store_vap_lookup(&(vap_addrs[v])) != NULL)
+        return test_fail("vAP found after its delete", v);
+
+    /* its stations are gone, and their keys reset */
+    for (a = 0; a < NB_ADDRS; a++) {
+        if (sta_vap[a] != (int)v)
+            continue;
+
+        if (store_sta_lookup(&(sta_addrs[a])) != NULL)
+            return test_fail("Station found after its vAP's delete", a);
+
+        if (sta_ptrs[a]->ptk[0].sa.tk_len != 0 ||
+            sta_ptrs[a]->parent_vap != NULL)
+            return test_fail("Station not reset with its vAP", a);
+
+        sta_vap[a] = -1;
+        nb_model_stas--;
+        nb_cascaded++;
+    }
+
+    return 0;
+}
+
+static int
+sta_add(uint32_t a, uint32_t v)
+{
+    struct sta_elem *sta = store_sta_add(&(sta_addrs[a]), &(vap_addrs[v]));
+    uint8_t key[CCMP_128_KEY_LEN];
+
+    if (!vap_present[v]) {
+        if (sta != NULL)
+            return test_fail("Station added to a missing vAP", a);
+        return 0;
+    }
+
+    if (sta == NULL) {
+        if (sta_vap[a] < 0 && nb_model_stas == STAS_MAX)
+            return 0;
+        return test_fail("Could not add station", a);
+    }
+
+    if (sta->parent_vap != &(vaps[store_vap_lookup(&(vap_addrs[v])) -
+                                  vaps]))
+        return test_fail("Station added with the wrong vAP", a);
+
+    /* re-added, to another vAP, it is moved and keeps its key */
+    if (sta_vap[a] >= 0) {
+        if (sta != sta_ptrs[a])
+            return test_fail("Station moved to another entry", a);
+        sta_vap[a] = (int)v;
+        return 0;
+    }
+
+    sta_key(a, key);
+    if (sta_ptk_rx_set(sta, 0, key, CCMP_128_KEY_LEN,
+                       CCMP_CIPHER_CCMP) != RWPA_STS_OK ||
+        sta_ptk_tx_set(sta, 0, 0) != RWPA_STS_OK)
+        return test_fail("Could not set the station's PTK", a);
+
+    sta_ptrs[a] = sta;
+    sta_vap[a] = (int)v;
+    nb_model_stas++;
+
+    return 0;
+}
+
+static int
+sta_del(uint32_t a)
+{
+    enum rwpa_status sts = store_sta_del(&(sta_addrs[a]));
+
+    if (sta_vap[a] < 0)
+        return sts == RWPA_STS_OK ? test_fail("Missing station deleted", a) : 0;
+
+    if (sts != RWPA_STS_OK)
+        return test_fail("Could not delete station", a);
+
+    if (sta_ptrs[a]->ptk[0].sa.tk_len != 0)
+        return test_fail("Station's key not reset", a);
+
+    sta_vap[a] = -1;
+    nb_model_stas--;
+
+    return 0;
+}
+
+/* the store agrees with the model */
+static int
+verify(void)
+{
+    uint32_t counts[NB_VAPS] = { 0 };
+    uint32_t a, v, n;
+
+    if (store_check() != RWPA_STS_OK)
+        return test_fail("Store inconsistent", 0);
+
+    for (a = 0; a < NB_ADDRS; a++) {
+        struct sta_elem *sta = store_sta_lookup(&(sta_addrs[a]));
+
+        if (sta_vap[a] < 0) {
+            if (sta != NULL)
+                return test_fail("Deleted station found", a);
+            continue;
+        }
+
+        if (sta != sta_ptrs[a] ||
+            sta->parent_vap != store_vap_lookup(&(vap_addrs[sta_vap[a]])))
+            return test_fail("Station not found, or with the wrong vAP", a);
+        counts[sta_vap[a]]++;
+    }
+
+    for (v = 0; v < NB_VAPS; v++) {
+        struct vap_elem *vap = store_vap_lookup(&(vap_addrs[v]));
+
+        if ((vap != NULL) != vap_present[v])
+            return test_fail("vAP presence wrong", v);
+        if (vap == NULL)
+            continue;
+
+        n = store_vap_sta_foreach(vap, NULL, NULL);
+        if (n != counts[v])
+            return test_fail("Wrong number of stations on the vAP", v);
+    }
+
+    if (mock_sessions_live() != (int64_t)nb_model_stas)
+        return test_fail("Sessions leaked", (uint32_t)mock_sessions_live());
+
+    return 0;
+}
+
+static int
+churn(void)
+{
+    uint32_t b, i, r;
+    int sts = 0;
+
+    for (b = 0; b < NB_BATCHES && sts == 0; b++) {
+        for (i = 0; i < BATCH && sts == 0; i++) {
+            uint32_t v = test_rand() % NB_VAPS;
+            uint32_t a = test_rand() % NB_ADDRS;
+
+            r = test_rand() % 100;
+            if (r < 4)
+                sts = vap_present[v] ? vap_del(v) : vap_add(v);
+            else if (r < 10)
+                sts = vap_present[v] ? 0 : vap_add(v);
+            else if (r < 60)
+                sts = sta_add(a, v);
+            else
+                sts = sta_del(a);
+
+            /* let the reader run */
+            rte_pause();
+        }
+
+        if (sts == 0)
+            sts = verify();
+    }
+
+    return sts;
+}
+
+/*
+ * store_check() catches each planted inconsistency, and passes again
+ * once it is undone
+ */
+static int
+planted_check(const char *what)
+{
+    if (store_check() == RWPA_STS_OK) {
+        fprintf(stderr, "Not detected: %s\n", what);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+planted(void)
+{
+    struct store_sta_link saved;
+    struct vap_elem *parent;
+    int32_t v, s, other;
+    int sts = 0;
+
+    /* a vAP with 2 stations at least, and another one */
+    for (v = 0; v < NB_VAPS; v++)
+        if (vap_present[v] && vap_stas[v].num_stas >= 2)
+            break;
+    for (other = 0; other < NB_VAPS; other++)
+        if (other != v && vap_present[other])
+            break;
+    if (v == NB_VAPS || other == NB_VAPS)
+        return test_fail("No vAPs to plant inconsistencies in", 0);
+
+    v = (int32_t)(store_vap_lookup(&(vap_addrs[v])) - vaps);
+    other = (int32_t)(store_vap_lookup(&(vap_addrs[other])) - vaps);
+    s = sta_links[vap_stas[v].head].next;
+
+    vap_stas[v].num_stas++;
+    sts |= planted_check("vAP station count");
+    vap_stas[v].num_stas--;
+
+    saved = sta_links[s];
+    sta_links[s].prev = STORE_INDEX_NONE;
+    sts |= planted_check("broken list");
+    sta_links[s] = saved;
+
+    parent = stas[s].parent_vap;
+    stas[s].parent_vap = &(vaps[other]);
+    sts |= planted_check("station parent not its list's vAP");
+    stas[s].parent_vap = parent;
+
+    store_vap_sta_unlink(s);
+    sts |= planted_check("station not listed");
+    store_vap_sta_link(s, v, &(saved.addr));
+
+    if (store_check() != RWPA_STS_OK)
+        return test_fail("Store inconsistent once undone", 0);
+
+    return sts;
+}
+
+int
+main(void)
+{
+    struct app_store_params store_params = {
+        .vaps_max = NB_VAPS,
+        .stas_max = STAS_MAX,
+    };
+    struct app_addr_params addr_params;
+    uint32_t i;
+    int sts = 0;
+
+    shim_lcore_id_set(LCORE_WRITER);
+    shim_lcore_count = 2;
+    test_rand_seed(2);
+
+    /*
+     * the adds to missing vAPs or to a full store, and the planted
+     * inconsistencies, are logged as errors
+     */
+    shim_log_level = RTE_LOG_CRIT;
+
+    memset(&addr_params, 0, sizeof(addr_params));
+    store_init(0, &store_params, &addr_params);
+
+    test_addrs_init(vap_addrs, NB_VAPS, sta_addrs, NB_ADDRS);
+    for (i = 0; i < NB_ADDRS; i++)
+        sta_vap[i] = -1;
+
+    test_reader_start(&reader);
+    if (churn() != 0)
+        sts = 1;
+    test_reader_stop(&reader);
+
+    printf("%u batches of %u changes, %u stations deleted with their vAP, "
+           "%u left, %" PRIu64 " stations read, %" PRIu64 " reset under "
+           "their reader\n", NB_BATCHES, BATCH, nb_cascaded, nb_model_stas,
+           reader.nb_reads, reader.nb_reset);
+
+    if (reader.nb_reset != 0)
+        sts = 1;
+
+    if (sts == 0 && planted() != 0)
+        sts = 1;
+
+    /* the vAPs take all the stations with them */
+    for (i = 0; i < NB_VAPS && sts == 0; i++)
+        if (vap_present[i] && vap_del(i) != 0)
+            sts = 1;
+
+    if (sts == 0 && (nb_model_stas != 0 || verify() != 0 ||
+                     mock_sessions_live() != 0))
+        sts = 1;
+
+    store_cleanup();
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
@@ -0,0 +1,165 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+#include "r-wpa_global_vars.h"
+#include "ccmp_sa.h"
+#include "station.h"
+#include "store.h"
+#include "store_helpers.h"
+
+#define READER_BURST    32
+
+static __thread uint32_t rand_state;
+
+void
+test_rand_seed(uint32_t seed)
+{
+    rand_state = seed;
+}
+
+uint32_t
+test_rand(void)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+
+    return rand_state >> 8;
+}
+
+int
+test_fail(const char *what, uint32_t i)
+{
+    fprintf(stderr, "%s (%u)\n", what, i);
+
+    return -1;
+}
+
+void
+test_addrs_init(struct ether_addr *vap_addrs, uint32_t nb_vaps,
+                struct ether_addr *sta_addrs, uint32_t nb_stas)
+{
+    uint32_t i;
+
+    memset(vap_addrs, 0, nb_vaps * sizeof(struct ether_addr));
+    for (i = 0; i < nb_vaps; i++) {
+        vap_addrs[i].addr_bytes[0] = 0x06;
+        vap_addrs[i].addr_bytes[5] = (uint8_t)i;
+    }
+
+    memset(sta_addrs, 0, nb_stas * sizeof(struct ether_addr));
+    for (i = 0; i < nb_stas; i++) {
+        sta_addrs[i].addr_bytes[0] = 0x02;
+        sta_addrs[i].addr_bytes[4] = (uint8_t)(i >> 8);
+        sta_addrs[i].addr_bytes[5] = (uint8_t)i;
+    }
+}
+
+uint32_t
+test_addr_index(const struct ether_addr *addr)
+{
+    if (addr->addr_bytes[0] == 0x06)
+        return addr->addr_bytes[5];
+
+    return ((uint32_t)addr->addr_bytes[4] << 8) | addr->addr_bytes[5];
+}
+
+static void *
+reader_main(void *arg)
+{
+    struct test_reader *reader = arg;
+    struct ether_addr *addrs[READER_BURST];
+    int32_t found[READER_BURST];
+    uint8_t keys[READER_BURST][CCMP_128_KEY_LEN];
+    uint8_t tk_lens[READER_BURST];
+    unsigned i;
+    uint8_t idx;
+
+    shim_lcore_id_set(reader->lcore_id);
+    test_rand_seed(1);
+
+    while (!reader->stop) {
+        for (i = 0; i < READER_BURST; i++)
+            addrs[i] = &(reader->addrs[test_rand() % reader->nb_addrs]);
+
+        idx = store_read_lock();
+        store_sta_bulk_lookup(addrs, READER_BURST, found);
+
+        for (i = 0; i < READER_BURST; i++) {
+            struct sta_elem *sta = store_sta_get(found[i]);
+
+            tk_lens[i] = sta != NULL ? sta->ptk[0].sa.tk_len : 0;
+            if (tk_lens[i] != 0)
+                memcpy(keys[i], sta->ptk[0].sa.cold->tk, CCMP_128_KEY_LEN);
+        }
+
+        /* let the writer run, it must wait for this section */
+        rte_pause();
+
+        for (i = 0; i < READER_BURST; i++) {
+            struct sta_elem *sta = store_sta_get(found[i]);
+
+            if (tk_lens[i] == 0)
+                continue;
+
+            reader->nb_reads++;
+            if (sta->ptk[0].sa.tk_len != tk_lens[i] ||
+                memcmp(sta->ptk[0].sa.cold->tk, keys[i],
+                       CCMP_128_KEY_LEN) != 0)
+                reader->nb_reset++;
+        }
+        store_read_unlock(idx);
+
+        rte_pause();
+    }
+
+    return NULL;
+}
+
+void
+test_reader_start(struct test_reader *reader)
+{
+    reader->stop = 0;
+    reader->nb_reads = 0;
+    reader->nb_reset = 0;
+
+    if (pthread_create(&(reader->thread), NULL, reader_main, reader) != 0)
+        rte_exit(EXIT_FAILURE, "Cannot start the store reader\n");
+}
+
+void
+test_reader_stop(struct test_reader *reader)
+{
+    reader->stop = 1;
+    pthread_join(reader->thread, NULL);
+}
@@ -0,0 +1,95 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Helpers shared by the store tests
+ * - random numbers, failure logging, the vAP and station addresses,
+ *   and a store reader running on a thread of its own
+ */
+
+#ifndef __INCLUDE_STORE_HELPERS_H__
+#define __INCLUDE_STORE_HELPERS_H__
+
+#include <pthread.h>
+
+/* each thread has its own random state, seeded with test_rand_seed() */
+void
+test_rand_seed(uint32_t seed);
+
+uint32_t
+test_rand(void);
+
+/* logs what failed, for the index i, and returns -1 */
+int
+test_fail(const char *what, uint32_t i);
+
+/*
+ * vAP v is 06:00:00:00:00:v, station a is 02:00:00:00:a >> 8:a
+ * - test_addr_index() gives back v or a
+ */
+void
+test_addrs_init(struct ether_addr *vap_addrs, uint32_t nb_vaps,
+                struct ether_addr *sta_addrs, uint32_t nb_stas);
+
+uint32_t
+test_addr_index(const struct ether_addr *addr);
+
+/*
+ * Store reader
+ * - looks up bursts of stations picked at random from addrs, on its
+ *   own lcore, and counts the stations found with a PTK whose key is
+ *   reset before it leaves its read section
+ * - yields in the middle of each read section, so that the writer
+ *   runs while the reader holds the stations
+ */
+struct test_reader {
+    struct ether_addr *addrs;
+    uint32_t nb_addrs;
+    unsigned lcore_id;
+
+    volatile int stop;
+    uint64_t nb_reads;
+    uint64_t nb_reset;
+
+    pthread_t thread;
+};
+
+void
+test_reader_start(struct test_reader *reader);
+
+void
+test_reader_stop(struct test_reader *reader);
+
+#endif // __INCLUDE_STORE_HELPERS_H__
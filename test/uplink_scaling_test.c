@@ -0,0 +1,619 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Uplink scaling test
+ * - runs 1, 2, 4 and 8 instances of the uplink thread (uplink_thread.c,
+ *   built in here), each reading its own RXQ, as with RSS, and reports
+ *   the Mpps of each run, in sync and in async crypto mode
+ * - the data path is the real one, from the AP tunnel to the GRE
+ *   tunnel to the WAG, with the store, the SAs and the inline engine
+ *   decrypting the CCMP frames on the uplink lcores
+ * - the frames are built and encrypted beforehand, NB_FRAMES per run,
+ *   each station's frames on the RXQ of one thread, so a run times
+ *   the uplink threads only
+ * - checks every frame is decrypted and sent to the WAG, and each
+ *   station's frames in order
+ * - the worker counts may be given on the command line instead; on a
+ *   host with fewer CPUs than threads, the threads share the CPUs and
+ *   the Mpps do not scale
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "uplink_thread.c"
+#include "ieee8022.h"
+
+#define MAX_WORKERS     8
+#define NB_STAS         1024
+#define NB_VAPS         16
+#define NB_FRAMES       (1 << 17)
+
+/* bytes of data per frame, after the 802.2 SNAP header */
+#define FRAME_DATA_LEN  256
+
+#define AP_LINK         0
+#define WAG_LINK        1
+#define AP_TUN_PORT     5000
+
+/* a run not making progress for this long has lost frames */
+#define STALL_MS        2000
+
+volatile int force_quit = 0;
+
+struct frame_data {
+    uint32_t sta;
+    uint64_t seq;
+} __attribute__((__packed__));
+
+struct test_sta {
+    struct ether_addr addr;
+    struct ether_addr *vap_addr;
+    struct sta_elem *sta;
+    uint64_t pn;                /* generator */
+    uint64_t next_seq;          /* generator */
+    uint64_t last_seq;          /* its uplink thread */
+} __rte_cache_aligned;
+
+/* the RXQ of an uplink thread, and what it sent to the WAG */
+struct test_queue {
+    struct rte_mbuf **frames;
+    uint32_t nb_frames;
+    volatile uint32_t next;
+    volatile uint64_t nb_tx;
+    volatile uint64_t last_tx_tsc;
+    uint64_t nb_errors;
+} __rte_cache_aligned;
+
+static struct test_sta stas[NB_STAS];
+static struct ether_addr vap_addrs[NB_VAPS];
+static struct test_queue queues[MAX_WORKERS];
+
+static struct app_params app;
+
+static volatile int started;
+
+/*
+ * build an uplink frame from the station, as an AP would: QoS data to
+ * the DS, CCMP encrypted with the station's PTK, in the vAP headers
+ * and the UDP AP tunnel
+ */
+static struct rte_mbuf *
+frame_build(uint32_t s)
+{
+    struct test_sta *ts = &stas[s];
+    uint16_t len = sizeof(struct ieee80211_hdr) + sizeof(union qos_ctrl) +
+                   sizeof(struct ieee8022_snap_hdr) + FRAME_DATA_LEN;
+    struct ether_addr ap_mac = { .addr_bytes = { 0x00, 0xa0, 0, 0, 0, 1 } };
+    struct ether_addr da = { .addr_bytes = { 0x04, 0, 0, 0, 0, 1 } };
+    struct rwpa_meta meta, *p_meta = &meta;
+    struct ieee80211_hdr *wifi_hdr;
+    struct ieee8022_snap_hdr *snap_hdr;
+    struct frame_data *data;
+    struct rte_mbuf *m;
+    uint16_t nb_ok;
+    uint8_t ok;
+
+    m = shim_pktmbuf_alloc(len);
+    if (m == NULL)
+        rte_exit(EXIT_FAILURE, "Out of memory\n");
+
+    wifi_hdr = rte_pktmbuf_mtod(m, struct ieee80211_hdr *);
+    wifi_hdr->frame_ctrl.le.type = IEEE80211_TYPE_DATA;
+    wifi_hdr->frame_ctrl.le.sub_type = IEEE80211_DATA_SUBTYPE_QOS_DATA;
+    wifi_hdr->frame_ctrl.le.to_ds = 1;
+    wifi_hdr->frame_ctrl.le.wep = 1;
+    ether_addr_copy(ts->vap_addr, &(wifi_hdr->addr1));
+    ether_addr_copy(&(ts->addr), &(wifi_hdr->addr2));
+    ether_addr_copy(&da, &(wifi_hdr->addr3));
+
+    snap_hdr = (struct ieee8022_snap_hdr *)
+        ((char *)&wifi_hdr[1] + sizeof(union qos_ctrl));
+    snap_hdr->dsap = DSAP_SNAP;
+    snap_hdr->ssap = SSAP_SNAP;
+    snap_hdr->control = CTRL_UNNUMBERED;
+    RESET_VENDOR_ID(snap_hdr->vendor_id);
+    snap_hdr->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+
+    data = rte_pktmbuf_mtod_offset(m, struct frame_data *,
+                                   len - sizeof(struct frame_data));
+    data->sta = s;
+    data->seq = ++ts->next_seq;
+
+    /* encrypt it with the next PN */
+    memset(&meta, 0, sizeof(meta));
+    ieee80211_packet_parse(m, &meta);
+    meta.sa = &(ts->sta->ptk[0].sa);
+    meta.counter = ++ts->pn;
+    meta.key_id = 0;
+
+    if (ccmp_encap(m, &meta) != RWPA_STS_OK ||
+        ccmp_inline_burst_enqueue(&m, 1, &p_meta, CCMP_OP_ENCRYPT,
+                                  &ok) != 1 ||
+        ccmp_inline_burst_dequeue(&m, NULL, 1, &nb_ok, &ok) != 1 ||
+        nb_ok != 1)
+        rte_exit(EXIT_FAILURE, "Cannot encrypt frame\n");
+
+    if (vap_tlv_encap(m) != RWPA_STS_OK ||
+        vap_hdr_encap(m, 0, 0, (seq_num_val_t)data->seq, &(ts->addr),
+                      ts->vap_addr) != RWPA_STS_OK ||
+        udp_encap(m, AP_TUN_PORT, IPv4(10, 0, 0, 1 + s % 200), &ap_mac,
+                  app.addr_params.vnfd_port_to_ap,
+                  app.addr_params.vnfd_ip_to_ap,
+                  &(app.link_params[AP_LINK].mac_addr)) != RWPA_STS_OK)
+        rte_exit(EXIT_FAILURE, "Cannot encapsulate frame\n");
+
+    return m;
+}
+
+/*
+ * the RXQs of the uplink threads
+ * - nothing is received until all the threads have been started
+ */
+uint16_t
+rte_eth_rx_burst(uint8_t port_id, uint16_t queue_id,
+                 struct rte_mbuf **rx_pkts, const uint16_t nb_pkts)
+{
+    struct test_queue *q = &queues[queue_id];
+    uint16_t i;
+
+    RTE_SET_USED(port_id);
+
+    if (!started || q->next == q->nb_frames) {
+        rte_pause();
+        return 0;
+    }
+
+    for (i = 0; i < nb_pkts && q->next < q->nb_frames; i++)
+        rx_pkts[i] = q->frames[q->next++];
+
+    return i;
+}
+
+/*
+ * the TXQs of the uplink threads
+ * - only the WAG link should be sent to, each frame being the
+ *   station's next one
+ * - the frames are freed once the run is over, by the main thread
+ */
+uint16_t
+rte_eth_tx_buffer(uint8_t port_id, uint16_t queue_id,
+                  struct rte_eth_dev_tx_buffer *buffer,
+                  struct rte_mbuf *tx_pkt)
+{
+    struct test_queue *q = &queues[queue_id];
+    struct frame_data *data;
+
+    RTE_SET_USED(buffer);
+
+    data = rte_pktmbuf_mtod_offset(tx_pkt, struct frame_data *,
+                                   tx_pkt->data_len -
+                                   sizeof(struct frame_data));
+
+    if (port_id != WAG_LINK || data->sta >= NB_STAS ||
+        data->seq != stas[data->sta].last_seq + 1)
+        q->nb_errors++;
+    else
+        stas[data->sta].last_seq = data->seq;
+
+    q->nb_tx++;
+    q->last_tx_tsc = rte_rdtsc();
+
+    return 0;
+}
+
+uint16_t
+rte_eth_tx_buffer_flush(uint8_t port_id, uint16_t queue_id,
+                        struct rte_eth_dev_tx_buffer *buffer)
+{
+    RTE_SET_USED(port_id);
+    RTE_SET_USED(queue_id);
+    RTE_SET_USED(buffer);
+
+    return 0;
+}
+
+/*
+ * the rest of the uplink thread's dependencies, which the inline
+ * engine, unfragmented frames and a build without TLS polling do not
+ * use
+ */
+enum rwpa_status
+crypto_chan_init(struct crypto_chan *chan, uint8_t cdev_id, uint16_t qp)
+{
+    chan->cdev_id = cdev_id;
+    chan->qp = qp;
+
+    return RWPA_STS_OK;
+}
+
+enum rwpa_status
+crypto_ops_alloc(uint32_t num_ops_alloc, struct rte_crypto_op **ops)
+{
+    RTE_SET_USED(num_ops_alloc);
+    RTE_SET_USED(ops);
+
+    return RWPA_STS_ERR;
+}
+
+uint16_t
+crypto_burst_enqueue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan)
+{
+    RTE_SET_USED(ops);
+    RTE_SET_USED(nb_ops);
+    RTE_SET_USED(chan);
+
+    return 0;
+}
+
+uint16_t
+crypto_burst_dequeue(struct rte_crypto_op **ops, uint16_t nb_ops,
+                     struct crypto_chan *chan)
+{
+    RTE_SET_USED(ops);
+    RTE_SET_USED(nb_ops);
+    RTE_SET_USED(chan);
+
+    return 0;
+}
+
+int
+crypto_gcm_supported(void)
+{
+    return FALSE;
+}
+
+struct sess_cache_entry *
+sess_cache_get(struct sess_cache_entry **slot,
+               struct rte_crypto_sym_xform *xform)
+{
+    RTE_SET_USED(slot);
+    RTE_SET_USED(xform);
+
+    return NULL;
+}
+
+void
+sess_cache_release(struct sess_cache_entry **slot)
+{
+    *slot = NULL;
+}
+
+void
+vap_frag_lcore_init(void)
+{
+}
+
+void
+vap_frag_free_death_row(void)
+{
+}
+
+enum rwpa_status
+vap_payload_reassemble(struct rte_mbuf *mi,
+                       struct rte_mbuf **mo,
+                       uint64_t tms,
+                       struct rwpa_meta *meta)
+{
+    RTE_SET_USED(tms);
+    RTE_SET_USED(meta);
+
+    *mo = NULL;
+    rte_pktmbuf_free(mi);
+
+    return RWPA_STS_ERR;
+}
+
+int
+arp_reply(struct rte_mbuf *mbuf, uint8_t port, uint32_t vnfd_ip_addr)
+{
+    RTE_SET_USED(port);
+    RTE_SET_USED(vnfd_ip_addr);
+
+    rte_pktmbuf_free(mbuf);
+
+    return 0;
+}
+
+/*
+ * set up an uplink thread per worker, reading its RXQ on the AP link
+ * and writing to its TXQs on the AP and WAG links, as the config
+ * parser would
+ */
+static void
+app_setup(uint32_t nb_workers, int async)
+{
+    static char names[MAX_WORKERS][32];
+    uint32_t i;
+
+    memset(&app, 0, sizeof(app));
+
+    app.crypto_params.engine = CCMP_ENGINE_INLINE;
+    app.crypto_params.async = async;
+
+    app.link_params[AP_LINK].mac_addr.addr_bytes[5] = 0x10;
+    app.link_params[WAG_LINK].mac_addr.addr_bytes[5] = 0x11;
+    app.addr_params.vnfd_ip_to_ap = IPv4(10, 0, 1, 1);
+    app.addr_params.vnfd_port_to_ap = 5001;
+    app.addr_params.vnfd_ip_to_wag = IPv4(10, 0, 2, 1);
+    app.addr_params.wag_tun_ip = IPv4(10, 0, 2, 2);
+    app.addr_params.wag_tun_mac.addr_bytes[5] = 0x20;
+
+    app.n_threads = nb_workers;
+    for (i = 0; i < nb_workers; i++) {
+        struct app_thread_params *p = &(app.thread_params[i]);
+
+        snprintf(names[i], sizeof(names[i]), "RXQ0.%u", i);
+        app.hwq_in_params[i].name = names[i];
+
+        p->name = "UPLINK_THREAD";
+        strcpy(p->type, "UPLINK_THREAD");
+        p->lcore_id = 1 + i;
+        p->crypto_qp = i;
+
+        p->n_pktq_in = 1;
+        p->pktq_in[UL_SRC_PORT].type = APP_PKTQ_IN_HWQ;
+        p->pktq_in[UL_SRC_PORT].id = i;
+
+        p->n_ports_in = 1;
+        p->port_in[UL_SRC_PORT].type = THREAD_PORT_IN_ETHDEV_READER;
+        p->port_in[UL_SRC_PORT].params.ethdev.port_id = AP_LINK;
+        p->port_in[UL_SRC_PORT].params.ethdev.queue_id = i;
+
+        p->n_ports_out = 2;
+        p->port_out[UL_DST_PORT_WAG].type = THREAD_PORT_OUT_ETHDEV_WRITER;
+        p->port_out[UL_DST_PORT_WAG].params.ethdev.port_id = WAG_LINK;
+        p->port_out[UL_DST_PORT_WAG].params.ethdev.queue_id = i;
+        p->port_out[UL_DST_PORT_AP].type = THREAD_PORT_OUT_ETHDEV_WRITER;
+        p->port_out[UL_DST_PORT_AP].params.ethdev.port_id = AP_LINK;
+        p->port_out[UL_DST_PORT_AP].params.ethdev.queue_id = i;
+    }
+}
+
+/*
+ * the RXQ of each thread gets the frames of the stations steered to
+ * it, interleaved, as RSS would
+ */
+static void
+frames_build(uint32_t nb_workers)
+{
+    uint32_t i, w, s;
+
+    for (w = 0; w < nb_workers; w++) {
+        struct test_queue *q = &queues[w];
+
+        memset(q, 0, sizeof(*q));
+        q->nb_frames = NB_FRAMES / nb_workers;
+        q->frames = calloc(q->nb_frames, sizeof(struct rte_mbuf *));
+        if (q->frames == NULL)
+            rte_exit(EXIT_FAILURE, "Out of memory\n");
+
+        for (i = 0, s = w; i < q->nb_frames; i++) {
+            q->frames[i] = frame_build(s);
+            s += nb_workers;
+            if (s >= NB_STAS)
+                s = w;
+        }
+    }
+}
+
+static void *
+worker_main(void *arg)
+{
+    struct app_thread_params *p = arg;
+
+    shim_lcore_id_set(p->lcore_id);
+
+    p->thread_ctx = thread_uplink.thread_ops->f_init(p, &app);
+    thread_uplink.thread_ops->f_run(p->thread_ctx);
+    thread_uplink.thread_ops->f_free(p->thread_ctx);
+
+    return NULL;
+}
+
+static int
+run(uint32_t nb_workers, int async)
+{
+    pthread_t workers[MAX_WORKERS];
+    uint64_t nb_tx, prev_nb_tx = 0, nb_errors = 0, nb_frames = 0;
+    uint64_t start_tsc, end_tsc = 0, stall_tsc;
+    uint32_t i;
+    int sts = 0;
+
+    app_setup(nb_workers, async);
+    frames_build(nb_workers);
+
+    for (i = 0; i < NB_STAS; i++)
+        stas[i].last_seq = stas[i].next_seq - (NB_FRAMES / NB_STAS);
+
+    force_quit = 0;
+    started = 0;
+    shim_lcore_count = 1 + nb_workers;
+    for (i = 0; i < nb_workers; i++)
+        pthread_create(&workers[i], NULL, worker_main,
+                       &(app.thread_params[i]));
+
+    /* let the threads initialize, then open the RXQs */
+    usleep(100000);
+    start_tsc = rte_rdtsc();
+    rte_smp_wmb();
+    started = 1;
+
+    stall_tsc = start_tsc;
+    for (;;) {
+        usleep(1000);
+
+        for (i = 0, nb_tx = 0; i < nb_workers; i++)
+            nb_tx += queues[i].nb_tx;
+        if (nb_tx == NB_FRAMES / nb_workers * nb_workers)
+            break;
+
+        if (nb_tx != prev_nb_tx) {
+            prev_nb_tx = nb_tx;
+            stall_tsc = rte_rdtsc();
+        } else if (rte_rdtsc() - stall_tsc >
+                   STALL_MS * rte_get_tsc_hz() / MS_PER_S) {
+            break;
+        }
+    }
+
+    force_quit = 1;
+    for (i = 0; i < nb_workers; i++)
+        pthread_join(workers[i], NULL);
+
+    for (i = 0, nb_tx = 0; i < nb_workers; i++) {
+        nb_frames += queues[i].nb_frames;
+        nb_tx += queues[i].nb_tx;
+        nb_errors += queues[i].nb_errors;
+        end_tsc = RTE_MAX(end_tsc, queues[i].last_tx_tsc);
+    }
+
+    printf("uplink, %s: %u thread(s), %" PRIu64 " frames in %.1f ms, "
+           "%.2f Mpps (%.2f Mpps per thread)\n",
+           async ? "async" : "sync", nb_workers, nb_tx,
+           (double)(end_tsc - start_tsc) * MS_PER_S / rte_get_tsc_hz(),
+           (double)nb_tx * rte_get_tsc_hz() / US_PER_S /
+               (double)(end_tsc - start_tsc),
+           (double)nb_tx * rte_get_tsc_hz() / US_PER_S /
+               (double)(end_tsc - start_tsc) / nb_workers);
+
+    if (nb_workers > (uint32_t)sysconf(_SC_NPROCESSORS_ONLN))
+        printf("  (more threads than CPUs, the threads share the CPUs)\n");
+
+    if (nb_tx != nb_frames) {
+        fprintf(stderr, "%" PRIu64 " frames of %" PRIu64 " sent to the WAG\n",
+                nb_tx, nb_frames);
+        sts = -1;
+    }
+
+    if (nb_errors != 0) {
+        fprintf(stderr, "%" PRIu64 " frames misrouted or out of order\n",
+                nb_errors);
+        sts = -1;
+    }
+
+    /* the frames are only all accounted for when none was dropped */
+    for (i = 0; i < nb_workers; i++) {
+        uint32_t j;
+
+        if (sts == 0)
+            for (j = 0; j < queues[i].nb_frames; j++)
+                rte_pktmbuf_free(queues[i].frames[j]);
+        free(queues[i].frames);
+    }
+
+    return sts;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct app_store_params store_params = {
+        .vaps_max = NB_VAPS,
+        .stas_max = NB_STAS,
+    };
+    struct app_addr_params addr_params;
+    uint32_t nb_workers[MAX_WORKERS] = { 1, 2, 4, 8 };
+    uint32_t nb_runs = 4;
+    uint8_t key[CCMP_128_KEY_LEN];
+    uint32_t i, j;
+    int async, sts = 0;
+
+    if (!__builtin_cpu_supports("aes")) {
+        printf("SKIP: the inline engine needs AES-NI\n");
+        return 0;
+    }
+
+    if (argc > 1) {
+        for (nb_runs = 0; nb_runs < (uint32_t)argc - 1; nb_runs++) {
+            if (nb_runs < MAX_WORKERS)
+                nb_workers[nb_runs] = (uint32_t)atoi(argv[1 + nb_runs]);
+            if (nb_runs == MAX_WORKERS || nb_workers[nb_runs] == 0 ||
+                nb_workers[nb_runs] > MAX_WORKERS)
+                rte_exit(EXIT_FAILURE, "Usage: %s [1-%u thread(s)...]\n",
+                         argv[0], MAX_WORKERS);
+        }
+    }
+
+    printf("%ld CPU(s) online\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+    shim_lcore_id_set(0);
+    ccmp_engine_set(CCMP_ENGINE_INLINE);
+    ccmp_inline_lcore_init();
+
+    memset(&addr_params, 0, sizeof(addr_params));
+    store_init(0, &store_params, &addr_params);
+
+    for (i = 0; i < NB_VAPS; i++) {
+        vap_addrs[i].addr_bytes[0] = 0x06;
+        vap_addrs[i].addr_bytes[5] = (uint8_t)i;
+        if (store_vap_add(&vap_addrs[i]) == NULL)
+            rte_exit(EXIT_FAILURE, "Cannot add vAP %u\n", i);
+    }
+
+    for (i = 0; i < NB_STAS; i++) {
+        struct test_sta *ts = &stas[i];
+
+        ts->addr.addr_bytes[0] = 0x02;
+        ts->addr.addr_bytes[4] = (uint8_t)(i >> 8);
+        ts->addr.addr_bytes[5] = (uint8_t)i;
+        ts->vap_addr = &vap_addrs[i % NB_VAPS];
+
+        ts->sta = store_sta_add(&(ts->addr), ts->vap_addr);
+        if (ts->sta == NULL)
+            rte_exit(EXIT_FAILURE, "Cannot add station %u\n", i);
+
+        for (j = 0; j < CCMP_128_KEY_LEN; j++)
+            key[j] = (uint8_t)(i * 31 + j);
+        sta_ptk_set(ts->sta, key, CCMP_128_KEY_LEN, CCMP_CIPHER_CCMP);
+    }
+
+    for (async = 0; async <= 1; async++)
+        for (i = 0; i < nb_runs; i++)
+            if (run(nb_workers[i], async) != 0)
+                sts = 1;
+
+    for (i = 0; i < NB_STAS; i++)
+        store_sta_del(&(stas[i].addr));
+    for (i = 0; i < NB_VAPS; i++)
+        store_vap_del(&vap_addrs[i]);
+    store_cleanup();
+
+    printf("%s\n", sts == 0 ? "PASS" : "FAIL");
+
+    return sts;
+}
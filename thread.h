@@ -44,8 +44,13 @@
 #define APP_MAX_THREAD_ARGS                  64
 #endif
 
-#define APP_MAX_THREAD_PKTQ_IN                2
-#define APP_MAX_THREAD_PKTQ_OUT               2
+#ifndef APP_MAX_THREAD_PKTQ_IN
+#define APP_MAX_THREAD_PKTQ_IN               16
+#endif
+
+#ifndef APP_MAX_THREAD_PKTQ_OUT
+#define APP_MAX_THREAD_PKTQ_OUT              16
+#endif
 
 #ifndef THREAD_MAX_PORT_IN
 #define THREAD_MAX_PORT_IN                   64
@@ -57,6 +62,7 @@
 
 #include <rte_common.h>
 #include <rte_port_ethdev.h>
+#include <rte_ring.h>
 
 struct app_thread_params;
 
@@ -79,6 +85,7 @@ struct thread_type {
 
 enum app_pktq_in_type {
     APP_PKTQ_IN_HWQ,
+    APP_PKTQ_IN_SWQ,
 };
 
 struct app_pktq_in_params {
@@ -88,6 +95,7 @@ struct app_pktq_in_params {
 
 enum app_pktq_out_type {
     APP_PKTQ_OUT_HWQ,
+    APP_PKTQ_OUT_SWQ,
 };
 
 struct app_pktq_out_params {
@@ -97,17 +105,35 @@ struct app_pktq_out_params {
 
 enum thread_port_in_type {
     THREAD_PORT_IN_ETHDEV_READER,
+    THREAD_PORT_IN_RING_READER,
 };
 
 enum thread_port_out_type {
     THREAD_PORT_OUT_ETHDEV_WRITER,
     THREAD_PORT_OUT_ETHDEV_WRITER_NODROP,
+    THREAD_PORT_OUT_RING_WRITER,
+};
+
+/*
+ * SWQ reader
+ * - port_id is the NIC port the packets on the ring were received on,
+ *   i.e. the port read by the thread writing to the ring
+ */
+struct thread_port_ring_reader_params {
+    struct rte_ring *ring;
+    uint16_t port_id;
+};
+
+struct thread_port_ring_writer_params {
+    struct rte_ring *ring;
+    uint32_t tx_burst_sz;
 };
 
 struct thread_port_in_params {
     enum thread_port_in_type type;
     union {
         struct rte_port_ethdev_reader_params ethdev;
+        struct thread_port_ring_reader_params ring;
     } params;
     uint32_t burst_size;
 };
@@ -118,6 +144,7 @@ struct thread_port_out_params {
     union {
         struct rte_port_ethdev_writer_params ethdev;
         struct rte_port_ethdev_writer_nodrop_params ethdev_nodrop;
+        struct thread_port_ring_writer_params ring;
     } params;
     uint32_t burst_size;
 };
@@ -128,6 +155,8 @@ thread_port_in_params_convert(struct thread_port_in_params *p)
     switch (p->type) {
         case THREAD_PORT_IN_ETHDEV_READER:
             return (void *) &p->params.ethdev;
+        case THREAD_PORT_IN_RING_READER:
+            return (void *) &p->params.ring;
         default:
             return NULL;
     }
@@ -139,11 +168,35 @@ thread_port_in_get_id(struct thread_port_in_params *p)
     switch (p->type) {
         case THREAD_PORT_IN_ETHDEV_READER:
             return p->params.ethdev.port_id;
+        case THREAD_PORT_IN_RING_READER:
+            return p->params.ring.port_id;
         default:
             return -1;
     }
 }
 
+static inline int
+thread_port_in_get_queue_id(struct thread_port_in_params *p)
+{
+    switch (p->type) {
+        case THREAD_PORT_IN_ETHDEV_READER:
+            return p->params.ethdev.queue_id;
+        default:
+            return -1;
+    }
+}
+
+static inline struct rte_ring *
+thread_port_in_get_ring(struct thread_port_in_params *p)
+{
+    switch (p->type) {
+        case THREAD_PORT_IN_RING_READER:
+            return p->params.ring.ring;
+        default:
+            return NULL;
+    }
+}
+
 static inline void *
 thread_port_out_params_convert(struct thread_port_out_params *p)
 {
@@ -152,6 +205,8 @@ thread_port_out_params_convert(struct thread_port_out_params *p)
             return (void *) &p->params.ethdev;
         case THREAD_PORT_OUT_ETHDEV_WRITER_NODROP:
             return (void *) &p->params.ethdev_nodrop;
+        case THREAD_PORT_OUT_RING_WRITER:
+            return (void *) &p->params.ring;
         default:
             return NULL;
     }
@@ -195,6 +250,17 @@ thread_port_out_get_queue_id(struct thread_port_out_params *p)
     }
 }
 
+static inline struct rte_ring *
+thread_port_out_get_ring(struct thread_port_out_params *p)
+{
+    switch (p->type) {
+        case THREAD_PORT_OUT_RING_WRITER:
+            return p->params.ring.ring;
+        default:
+            return NULL;
+    }
+}
+
 struct app_thread_params {
     char *name;
     char type[APP_THREAD_TYPE_SIZE];
@@ -216,7 +282,9 @@ struct app_thread_params {
     struct thread_port_out_params port_out[THREAD_MAX_PORT_OUT];
     uint32_t n_ports_in;
     uint32_t n_ports_out;
+    uint8_t crypto_dev; /** APP_CRYPTO_DEV_NONE for the first device */
     uint16_t crypto_qp;
+    void *thread_ctx; /** per-instance context returned by f_init() */
 };
 
 #endif // __INCLUDE_THREAD_H__
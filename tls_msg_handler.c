@@ -38,6 +38,7 @@
 
 #include <rte_common.h>
 #include <rte_mbuf.h>
+#include <rte_hash.h>
 
 #include "r-wpa_global_vars.h"
 #include "app.h"
@@ -50,10 +51,12 @@
 #include "wpapt_cdi.h"
 #include "wpapt_cdi_helper.h"
 #include "tls_msg_handler.h"
+#include "counter.h"
 #include "ieee80211.h"
 #include "ieee80211_utils.h"
 #include "ieee8022.h"
 #include "eapol.h"
+#include "ccmp.h"
 
 int init(struct rte_mbuf *data);
 int status(struct rte_mbuf *data);
@@ -64,19 +67,29 @@ int sta_del(struct rte_mbuf *data);
 int key_set(struct rte_mbuf *data);
 int frame(struct rte_mbuf *data);
 int eapol_mic(struct rte_mbuf *data);
+int bss_add_bulk(struct rte_mbuf *data);
+int sta_add_bulk(struct rte_mbuf *data);
+int key_set_bulk(struct rte_mbuf *data);
+int ptk_rx_set(struct rte_mbuf *data);
+int ptk_tx_set(struct rte_mbuf *data);
 
 const struct ether_addr gtk_addr = { .addr_bytes = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
 
 tls_handler_ctx_t tls_handlers[] = {
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_INIT,       init      },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STATUS,     status    },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_BSS_ADD,    bss_add   },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_BSS_REMOVE, bss_del   },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STA_ADD,    sta_add   },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STA_REMOVE, sta_del   },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_SET_KEY,    key_set   },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_FRAME,      frame     },
-    { SOCKET, (uint16_t)WPAPT_CDI_MSG_EAPOL_MIC,  eapol_mic },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_INIT,          init         },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STATUS,        status       },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_BSS_ADD,       bss_add      },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_BSS_REMOVE,    bss_del      },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STA_ADD,       sta_add      },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STA_REMOVE,    sta_del      },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_SET_KEY,       key_set      },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_FRAME,         frame        },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_EAPOL_MIC,     eapol_mic    },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_BSS_ADD_BULK,  bss_add_bulk },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_STA_ADD_BULK,  sta_add_bulk },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_SET_KEY_BULK,  key_set_bulk },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_SET_PTK_RX,    ptk_rx_set   },
+    { SOCKET, (uint16_t)WPAPT_CDI_MSG_SET_PTK_TX,    ptk_tx_set   },
     { EOL }
 };
 
@@ -170,6 +183,11 @@ int bss_del(struct rte_mbuf *data)
                 bss_remove->bssid[5]);
     }
 
+#ifdef RWPA_VALIDATION_PLUS
+    if (store_check() != RWPA_STS_OK)
+        RTE_LOG(ERR, RWPA_TLS, "Store inconsistent after bss delete\n");
+#endif
+
     return TLS_HANDLER_ACTION_NONE;
 }
 
@@ -228,17 +246,98 @@ int sta_del(struct rte_mbuf *data)
     return TLS_HANDLER_ACTION_NONE;
 }
 
-int key_set(struct rte_mbuf *data)
+/*
+ * map the set key cipher suite to the CCMP SA cipher
+ * - the key length must match the -128 or -256 variant
+ * - WPAPT_ALG_NONE is taken as CCMP, as sent by controllers
+ *   which do not fill in the cipher suite
+ * - GCMP is refused if the crypto engine cannot do it, rather than
+ *   installing a key the station's packets would fail with
+ */
+static enum rwpa_status
+key_cipher_get(uint16_t alg, uint8_t key_len, enum ccmp_cipher *cipher)
 {
-    struct wpapt_cdi_msg_set_key *set_key =
-            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_set_key *);
+    switch (alg) {
+    case WPAPT_ALG_NONE:
+        *cipher = CCMP_CIPHER_CCMP;
+        return RWPA_STS_OK;
+
+    case WPAPT_ALG_CCMP:
+        *cipher = CCMP_CIPHER_CCMP;
+        return key_len == CCMP_128_KEY_LEN ? RWPA_STS_OK : RWPA_STS_ERR;
+
+    case WPAPT_ALG_CCMP_256:
+        *cipher = CCMP_CIPHER_CCMP;
+        return key_len == CCMP_256_KEY_LEN ? RWPA_STS_OK : RWPA_STS_ERR;
+
+    case WPAPT_ALG_GCMP:
+        *cipher = CCMP_CIPHER_GCMP;
+        return (key_len == CCMP_128_KEY_LEN && ccmp_gcmp_supported()) ?
+                   RWPA_STS_OK : RWPA_STS_ERR;
+
+    case WPAPT_ALG_GCMP_256:
+        *cipher = CCMP_CIPHER_GCMP;
+        return (key_len == CCMP_256_KEY_LEN && ccmp_gcmp_supported()) ?
+                   RWPA_STS_OK : RWPA_STS_ERR;
+
+    default:
+        return RWPA_STS_ERR;
+    }
+}
+
+/*
+ * install the key of a set key message
+ * - sta is the station looked up for a PTK, and is ignored for
+ *   other keys
+ */
+static int
+key_apply(struct wpapt_cdi_msg_set_key *set_key, struct sta_elem *sta)
+{
+    enum ccmp_cipher cipher;
 
     unsigned key_id = set_key->key_idx;
     /* 0: PTK; 1,2: GTK; 3,4: IGTK */
 
+    /* a GTK without key material retires the GTK kept for RX */
+    if ((key_id == GTK1 || key_id == GTK2) && set_key->key_len == 0) {
+        struct vap_elem *vap =
+                store_vap_lookup((struct ether_addr *)set_key->bssid);
+
+        if (vap == NULL || vap_gtk_retire(vap, key_id) != RWPA_STS_OK) {
+            RTE_LOG(ERR, RWPA_TLS,
+                    "Could not retire GTK %u of vap "
+                    "(%02x:%02x:%02x:%02x:%02x:%02x)\n",
+                    key_id,
+                    set_key->bssid[0],
+                    set_key->bssid[1],
+                    set_key->bssid[2],
+                    set_key->bssid[3],
+                    set_key->bssid[4],
+                    set_key->bssid[5]);
+            return TLS_HANDLER_ACTION_ERROR;
+        }
+        return TLS_HANDLER_ACTION_NONE;
+    }
+
+    if ((key_id == 0 || key_id == GTK1 || key_id == GTK2) &&
+        key_cipher_get(set_key->cipher_suite, set_key->key_len,
+                       &cipher) == RWPA_STS_ERR) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Unsupported cipher suite %u with key length %u "
+                "for key %u of sta (%02x:%02x:%02x:%02x:%02x:%02x)\n",
+                set_key->cipher_suite,
+                set_key->key_len,
+                key_id,
+                set_key->sta_addr[0],
+                set_key->sta_addr[1],
+                set_key->sta_addr[2],
+                set_key->sta_addr[3],
+                set_key->sta_addr[4],
+                set_key->sta_addr[5]);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
     if (key_id == 0) {
-        struct sta_elem *sta;
-        sta = store_sta_lookup((struct ether_addr *)set_key->sta_addr);
         if (sta == NULL) {
             RTE_LOG(ERR, RWPA_TLS,
                     "Could not lookup sta (%02x:%02x:%02x:%02x:%02x:%02x) "
@@ -251,7 +350,8 @@ int key_set(struct rte_mbuf *data)
                     set_key->sta_addr[5]);
             return TLS_HANDLER_ACTION_ERROR;
         }
-        sta_ptk_set(sta, (const uint8_t *)&(set_key->key), set_key->key_len);
+        sta_ptk_set(sta, (const uint8_t *)&(set_key->key), set_key->key_len,
+                    cipher);
 
     } else if (key_id == GTK1 || key_id == GTK2) {
         if (is_same_ether_addr((struct ether_addr *)set_key->sta_addr, &gtk_addr)) {
@@ -260,7 +360,7 @@ int key_set(struct rte_mbuf *data)
             if (vap) {
                 vap_gtk_set(vap, key_id,
                             (const uint8_t *)&(set_key->key),
-                            set_key->key_len, TRUE);
+                            set_key->key_len, cipher, TRUE);
             }
         }
     }
@@ -268,6 +368,18 @@ int key_set(struct rte_mbuf *data)
     return TLS_HANDLER_ACTION_NONE;
 }
 
+int key_set(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_set_key *set_key =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_set_key *);
+    struct sta_elem *sta = NULL;
+
+    if (set_key->key_idx == 0)
+        sta = store_sta_lookup((struct ether_addr *)set_key->sta_addr);
+
+    return key_apply(set_key, sta);
+}
+
 int frame(struct rte_mbuf *data)
 {
     struct wpapt_cdi_msg_frame *frame =
@@ -365,3 +477,222 @@ int eapol_mic(struct rte_mbuf *data)
     return TLS_HANDLER_ACTION_NONE;
 }
 
+int bss_add_bulk(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_bss_add_bulk *bss_add =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_bss_add_bulk *);
+    struct ether_addr *vap_addrs[STORE_BULK_ADD_MAX];
+    struct vap_elem *vaps[STORE_BULK_ADD_MAX];
+    uint32_t i, j, n, nb_added = 0;
+
+    /* the count has to be there before it can be checked */
+    if (rte_pktmbuf_data_len(data) < sizeof(*bss_add)) {
+        RTE_LOG(ERR, RWPA_TLS, "Bulk bss add message too short\n");
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    if (rte_pktmbuf_data_len(data) < sizeof(*bss_add) +
+            bss_add->count * sizeof(bss_add->entries[0])) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Bulk bss add message too short for %u bss\n",
+                bss_add->count);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    for (i = 0; i < bss_add->count; i += n) {
+        n = RTE_MIN(bss_add->count - i, (uint32_t)STORE_BULK_ADD_MAX);
+        for (j = 0; j < n; j++)
+            vap_addrs[j] = (struct ether_addr *)bss_add->entries[i + j].bssid;
+
+        nb_added += store_vap_bulk_add(vap_addrs, n, vaps);
+    }
+
+    if (nb_added < bss_add->count)
+        RTE_LOG(ERR, RWPA_TLS,
+                "Could not add %u of %u bss to store\n",
+                bss_add->count - nb_added, bss_add->count);
+
+    return TLS_HANDLER_ACTION_NONE;
+}
+
+int sta_add_bulk(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_sta_add_bulk *sta_add =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_sta_add_bulk *);
+    struct ether_addr *sta_addrs[STORE_BULK_ADD_MAX];
+    struct ether_addr *vap_addrs[STORE_BULK_ADD_MAX];
+    struct sta_elem *stas[STORE_BULK_ADD_MAX];
+    uint32_t i, j, n, nb_added = 0;
+
+    if (rte_pktmbuf_data_len(data) < sizeof(*sta_add)) {
+        RTE_LOG(ERR, RWPA_TLS, "Bulk sta add message too short\n");
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    if (rte_pktmbuf_data_len(data) < sizeof(*sta_add) +
+            sta_add->count * sizeof(sta_add->entries[0])) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Bulk sta add message too short for %u sta\n",
+                sta_add->count);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    for (i = 0; i < sta_add->count; i += n) {
+        n = RTE_MIN(sta_add->count - i, (uint32_t)STORE_BULK_ADD_MAX);
+        for (j = 0; j < n; j++) {
+            sta_addrs[j] = (struct ether_addr *)sta_add->entries[i + j].sta_addr;
+            vap_addrs[j] = (struct ether_addr *)sta_add->entries[i + j].bssid;
+        }
+
+        nb_added += store_sta_bulk_add(sta_addrs, vap_addrs, n, stas);
+    }
+
+    if (nb_added < sta_add->count)
+        RTE_LOG(ERR, RWPA_TLS,
+                "Could not add %u of %u sta to store\n",
+                sta_add->count - nb_added, sta_add->count);
+
+    return TLS_HANDLER_ACTION_NONE;
+}
+
+/* the most set key entries which fit in a message */
+#define KEY_SET_BULK_MAX \
+    (WPAPT_CDI_MAX_MSG / sizeof(struct wpapt_cdi_msg_set_key) + 1)
+
+int key_set_bulk(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_set_key_bulk *set_key_bulk =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_set_key_bulk *);
+    struct wpapt_cdi_msg_set_key *set_keys[KEY_SET_BULK_MAX];
+    struct ether_addr *sta_addrs[RTE_HASH_LOOKUP_BULK_MAX];
+    int32_t found[RTE_HASH_LOOKUP_BULK_MAX];
+    uint32_t ptk_idx[RTE_HASH_LOOKUP_BULK_MAX];
+    struct sta_elem *stas[KEY_SET_BULK_MAX];
+    uint32_t len = rte_pktmbuf_data_len(data);
+    uint32_t off = sizeof(*set_key_bulk);
+    uint32_t i, j, n = 0, nb_failed = 0;
+
+    if (len < off) {
+        RTE_LOG(ERR, RWPA_TLS, "Bulk key set message too short\n");
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    /* find the entries, checking they are all within the message */
+    for (i = 0; i < set_key_bulk->count; i++) {
+        struct wpapt_cdi_msg_set_key *set_key =
+            (struct wpapt_cdi_msg_set_key *)((uint8_t *)set_key_bulk + off);
+
+        if (i == KEY_SET_BULK_MAX || len < off + sizeof(*set_key) ||
+            len < off + sizeof(*set_key) + set_key->key_len) {
+            RTE_LOG(ERR, RWPA_TLS,
+                    "Bulk key set message too short for %u keys\n",
+                    set_key_bulk->count);
+            return TLS_HANDLER_ACTION_ERROR;
+        }
+
+        set_keys[i] = set_key;
+        stas[i] = NULL;
+        off += sizeof(*set_key) + set_key->key_len;
+    }
+
+    /* lookup the stations of the PTKs, a burst at a time */
+    for (i = 0; i < set_key_bulk->count; i++) {
+        if (set_keys[i]->key_idx == 0) {
+            ptk_idx[n] = i;
+            sta_addrs[n++] = (struct ether_addr *)set_keys[i]->sta_addr;
+        }
+
+        if (n == RTE_HASH_LOOKUP_BULK_MAX ||
+            (n > 0 && i == set_key_bulk->count - 1u)) {
+            store_sta_bulk_lookup(sta_addrs, n, found);
+            for (j = 0; j < n; j++)
+                stas[ptk_idx[j]] = found[j] >= 0 ?
+                                   store_sta_get(found[j]) : NULL;
+            n = 0;
+        }
+    }
+
+    for (i = 0; i < set_key_bulk->count; i++)
+        if (key_apply(set_keys[i], stas[i]) != TLS_HANDLER_ACTION_NONE)
+            nb_failed++;
+
+    if (nb_failed > 0)
+        RTE_LOG(ERR, RWPA_TLS,
+                "Could not set %u of %u keys\n",
+                nb_failed, set_key_bulk->count);
+
+    return TLS_HANDLER_ACTION_NONE;
+}
+
+int ptk_rx_set(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_set_key *set_key =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_set_key *);
+    struct sta_elem *sta;
+    enum ccmp_cipher cipher;
+
+    if (key_cipher_get(set_key->cipher_suite, set_key->key_len,
+                       &cipher) == RWPA_STS_ERR) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Unsupported cipher suite %u with key length %u "
+                "for PTK %u of sta (%02x:%02x:%02x:%02x:%02x:%02x)\n",
+                set_key->cipher_suite,
+                set_key->key_len,
+                set_key->key_idx,
+                set_key->sta_addr[0],
+                set_key->sta_addr[1],
+                set_key->sta_addr[2],
+                set_key->sta_addr[3],
+                set_key->sta_addr[4],
+                set_key->sta_addr[5]);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    sta = store_sta_lookup((struct ether_addr *)set_key->sta_addr);
+    if (sta == NULL ||
+        set_key->key_idx >= PTK_KEY_ID_NUM ||
+        sta_ptk_rx_set(sta, (uint8_t)set_key->key_idx,
+                       (const uint8_t *)&(set_key->key),
+                       set_key->key_len, cipher) != RWPA_STS_OK) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Could not set PTK %u for RX of sta "
+                "(%02x:%02x:%02x:%02x:%02x:%02x)\n",
+                set_key->key_idx,
+                set_key->sta_addr[0],
+                set_key->sta_addr[1],
+                set_key->sta_addr[2],
+                set_key->sta_addr[3],
+                set_key->sta_addr[4],
+                set_key->sta_addr[5]);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    return TLS_HANDLER_ACTION_NONE;
+}
+
+int ptk_tx_set(struct rte_mbuf *data)
+{
+    struct wpapt_cdi_msg_set_ptk_tx *set_ptk_tx =
+            rte_pktmbuf_mtod(data, struct wpapt_cdi_msg_set_ptk_tx *);
+    struct sta_elem *sta;
+
+    sta = store_sta_lookup((struct ether_addr *)set_ptk_tx->sta_addr);
+    if (sta == NULL ||
+        set_ptk_tx->key_idx >= PTK_KEY_ID_NUM ||
+        sta_ptk_tx_set(sta, (uint8_t)set_ptk_tx->key_idx,
+                       store_ptk_rx_overlap_get()) != RWPA_STS_OK) {
+        RTE_LOG(ERR, RWPA_TLS,
+                "Could not switch TX to PTK %u of sta "
+                "(%02x:%02x:%02x:%02x:%02x:%02x)\n",
+                set_ptk_tx->key_idx,
+                set_ptk_tx->sta_addr[0],
+                set_ptk_tx->sta_addr[1],
+                set_ptk_tx->sta_addr[2],
+                set_ptk_tx->sta_addr[3],
+                set_ptk_tx->sta_addr[4],
+                set_ptk_tx->sta_addr[5]);
+        return TLS_HANDLER_ACTION_ERROR;
+    }
+
+    return TLS_HANDLER_ACTION_NONE;
+}
@@ -37,19 +37,40 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <unistd.h>
-#include <poll.h>
 #include <fcntl.h>
-#include <sys/time.h>
 #include <sys/socket.h>
 
 #include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_cycles.h>
 
 #include "wpapt_cdi.h"
 #include "r-wpa_global_vars.h"
+#ifdef RWPA_STATS_CAPTURE
+#include "statistics_capture.h"
+#endif
+
+#if !defined RWPA_STATS_CAPTURE_CONTROL_OFF && defined RWPA_STATS_CAPTURE
+
+#define TLS_TX_QUEUED_STATS(depth)                                             \
+     stats_capture_control_tls_tx_queued(depth);
+#define TLS_TX_WRITTEN_STATS(bytes, cycles)                                    \
+     stats_capture_control_tls_tx_written(bytes, cycles);
+#define TLS_TX_BLOCKED_STATS()                                                 \
+     stats_capture_control_tls_tx_blocked();
+
+#else
+
+#define TLS_TX_QUEUED_STATS(depth)
+#define TLS_TX_WRITTEN_STATS(bytes, cycles)
+#define TLS_TX_BLOCKED_STATS()
+
+#endif
 
 static struct rte_mempool *mp;
 
@@ -161,14 +182,18 @@ tls_socket_init(struct tls_socket *socket,
 {
     socket->s_server = -1;
     socket->ctx = ctx;
+    socket->rx_head = 0;
+    socket->rx_tail = 0;
+    socket->tx_len = 0;
+    socket->tx_retry_len = 0;
+    socket->tx_drain_tsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S *
+                           misc_params->tls_tx_drain_us;
     mp = mempool;
 
 #ifndef RWPA_NO_TLS
     openssl_init();
     socket->ssl_ctx = openssl_create_context();
     openssl_configure_context(socket->ssl_ctx, misc_params->certs_dir, misc_params->certs_password);
-#else
-    UNUSED(misc_params);
 #endif
     socket->s_server = create_tcp_sock(tls_socket_server_ip, tls_ss_portid);
 
@@ -179,6 +204,7 @@ tls_socket_init(struct tls_socket *socket,
     socket->ssl = SSL_new(socket->ssl_ctx);
 
     SSL_set_fd(socket->ssl, socket->s_server);
+    SSL_set_mode(socket->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
     int ssl_success = -1;
     while (ssl_success != 1) {
@@ -195,97 +221,204 @@ tls_socket_free(void)
 #endif
 }
 
+/*
+ * queue a WPAPT message for the controller
+ * - the message is copied to the transmit buffer and the mbuf freed
+ * - fails, leaving the mbuf to the caller, if the buffer is full even
+ *   after trying to flush it
+ */
 int
 tls_socket_write(struct tls_socket *socket, struct rte_mbuf *mbuf)
 {
-    void *data = rte_pktmbuf_mtod(mbuf, void *);
-#ifdef RWPA_NO_TLS
-    int ret = write(socket->s_server, data, mbuf->data_len);
-#else
-    int ret = SSL_write(socket->ssl, data, mbuf->data_len);
-#endif
-    return ret;
-}
+    uint32_t len = rte_pktmbuf_data_len(mbuf);
 
-uint32_t
-poll_sock(struct tls_socket *tls, struct rte_mbuf **pkts_burst, uint16_t nb_pkts)
-{
-    uint32_t nb_rx = 0;
-    uint16_t rlen = 0;
-    int activity;
-    unsigned int read_bytes = 0;
+    if (unlikely(len > TLS_SOCKET_TX_BUF_SZ - socket->tx_len)) {
+        tls_socket_flush(socket);
+        if (len > TLS_SOCKET_TX_BUF_SZ - socket->tx_len)
+            return -1;
+    }
+
+    if (socket->tx_len == 0)
+        socket->tx_first_tsc = rte_rdtsc();
 
-    fd_set readfds;
+    rte_memcpy(&socket->tx_buf[socket->tx_len],
+               rte_pktmbuf_mtod(mbuf, void *), len);
+    socket->tx_len += len;
+    rte_pktmbuf_free(mbuf);
 
-    struct timeval tv = {0,0};
+    TLS_TX_QUEUED_STATS(socket->tx_len);
 
-    unsigned int new_mbuf_needed = TRUE;
-    struct rte_mbuf *mbuf = NULL;
+    if (socket->tx_len >= TLS_SOCKET_TX_RECORD_SZ)
+        tls_socket_flush(socket);
+
+    return len;
+}
 
-    while(nb_rx < nb_pkts) {
-        if (new_mbuf_needed) {
-            mbuf = rte_pktmbuf_alloc(mp);
-            if (mbuf == NULL) {
+/*
+ * write the queued messages, a record at a time, until they are all
+ * written or the socket is not writable
+ * - an SSL_write() which could not complete must be retried with the
+ *   same length
+ */
+void
+tls_socket_flush(struct tls_socket *socket)
+{
+    uint32_t off = 0, len;
+    int ret;
+
+    while (off < socket->tx_len) {
+        len = socket->tx_retry_len ? socket->tx_retry_len :
+              RTE_MIN(socket->tx_len - off, (uint32_t)TLS_SOCKET_TX_RECORD_SZ);
+#ifdef RWPA_NO_TLS
+        ret = write(socket->s_server, &socket->tx_buf[off], len);
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                TLS_TX_BLOCKED_STATS();
+                break;
+            }
+#else
+        ret = SSL_write(socket->ssl, &socket->tx_buf[off], len);
+        if (ret <= 0) {
+            int err = SSL_get_error(socket->ssl, ret);
+
+            if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+                socket->tx_retry_len = len;
+                TLS_TX_BLOCKED_STATS();
                 break;
             }
-            new_mbuf_needed = FALSE;
+#endif
+            RTE_LOG(ERR, RWPA_TLS,
+                    "Error writing to tls socket, dropping %u bytes\n",
+                    socket->tx_len - off);
+            off = socket->tx_len;
+            break;
         }
 
-        FD_ZERO(&readfds);
-        FD_SET(tls->s_server, &readfds);
+        socket->tx_retry_len = 0;
+        off += ret;
 
-        activity = select(tls->s_server + 1, &readfds, NULL, NULL, &tv);
+        TLS_TX_WRITTEN_STATS(ret, rte_rdtsc() - socket->tx_first_tsc);
+    }
+
+    if (off == 0)
+        return;
+
+    /* keep the rest at the start of the buffer */
+    socket->tx_len -= off;
+    if (socket->tx_len > 0) {
+        memmove(socket->tx_buf, &socket->tx_buf[off], socket->tx_len);
+        socket->tx_first_tsc = rte_rdtsc();
+    }
+}
+
+/*
+ * read as much as fits into the receive buffer
+ * - the socket is non-blocking, so this stops as soon as there is
+ *   nothing more to read
+ * - the bytes not parsed yet are first moved to the start of the
+ *   buffer, if the space after them is too small for a full message
+ */
+static void
+sock_read(struct tls_socket *tls)
+{
+    int rlen;
+    uint32_t space;
+
+    if (tls->rx_head > 0 &&
+        TLS_SOCKET_RX_BUF_SZ - tls->rx_tail <
+        sizeof(struct wpapt_cdi_msg_header) + WPAPT_CDI_MAX_MSG) {
+        memmove(tls->rx_buf, &tls->rx_buf[tls->rx_head],
+                tls->rx_tail - tls->rx_head);
+        tls->rx_tail -= tls->rx_head;
+        tls->rx_head = 0;
+    }
 
-        if (activity > 0 && FD_ISSET(tls->s_server, &readfds)) {
-            struct wpapt_cdi_msg_header *data = rte_pktmbuf_mtod(mbuf, struct wpapt_cdi_msg_header *);
+    while ((space = TLS_SOCKET_RX_BUF_SZ - tls->rx_tail) > 0) {
 #ifdef RWPA_NO_TLS
-            rlen = read(tls->s_server, (uint8_t *)data + read_bytes, WPAPT_CDI_MAX_MSG - read_bytes);
+        rlen = read(tls->s_server, &tls->rx_buf[tls->rx_tail], space);
 #else
-            rlen = SSL_read(tls->ssl, (uint8_t *)data + read_bytes, WPAPT_CDI_MAX_MSG - read_bytes);
+        rlen = SSL_read(tls->ssl, &tls->rx_buf[tls->rx_tail], space);
 #endif
+        /* no more data (or the connection is gone) */
+        if (rlen < 1)
+            break;
 
-            /* no more data */
-            if (unlikely(rlen < 1 || errno)) {
-                rte_pktmbuf_free(mbuf);
-                break;
-            }
+        tls->rx_tail += rlen;
 
-            read_bytes += rlen;
+#ifdef RWPA_NO_TLS
+        /*
+         * a short read means the socket has been drained
+         * - SSL_read() returns at most one record at a time, so it is
+         *   called until it has nothing more
+         */
+        if ((uint32_t)rlen < space)
+            break;
+#endif
+    }
+}
 
-            /* check if a full header has been received */
-            if (read_bytes < sizeof(struct wpapt_cdi_msg_header)) {
-                continue;
-            }
+uint32_t
+poll_sock(struct tls_socket *tls, struct rte_mbuf **pkts_burst, uint16_t nb_pkts)
+{
+    uint32_t nb_rx = 0;
+    uint32_t msg_len;
+    struct wpapt_cdi_msg_header hdr;
+    struct wpapt_cdi_msg_header *data;
+    struct rte_mbuf *mbuf;
+
+    sock_read(tls);
 
-            /* check validity of message  */
+    while (nb_rx < nb_pkts &&
+           tls->rx_tail - tls->rx_head >= sizeof(struct wpapt_cdi_msg_header)) {
+        memcpy(&hdr, &tls->rx_buf[tls->rx_head], sizeof(hdr));
 #ifdef RWPA_NO_TLS
-            data->magic = ntohl(data->magic);
-            data->message_id = ntohs(data->message_id);
-            data->payload_len = ntohs(data->payload_len);
+        hdr.magic = ntohl(hdr.magic);
+        hdr.message_id = ntohs(hdr.message_id);
+        hdr.payload_len = ntohs(hdr.payload_len);
 #endif
-            if (data->magic != WPAPT_CDI_MAGIC ||
-                data->message_id < 1 ||
-                data->payload_len > WPAPT_CDI_MAX_MSG) {
-                read_bytes = 0;
-                continue;
-            }
 
-            /* check if all data from message has been received */
-            if ((read_bytes - sizeof(struct wpapt_cdi_msg_header)) < data->payload_len) {
-                continue;
-            }
+        /*
+         * check validity of message
+         * - skip a byte at a time until the stream is back in sync
+         */
+        if (hdr.magic != WPAPT_CDI_MAGIC ||
+            hdr.message_id < 1 ||
+            hdr.payload_len > WPAPT_CDI_MAX_MSG) {
+            tls->rx_head++;
+            continue;
+        }
 
-            mbuf->data_len = read_bytes;
-            mbuf->pkt_len = read_bytes;
-            pkts_burst[nb_rx++] = mbuf;
+        /* check if all data from message has been received */
+        msg_len = sizeof(struct wpapt_cdi_msg_header) + hdr.payload_len;
+        if (tls->rx_tail - tls->rx_head < msg_len)
+            break;
 
-            new_mbuf_needed = TRUE;
-            read_bytes = 0;
-        } else {
-            rte_pktmbuf_free(mbuf);
+        /* only now is the message copied to a mbuf */
+        mbuf = rte_pktmbuf_alloc(mp);
+        if (mbuf == NULL)
             break;
+
+        data = (struct wpapt_cdi_msg_header *)rte_pktmbuf_append(mbuf, msg_len);
+        if (unlikely(data == NULL)) {
+            RTE_LOG(ERR, RWPA_TLS,
+                    "WPAPT message of %u bytes does not fit in a mbuf, dropping\n",
+                    msg_len);
+            rte_pktmbuf_free(mbuf);
+            tls->rx_head += msg_len;
+            continue;
         }
+
+        *data = hdr;
+        rte_memcpy(&data[1],
+                   &tls->rx_buf[tls->rx_head + sizeof(struct wpapt_cdi_msg_header)],
+                   hdr.payload_len);
+        pkts_burst[nb_rx++] = mbuf;
+
+        tls->rx_head += msg_len;
     }
 
+    if (tls->rx_head == tls->rx_tail)
+        tls->rx_head = tls->rx_tail = 0;
+
     return nb_rx;
 }
@@ -47,8 +47,32 @@
 #endif
 
 #include "tls_msg_handler.h"
+#include "wpapt_cdi.h"
 #include "app.h"
 
+/*
+ * size of the receive buffer
+ * - several WPAPT messages are parsed out of each read, and a message
+ *   split across reads is kept until the rest of it arrives
+ */
+#define TLS_SOCKET_RX_BUF_SZ    (64 * 1024)
+
+/*
+ * size of the transmit buffer, and of the records written from it
+ * - WPAPT messages are queued in the buffer and written together, in
+ *   records of up to TLS_SOCKET_TX_RECORD_SZ (the largest TLS record),
+ *   when a record is full or the oldest message has waited for
+ *   tls_tx_drain_us
+ * - while the socket is not writable, messages keep being queued until
+ *   the buffer is full, then tls_socket_write() fails
+ */
+#define TLS_SOCKET_TX_BUF_SZ    (64 * 1024)
+#define TLS_SOCKET_TX_RECORD_SZ (16 * 1024)
+
+/*
+ * the TLS connection to the controller
+ * - only used by the control thread, so nothing here is thread safe
+ */
 struct tls_socket {
     int s_server; /** listening tcp socket */
     //fd_set masterfds;
@@ -57,6 +81,14 @@ struct tls_socket {
     SSL_CTX *ssl_ctx;
     SSL *ssl;
 #endif
+    uint32_t rx_head; /** first byte not yet parsed */
+    uint32_t rx_tail; /** first free byte */
+    uint8_t rx_buf[TLS_SOCKET_RX_BUF_SZ];
+    uint32_t tx_len; /** bytes queued */
+    uint32_t tx_retry_len; /** length of a write to be retried */
+    uint64_t tx_first_tsc; /** when the oldest queued byte was queued */
+    uint64_t tx_drain_tsc;
+    uint8_t tx_buf[TLS_SOCKET_TX_BUF_SZ];
 };
 
 void
@@ -73,6 +105,30 @@ tls_socket_free(void);
 int
 tls_socket_write(struct tls_socket *socket, struct rte_mbuf *mbuf);
 
+void
+tls_socket_flush(struct tls_socket *socket);
+
+/*
+ * flush the transmit buffer if its oldest message has waited too long
+ */
+static inline void
+tls_socket_drain(struct tls_socket *socket, uint64_t cur_tsc)
+{
+    if (socket->tx_len > 0 &&
+        cur_tsc - socket->tx_first_tsc >= socket->tx_drain_tsc)
+        tls_socket_flush(socket);
+}
+
+/*
+ * is there room for another message in the transmit buffer
+ */
+static inline int
+tls_socket_tx_has_room(struct tls_socket *socket)
+{
+    return (TLS_SOCKET_TX_BUF_SZ - socket->tx_len >=
+            sizeof(struct wpapt_cdi_msg_header) + WPAPT_CDI_MAX_MSG);
+}
+
 uint32_t
 poll_sock(struct tls_socket *tls, struct rte_mbuf **pkts_burst, uint16_t nb_pkts);
 
@@ -0,0 +1,266 @@
+/*
+ *   BSD LICENSE
+ * 
+ *   Copyright(c) 2007-2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ * 
+ *   Redistribution and use in source and binary forms, with or without 
+ *   modification, are permitted provided that the following conditions 
+ *   are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright 
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright 
+ *       notice, this list of conditions and the following disclaimer in 
+ *       the documentation and/or other materials provided with the 
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its 
+ *       contributors may be used to endorse or promote products derived 
+ *       from this software without specific prior written permission.
+ * 
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *  version: RWPA_VNF.L.18.02.0-42
+ */
+
+/*
+ * Store preload file converter
+ * - converts a text preload file (sta_mac,vap_mac,key per line) to the
+ *   binary format loaded in parallel by store_load() (RWPA_PRELOAD_STORE)
+ * - or generates a binary preload file of random stations, to measure
+ *   the start-up time for a given store size
+ *
+ * Build (no DPDK needed):
+ *   gcc -O2 -Wall -I.. -o store_convert store_convert.c
+ *
+ * Usage:
+ *   store_convert <stations.txt> <stations.bin>
+ *   store_convert -g <nb_stas> [-s <stas_per_vap>] <stations.bin>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "store_load.h"
+
+#define CCMP_128_KEY_LEN        (16)
+#define CCMP_256_KEY_LEN        (32)
+#define DEFAULT_STAS_PER_VAP    (10)
+
+static int
+mac_parse(const char *str, uint8_t mac[STORE_LOAD_BIN_MAC_LEN])
+{
+    char end;
+
+    if (sscanf(str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx%c",
+               &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5],
+               &end) != STORE_LOAD_BIN_MAC_LEN)
+        return -1;
+
+    return 0;
+}
+
+static int
+key_parse(const char *str, uint8_t key[KEY_LEN_MAX], uint8_t *key_len)
+{
+    size_t i, len = strlen(str);
+
+    if (!(len == CCMP_128_KEY_LEN * 2 || len == CCMP_256_KEY_LEN * 2))
+        return -1;
+
+    for (i = 0; i < len / 2; i++)
+        if (sscanf(&str[i * 2], "%2hhx", &key[i]) != 1)
+            return -1;
+
+    *key_len = (uint8_t)(len / 2);
+
+    return 0;
+}
+
+static int
+rec_write(FILE *fp, const struct store_load_bin_rec *rec)
+{
+    return fwrite(rec, sizeof(*rec), 1, fp) == 1 ? 0 : -1;
+}
+
+static int
+hdr_write(FILE *fp, uint32_t nb_recs)
+{
+    struct store_load_bin_hdr hdr = {
+        .magic = STORE_LOAD_BIN_MAGIC,
+        .version = STORE_LOAD_BIN_VERSION,
+        .rec_len = sizeof(struct store_load_bin_rec),
+        .nb_recs = nb_recs,
+    };
+
+    if (fseek(fp, 0, SEEK_SET) != 0)
+        return -1;
+
+    return fwrite(&hdr, sizeof(hdr), 1, fp) == 1 ? 0 : -1;
+}
+
+static int
+convert(FILE *in, FILE *out, uint32_t *nb_recs)
+{
+    struct store_load_bin_rec rec;
+    char line[1024], line_save[1024];
+    char *sta, *vap, *key, *save;
+    uint32_t line_num = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_num++;
+        strcpy(line_save, line);
+
+        sta = strtok_r(line, ",\n", &save);
+        vap = strtok_r(NULL, ",\n", &save);
+        key = strtok_r(NULL, ",\n", &save);
+
+        /* skip blank lines */
+        if (sta == NULL)
+            continue;
+
+        memset(&rec, 0, sizeof(rec));
+        if (vap == NULL || key == NULL ||
+            mac_parse(sta, rec.sta_mac) != 0 ||
+            mac_parse(vap, rec.vap_mac) != 0 ||
+            key_parse(key, rec.key, &rec.key_len) != 0) {
+            fprintf(stderr, "Invalid entry on line %u: %s",
+                    line_num, line_save);
+            continue;
+        }
+
+        if (rec_write(out, &rec) != 0)
+            return -1;
+
+        (*nb_recs)++;
+    }
+
+    return 0;
+}
+
+static int
+generate(FILE *out, uint32_t nb_stas, uint32_t stas_per_vap,
+         uint32_t *nb_recs)
+{
+    struct store_load_bin_rec rec;
+    uint32_t i, j, vap_id;
+
+    srand((unsigned)time(NULL));
+
+    for (i = 0; i < nb_stas; i++) {
+        vap_id = i / stas_per_vap;
+
+        memset(&rec, 0, sizeof(rec));
+
+        /* locally administered addresses */
+        rec.sta_mac[0] = 0x02;
+        rec.sta_mac[3] = (uint8_t)(i >> 16);
+        rec.sta_mac[4] = (uint8_t)(i >> 8);
+        rec.sta_mac[5] = (uint8_t)i;
+
+        rec.vap_mac[0] = 0x06;
+        rec.vap_mac[3] = (uint8_t)(vap_id >> 16);
+        rec.vap_mac[4] = (uint8_t)(vap_id >> 8);
+        rec.vap_mac[5] = (uint8_t)vap_id;
+
+        rec.key_len = CCMP_128_KEY_LEN;
+        for (j = 0; j < rec.key_len; j++)
+            rec.key[j] = (uint8_t)rand();
+
+        if (rec_write(out, &rec) != 0)
+            return -1;
+
+        (*nb_recs)++;
+    }
+
+    return 0;
+}
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s <stations.txt> <stations.bin>\n"
+            "       %s -g <nb_stas> [-s <stas_per_vap>] <stations.bin>\n",
+            prog, prog);
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t nb_stas = 0, stas_per_vap = DEFAULT_STAS_PER_VAP;
+    uint32_t nb_recs = 0;
+    FILE *in = NULL, *out;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "g:s:")) != -1) {
+        switch (opt) {
+        case 'g':
+            nb_stas = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            stas_per_vap = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((nb_stas == 0 && argc - optind != 2) ||
+        (nb_stas != 0 && argc - optind != 1) ||
+        stas_per_vap == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (nb_stas == 0) {
+        in = fopen(argv[optind], "r");
+        if (in == NULL) {
+            fprintf(stderr, "Failed to open %s\n", argv[optind]);
+            return EXIT_FAILURE;
+        }
+        optind++;
+    }
+
+    out = fopen(argv[optind], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Failed to open %s\n", argv[optind]);
+        if (in != NULL)
+            fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    /* header is rewritten with the number of records at the end */
+    ret = hdr_write(out, 0);
+    if (ret == 0)
+        ret = (in != NULL) ? convert(in, out, &nb_recs) :
+                             generate(out, nb_stas, stas_per_vap, &nb_recs);
+    if (ret == 0)
+        ret = hdr_write(out, nb_recs);
+
+    if (in != NULL)
+        fclose(in);
+
+    if (fclose(out) != 0 || ret != 0) {
+        fprintf(stderr, "Failed to write %s\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Wrote %u stations to %s\n", nb_recs, argv[optind]);
+
+    return EXIT_SUCCESS;
+}
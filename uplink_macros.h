@@ -45,7 +45,7 @@
 
 #if !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define _STORE_STA_BULK_LOOKUP_STATS(n, f)                                     \
+#define _STORE_STA_BULK_LOOKUP_STATS(n, f, h)                                  \
 ({                                                                             \
      uint8_t matched = 0;                                                      \
      for (unsigned int i = 0; i < n; i++) {                                    \
@@ -60,6 +60,8 @@
          stats->matched += matched;                                            \
          stats->unmatched += n - matched;                                      \
          stats->num_pkts += n;                                                 \
+         stats->cache_hits += h;                                               \
+         stats->cache_misses += n - h;                                         \
          stats->last_burst[                                                    \
              stats->last_burst_index++ %                                       \
              STA_LOOKUP_BURST_LEN] = n;                                        \
@@ -69,7 +71,7 @@
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define _STORE_STA_BULK_LOOKUP_STATS(n, f)                                     \
+#define _STORE_STA_BULK_LOOKUP_STATS(n, f, h)                                  \
      do {} while(0)
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -514,8 +516,8 @@
 
 #define STORE_STA_BULK_LOOKUP(a, n, f)                                         \
 ({                                                                             \
-     store_sta_bulk_lookup(a, n, f);                                           \
-     _STORE_STA_BULK_LOOKUP_STATS(n, f);                                       \
+     uint32_t nb_hits = store_sta_bulk_lookup(a, n, f);                        \
+     _STORE_STA_BULK_LOOKUP_STATS(n, f, nb_hits);                              \
 })
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -525,11 +527,16 @@
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_LOCK(s)                    sta_read_lock(s)
-#define STA_DECRYPT_DATA_GET(s, t, a, c, v) sta_decrypt_data_get(s, t, a, c, v)
+#define STA_REF_GET(m, r)                                                      \
+({                                                                             \
+     (m)->store_idx = (r);                                                     \
+     store_read_ref_get(r);                                                    \
+})
+#define STA_DECRYPT_DATA_GET(s, k, t, a, c, v)                                 \
+     sta_decrypt_data_get(s, k, t, a, c, v)
 #define CCMP_REPLAY_DETECT(h, c)            ccmp_replay_detect(h, c)
-#define STA_PTK_DECRYPT_COUNTER_SET(s, t, c)                                   \
-     sta_ptk_decrypt_counter_set(s, t, c)
+#define STA_PTK_DECRYPT_COUNTER_SET(s, k, t, c)                                \
+     sta_ptk_decrypt_counter_set(s, k, t, c)
 
 #if !defined RWPA_STATS_CAPTURE_CRYPTO_OFF && defined RWPA_STATS_CAPTURE
 
@@ -540,9 +547,9 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _CCMP_BURST_DEQUEUE_CALL_STATS;                                           \
      deq;                                                                      \
 })
@@ -552,12 +559,12 @@
 #define CCMP_BURST_ENQUEUE(b, l, m, o, q, s)                                   \
      ccmp_burst_enqueue(b, l, m, o, q, s)
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
-     ccmp_burst_dequeue(b, l, q, n, s)
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
+     ccmp_burst_dequeue(b, m, l, q, n, s)
 
 #endif // !defined RWPA_STATS_CAPTURE_CRYPTO_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_UNLOCK(s)                  sta_read_unlock(s)
+#define STA_REF_PUT(m)                      store_read_ref_put((m)->store_idx)
 #define IEEE80211_PACKET_CLASSIFY(m, meta)  ieee80211_packet_classify(m, meta)
 #define IEEE80211_TO_ETHER_CONVERT(m, meta) ieee80211_to_ether_convert(m, meta)
 #define GRE_ENCAP(m, si, sm, di, dm)        gre_encap(m, si, sm, di, dm, 0, 0)
@@ -565,7 +572,13 @@
 #define CCMP_DECAP(m, meta)                 ccmp_decap(m, meta)
 #define WPAPT_CDI_FRAME_ENCAP(m, meta, l)   wpapt_cdi_frame_encap(m, meta, l)
 #define WPAPT_CDI_HDR_ENCAP(m, i, l)        wpapt_cdi_hdr_encap(m, i, l)
-#define TLS_SOCKET_WRITE(t, m)              tls_socket_write(t, m)
+#define CONTROL_RING_ENQUEUE(r, m)                                             \
+({                                                                             \
+     if (unlikely(rte_ring_mp_enqueue(r, m) != 0))                             \
+         CTRL_LOG_AND_DROP(m, ERR, RWPA_UL,                                    \
+                           "Control ring full, dropping\n",                    \
+                           STATS_CTRL_DROPS_TYPE_RING_FULL);                   \
+})
 
 #else // ifndef RWPA_CYCLE_CAPTURE
 
@@ -642,9 +655,9 @@
 #define STORE_STA_BULK_LOOKUP(a, n, f)                                         \
 ({                                                                             \
      _UL_STA_LOOKUP_CYCLE_CAPTURE_START;                                       \
-     store_sta_bulk_lookup(a, n, f);                                           \
+     uint32_t nb_hits = store_sta_bulk_lookup(a, n, f);                        \
      _UL_STA_LOOKUP_CYCLE_CAPTURE_STOP;                                        \
-     _STORE_STA_BULK_LOOKUP_STATS(n, f);                                       \
+     _STORE_STA_BULK_LOOKUP_STATS(n, f, nb_hits);                              \
 })
 
 #else // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
@@ -658,17 +671,18 @@
 
 #endif // !defined RWPA_STATS_CAPTURE_STA_LOOKUP_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_LOCK(s)                                                       \
+#define STA_REF_GET(m, r)                                                      \
 ({                                                                             \
      _UL_STA_LOCK_CYCLE_CAPTURE_START;                                         \
-     sta_read_lock(s);                                                         \
+     (m)->store_idx = (r);                                                     \
+     store_read_ref_get(r);                                                    \
      _UL_STA_LOCK_CYCLE_CAPTURE_STOP;                                          \
 })
 
-#define STA_DECRYPT_DATA_GET(s, t, a, c, v)                                    \
+#define STA_DECRYPT_DATA_GET(s, k, t, a, c, v)                                 \
 ({                                                                             \
      _UL_STA_DECRYPT_DATA_GET_CYCLE_CAPTURE_START;                             \
-     sta_decrypt_data_get(s, t, a, c, v);                                      \
+     sta_decrypt_data_get(s, k, t, a, c, v);                                   \
      _UL_STA_DECRYPT_DATA_GET_CYCLE_CAPTURE_STOP;                              \
 })
 
@@ -680,10 +694,10 @@
      sts;                                                                      \
 })
 
-#define STA_PTK_DECRYPT_COUNTER_SET(s, t, c)                                   \
+#define STA_PTK_DECRYPT_COUNTER_SET(s, k, t, c)                                \
 ({                                                                             \
      _UL_STA_DECRYPT_DATA_UPDATE_CYCLE_CAPTURE_START;                          \
-     sta_ptk_decrypt_counter_set(s, t, c);                                     \
+     sta_ptk_decrypt_counter_set(s, k, t, c);                                  \
      _UL_STA_DECRYPT_DATA_UPDATE_CYCLE_CAPTURE_STOP;                           \
 })
 
@@ -698,10 +712,10 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
      _UL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_START;                                   \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _UL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_STOP;                                    \
      _CCMP_BURST_DEQUEUE_CALL_STATS;                                           \
      deq;                                                                      \
@@ -717,20 +731,20 @@
      enq;                                                                      \
 })
 
-#define CCMP_BURST_DEQUEUE(b, l, q, n, s)                                      \
+#define CCMP_BURST_DEQUEUE(b, m, l, q, n, s)                                   \
 ({                                                                             \
      _UL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_START;                                   \
-     uint16_t deq = ccmp_burst_dequeue(b, l, q, n, s);                         \
+     uint16_t deq = ccmp_burst_dequeue(b, m, l, q, n, s);                      \
      _UL_CRYPTO_DEQUEUE_CYCLE_CAPTURE_STOP;                                    \
      deq;                                                                      \
 })
 
 #endif // !defined RWPA_STATS_CAPTURE_CRYPTO_OFF && defined RWPA_STATS_CAPTURE
 
-#define STA_READ_UNLOCK(s)                                                     \
+#define STA_REF_PUT(m)                                                         \
 ({                                                                             \
      _UL_STA_UNLOCK_CYCLE_CAPTURE_START;                                       \
-     sta_read_unlock(s);                                                       \
+     store_read_ref_put((m)->store_idx);                                       \
      _UL_STA_UNLOCK_CYCLE_CAPTURE_STOP;                                        \
 })
 
@@ -790,11 +804,15 @@
      sts;                                                                      \
 })
 
-#define TLS_SOCKET_WRITE(t, m)                                                 \
+#define CONTROL_RING_ENQUEUE(r, m)                                             \
 ({                                                                             \
      _UL_TLS_TX_CYCLE_CAPTURE_START;                                           \
-     tls_socket_write(t, m);                                                   \
+     int ret = rte_ring_mp_enqueue(r, m);                                      \
      _UL_TLS_TX_CYCLE_CAPTURE_STOP;                                            \
+     if (unlikely(ret != 0))                                                   \
+         CTRL_LOG_AND_DROP(m, ERR, RWPA_UL,                                    \
+                           "Control ring full, dropping\n",                    \
+                           STATS_CTRL_DROPS_TYPE_RING_FULL);                   \
 })
 
 #endif // ifndef RWPA_CYCLE_CAPTURE
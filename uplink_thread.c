@@ -38,6 +38,7 @@
 #include <rte_common.h>
 #include <rte_malloc.h>
 #include <rte_cycles.h>
+#include <rte_atomic.h>
 #include <rte_timer.h>
 #include <rte_hash.h>
 #include <rte_log.h>
@@ -68,13 +69,15 @@
 #include "ieee80211_utils.h"
 #include "crypto.h"
 #include "ccmp.h"
+#include "ccmp_inline.h"
 #include "convert.h"
-#include "tls_socket.h"
+#include "tls_msg_handler.h"
 #include "vap_frag.h"
 #include "cycle_capture.h"
 #ifdef RWPA_STATS_CAPTURE
 #include "statistics_capture.h"
 #endif
+#include "control_thread.h"
 #include "uplink_macros.h"
 #include "uplink_thread.h"
 
@@ -87,45 +90,68 @@
 #define UL_DST_PORT_WAG         0
 #define UL_DST_PORT_AP          1
 
-#define UL_TP_TLS_MEMPOOL_ID    "tls_mempool_id"
+#define UL_WRR_ELEM_PMD         0
+#define UL_WRR_ELEM_CTRL        1
+
+/*
+ * Uplink thread context
+ * - one of these is allocated per UPLINK_THREAD instance, so that
+ *   several uplink threads can run in parallel, each one reading
+ *   its own RXQ and writing to its own TXQs and crypto qp
+ */
+struct uplink_ctx {
+    struct app_thread_params *tp;
+    struct src_port_params src_ports[UL_NUM_SRC_PORTS];
+    struct dst_port_params dst_ports[UL_NUM_DST_PORTS];
+    struct crypto_chan crypto_chan;
+    uint8_t crypto_async;
+    uint16_t nb_crypto_inflight;
+#ifndef RWPA_UL_NO_TLS_POLLING
+    struct rte_ring *ctrl_ring_in;
+    struct rte_ring *ctrl_ring_out;
+    unsigned nb_wrr_elements;
+    struct poll_wrr_elem wrr_elements[MAX_UL_WRR_ELEMS];
+#endif
+} __rte_cache_aligned;
 
 extern volatile int force_quit;
 struct app_params *g_app;
 
-static struct app_thread_params *tp_uplink;
 static struct app_addr_params *addr_params;
 
 struct ether_addr *vnfd_eth_addr_to_ap;
 struct ether_addr *vnfd_eth_addr_to_wag;
 
-static struct src_port_params src_ports[UL_NUM_SRC_PORTS];
-static struct dst_port_params dst_ports[UL_NUM_DST_PORTS];
+static uint8_t ul_src_port_id;
 
 #ifndef RWPA_UL_NO_TLS_POLLING
-static struct tls_socket *tls;
-
-static uint32_t tls_mempool_id;
-
-static struct poll_wrr_elem *wrr_elements[MAX_UL_WRR_ELEMS];
-
-static void tls_dequeue(uint64_t cur_tsc);
+/*
+ * the TLS connection to the controller is owned by the control thread
+ * - EAPOLs from the controller are read from this thread's ring from
+ *   the control thread, EAPOLs from the APs are written to the ring
+ *   shared by all uplink threads to the control thread
+ */
+static void ctrl_dequeue(void *arg, uint64_t cur_tsc);
+#endif
+static void pmd_dequeue(void *arg, uint64_t cur_tsc);
+#ifndef RWPA_NO_CRYPTO
+static void ap_tunnel_crypto_completions_process(struct uplink_ctx *ctx);
 #endif
-static void pmd_dequeue(uint64_t cur_tsc);
 
 static void *
 thread_uplink_init(struct app_thread_params *p, void *arg)
 {
     unsigned lcore_id, socket_id;
+    struct uplink_ctx *ctx;
 
     g_app = (struct app_params *)arg;
-    tp_uplink = p;
     addr_params = &g_app->addr_params;
 
     lcore_id = rte_lcore_id();
     socket_id = rte_socket_id();
 
-    unsigned n_ports_in = tp_uplink->n_ports_in;
-    unsigned n_ports_out = tp_uplink->n_ports_out;
+    unsigned n_ports_in = p->n_ports_in;
+    unsigned n_ports_out = p->n_ports_out;
 
     if (n_ports_in > UL_NUM_SRC_PORTS || n_ports_out > UL_NUM_DST_PORTS)
         rte_exit(EXIT_FAILURE,
@@ -136,80 +162,98 @@ thread_uplink_init(struct app_thread_params *p, void *arg)
                  "Must be exactly %d ports assigned to uplink\n",
                  UL_NUM_PORTS);
 
+    ctx = rte_zmalloc_socket(p->name, sizeof(struct uplink_ctx),
+                             RTE_CACHE_LINE_SIZE, socket_id);
+    if (ctx == NULL)
+        rte_exit(EXIT_FAILURE,
+                 "Could not allocate context for %s\n", p->name);
+
+    ctx->tp = p;
+
+    if (crypto_chan_init(&ctx->crypto_chan, p->crypto_dev,
+                         p->crypto_qp) != RWPA_STS_OK)
+        rte_exit(EXIT_FAILURE,
+                 "Could not set up crypto qp %u for %s\n",
+                 p->crypto_qp, p->name);
+
+    ctx->crypto_async = g_app->crypto_params.async ? TRUE : FALSE;
+
+    /* create this lcore's queue of inline crypto results */
+    if (g_app->crypto_params.engine == CCMP_ENGINE_INLINE)
+        ccmp_inline_lcore_init();
+
     /* get src port info */
-    src_ports[UL_SRC_PORT].port_id =
-        thread_port_in_get_id(&tp_uplink->port_in[UL_SRC_PORT]);
+    ctx->src_ports[UL_SRC_PORT].port_id =
+        thread_port_in_get_id(&p->port_in[UL_SRC_PORT]);
+    ctx->src_ports[UL_SRC_PORT].ring =
+        thread_port_in_get_ring(&p->port_in[UL_SRC_PORT]);
+    if (ctx->src_ports[UL_SRC_PORT].ring == NULL)
+        ctx->src_ports[UL_SRC_PORT].queue_id =
+            thread_port_in_get_queue_id(&p->port_in[UL_SRC_PORT]);
+    ul_src_port_id = ctx->src_ports[UL_SRC_PORT].port_id;
 
     /* get WAG dest port info */
-    dst_ports[UL_DST_PORT_WAG].port_id =
-        thread_port_out_get_id(&tp_uplink->port_out[UL_DST_PORT_WAG]);
-    dst_ports[UL_DST_PORT_WAG].queue_id =
-        thread_port_out_get_queue_id(&tp_uplink->port_out[UL_DST_PORT_WAG]);
-    dst_ports[UL_DST_PORT_WAG].tx_buffer =
-        thread_port_out_get_tx_buffer(&tp_uplink->port_out[UL_DST_PORT_WAG]);
+    ctx->dst_ports[UL_DST_PORT_WAG].port_id =
+        thread_port_out_get_id(&p->port_out[UL_DST_PORT_WAG]);
+    ctx->dst_ports[UL_DST_PORT_WAG].queue_id =
+        thread_port_out_get_queue_id(&p->port_out[UL_DST_PORT_WAG]);
+    ctx->dst_ports[UL_DST_PORT_WAG].tx_buffer =
+        thread_port_out_get_tx_buffer(&p->port_out[UL_DST_PORT_WAG]);
 
     /* get AP dest port info */
-    dst_ports[UL_DST_PORT_AP].port_id =
-        thread_port_out_get_id(&tp_uplink->port_out[UL_DST_PORT_AP]);
-    dst_ports[UL_DST_PORT_AP].queue_id =
-        thread_port_out_get_queue_id(&tp_uplink->port_out[UL_DST_PORT_AP]);
-    dst_ports[UL_DST_PORT_AP].tx_buffer =
-        thread_port_out_get_tx_buffer(&tp_uplink->port_out[UL_DST_PORT_AP]);
+    ctx->dst_ports[UL_DST_PORT_AP].port_id =
+        thread_port_out_get_id(&p->port_out[UL_DST_PORT_AP]);
+    ctx->dst_ports[UL_DST_PORT_AP].queue_id =
+        thread_port_out_get_queue_id(&p->port_out[UL_DST_PORT_AP]);
+    ctx->dst_ports[UL_DST_PORT_AP].tx_buffer =
+        thread_port_out_get_tx_buffer(&p->port_out[UL_DST_PORT_AP]);
 
     /* save vnfd ethernet addresses from link parameters */
-    vnfd_eth_addr_to_ap = &g_app->link_params[dst_ports[UL_DST_PORT_AP].port_id].mac_addr;
-    vnfd_eth_addr_to_wag = &g_app->link_params[dst_ports[UL_DST_PORT_WAG].port_id].mac_addr;
+    vnfd_eth_addr_to_ap = &g_app->link_params[ctx->dst_ports[UL_DST_PORT_AP].port_id].mac_addr;
+    vnfd_eth_addr_to_wag = &g_app->link_params[ctx->dst_ports[UL_DST_PORT_WAG].port_id].mac_addr;
+
+    /* create this lcore's fragment reassembly table */
+    vap_frag_lcore_init();
 
 #ifndef RWPA_UL_NO_TLS_POLLING
     /* initialise wrr elements from config file */
-    struct poll_wrr_elem *wrr_elem_pmd = NULL;
-    wrr_elem_pmd = malloc(sizeof(struct poll_wrr_elem));
-    RWPA_CHECK_NOT_NULL(wrr_elem_pmd);
-    wrr_elem_pmd->allocated_tsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * g_app->misc_params.uplink_pmd_us;
-    wrr_elem_pmd->p_func = pmd_dequeue;
-    wrr_elements[0] = wrr_elem_pmd;
-    
-    struct poll_wrr_elem *wrr_elem_tls = malloc(sizeof(struct poll_wrr_elem));
-    RWPA_CHECK_NOT_NULL(wrr_elem_tls);
-    wrr_elem_tls->allocated_tsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * g_app->misc_params.uplink_tls_us;
-    wrr_elem_tls->p_func = tls_dequeue;
-    wrr_elements[1] = wrr_elem_tls;
-
-    /* find the tls mempool id */
-    int tls_mempool_id_rd_sts = -1;
-    for (uint32_t i = 0; i < tp_uplink->n_args; i++) {
-        if (strcmp(tp_uplink->args_name[i], UL_TP_TLS_MEMPOOL_ID) == 0) {
-            tls_mempool_id_rd_sts = parser_read_uint32(&tls_mempool_id,
-                                                       tp_uplink->args_value[i]);
-        }
-    }
-    if (tls_mempool_id_rd_sts != 0)
+    ctx->wrr_elements[UL_WRR_ELEM_PMD].allocated_tsc =
+        (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * g_app->misc_params.uplink_pmd_us;
+    ctx->wrr_elements[UL_WRR_ELEM_PMD].p_func = pmd_dequeue;
+    ctx->wrr_elements[UL_WRR_ELEM_CTRL].allocated_tsc =
+        (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * g_app->misc_params.uplink_tls_us;
+    ctx->wrr_elements[UL_WRR_ELEM_CTRL].p_func = ctrl_dequeue;
+    ctx->nb_wrr_elements = MAX_UL_WRR_ELEMS;
+
+    /* get the rings to and from the control thread */
+    ctx->ctrl_ring_in = control_ring_to_worker_get(p->name, socket_id);
+    ctx->ctrl_ring_out = control_ring_from_workers_get(socket_id);
+    if (ctx->ctrl_ring_in == NULL || ctx->ctrl_ring_out == NULL)
         rte_exit(EXIT_FAILURE,
-                 "Could not find valid %s thread param for %s\n",
-                 UL_TP_TLS_MEMPOOL_ID,
-                 tp_uplink->name);
-
-    /* initialise tls socket */
-    tls = malloc(sizeof(struct tls_socket));
-    RWPA_CHECK_NOT_NULL(tls);
-    tls_socket_init(tls, tls_handlers, g_app->mempool[tls_mempool_id],
-                    addr_params->vnfc_tls_ss_ip, addr_params->vnfc_tls_ss_port,
-                    &g_app->misc_params);
+                 "%s: could not create control rings\n", p->name);
 #endif
-  
-    RTE_LOG(INFO, RWPA_UL,
-            "%s (%s): Initializing on lcore %u (socket %u)\n",
-            tp_uplink->name, tp_uplink->type, lcore_id, socket_id);
 
-    return NULL;
+    RTE_LOG(INFO, RWPA_UL,
+            "%s (%s): Initializing on lcore %u (socket %u), "
+            "RX %s (port %u), cryptodev %u qp %u (%s)\n",
+            p->name, p->type, lcore_id, socket_id,
+            p->pktq_in[UL_SRC_PORT].type == APP_PKTQ_IN_SWQ ?
+                g_app->swq_params[p->pktq_in[UL_SRC_PORT].id].name :
+                g_app->hwq_in_params[p->pktq_in[UL_SRC_PORT].id].name,
+            ctx->src_ports[UL_SRC_PORT].port_id,
+            ctx->crypto_chan.cdev_id, ctx->crypto_chan.qp,
+            ctx->crypto_async ? "async" : "sync");
+
+    return ctx;
 }
 
 #ifndef RWPA_UL_NO_TLS_POLLING
-static void 
-eapols_process(struct pkt_buffer *eapols_in)
+static void
+eapols_process(struct uplink_ctx *ctx, struct pkt_buffer *eapols_in)
 {
     unsigned i, j, k;
     int wep_save;
+    uint8_t rd;
     struct rte_mbuf *m;
     struct rwpa_meta meta[MAX_PKT_BURST] = {0};
     struct ether_addr *sta_addrs[MAX_PKT_BURST];
@@ -274,7 +318,10 @@ eapols_process(struct pkt_buffer *eapols_in)
     /*
      * STORE LOOKUP
      * - search the store for each of the stations
+     * - the EAPOLs are encrypted synchronously, so the stations found
+     *   stay valid until the end of the read section, below
      */
+    rd = store_read_lock();
     store_sta_bulk_lookup(sta_addrs, nb_sta_addrs, found);
 
     for (i = 0, j = 0; i < eapols_in->len; i++) {
@@ -288,13 +335,13 @@ eapols_process(struct pkt_buffer *eapols_in)
                  * STATION FOUND
                  */
 
-                /* get the station and lock it */
+                /* get the station */
                 meta[i].sta = store_sta_get(found[j]);
-                sta_read_lock(meta[i].sta);
 
-                /* get the PTK SA, PTK's encrypt counter and vAP */
+                /* get the TX PTK's SA, encrypt counter and KeyID, and vAP */
                 sta_encrypt_data_get(meta[i].sta, &(meta[i].sa),
-                                     &(meta[i].counter), &(meta[i].vap));
+                                     &(meta[i].counter), &(meta[i].vap),
+                                     &(meta[i].key_id));
 
                 /*
                  * check is there a key for this station
@@ -307,7 +354,6 @@ eapols_process(struct pkt_buffer *eapols_in)
                       * - add the CCMP header and space for the MIC
                       */
                      if (unlikely(ccmp_encap(m, &meta[i]) != RWPA_STS_OK)) {
-                         sta_read_unlock(meta[i].sta);
                          CTRL_LOG_AND_DROP(eapols_in->buffer[i], ERR, RWPA_UL,
                                            "Error adding CCMP header to EAPOL packet, dropping\n",
                                            STATS_CTRL_DROPS_TYPE_PACKET_ENCAP_ERROR);
@@ -318,7 +364,11 @@ eapols_process(struct pkt_buffer *eapols_in)
                          eapols_crypto_in.len++;
                     }
                  } else {
-                     sta_read_unlock(meta[i].sta);
+                     /*
+                      * not encrypted, clear the SA as its key may be
+                      * set meanwhile
+                      */
+                     meta[i].sa = NULL;
                  }
             } else {
                 /*
@@ -340,7 +390,7 @@ eapols_process(struct pkt_buffer *eapols_in)
      */
     nb_crypto_enq = ccmp_burst_enqueue(eapols_crypto_in.buffer, eapols_crypto_in.len,
                                        meta_crypto_in, CCMP_OP_ENCRYPT,
-                                       tp_uplink->crypto_qp, crypto_enq_success);
+                                       &ctx->crypto_chan, crypto_enq_success);
 
     /*
      * dequeue packets from crypto devices
@@ -351,13 +401,14 @@ eapols_process(struct pkt_buffer *eapols_in)
     do {
         nb_crypto_deq_success = 0;
         nb_crypto_deq = ccmp_burst_dequeue((eapols_crypto_out.buffer + eapols_crypto_out.len),
+                                           NULL,
                                            (nb_crypto_enq - eapols_crypto_out.len),
-                                           tp_uplink->crypto_qp, &nb_crypto_deq_success,
+                                           &ctx->crypto_chan, &nb_crypto_deq_success,
                                            (crypto_deq_success + eapols_crypto_out.len));
 
         eapols_crypto_out.len += nb_crypto_deq;
         nb_crypto_deq_success_acc += nb_crypto_deq_success;
-    } while ((!force_quit) && (eapols_crypto_out.len < nb_crypto_enq));
+    } while (eapols_crypto_out.len < nb_crypto_enq);
 
     /*
      * CRYPTO TIDYUP
@@ -378,14 +429,10 @@ eapols_process(struct pkt_buffer *eapols_in)
     }
 #endif
 
-    /* unlock station and free mbuf for any failed crypto ops */
+    /* free mbuf for any failed crypto ops */
     for (i = 0, j = 0, k = 0; i < eapols_in->len; i++) {
         if (eapols_in->buffer[i] != NULL &&
-            meta[i].sa != NULL &&
-            meta[i].sa->tk_len > 0) {
-
-            sta_read_unlock(meta[i].sta);
-
+            meta[i].sa != NULL) {
 #ifndef RWPA_NO_CRYPTO
             if (unlikely(j < eapols_crypto_in.len &&
                          crypto_enq_success[j++] == FALSE)) {
@@ -472,117 +519,291 @@ eapols_process(struct pkt_buffer *eapols_in)
              * WRITE TO TX BUFFER
              */
             } else {
-                rte_eth_tx_buffer(dst_ports[UL_DST_PORT_AP].port_id,
-                                  dst_ports[UL_DST_PORT_AP].queue_id,
-                                  dst_ports[UL_DST_PORT_AP].tx_buffer, m);
+                rte_eth_tx_buffer(ctx->dst_ports[UL_DST_PORT_AP].port_id,
+                                  ctx->dst_ports[UL_DST_PORT_AP].queue_id,
+                                  ctx->dst_ports[UL_DST_PORT_AP].tx_buffer, m);
 
             }
         }
     }
+
+    store_read_unlock(rd);
 }
 
 static void
-tls_dequeue(uint64_t cur_tsc)
+ctrl_dequeue(void *arg, uint64_t cur_tsc)
 {
-    unsigned i, j;
-    struct rte_mbuf *m;
-    struct pkt_buffer pkts_in __rte_cache_aligned;
+    struct uplink_ctx *ctx = (struct uplink_ctx *)arg;
     struct pkt_buffer eapols __rte_cache_aligned;
 
     UNUSED(cur_tsc);
 
-    pkts_in.len = poll_sock(tls, pkts_in.buffer, MAX_PKT_BURST);
+    eapols.len = rte_ring_sc_dequeue_burst(ctx->ctrl_ring_in,
+                                           (void **)eapols.buffer,
+                                           MAX_PKT_BURST, NULL);
+    if (eapols.len == 0)
+        return;
 
-    eapols.len = 0;
+#ifndef RWPA_NO_CRYPTO
+    /*
+     * complete all the crypto ops in flight before processing the
+     * EAPOLs from the controller
+     * - the EAPOLs are encrypted on the same crypto qp and are
+     *   dequeued straight away
+     */
+    while (ctx->nb_crypto_inflight > 0)
+        ap_tunnel_crypto_completions_process(ctx);
+#endif
 
-    for (i = 0; i < pkts_in.len; i++) {
-        RWPA_CHECK_ARRAY_OFFSET(i, MAX_PKT_BURST - 1);
+    /*
+     * process the EAPOL packets
+     */
+    eapols_process(ctx, &eapols);
+}
+#endif
 
-        m = pkts_in.buffer[i];
-        rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+/*
+ * POST CRYPTO PROCESSING
+ * - the station is still referenced, but not locked
+ */
+static inline void
+ap_tunnel_packet_post_crypto_process(struct uplink_ctx *ctx,
+                                     struct rte_mbuf *m,
+                                     struct rwpa_meta *meta)
+{
+    rte_prefetch0(rte_pktmbuf_mtod(m, void *));
 
-        struct wpapt_cdi_msg_header *data = rte_pktmbuf_mtod(m, struct wpapt_cdi_msg_header *);
-        uint16_t type = data->message_id;
-
-        for (j = 0; tls->ctx[j].type != EOL; j++) {
-            if (tls->ctx[j].cmd == type) {
-                if (wpapt_cdi_hdr_decap(m) == RWPA_STS_OK) {
-                    unsigned action = tls->ctx[j].handler(m);
-                    switch (action) {
-                        case TLS_HANDLER_ACTION_PROCESS:
-                            eapols.buffer[eapols.len++] = m;
-                            break;
-                        case TLS_HANDLER_ACTION_TLS_TX:
-                            tls_socket_write(tls, m);
-                            break;
-                        case TLS_HANDLER_ACTION_ERROR:
-                            CTRL_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                              "Error handling WPAPT message, dropping\n",
-                                              STATS_CTRL_DROPS_TYPE_MSG_HANDLING_ERROR);
-                            break;
-                        case TLS_HANDLER_ACTION_NONE:
-                        default:
-                            rte_pktmbuf_free(m);
-                            break;
-                    }
-                } else {
-                    CTRL_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                      "Error removing WPAPT header, dropping\n",
-                                      STATS_CTRL_DROPS_TYPE_PACKET_DECAP_ERROR);
-                }
-                break;
-            }
+    /*
+     * 802.11 PACKET CLASSIFICATION
+     */
+    enum ieee80211_pkt_type pkt_type =
+        IEEE80211_PACKET_CLASSIFY(m, meta);
+
+    if (likely(pkt_type == IEEE80211_PKT_TYPE_DATA)) {
+        /* DATA */
+
+        /*
+         * IEEE802.11 -> ETHERNET CONVERSION
+         * - handles CCMP decap
+         */
+        if (unlikely(IEEE80211_TO_ETHER_CONVERT(
+                         m, meta) != RWPA_STS_OK)) {
+            DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                              "Error converting packet to Ethernet, dropping\n",
+                              STATS_UL_DROPS_TYPE_ETH_CONVERT_ERROR);
+
+        /*
+         * GRE ENCAP
+         * - add the outer Ethernet, IP and GRE headers
+         * - only if sending to a WAG
+         */
+        } else if (unlikely(g_app->misc_params.no_wag == FALSE &&
+                            GRE_ENCAP(m, addr_params->vnfd_ip_to_wag,
+                                      vnfd_eth_addr_to_wag,
+                                      addr_params->wag_tun_ip,
+                                      &(addr_params->wag_tun_mac)) != RWPA_STS_OK)) {
+            DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                              "Error adding GRE headers, dropping\n",
+                              STATS_UL_DROPS_TYPE_DATA_PACKET_ENCAP_ERROR);
+
+        /*
+         * WRITE TO TX BUFFER
+         */
+        } else {
+            RTE_ETH_TX_BUFFER(ctx->dst_ports[UL_DST_PORT_WAG].port_id,
+                              ctx->dst_ports[UL_DST_PORT_WAG].queue_id,
+                              ctx->dst_ports[UL_DST_PORT_WAG].tx_buffer, m);
         }
 
-        if (tls->ctx[j].type == EOL) {
-#ifdef RWPA_EXTRA_DEBUG
-            RTE_LOG(ERR, RWPA_UL,
-                    "Unknown WPAPT message type [%d] received, dropping\n",
-                    type);
-#endif
-            UL_CTRL_DROP_STAT_INC(STATS_UL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE, 1);
+    }  else if (pkt_type == IEEE80211_PKT_TYPE_EAPOL) {
+        /* EAPOL */
+
+        /*
+         * CCMP DECAP
+         * - remove the CCMP header and MIC
+         */
+        if (meta->wep &&
+            CCMP_DECAP(m, meta) == RWPA_STS_ERR) {
+            DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                              "Error removing CCMP header, dropping\n",
+                              STATS_UL_DROPS_TYPE_PACKET_DECAP_ERROR);
+
+        /*
+         * WPAPT_CDI_MSG_FRAME ENCAP
+         * - add the wpapt_cdi_msg_frame encapsulation
+         */
+        } else if (unlikely(WPAPT_CDI_FRAME_ENCAP(
+                              m, meta, m->data_len) != RWPA_STS_OK)) {
+            DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                              "Error adding TLS message frame, dropping\n",
+                              STATS_UL_DROPS_TYPE_CTRL_PACKET_ENCAP_ERROR);
+
+        /*
+         * WPAPT_CDI_MSG_HEADER ENCAP
+         * -add the wpapt_cdi_msg_header
+         */
+        } else if (unlikely(WPAPT_CDI_HDR_ENCAP(
+                                m, WPAPT_CDI_MSG_FRAME, m->data_len) != RWPA_STS_OK)) {
+            DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                         "Error adding TLS message header, dropping\n",
+                         STATS_UL_DROPS_TYPE_CTRL_PACKET_ENCAP_ERROR);
+
+        /*
+         * WRITE TO CONTROL THREAD
+         */
+        } else {
+#ifndef RWPA_UL_NO_TLS_POLLING
+            CONTROL_RING_ENQUEUE(ctx->ctrl_ring_out, m);
+#else
             DROP(m);
+#endif
         }
+    } else {
+        /* Something Else */
+        DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
+                          "Could not classify 802.11 packet, dropping\n",
+                          STATS_UL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE);
+    }
+}
+
+#ifndef RWPA_NO_CRYPTO
+/*
+ * CRYPTO COMPLETIONS
+ * - dequeue a burst of completed crypto ops, finish processing their
+ *   packets and drop the references on their stations
+ * - the meta info of each packet is returned with it, as the burst
+ *   the packet was received in may have been processed already
+ */
+static void
+ap_tunnel_crypto_completions_process(struct uplink_ctx *ctx)
+{
+    struct rte_mbuf *pkts_crypto_out[MAX_PKT_BURST];
+    struct rwpa_meta meta_crypto_out[MAX_PKT_BURST];
+    uint8_t crypto_deq_success[MAX_PKT_BURST];
+    uint16_t nb_crypto_deq, nb_crypto_deq_success = 0;
+    unsigned i;
+
+    if (ctx->nb_crypto_inflight == 0)
+        return;
+
+    nb_crypto_deq = CCMP_BURST_DEQUEUE(pkts_crypto_out, meta_crypto_out,
+                                       RTE_MIN(ctx->nb_crypto_inflight, MAX_PKT_BURST),
+                                       &ctx->crypto_chan, &nb_crypto_deq_success,
+                                       crypto_deq_success);
+
+    if (nb_crypto_deq == 0)
+        return;
+
+    ctx->nb_crypto_inflight -= nb_crypto_deq;
+
+    CCMP_BURST_DEQUEUE_STATS(nb_crypto_deq, nb_crypto_deq_success);
+
+    /* log error for any failed crypto ops */
+    if (unlikely(nb_crypto_deq_success < nb_crypto_deq)) {
+        UL_DATA_DROP_STAT_INC(STATS_UL_DROPS_TYPE_DECRYPTION_ERROR,
+                              (nb_crypto_deq - nb_crypto_deq_success));
+
+#ifdef RWPA_EXTRA_DEBUG
+        RTE_LOG(ERR, RWPA_UL,
+            "CCMP decryption failed for %d out of %d "
+            "packets, dropping\n",
+            (nb_crypto_deq - nb_crypto_deq_success),
+            nb_crypto_deq);
+#endif
     }
 
+    /* free mbuf for any failed crypto ops */
+    for (i = 0; i < nb_crypto_deq; i++) {
+        if (unlikely(crypto_deq_success[i] == FALSE))
+            DROP(pkts_crypto_out[i]);
+    }
+
+    for (i = 0; i < nb_crypto_deq; i++) {
+        if (likely(pkts_crypto_out[i] != NULL))
+            ap_tunnel_packet_post_crypto_process(ctx, pkts_crypto_out[i],
+                                                 &meta_crypto_out[i]);
+    }
+
+    /* done with the stations, drop the references taken by their ops */
+    rte_smp_mb();
+    for (i = 0; i < nb_crypto_deq; i++)
+        STA_REF_PUT(&meta_crypto_out[i]);
+}
+
+/*
+ * CCMP DECRYPTION
+ * - enqueue the packets first to last - 1 of the burst for decryption
+ * - the stations stay referenced until their ops are dequeued
+ */
+static inline void
+ap_tunnel_crypto_enqueue(struct uplink_ctx *ctx,
+                         struct pkt_buffer *pkts_crypto_in,
+                         struct rwpa_meta **meta_crypto_in,
+                         uint16_t first,
+                         uint16_t last,
+                         uint8_t crypto_enq_success[])
+{
+    uint16_t nb = last - first;
+    uint16_t nb_crypto_enq;
+
+    if (nb == 0)
+        return;
 
     /*
-     * process the EAPOL packets
+     * in async mode, make room on the crypto qp for these packets by
+     * completing some of the ops already in flight
      */
-    eapols_process(&eapols);
+    while (unlikely(ctx->crypto_async &&
+                    ctx->nb_crypto_inflight + nb > CCMP_MAX_INFLIGHT_OPS))
+        ap_tunnel_crypto_completions_process(ctx);
+
+    nb_crypto_enq = CCMP_BURST_ENQUEUE(&(pkts_crypto_in->buffer[first]), nb,
+                                       &meta_crypto_in[first], CCMP_OP_DECRYPT,
+                                       &ctx->crypto_chan,
+                                       &crypto_enq_success[first]);
+
+    ctx->nb_crypto_inflight += nb_crypto_enq;
+
+    if (unlikely(nb_crypto_enq < nb))
+        UL_DATA_DROP_STAT_INC(STATS_UL_DROPS_TYPE_DECRYPTION_ERROR,
+                              (nb - nb_crypto_enq));
 }
 #endif
 
 static void
-ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
+ap_tunnel_packets_process(struct uplink_ctx *ctx, struct pkt_buffer *pkts_in, uint64_t cur_tsc)
 {
-    unsigned i, j, k;
+    unsigned i, j;
+    uint8_t rd;
     struct rte_mbuf *m;
     struct rwpa_meta meta[MAX_PKT_BURST] = {0};
     struct ether_addr *sta_addrs[MAX_PKT_BURST];
+    uint16_t sta_pkts[MAX_PKT_BURST];
     uint32_t nb_sta_addrs = 0;
+    uint32_t now;
     int32_t found[MAX_PKT_BURST];
 #ifndef RWPA_NO_CRYPTO
     struct pkt_buffer pkts_crypto_in __rte_cache_aligned;
-    struct pkt_buffer pkts_crypto_out __rte_cache_aligned;
     struct rwpa_meta *meta_crypto_in[MAX_PKT_BURST] = {0};
-    uint16_t nb_crypto_enq, nb_crypto_deq;
-    uint16_t  nb_crypto_deq_success, nb_crypto_deq_success_acc;
+    uint16_t crypto_pos[MAX_PKT_BURST];
+    uint16_t crypto_first = 0;
     uint8_t crypto_enq_success[MAX_PKT_BURST] = {0};
-    uint8_t crypto_deq_success[MAX_PKT_BURST] = {0};
 
     pkts_crypto_in.len = 0;
-    pkts_crypto_out.len = 0;
-#else
-    UNUSED(k);
 #endif
 
     /*
      * RX HEADERS DECAPSULATION
+     * - the headers are prefetched PREFETCH_OFFSET packets ahead
      */
+    for (i = 0; i < PREFETCH_OFFSET && i < pkts_in->len; i++)
+        rte_prefetch0(rte_pktmbuf_mtod(pkts_in->buffer[i], void *));
+
     for (i = 0; i < pkts_in->len; i++) {
         m = pkts_in->buffer[i];
-        rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+        if (i + PREFETCH_OFFSET < pkts_in->len)
+            rte_prefetch0(rte_pktmbuf_mtod(pkts_in->buffer[i + PREFETCH_OFFSET],
+                                           void *));
 
         /*
          * AP TUNNEL DECAP
@@ -670,7 +891,16 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
                      */
                     IEEE80211_PACKET_PARSE(m, &meta[i]);
 
+                    /* the KeyID of an encrypted packet selects its PTK */
+                    if (meta[i].wep) {
+                        struct ccmp_hdr *ccmp_hdr =
+                            rte_pktmbuf_mtod_offset(m, struct ccmp_hdr *,
+                                                    meta[i].wifi_hdr_sz);
+                        meta[i].key_id = ccmp_hdr->key_id.le.key_id;
+                    }
+
                     /* get the source station address for the store lookup */
+                    sta_pkts[nb_sta_addrs] = i;
                     sta_addrs[nb_sta_addrs++] = meta[i].p_sta_addr;
                 }
             }
@@ -680,28 +910,56 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
     /*
      * STORE LOOKUP
      * - search the store for each of the stations
+     * - the stations found stay valid until the end of the read
+     *   section, or while referenced by their crypto ops
      */
+    rd = store_read_lock();
+    now = store_tick_get();
     STORE_STA_BULK_LOOKUP(sta_addrs, nb_sta_addrs, found);
 
+    /*
+     * the stations are prefetched PREFETCH_STA_OFFSET packets ahead,
+     * and their PTKs and vAPs one packet ahead, once the station's
+     * first line is in
+     */
+    for (j = 0; j < PREFETCH_STA_OFFSET && j < nb_sta_addrs; j++)
+        if (found[j] >= 0)
+            sta_prefetch(store_sta_get(found[j]));
+
     for (i = 0, j = 0; i < pkts_in->len; i++) {
         m = pkts_in->buffer[i];
 
         if (likely(m != NULL && j < nb_sta_addrs)) {
-            rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+            if (j + PREFETCH_STA_OFFSET < nb_sta_addrs &&
+                found[j + PREFETCH_STA_OFFSET] >= 0)
+                sta_prefetch(store_sta_get(found[j + PREFETCH_STA_OFFSET]));
+
+            if (j + 1 < nb_sta_addrs && found[j + 1] >= 0) {
+                struct rwpa_meta *next = &meta[sta_pkts[j + 1]];
+
+                sta_decrypt_data_prefetch(store_sta_get(found[j + 1]),
+                                          next->key_id,
+                                          (next->has_qc ? next->p_qc->le.tid : 0));
+            }
 
             if (found[j] >= 0) {
                 /*
                  * STATION FOUND
                  */
                 uint8_t tid = (meta[i].has_qc ? meta[i].p_qc->le.tid : 0);
+                struct ccmp_hdr *ccmp_hdr =
+                    rte_pktmbuf_mtod_offset(m, struct ccmp_hdr *,
+                                            meta[i].wifi_hdr_sz);
 
-                /* get the station and lock it */
+                /* get the station, reference it and mark it seen */
                 meta[i].sta = store_sta_get(found[j]);
-                STA_READ_LOCK(meta[i].sta);
+                STA_REF_GET(&meta[i], rd);
+                sta_seen(meta[i].sta, now);
 
                 /* get the PTK SA, PTK's decrypt counter and parent vAP */
-                STA_DECRYPT_DATA_GET(meta[i].sta, tid, &(meta[i].sa),
-                                     &(meta[i].counter), &(meta[i].vap));
+                STA_DECRYPT_DATA_GET(meta[i].sta, meta[i].key_id, tid,
+                                     &(meta[i].sa), &(meta[i].counter),
+                                     &(meta[i].vap));
 
 #ifndef RWPA_DYNAMIC_AP_CONF_UPDATE_OFF
                 /* save the vAP's tunnel mac, ip and port */
@@ -724,14 +982,9 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
                         /*
                          * REPLAY DETECTION
                          */
-                        struct ccmp_hdr *ccmp_hdr =
-                            rte_pktmbuf_mtod_offset(m,
-                                                    struct ccmp_hdr *,
-                                                    meta[i].wifi_hdr_sz);
-
                         if (unlikely(CCMP_REPLAY_DETECT(
                                          ccmp_hdr, &(meta[i].counter)) == RWPA_STS_ERR)) {
-                            STA_READ_UNLOCK(meta[i].sta);
+                            STA_REF_PUT(&meta[i]);
                             DATA_LOG_AND_DROP(pkts_in->buffer[i], ERR, RWPA_UL,
                                               "Replay detected, dropping\n",
                                               STATS_UL_DROPS_TYPE_REPLAY_DETECTED);
@@ -739,12 +992,15 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
                             /*
                              * save the CCMP header PN to the store for next
                              * replay check
-                             * NOTE: this function writes to the ptk_decrypt_ctr of
-                             * the station, but the read lock has only been taken
-                             * - this is ok as this is the only 'read' thread which
-                             *   will be touching this counter
+                             * NOTE: this function writes to the PTK decrypt counter of
+                             * the station, which is not write locked
+                             * - this is ok as all of a station's packets are
+                             *   received by the same uplink thread (see the RSS
+                             *   and dispatch thread setup), so it is the only
+                             *   'read' thread which will be touching this counter
                              */
-                            STA_PTK_DECRYPT_COUNTER_SET(meta[i].sta, tid, meta[i].counter);
+                            STA_PTK_DECRYPT_COUNTER_SET(meta[i].sta, meta[i].key_id,
+                                                        tid, meta[i].counter);
 
 #ifndef RWPA_NO_CRYPTO
                             /*
@@ -761,7 +1017,7 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
                          * NO KEY
                          * - drop the packet
                          */
-                        STA_READ_UNLOCK(meta[i].sta);
+                        STA_REF_PUT(&meta[i]);
                         DATA_LOG_AND_DROP(pkts_in->buffer[i], ERR, RWPA_UL,
                                           "No key set for station, dropping\n",
                                           STATS_UL_DROPS_TYPE_NO_STATION_KEY);
@@ -769,9 +1025,14 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
                 } else {
                     /*
                      * NOT ENCRYPTED
-                     * - just unlock the station
+                     * - just drop the reference on the station
+                     * - note how many encrypted packets are ahead of
+                     *   it in the burst
                      */
-                    STA_READ_UNLOCK(meta[i].sta);
+                    STA_REF_PUT(&meta[i]);
+#ifndef RWPA_NO_CRYPTO
+                    crypto_pos[i] = pkts_crypto_in.len;
+#endif
                 }
             } else {
                 /*
@@ -789,172 +1050,85 @@ ap_tunnel_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
 #ifndef RWPA_NO_CRYPTO
     /*
      * CCMP DECRYPTION
-     * - enqueue packets for decryption
+     * - the encrypted packets are enqueued in order, up to each packet
+     *   which was not encrypted
+     * - that packet is only finished once all the ops in flight have
+     *   been completed, in async mode too, so that a station's
+     *   cleartext frames (e.g. EAPOL) stay in order with its encrypted
+     *   ones
+     * - packets which were not encrypted are rare, so this seldom
+     *   drains the ops in flight
      */
-    nb_crypto_enq = CCMP_BURST_ENQUEUE(pkts_crypto_in.buffer, pkts_crypto_in.len,
-                                       meta_crypto_in, CCMP_OP_DECRYPT,
-                                       tp_uplink->crypto_qp, crypto_enq_success);
-
-    /*
-     * dequeue packets from crypto devices
-     * - the same number of packets that were enqueued must be dequeued
-     */
-    nb_crypto_deq_success_acc = 0;
-    do {
-        nb_crypto_deq_success = 0;
-        nb_crypto_deq = CCMP_BURST_DEQUEUE((pkts_crypto_out.buffer + pkts_crypto_out.len),
-                                           (nb_crypto_enq - pkts_crypto_out.len),
-                                           tp_uplink->crypto_qp, &nb_crypto_deq_success,
-                                           (crypto_deq_success + pkts_crypto_out.len));
-
-        pkts_crypto_out.len += nb_crypto_deq;
-        nb_crypto_deq_success_acc += nb_crypto_deq_success;
-    } while ((!force_quit) && (pkts_crypto_out.len < nb_crypto_enq));
-
-    CCMP_BURST_DEQUEUE_STATS(nb_crypto_enq, nb_crypto_deq_success_acc);
+    for (i = 0; i < pkts_in->len; i++) {
+        if (likely(pkts_in->buffer[i] == NULL || meta[i].wep))
+            continue;
 
-    /*
-     * CRYPTO TIDYUP
-     */
+        ap_tunnel_crypto_enqueue(ctx, &pkts_crypto_in, meta_crypto_in,
+                                 crypto_first, crypto_pos[i],
+                                 crypto_enq_success);
+        crypto_first = crypto_pos[i];
 
-    /* log error for any failed crypto ops */
-    if (unlikely(nb_crypto_deq_success_acc < pkts_crypto_in.len)) {
-        UL_DATA_DROP_STAT_INC(STATS_UL_DROPS_TYPE_DECRYPTION_ERROR,
-                              (pkts_crypto_in.len - nb_crypto_deq_success_acc));
+        while (ctx->nb_crypto_inflight > 0)
+            ap_tunnel_crypto_completions_process(ctx);
 
-#ifdef RWPA_EXTRA_DEBUG
-        RTE_LOG(ERR, RWPA_UL,
-            "CCMP decryption failed for %d out of %d "
-            "packets, dropping\n",
-            (pkts_crypto_in.len - nb_crypto_deq_success_acc),
-            pkts_crypto_in.len);
-#endif
+        ap_tunnel_packet_post_crypto_process(ctx, pkts_in->buffer[i],
+                                             &meta[i]);
+        pkts_in->buffer[i] = NULL;
     }
+
+    ap_tunnel_crypto_enqueue(ctx, &pkts_crypto_in, meta_crypto_in,
+                             crypto_first, pkts_crypto_in.len,
+                             crypto_enq_success);
 #endif
 
-    /* unlock station and free mbuf for any failed crypto ops */
-    for (i = 0, j = 0, k = 0; i < pkts_in->len; i++) {
+    /*
+     * the encrypted packets now belong to their crypto ops
+     * - drop the station reference and free mbuf for any ops not enqueued
+     */
+    for (i = 0, j = 0; i < pkts_in->len; i++) {
         if (likely(pkts_in->buffer[i] != NULL &&
                    meta[i].wep)) {
-
-            STA_READ_UNLOCK(meta[i].sta);
-
 #ifndef RWPA_NO_CRYPTO
-            if (unlikely(j < pkts_crypto_in.len &&
-                         crypto_enq_success[j++] == FALSE)) {
-                DROP(pkts_in->buffer[i]);
-            } else if (unlikely(k < nb_crypto_enq &&
-                                crypto_deq_success[k++] == FALSE)) {
+            if (unlikely(crypto_enq_success[j++] == FALSE)) {
+                STA_REF_PUT(&meta[i]);
                 DROP(pkts_in->buffer[i]);
+            } else {
+                pkts_in->buffer[i] = NULL;
             }
+#else
+            STA_REF_PUT(&meta[i]);
 #endif
         }
     }
 
+#ifdef RWPA_NO_CRYPTO
     /*
-     * POST CRYPTO PROCESSING
+     * finish processing the packets, in order, as they are not
+     * decrypted
      */
-    for (i = 0, j = 0; i < pkts_in->len; i++) {
-        m = pkts_in->buffer[i];
-
-        if (likely(m != NULL)) {
-            rte_prefetch0(rte_pktmbuf_mtod(m, void *));
-
-            /*
-             * 802.11 PACKET CLASSIFICATION
-             */
-            enum ieee80211_pkt_type pkt_type =
-                IEEE80211_PACKET_CLASSIFY(m, &meta[i]);
-
-            if (likely(pkt_type == IEEE80211_PKT_TYPE_DATA)) {
-                /* DATA */
-
-                /*
-                 * IEEE802.11 -> ETHERNET CONVERSION
-                 * - handles CCMP decap
-                 */
-                if (unlikely(IEEE80211_TO_ETHER_CONVERT(
-                                 m, &meta[i]) != RWPA_STS_OK)) {
-                    DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                      "Error converting packet to Ethernet, dropping\n",
-                                      STATS_UL_DROPS_TYPE_ETH_CONVERT_ERROR);
-
-                /*
-                 * GRE ENCAP
-                 * - add the outer Ethernet, IP and GRE headers
-                 * - only if sending to a WAG
-                 */
-                } else if (unlikely(g_app->misc_params.no_wag == FALSE &&
-                                    GRE_ENCAP(m, addr_params->vnfd_ip_to_wag,
-                                              vnfd_eth_addr_to_wag,
-                                              addr_params->wag_tun_ip,
-                                              &(addr_params->wag_tun_mac)) != RWPA_STS_OK)) {
-                    DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                      "Error adding GRE headers, dropping\n",
-                                      STATS_UL_DROPS_TYPE_DATA_PACKET_ENCAP_ERROR);
-
-                /*
-                 * WRITE TO TX BUFFER
-                 */
-                } else {
-                    RTE_ETH_TX_BUFFER(dst_ports[UL_DST_PORT_WAG].port_id,
-                                      dst_ports[UL_DST_PORT_WAG].queue_id,
-                                      dst_ports[UL_DST_PORT_WAG].tx_buffer, m);
-                }
-
-            }  else if (pkt_type == IEEE80211_PKT_TYPE_EAPOL) {
-                /* EAPOL */
-
-                /*
-                 * CCMP DECAP
-                 * - remove the CCMP header and MIC
-                 */
-                if (meta[i].wep &&
-                    CCMP_DECAP(m, &meta[i]) == RWPA_STS_ERR) {
-                    DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                      "Error removing CCMP header, dropping\n",
-                                      STATS_UL_DROPS_TYPE_PACKET_DECAP_ERROR);
+    for (i = 0; i < pkts_in->len; i++) {
+        if (likely(pkts_in->buffer[i] != NULL))
+            ap_tunnel_packet_post_crypto_process(ctx, pkts_in->buffer[i],
+                                                 &meta[i]);
+    }
+#endif
 
-                /*
-                 * WPAPT_CDI_MSG_FRAME ENCAP
-                 * - add the wpapt_cdi_msg_frame encapsulation
-                 */
-                } else if (unlikely(WPAPT_CDI_FRAME_ENCAP(
-                                      m, &meta[i], m->data_len) != RWPA_STS_OK)) {
-                    DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                      "Error adding TLS message frame, dropping\n",
-                                      STATS_UL_DROPS_TYPE_CTRL_PACKET_ENCAP_ERROR);
+    store_read_unlock(rd);
 
-                /*
-                 * WPAPT_CDI_MSG_HEADER ENCAP
-                 * -add the wpapt_cdi_msg_header
-                 */
-                } else if (unlikely(WPAPT_CDI_HDR_ENCAP(
-                                        m, WPAPT_CDI_MSG_FRAME, m->data_len) != RWPA_STS_OK)) {
-                    DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                 "Error adding TLS message header, dropping\n",
-                                 STATS_UL_DROPS_TYPE_CTRL_PACKET_ENCAP_ERROR);
-
-                /*
-                 * WRITE TO TLS SOCKET
-                 */
-                } else {
-#ifndef RWPA_UL_NO_TLS_POLLING
-                    TLS_SOCKET_WRITE(tls, m);
+#ifndef RWPA_NO_CRYPTO
+    /*
+     * in sync mode, wait for all the ops to be dequeued
+     * - in async mode they are dequeued on the next loop iterations
+     *   instead, while the next bursts are being received
+     */
+    while (!ctx->crypto_async &&
+           ctx->nb_crypto_inflight > 0)
+        ap_tunnel_crypto_completions_process(ctx);
 #endif
-                }
-            } else {
-                /* Something Else */
-                DATA_LOG_AND_DROP(m, ERR, RWPA_UL,
-                                  "Could not classify 802.11 packet, dropping\n",
-                                  STATS_UL_DROPS_TYPE_UNEXPECTED_PACKET_TYPE);
-            }
-        }
-    }
 }
 
 static void
-uplink_pmd_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
+uplink_pmd_packets_process(struct uplink_ctx *ctx, struct pkt_buffer *pkts_in, uint64_t cur_tsc)
 {
     unsigned i;
     struct rte_mbuf *m;
@@ -971,10 +1145,10 @@ uplink_pmd_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
              * ARP
              */
             case OUTER_PKT_TYPE_ARP:
-                if (arp_reply(m, dst_ports[UL_DST_PORT_AP].port_id, addr_params->vnfd_ip_to_ap))
-			rte_eth_tx_buffer(dst_ports[UL_DST_PORT_AP].port_id,
-					  dst_ports[UL_DST_PORT_AP].queue_id,
-					  dst_ports[UL_DST_PORT_AP].tx_buffer, m);
+                if (arp_reply(m, ctx->dst_ports[UL_DST_PORT_AP].port_id, addr_params->vnfd_ip_to_ap))
+			rte_eth_tx_buffer(ctx->dst_ports[UL_DST_PORT_AP].port_id,
+					  ctx->dst_ports[UL_DST_PORT_AP].queue_id,
+					  ctx->dst_ports[UL_DST_PORT_AP].tx_buffer, m);
                 break;
 
             /*
@@ -1034,21 +1208,40 @@ uplink_pmd_packets_process(struct pkt_buffer *pkts_in, uint64_t cur_tsc)
     /*
      * process the AP tunnel encapsulated packets
      */
-    ap_tunnel_packets_process(&pkts_ap_tunnel, cur_tsc);
+    ap_tunnel_packets_process(ctx, &pkts_ap_tunnel, cur_tsc);
 }
 
 static void
-pmd_dequeue(uint64_t cur_tsc)
+pmd_dequeue(void *arg, uint64_t cur_tsc)
 {
+    struct uplink_ctx *ctx = (struct uplink_ctx *)arg;
     struct pkt_buffer pkts_in __rte_cache_aligned;
 
-    pkts_in.len = RTE_ETH_RX_BURST(src_ports[UL_SRC_PORT].port_id, 0,
-                                   pkts_in.buffer, MAX_PKT_BURST);
+#ifndef RWPA_NO_CRYPTO
+    /*
+     * complete the crypto ops of previous bursts
+     */
+    if (ctx->crypto_async)
+        ap_tunnel_crypto_completions_process(ctx);
+#endif
+
+    /*
+     * read from the RXQ, or from the SWQ when a dispatch thread
+     * is steering the packets to this thread
+     */
+    if (ctx->src_ports[UL_SRC_PORT].ring != NULL)
+        pkts_in.len = rte_ring_sc_dequeue_burst(ctx->src_ports[UL_SRC_PORT].ring,
+                                                (void **)pkts_in.buffer,
+                                                MAX_PKT_BURST, NULL);
+    else
+        pkts_in.len = RTE_ETH_RX_BURST(ctx->src_ports[UL_SRC_PORT].port_id,
+                                       ctx->src_ports[UL_SRC_PORT].queue_id,
+                                       pkts_in.buffer, MAX_PKT_BURST);
 
     if (likely(pkts_in.len)) {
         UL_DATA_PMD_READ_STAT_INC(STATS_PMD_READS_TYPE_NON_EMPTY, 1);
         UL_PROCESS_FULL_CYCLE_CAPTURE_START;
-        uplink_pmd_packets_process(&pkts_in, cur_tsc);
+        uplink_pmd_packets_process(ctx, &pkts_in, cur_tsc);
         UL_PROCESS_FULL_CYCLE_CAPTURE_STOP;
     } else {
         UL_DATA_PMD_READ_STAT_INC(STATS_PMD_READS_TYPE_EMPTY, 1);
@@ -1056,11 +1249,11 @@ pmd_dequeue(uint64_t cur_tsc)
 }
 
 static void
-uplink_main_loop(void)
+uplink_main_loop(struct uplink_ctx *ctx)
 {
 #ifndef RWPA_UL_NO_TLS_POLLING
     unsigned wrr_index = 0;
-    struct poll_wrr_elem *cur_wrr = wrr_elements[wrr_index];
+    struct poll_wrr_elem *cur_wrr = &(ctx->wrr_elements[wrr_index]);
     uint64_t cur_wrr_tsc, prev_wrr_tsc;
 #endif
     uint64_t prev_tsc, diff_tsc, cur_tsc;
@@ -1081,9 +1274,9 @@ uplink_main_loop(void)
         diff_tsc = cur_tsc - prev_tsc;
         if (unlikely(diff_tsc > drain_tsc)) {
             for (int i = 0; i < UL_NUM_DST_PORTS; i++)
-                rte_eth_tx_buffer_flush(dst_ports[i].port_id,
-                                        dst_ports[i].queue_id,
-                                        dst_ports[i].tx_buffer);
+                rte_eth_tx_buffer_flush(ctx->dst_ports[i].port_id,
+                                        ctx->dst_ports[i].queue_id,
+                                        ctx->dst_ports[i].tx_buffer);
             prev_tsc = cur_tsc;
         }
 
@@ -1094,26 +1287,42 @@ uplink_main_loop(void)
         cur_wrr_tsc = rte_rdtsc();
         diff_tsc = cur_wrr_tsc - prev_wrr_tsc;
         if (unlikely(diff_tsc > cur_wrr->allocated_tsc)) {
-            if (wrr_index < (MAX_UL_WRR_ELEMS - 1)) {
+            if (wrr_index < (ctx->nb_wrr_elements - 1)) {
                 wrr_index++;
             } else {
                 wrr_index = 0;
             }
-            cur_wrr = wrr_elements[wrr_index];
+            cur_wrr = &(ctx->wrr_elements[wrr_index]);
             prev_wrr_tsc = cur_wrr_tsc;
         }
 
-        cur_wrr->p_func(cur_wrr_tsc);
+        cur_wrr->p_func(ctx, cur_wrr_tsc);
 #else
-        pmd_dequeue(cur_tsc);
+        pmd_dequeue(ctx, cur_tsc);
 #endif
         vap_frag_free_death_row();
     }
+
+#ifndef RWPA_NO_CRYPTO
+    /*
+     * complete the ops still in flight in async mode
+     * - they hold mbufs and station references, which have to be
+     *   released before the store is synchronized and freed
+     */
+    while (ctx->nb_crypto_inflight > 0)
+        ap_tunnel_crypto_completions_process(ctx);
+#endif
+
+    for (int i = 0; i < UL_NUM_DST_PORTS; i++)
+        rte_eth_tx_buffer_flush(ctx->dst_ports[i].port_id,
+                                ctx->dst_ports[i].queue_id,
+                                ctx->dst_ports[i].tx_buffer);
 }
 
 static int
-thread_uplink_run(__rte_unused void *arg)
+thread_uplink_run(void *arg)
 {
+    struct uplink_ctx *ctx = (struct uplink_ctx *)arg;
     unsigned lcore_id, socket_id;
 
     lcore_id = rte_lcore_id();
@@ -1121,16 +1330,17 @@ thread_uplink_run(__rte_unused void *arg)
 
     RTE_LOG(INFO, RWPA_UL,
             "%s (%s): Entering main loop on lcore %u (socket %u)\n",
-            tp_uplink->name, tp_uplink->type, lcore_id, socket_id);
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
 
-    uplink_main_loop();
+    uplink_main_loop(ctx);
 
     return 0;
 }
 
 static int
-thread_uplink_free(__rte_unused void *arg)
+thread_uplink_free(void *arg)
 {
+    struct uplink_ctx *ctx = (struct uplink_ctx *)arg;
     unsigned lcore_id, socket_id;
 
     lcore_id = rte_lcore_id();
@@ -1138,9 +1348,9 @@ thread_uplink_free(__rte_unused void *arg)
 
     RTE_LOG(INFO, RWPA_UL,
             "%s (%s): Freeing on lcore %u (socket %u)\n",
-            tp_uplink->name, tp_uplink->type, lcore_id, socket_id);
+            ctx->tp->name, ctx->tp->type, lcore_id, socket_id);
 
-    tls_socket_free();
+    rte_free(ctx);
 
     return 0;
 }
@@ -1148,7 +1358,7 @@ thread_uplink_free(__rte_unused void *arg)
 uint8_t
 uplink_thread_src_port_get(void)
 {
-    return src_ports[UL_SRC_PORT].port_id;
+    return ul_src_port_id;
 }
 
 static struct thread_ops_s thread_uplink_ops = {
@@ -46,6 +46,8 @@
 #include "counter.h"
 #include "seq_num.h"
 #include "ap_config.h"
+#include "store.h"
+#include "sess_cache.h"
 
 #define _VAP_LOCK_T             rte_rwlock_t
 #define _VAP_LOCK_INIT(lock)    rte_rwlock_init(&(lock))
@@ -57,36 +59,55 @@
 /*
  * vAP
  */
+/*
+ * AAD length of the group frames encrypted with a GTK
+ * - group frames are sent as non-QoS data with 3 addresses
+ */
+#define VAP_GTK_AAD_LEN 22
+
+/*
+ * vAP
+ * - the tunnel addresses, read for every packet, come first, and the
+ *   raw GTKs and xforms are in the SAs' cold parts
+ * - current_gtk_index is the GTK used for TX, switched with a single
+ *   store once the other GTK is installed
+ */
 struct vap_elem {
     struct ether_addr address;
 
-    struct ccmp_sa gtk1_sa;
-    struct ccmp_sa gtk2_sa;
-
-    counter_t gtk1_encrypt_ctr;
-    counter_t gtk2_encrypt_ctr;
-
-    uint8_t current_gtk_index;
-
-    seq_num_t frag_seq_num;
-
     uint8_t tun_mac_set;
     struct ether_addr tun_mac;
     uint32_t tun_ip;
     uint16_t tun_port;
 
+    seq_num_t frag_seq_num;
+
+    volatile uint8_t current_gtk_index;
+
+    counter_t gtk1_encrypt_ctr;
+    counter_t gtk2_encrypt_ctr;
+
+    struct ccmp_sa gtk1_sa;
+    struct ccmp_sa gtk2_sa;
+
     _VAP_LOCK_T lock;
 } __rte_cache_aligned;
 
 /*
  * Init vAP
+ * - binds the GTK SAs to their cold parts, which the store allocates
+ *   separately from the vAP
  */
 static inline void
-vap_init(struct vap_elem *vap)
+vap_init(struct vap_elem *vap,
+         struct ccmp_sa_cold *gtk1_cold,
+         struct ccmp_sa_cold *gtk2_cold)
 {
     if (likely(vap != NULL)) {
         memset(&(vap->gtk1_sa), 0, sizeof(struct ccmp_sa));
         memset(&(vap->gtk2_sa), 0, sizeof(struct ccmp_sa));
+        ccmp_sa_bind(&(vap->gtk1_sa), gtk1_cold);
+        ccmp_sa_bind(&(vap->gtk2_sa), gtk2_cold);
         counter_set(&(vap->gtk1_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
         counter_set(&(vap->gtk2_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
         vap->current_gtk_index = 0;
@@ -248,35 +269,26 @@ vap_address_set(struct vap_elem *vap,
 }
 
 /*
- * Set GTK
+ * Select GTK SA
  */
-static inline void
-vap_gtk_set(struct vap_elem *vap,
-            uint8_t gtk_index,
-            const uint8_t *gtk,
-            const uint8_t gtk_len,
-            uint8_t set_current_idx)
+static inline struct ccmp_sa *
+vap_gtk_sa_select(struct vap_elem *vap, uint8_t gtk_idx)
 {
-    struct ccmp_sa *set_gtk_sa = NULL;
-
-    if (likely(vap != NULL && gtk != NULL)) {
-        if (gtk_index == GTK1) {
-            set_gtk_sa = &(vap->gtk1_sa);
-        } else if (gtk_index == GTK2) {
-            set_gtk_sa = &(vap->gtk2_sa);
-        }
+    struct ccmp_sa *sa;
 
-        if (likely(set_gtk_sa != NULL)) {
-            _VAP_WRITE_LOCK(vap->lock);
-            ccmp_sa_reset(set_gtk_sa);
-            ccmp_sa_init(gtk, gtk_len, set_gtk_sa);
-            counter_set(&(vap->gtk1_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
-            counter_set(&(vap->gtk2_encrypt_ctr), ENCRYPT_CTR_DEFAULT_VAL);
-            if (set_current_idx)
-                vap->current_gtk_index = gtk_index;
-            _VAP_WRITE_UNLOCK(vap->lock);
-        }
+    switch(gtk_idx) {
+        case GTK1:
+            sa = &(vap->gtk1_sa);
+            break;
+        case GTK2:
+            sa = &(vap->gtk2_sa);
+            break;
+        default:
+            sa = NULL;
+            break;
     }
+
+    return sa;
 }
 
 /*
@@ -302,6 +314,94 @@ vap_gtk_counter_select(struct vap_elem *vap, uint8_t gtk_idx)
     return ctr;
 }
 
+/*
+ * Set GTK
+ * - installs the GTK in its slot, leaving the GTK of the other slot,
+ *   and its encrypt counter, untouched for TX or RX
+ * - the encrypt session of the new GTK is built outside of the vAP
+ *   lock, before TX is switched to it, if set_current_idx, with a
+ *   single store of the index
+ */
+static inline enum rwpa_status
+vap_gtk_set(struct vap_elem *vap,
+            uint8_t gtk_index,
+            const uint8_t *gtk,
+            const uint8_t gtk_len,
+            enum ccmp_cipher cipher,
+            uint8_t set_current_idx)
+{
+    struct ccmp_sa *set_gtk_sa;
+    struct sess_cache_entry *sess;
+    enum rwpa_status sts;
+
+    if (unlikely(vap == NULL || gtk == NULL))
+        return RWPA_STS_ERR;
+
+    set_gtk_sa = vap_gtk_sa_select(vap, gtk_index);
+    if (unlikely(set_gtk_sa == NULL))
+        return RWPA_STS_ERR;
+
+    _VAP_WRITE_LOCK(vap->lock);
+
+    /* replacing a key, wait for its packets in flight */
+    if (set_gtk_sa->tk_len != 0) {
+        set_gtk_sa->tk_len = 0;
+        rte_smp_wmb();
+        store_synchronize();
+    }
+
+    ccmp_sa_reset(set_gtk_sa);
+    counter_set(vap_gtk_counter_select(vap, gtk_index),
+                ENCRYPT_CTR_DEFAULT_VAL);
+
+    /* publishes the new key */
+    sts = ccmp_sa_init(gtk, gtk_len, cipher, set_gtk_sa);
+    _VAP_WRITE_UNLOCK(vap->lock);
+
+    if (unlikely(sts != RWPA_STS_OK))
+        return sts;
+
+    sess = ccmp_sa_session_select(set_gtk_sa, CCMP_OP_ENCRYPT,
+                                  VAP_GTK_AAD_LEN);
+    sess_cache_put(sess);
+
+    if (set_current_idx) {
+        rte_smp_wmb();
+        vap->current_gtk_index = gtk_index;
+    }
+
+    return RWPA_STS_OK;
+}
+
+/*
+ * Retire GTK
+ * - removes a GTK no longer used for RX, the GTK used for TX can only
+ *   be replaced
+ */
+static inline enum rwpa_status
+vap_gtk_retire(struct vap_elem *vap, uint8_t gtk_index)
+{
+    struct ccmp_sa *sa;
+
+    if (unlikely(vap == NULL))
+        return RWPA_STS_ERR;
+
+    sa = vap_gtk_sa_select(vap, gtk_index);
+    if (unlikely(sa == NULL || gtk_index == vap->current_gtk_index))
+        return RWPA_STS_ERR;
+
+    _VAP_WRITE_LOCK(vap->lock);
+    if (sa->tk_len != 0) {
+        sa->tk_len = 0;
+        rte_smp_wmb();
+        store_synchronize();
+        ccmp_sa_reset(sa);
+    }
+    _VAP_WRITE_UNLOCK(vap->lock);
+
+    return RWPA_STS_OK;
+}
+
 /*
  * Get Current GTK Counter
  */
@@ -320,6 +420,36 @@ vap_current_gtk_counter_get(struct vap_elem *vap)
     return val;
 }
 
+/*
+ * Get Current GTK Encrypt Data
+ * - reads the TX index once, so a concurrent switch gives either the
+ *   old or the new GTK with its own counter, never a mix
+ * - sa is set to NULL if no GTK is installed for TX
+ */
+static inline void
+vap_gtk_encrypt_data_get(struct vap_elem *vap,
+                         struct ccmp_sa **sa,
+                         counter_val_t *ctr,
+                         uint8_t *gtk_idx)
+{
+    uint8_t idx;
+
+    if (likely(vap != NULL && sa != NULL && ctr != NULL &&
+               gtk_idx != NULL)) {
+        idx = vap->current_gtk_index;
+        rte_smp_rmb();
+
+        *sa = vap_gtk_sa_select(vap, idx);
+        if (unlikely(*sa == NULL || (*sa)->tk_len == 0)) {
+            *sa = NULL;
+            return;
+        }
+
+        *ctr = counter_increment(vap_gtk_counter_select(vap, idx));
+        *gtk_idx = idx;
+    }
+}
+
 /*
  * Get GTK1 Encrypt Data
  * - read lock must be taken before calling this function
@@ -40,6 +40,7 @@
 #include <rte_branch_prediction.h>
 #include <rte_common.h>
 #include <rte_cycles.h>
+#include <rte_lcore.h>
 #include <rte_mbuf.h>
 #include <rte_ip.h>
 #include <rte_ip_frag.h>
@@ -59,18 +60,22 @@
 
 #define MAX_VAP_FRAG_SZ_MULTIPLE  8
 
-static struct rte_ip_frag_tbl *frag_tbl;
-static struct rte_ip_frag_death_row death_row;
+/*
+ * reassembly tables are not thread safe, so each uplink lcore gets
+ * its own table and death row
+ * - all fragments of a packet must be received on the same lcore
+ */
+static struct rte_ip_frag_tbl *frag_tbl[RTE_MAX_LCORE];
+static struct rte_ip_frag_death_row death_row[RTE_MAX_LCORE];
 static uint32_t vap_frag_sz = 0;
+static uint32_t frag_max_stations = 0;
+static uint64_t frag_cycles = 0;
 
 void
 vap_frag_init(uint32_t max_stations,
               uint32_t frag_ttl_ms,
               uint32_t max_vap_frag_sz)
 {
-    uint64_t frag_cycles = (rte_get_tsc_hz() + MS_PER_S - 1) /
-                               MS_PER_S * frag_ttl_ms;
-
     /*
      * check max vap fragment size is a multiple
      * of 8
@@ -80,23 +85,44 @@ vap_frag_init(uint32_t max_stations,
                  "of %d, exiting\n",
                  MAX_VAP_FRAG_SZ_MULTIPLE);
 
-    /* create the reassembly table */
-    frag_tbl = rte_ip_frag_table_create(
-                                max_stations, FRAG_TBL_BUCKET_ENTRIES,
-                                max_stations, frag_cycles, rte_socket_id());
+    memset(frag_tbl, 0x0, sizeof(frag_tbl));
+    memset(death_row, 0x0, sizeof(death_row));
+
+    frag_cycles = (rte_get_tsc_hz() + MS_PER_S - 1) /
+                      MS_PER_S * frag_ttl_ms;
+    frag_max_stations = max_stations;
+    vap_frag_sz = max_vap_frag_sz;
+}
+
+void
+vap_frag_lcore_init(void)
+{
+    unsigned lcore_id = rte_lcore_id();
 
-    if (frag_tbl == NULL)
-        rte_exit(EXIT_FAILURE, "Error creating fragment table, exiting\n");
+    if (frag_tbl[lcore_id] != NULL)
+        return;
 
-    memset(&death_row, 0x0, sizeof(struct rte_ip_frag_death_row));
+    /* create the reassembly table for this lcore */
+    frag_tbl[lcore_id] = rte_ip_frag_table_create(
+                                frag_max_stations, FRAG_TBL_BUCKET_ENTRIES,
+                                frag_max_stations, frag_cycles, rte_socket_id());
 
-    vap_frag_sz = max_vap_frag_sz;
+    if (frag_tbl[lcore_id] == NULL)
+        rte_exit(EXIT_FAILURE, "Error creating fragment table on lcore %u, exiting\n",
+                 lcore_id);
 }
 
 void
 vap_frag_destroy(void)
 {
-    rte_ip_frag_table_destroy(frag_tbl);
+    unsigned i;
+
+    for (i = 0; i < RTE_MAX_LCORE; i++) {
+        if (frag_tbl[i] != NULL) {
+            rte_ip_frag_table_destroy(frag_tbl[i]);
+            frag_tbl[i] = NULL;
+        }
+    }
 }
 
 enum rwpa_status
@@ -152,6 +178,7 @@ vap_payload_reassemble(struct rte_mbuf *mi,
 {
     struct ipv4_hdr *ip_hdr;
     uint16_t frag_offs;
+    unsigned lcore_id = rte_lcore_id();
 
     /*
      * check parameters and prepend a 'dummy' IPv4
@@ -160,6 +187,7 @@ vap_payload_reassemble(struct rte_mbuf *mi,
     if (unlikely(mi == NULL ||
                  mo == NULL ||
                  meta == NULL ||
+                 frag_tbl[lcore_id] == NULL ||
                  (ip_hdr = (struct ipv4_hdr *)
                      rte_pktmbuf_prepend(mi, sizeof(struct ipv4_hdr))) == NULL))
         return RWPA_STS_ERR;
@@ -201,7 +229,8 @@ vap_payload_reassemble(struct rte_mbuf *mi,
 
     /* attempt to reassemble the packet */
     *mo = rte_ipv4_frag_reassemble_packet(
-                                frag_tbl, &death_row, mi, tms, ip_hdr);
+                                frag_tbl[lcore_id], &death_row[lcore_id],
+                                mi, tms, ip_hdr);
 
     /*
      * check if the packet is fully reassembled
@@ -217,5 +246,5 @@ vap_payload_reassemble(struct rte_mbuf *mi,
 void
 vap_frag_free_death_row(void)
 {
-     rte_ip_frag_free_death_row(&death_row, FRAG_DR_PREFETCH);
+     rte_ip_frag_free_death_row(&death_row[rte_lcore_id()], FRAG_DR_PREFETCH);
 }
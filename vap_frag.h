@@ -43,6 +43,13 @@ vap_frag_init(uint32_t max_stations,
               uint32_t frag_ttl_ms,
               uint32_t max_vap_frag_sz);
 
+/*
+ * Create the reassembly table for the calling lcore
+ * - must be called by each thread which reassembles packets
+ */
+void
+vap_frag_lcore_init(void);
+
 void
 vap_frag_destroy(void);
 
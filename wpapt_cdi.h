@@ -108,6 +108,11 @@ enum WPAPT_CIPHER_ALG {
 #define WPAPT_CDI_MSG_SET_KEY       7
 #define WPAPT_CDI_MSG_FRAME         8
 #define WPAPT_CDI_MSG_EAPOL_MIC     9
+#define WPAPT_CDI_MSG_BSS_ADD_BULK  10
+#define WPAPT_CDI_MSG_STA_ADD_BULK  11
+#define WPAPT_CDI_MSG_SET_KEY_BULK  12
+#define WPAPT_CDI_MSG_SET_PTK_RX    13
+#define WPAPT_CDI_MSG_SET_PTK_TX    14
 
 
 #pragma pack(push,1)
@@ -209,6 +214,8 @@ struct wpapt_cdi_msg_sta_add
  * Purpose:   A request to remove the given station from database.
  */
 
+#define WPAPT_CDI_STA_REMOVE_REASON_IDLE 1 /* DVNF: no frames received */
+
 struct wpapt_cdi_msg_sta_remove
 {
     uint8_t  bssid[WPAPT_ETH_ALEN];
@@ -230,7 +237,7 @@ struct wpapt_cdi_msg_set_key
     uint8_t  sta_addr[WPAPT_ETH_ALEN]; /* FF:FF:FF:FF:FF:FF for GTK */
     uint16_t key_idx;                  /* 0: PTK; 1,2: GTK; 3,4: IGTK */
     uint16_t cipher_suite;             /* enum WPAPT_CIPHER_ALG */
-    uint8_t  key_len;
+    uint8_t  key_len;                  /* 0 for a GTK: retire it */
     uint8_t  key[0];
 };
 
@@ -290,6 +297,85 @@ struct wpapt_cdi_msg_eapol_mic
     uint8_t     frame[0];   /* staring from .11 header */
 };
 
+/*               Message WPAPT_CDI_MSG_BSS_ADD_BULK
+ * ----------------------------------------------------------
+ * Direction: From CVNF to DVNF
+ * Purpose:   Same as WPAPT_CDI_MSG_BSS_ADD, for many CPEs at once, e.g.
+ *            when replaying the CPEs after a CVNF failover.
+ *
+ * Note: The ESSID is not carried, so that all the entries are the
+ *       same size.
+ */
+
+struct wpapt_cdi_msg_bss_add_bulk_entry
+{
+    uint8_t  bssid[WPAPT_ETH_ALEN];
+};
+
+struct wpapt_cdi_msg_bss_add_bulk
+{
+    uint16_t count;  /* Number of entries that follow */
+    struct wpapt_cdi_msg_bss_add_bulk_entry entries[0];
+};
+
+
+/*               Message WPAPT_CDI_MSG_STA_ADD_BULK
+ * ----------------------------------------------------------
+ * Direction: From CVNF to DVNF
+ * Purpose:   Same as WPAPT_CDI_MSG_STA_ADD, for many stations at once.
+ */
+
+struct wpapt_cdi_msg_sta_add_bulk
+{
+    uint16_t count;  /* Number of entries that follow */
+    struct wpapt_cdi_msg_sta_add entries[0];
+};
+
+
+/*               Message WPAPT_CDI_MSG_SET_KEY_BULK
+ * ----------------------------------------------------------
+ * Direction: From CVNF to DVNF
+ * Purpose:   Same as WPAPT_CDI_MSG_SET_KEY, for many keys at once.
+ *
+ * Note: The entries are struct wpapt_cdi_msg_set_key, each one followed
+ *       by its key_len bytes of key.
+ */
+
+struct wpapt_cdi_msg_set_key_bulk
+{
+    uint16_t count;  /* Number of entries that follow */
+    uint8_t  entries[0];
+};
+
+
+/*               Message WPAPT_CDI_MSG_SET_PTK_RX
+ * ----------------------------------------------------------
+ * Direction: From CVNF to DVNF
+ * Purpose:   To install a PTK with Extended Key ID (IEEE 802.11-2016
+ *            12.7.6), for receive only, so that a station can be rekeyed
+ *            without dropping the frames in flight.
+ *
+ * Note: The message is a struct wpapt_cdi_msg_set_key, with key_idx the
+ *       KeyID of the PTK (0 or 1). It cannot replace the PTK used for
+ *       transmit, unless the station has no PTK yet.
+ */
+
+
+/*               Message WPAPT_CDI_MSG_SET_PTK_TX
+ * ----------------------------------------------------------
+ * Direction: From CVNF to DVNF
+ * Purpose:   To switch transmit to a PTK installed with
+ *            WPAPT_CDI_MSG_SET_PTK_RX. The PTK used for transmit until
+ *            then stays valid for receive for ptk_rx_overlap_ms.
+ */
+
+struct wpapt_cdi_msg_set_ptk_tx
+{
+    uint8_t  bssid[WPAPT_ETH_ALEN];
+    uint8_t  sta_addr[WPAPT_ETH_ALEN];
+    uint16_t key_idx;                  /* KeyID of the PTK, 0 or 1 */
+};
+
 #pragma pack(pop)
 
 #endif /* WPAPT_CDI_H */